@@ -1,15 +1,23 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount,
+    bool packObjectData)
 {
     ThrowIfFailed(device->CreateCommandAllocator(
         D3D12_COMMAND_LIST_TYPE_DIRECT,
 		IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
   //  FrameCB = std::make_unique<UploadBuffer<FrameConstants>>(device, 1, true);
-    PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-    MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, !packObjectData);
+
+    // Size the first page so the initial scene fits without growing.
+    UINT objectByteSize = packObjectData ? sizeof(ObjectConstants) :
+        d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
+    UINT64 initialBytes =
+        (UINT64)passCount*d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants)) +
+        (UINT64)objectCount*objectByteSize;
+    UINT64 pageSize = LinearUploadAllocator::DefaultPageSize;
+    UploadAlloc = std::make_unique<LinearUploadAllocator>(device, MathHelper::Max(initialBytes, pageSize));
 }
 
 FrameResource::~FrameResource()
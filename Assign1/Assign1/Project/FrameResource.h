@@ -3,6 +3,7 @@
 #include "../../Common/d3dUtil.h"
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
+#include "../../Common/LinearUploadAllocator.h"
 
 struct ObjectConstants
 {
@@ -34,6 +35,14 @@ struct PassConstants
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
     // are spot lights for a maximum of MaxLights per object.
     Light Lights[MaxLights];
+
+    // Clustered light grid, see ClusteredLightCuller.  Point and spot lights that
+    // are not in Lights are found through the per-cluster light lists.
+    UINT ClusterCountX = 0;
+    UINT ClusterCountY = 0;
+    UINT ClusterCountZ = 0;
+    float ClusterDepthScale = 0.0f;
+    float ClusterDepthBias = 0.0f;
 };
 
 struct Vertex
@@ -48,7 +57,10 @@ struct FrameResource
 {
 public:
     
-    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
+    // With packObjectData the material constants are stored tightly packed for use
+    // as a structured buffer instead of in 256-byte constant buffer slots.
+    FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount,
+        bool packObjectData = false);
     FrameResource(const FrameResource& rhs) = delete;
     FrameResource& operator=(const FrameResource& rhs) = delete;
     ~FrameResource();
@@ -60,9 +72,12 @@ public:
     // We cannot update a cbuffer until the GPU is done processing the commands
     // that reference it.  So each frame needs their own cbuffers.
    // std::unique_ptr<UploadBuffer<FrameConstants>> FrameCB = nullptr;
-    std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
     std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
-    std::unique_ptr<UploadBuffer<ObjectConstants>> ObjectCB = nullptr;
+
+    // Transient per-frame data (pass and object constants, dynamic vertices,
+    // instance data) is sub-allocated from here every frame.  It is reset once
+    // Fence has completed, so the number of render items is not fixed at startup.
+    std::unique_ptr<LinearUploadAllocator> UploadAlloc = nullptr;
 
     // Fence value to mark commands up to this fence point.  This lets us
     // check if these frame resources are still in use by the GPU.
@@ -0,0 +1,21 @@
+#include "RenderItemPool.h"
+
+RenderItemPool::Handle RenderItemPool::Add(const RenderItem& item, RenderItemInfo&& info)
+{
+    Handle handle = mItems.Insert(RenderItem(item));
+    mItems[handle].ObjCBIndex = handle.Index;
+
+    mInfos.push_back(std::move(info));
+    return handle;
+}
+
+void RenderItemPool::Remove(Handle handle)
+{
+    // Mirror the slot map's swap with the last item.
+    const UINT index = mItems.IndexOf(handle);
+    if(index != mInfos.size() - 1)
+        mInfos[index] = std::move(mInfos.back());
+    mInfos.pop_back();
+
+    mItems.Remove(handle);
+}
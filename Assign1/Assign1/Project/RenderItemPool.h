@@ -0,0 +1,103 @@
+//***************************************************************************************
+// RenderItemPool.h
+//
+// Storage for the scene's render items, split by how often the data is read.  The
+// draw loop reads RenderItem, which only holds what a draw call needs.  Transforms,
+// bounds, dirty state and names live in RenderItemInfo, a parallel array read when
+// objects are updated and culled.  Both arrays stay dense and in the same order:
+// removing an item moves the last item into its place.  Handles stay valid across
+// removals, and an item's object constant slot is its handle's slot, so moving an
+// item in the arrays never moves its constants.
+//***************************************************************************************
+
+#pragma once
+
+#include "FrameResource.h"
+#include "../../Common/SlotMap.h"
+#include "../../Common/SceneGraph.h"
+
+// Data read for every draw.
+struct RenderItem
+{
+    SlotHandle Geo;
+    SlotHandle Mat;
+
+    // Index of this render item's element in the per-frame object constant block.
+    // Assigned by the pool.
+    UINT ObjCBIndex = -1;
+
+    // Primitive topology.
+    D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+    // DrawIndexedInstanced parameters.
+    UINT IndexCount = 0;
+    UINT StartIndexLocation = 0;
+    int BaseVertexLocation = 0;
+};
+
+// Data read when the item changes or is culled.
+struct RenderItemInfo
+{
+    // World matrix of the shape that describes the object's local space
+    // relative to the world space, which defines the position, orientation,
+    // and scale of the object in the world.
+    DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+
+    DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+
+    // Dirty flag indicating the object data has changed and we need to rebuild its constants.
+    // Object constants are cached on the CPU and copied into each frame's transient upload
+    // memory, so a single rebuild is enough; any value > 0 marks the item as dirty.
+    int NumFramesDirty = gNumFrameResources;
+
+    // Local space bounds of the submesh, used for visibility tests.
+    DirectX::BoundingBox Bounds;
+
+    // Solid boxes that hide what is behind them are rasterized by the occlusion culler.
+    bool Occluder = false;
+
+    // Scene graph node that World follows.
+    SceneGraph::NodeHandle Node = SceneGraph::InvalidNode;
+
+    std::string Name;
+};
+
+class RenderItemPool
+{
+public:
+    typedef SlotHandle Handle;
+
+    RenderItemPool() = default;
+    RenderItemPool(const RenderItemPool& rhs) = delete;
+    RenderItemPool& operator=(const RenderItemPool& rhs) = delete;
+
+    // Sets the item's ObjCBIndex.
+    Handle Add(const RenderItem& item, RenderItemInfo&& info);
+
+    // Moves the last item into the removed item's place.
+    void Remove(Handle handle);
+
+    bool IsValid(Handle handle)const { return mItems.IsValid(handle); }
+
+    UINT Size()const { return mItems.Size(); }
+
+    // Object constant slots in use are below ObjectCount.
+    UINT ObjectCount()const { return mItems.SlotCount(); }
+
+    // Position of an item in the dense arrays.  Positions change when items are removed.
+    UINT IndexOf(Handle handle)const { return mItems.IndexOf(handle); }
+    Handle HandleAt(UINT index)const { return mItems.HandleAt(index); }
+
+    // Dense arrays of Size() elements, in the same order.
+    RenderItem* Items() { return mItems.Data(); }
+    const RenderItem* Items()const { return mItems.Data(); }
+    RenderItemInfo* Infos() { return mInfos.data(); }
+    const RenderItemInfo* Infos()const { return mInfos.data(); }
+
+    RenderItem& GetItem(Handle handle) { return mItems[handle]; }
+    RenderItemInfo& GetInfo(Handle handle) { return mInfos[mItems.IndexOf(handle)]; }
+
+private:
+    SlotMap<RenderItem> mItems;
+    std::vector<RenderItemInfo> mInfos;
+};
@@ -20,11 +20,51 @@
 // Include structures and functions for lighting.
 #include "LightingUtil.hlsl"
 
+struct ObjectData
+{
+    float4x4 World;
+    float4x4 TexTransform;
+};
+
+struct MaterialData
+{
+    float4   DiffuseAlbedo;
+    float3   FresnelR0;
+    float    Roughness;
+    float4x4 MatTransform;
+};
+
+#ifdef PACKED_OBJECT_DATA
+
+// Indices of the object and material being drawn, set per draw as root constants.
+cbuffer cbDrawIndices : register(b0)
+{
+    uint gObjectIndex;
+    uint gMaterialIndex;
+};
+
+// Tightly packed per-object and per-material data for the whole pass.
+StructuredBuffer<ObjectData> gObjectData : register(t0);
+StructuredBuffer<MaterialData> gMaterialData : register(t1);
+
+ObjectData GetObjectData()
+{
+    return gObjectData[gObjectIndex];
+}
+
+MaterialData GetMaterialData()
+{
+    return gMaterialData[gMaterialIndex];
+}
+
+#else
+
 // Constant data that varies per frame.
 
 cbuffer cbPerObject : register(b0)
 {
     float4x4 gWorld;
+    float4x4 gTexTransform;
 };
 
 cbuffer cbMaterial : register(b1)
@@ -35,6 +75,26 @@ cbuffer cbMaterial : register(b1)
 	float4x4 gMatTransform;
 };
 
+ObjectData GetObjectData()
+{
+    ObjectData obj;
+    obj.World = gWorld;
+    obj.TexTransform = gTexTransform;
+    return obj;
+}
+
+MaterialData GetMaterialData()
+{
+    MaterialData mat;
+    mat.DiffuseAlbedo = gDiffuseAlbedo;
+    mat.FresnelR0 = gFresnelR0;
+    mat.Roughness = gRoughness;
+    mat.MatTransform = gMatTransform;
+    return mat;
+}
+
+#endif
+
 // Constant data that varies per material.
 cbuffer cbPass : register(b2)
 {
@@ -59,7 +119,55 @@ cbuffer cbPass : register(b2)
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
     // are spot lights for a maximum of MaxLights per object.
     Light gLights[MaxLights];
+
+    uint3 gClusterCount;
+    float gClusterDepthScale;
+    float gClusterDepthBias;
+};
+
+#ifdef CLUSTERED_LIGHTING
+
+// Matches ClusteredLightCuller::ClusterRange.
+struct ClusterRange
+{
+    uint Offset;
+    uint PointCount;
+    uint SpotCount;
 };
+
+// Point lights followed by spot lights, and the lights of each cluster as indices
+// into that array, point lights first.
+StructuredBuffer<Light> gClusterLights : register(t2);
+StructuredBuffer<ClusterRange> gClusterRanges : register(t3);
+StructuredBuffer<uint> gClusterLightIndices : register(t4);
+
+float3 ComputeClusteredLighting(Material mat, float2 screenPos, float3 pos, float3 normal, float3 toEye)
+{
+    // Find the cluster from the pixel position and the view depth.
+    float viewZ = mul(float4(pos, 1.0f), gView).z;
+    uint3 cluster;
+    cluster.xy = min(uint2(screenPos*gInvRenderTargetSize*gClusterCount.xy), gClusterCount.xy - 1);
+    cluster.z = min((uint)max(log(viewZ)*gClusterDepthScale + gClusterDepthBias, 0.0f), gClusterCount.z - 1);
+
+    ClusterRange range = gClusterRanges[cluster.x + gClusterCount.x*(cluster.y + gClusterCount.y*cluster.z)];
+
+    float3 result = 0.0f;
+
+    uint i = range.Offset;
+    for(; i < range.Offset + range.PointCount; ++i)
+    {
+        result += ComputePointLight(gClusterLights[gClusterLightIndices[i]], mat, pos, normal, toEye);
+    }
+
+    for(; i < range.Offset + range.PointCount + range.SpotCount; ++i)
+    {
+        result += ComputeSpotLight(gClusterLights[gClusterLightIndices[i]], mat, pos, normal, toEye);
+    }
+
+    return result;
+}
+
+#endif
  
 struct VertexIn
 {
@@ -77,13 +185,15 @@ struct VertexOut
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+    float4x4 world = GetObjectData().World;
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), world);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(vin.NormalL, (float3x3)world);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
@@ -93,6 +203,8 @@ VertexOut VS(VertexIn vin)
 
 float4 PS(VertexOut pin) : SV_Target
 {
+    MaterialData matData = GetMaterialData();
+
     // Interpolating normal can unnormalize it, so renormalize it.
     pin.NormalW = normalize(pin.NormalW);
 
@@ -100,18 +212,23 @@ float4 PS(VertexOut pin) : SV_Target
     float3 toEyeW = normalize(gEyePosW - pin.PosW);
 
 	// Indirect lighting.
-    float4 ambient = gAmbientLight*gDiffuseAlbedo;
+    float4 ambient = gAmbientLight*matData.DiffuseAlbedo;
 
-    const float shininess = 1.0f - gRoughness;
-    Material mat = { gDiffuseAlbedo, gFresnelR0, shininess };
+    const float shininess = 1.0f - matData.Roughness;
+    Material mat = { matData.DiffuseAlbedo, matData.FresnelR0, shininess };
     float3 shadowFactor = 1.0f;
     float4 directLight = ComputeLighting(gLights, mat, pin.PosW, 
         pin.NormalW, toEyeW, shadowFactor);
 
+#ifdef CLUSTERED_LIGHTING
+    directLight.rgb += ComputeClusteredLighting(mat, pin.PosH.xy, pin.PosW,
+        pin.NormalW, toEyeW);
+#endif
+
     float4 litColor = ambient + directLight;
 
     // Common convention to take alpha from diffuse material.
-    litColor.a = gDiffuseAlbedo.a;
+    litColor.a = matData.DiffuseAlbedo.a;
 
     return litColor;
 }
@@ -6,7 +6,31 @@
 #include "../../Common/MathHelper.h"
 #include "../../Common/UploadBuffer.h"
 #include "../../Common/GeometryGenerator.h"
+#include "../../Common/UploadBatcher.h"
+#include "../../Common/HeapManager.h"
+#include "../../Common/GeometryPool.h"
+#include "../../Common/ShaderCache.h"
+#include "../../Common/ShaderPermutations.h"
+#include "../../Common/ThreadPool.h"
+#include "../../Common/PipelineCache.h"
+#include "../../Common/ClusteredLightCuller.h"
+#include "../../Common/OcclusionCuller.h"
+#include "../../Common/VisibilityCache.h"
+#include "../../Common/SceneGraph.h"
+#include "../../Common/SceneFile.h"
+#include "../../Common/FileUtil.h"
+#include "../../Common/SlotMap.h"
+#include "../../Common/StaticBatcher.h"
+#include "../../Common/IndirectDraw.h"
+#include "../../Common/RenderGraph.h"
+#include "../../Common/DescriptorHeap.h"
+#include "../../Common/CommandStream.h"
+#include "../../Common/D3D12CommandRecorder.h"
+#include "../../Common/CommandReplay.h"
+#include "../../Common/SoftwareRasterizer.h"
 #include "FrameResource.h"
+#include "RenderItemPool.h"
+#include <chrono>
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -17,39 +41,12 @@ using namespace DirectX::PackedVector;
 
 const int gNumFrameResources = 3;
 
-// Lightweight structure stores parameters to draw a shape.  This will
-// vary from app-to-app.
-struct RenderItem
-{
-	RenderItem() = default;
-
-    // World matrix of the shape that describes the object's local space
-    // relative to the world space, which defines the position, orientation,
-    // and scale of the object in the world.
-    XMFLOAT4X4 World = MathHelper::Identity4x4();
-
-	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
-
-	// Dirty flag indicating the object data has changed and we need to update the constant buffer.
-	// Because we have an object cbuffer for each FrameResource, we have to apply the
-	// update to each FrameResource.  Thus, when we modify obect data we should set 
-	// NumFramesDirty = gNumFrameResources so that each frame resource gets the update.
-	int NumFramesDirty = gNumFrameResources;
-
-	// Index into GPU constant buffer corresponding to the ObjectCB for this render item.
-	UINT ObjCBIndex = -1;
-
-	Material* Mat = nullptr;
-	MeshGeometry* Geo = nullptr;
+static const std::wstring CaptureDirectory = L"Captures";
+static const std::wstring CaptureFile = L"Captures/Frames.ccap";
 
-    // Primitive topology.
-    D3D12_PRIMITIVE_TOPOLOGY PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-
-    // DrawIndexedInstanced parameters.
-    UINT IndexCount = 0;
-    UINT StartIndexLocation = 0;
-    int BaseVertexLocation = 0;
-};
+static const std::wstring FrameStatsDirectory = L"FrameStats";
+static const std::wstring FrameStatsCsvFile = L"FrameStats/Frames.csv";
+static const std::wstring FrameStatsJsonFile = L"FrameStats/Frames.json";
 
 class ShapesApp : public D3DApp
 {
@@ -72,11 +69,22 @@ private:
 
     void OnKeyboardInput(const GameTimer& gt);
 	void UpdateCamera(const GameTimer& gt);
+	void UpdateSceneGraph(const GameTimer& gt);
+	void CullRenderItems(const GameTimer& gt);
 	void AnimateMaterials(const GameTimer& gt);
 	void UpdateObjectCBs(const GameTimer& gt);
 	void UpdateMaterialCBs(const GameTimer& gt);
 	void UpdateMainPassCB(const GameTimer& gt);
-
+	void UpdateClusteredLights(const GameTimer& gt);
+	void DrawSoftwareFrame();
+	void BenchmarkSubmission();
+	void CaptureFrame();
+	void ReplayCapture();
+	void ReplayCaptureOnDevice();
+	std::unordered_map<std::string, void*> CaptureObjects();
+	void ExportFrameStats();
+
+    void BuildLights();
     void BuildRootSignature();
     void BuildShadersAndInputLayout();
     void BuildShapeGeometry();
@@ -84,8 +92,12 @@ private:
     void BuildPSOs();
     void BuildFrameResources();
     void BuildMaterials();
+	void BuildTextureDescriptors();
     void BuildRenderItems();
-    void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems);
+	void RecordFrame(CommandRecorder* cmdList);
+    void DrawRenderItems(CommandRecorder* cmdList, const std::vector<UINT>& ritems);
+	void BuildIndirectArguments();
+	void DrawRenderItemsIndirect(CommandRecorder* cmdList);
  
 private:
 
@@ -97,25 +109,152 @@ private:
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 
-	ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
-
-	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
-	std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
-	std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
+	// Worker threads for startup and per-frame CPU work.
+	std::unique_ptr<ThreadPool> mThreadPool;
+
+	// Default heap buffers are placed in large heaps owned by mHeapManager.
+	std::unique_ptr<HeapManager> mHeapManager;
+
+	// Stages every default buffer upload and records the copies in batches.
+	std::unique_ptr<UploadBatcher> mUploadBatcher;
+
+	// All meshes share one vertex buffer per vertex format and one index buffer.
+	std::unique_ptr<GeometryPool> mGeometryPool;
+
+	// When true, per-object and per-material data is stored in tightly packed
+	// structured buffers indexed through root constants instead of 256-byte
+	// aligned constant buffer slots bound with a root CBV per draw.
+	bool mPackedObjectData = true;
+
+	// When true, point and spot lights are assigned to a 3D grid of view frustum
+	// clusters on the CPU and the pixel shader only evaluates its cluster's lights.
+	bool mClusteredLighting = true;
+	ClusteredLightCuller mLightCuller;
+	UINT mClusterRootParameter = 0;
+	LinearUploadAllocator::Allocation mClusterLightsAlloc;
+	LinearUploadAllocator::Allocation mClusterRangesAlloc;
+	LinearUploadAllocator::Allocation mClusterIndicesAlloc;
+
+	// When true and every visible item shares the IA bindings, the opaque pass is
+	// issued with a single ExecuteIndirect.  Each command sets the object and
+	// material indices, so it needs packed object data.
+	bool mIndirectDraws = true;
+	IndirectDrawBuilder mIndirectBuilder{ 0, 2 };
+	ComPtr<ID3D12CommandSignature> mCommandSignature;
+	LinearUploadAllocator::Allocation mIndirectArgsAlloc;
+	bool mIndirectArgsReady = false;
+
+	// Passes of the frame and the barriers between them.  The compiled schedule
+	// is logged once.
+	RenderGraph mRenderGraph;
+	bool mRenderGraphLogged = false;
+
+	// CPU renderer for the opaque pass.  Pressing R renders the current frame with it
+	// and logs the image hash and timings.
+	std::unique_ptr<SoftwareRasterizer> mSoftwareRasterizer;
+	bool mSoftwareFrameKeyDown = false;
+	bool mSoftwareFrameRequested = false;
+
+	// Pressing B records the current frame into an in-memory command stream many
+	// times and logs the CPU cost per frame and the call counts.
+	CommandStreamRecorder mCommandStream;
+	bool mSubmissionBenchmarkKeyDown = false;
+	bool mSubmissionBenchmarkRequested = false;
+
+	// Frames are recorded into mCommandRecorder.  Pressing C captures the next
+	// CaptureFrameCount frames, with the buffer contents they read, to CaptureFile;
+	// while capturing, frames go to the GPU through mCaptureReplay so the timings of
+	// the captured commands on the device are reported too.  Pressing P replays the
+	// file against the recording backend and reports the result; if the file was
+	// captured in this run, so its buffer addresses are still good, the next frame
+	// also replays it on the device, its objects found by name in CaptureObjects.
+	static const UINT CaptureFrameCount = 8;
+	std::unique_ptr<D3D12CommandRecorder> mCommandRecorder;
+	std::unique_ptr<CommandReplay> mCaptureReplay;
+	CommandCapture mCapture;
+	CommandCapture mReplayCapture;   // The file as last loaded by P.
+	UINT mCaptureFramesLeft = 0;
+	bool mCaptureKeyDown = false;
+	bool mReplayKeyDown = false;
+	bool mReplayRequested = false;
+	bool mDeviceReplayRequested = false;
+
+	// Pressing F writes the frame statistics window to FrameStatsCsvFile and
+	// FrameStatsJsonFile and logs the rolling summary.
+	bool mFrameStatsKeyDown = false;
+	bool mFrameStatsExportRequested = false;
+
+	// Shader-visible CBV/SRV/UAV descriptors: persistent ones for textures and a
+	// transient ring shared by the frame resources.
+	std::unique_ptr<DescriptorHeap> mDescriptorHeap;
+
+	// Resources are stored in slot maps and addressed by handle.  Their names are
+	// interned in mNames and only used to find them while loading.
+	NameRegistry mNames;
+	SlotMap<MeshGeometry> mGeometries;
+	SlotMap<Material> mMaterials;
+	SlotMap<Texture> mTextures;
+	SlotMap<ComPtr<ID3DBlob>> mShaders;
+	SlotHandle mStandardVS;
+
+	// Compiled shader bytecode persisted across runs.
+	std::unique_ptr<ShaderCache> mShaderCache;
+
+	// Pixel shader compiled for a range of light counts, and the variant in use.
+	// The pass constants lay the lights out by the counts of that variant.
+	std::unique_ptr<ShaderPermutations> mOpaquePSVariants;
+	int mOpaquePSVariant = ShaderPermutations::InvalidVariant;
+
+	// Scene lights by type.
+	std::vector<Light> mDirLights;
+	std::vector<Light> mPointLights;
+	std::vector<Light> mSpotLights;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
-    ComPtr<ID3D12PipelineState> mOpaquePSO = nullptr;
+	// PSOs are created in the background and persisted in a pipeline library.
+	std::unique_ptr<PipelineCache> mPipelineCache;
+	PipelineCache::Handle mOpaquePSO = PipelineCache::InvalidHandle;
  
-	// List of all the render items.
-	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
+	// All render items are opaque, so they all use the opaque PSO.
+	RenderItemPool mRitems;
+
+	// Transform hierarchy of the scene.  Each render item has its own node; the
+	// render item of a node, if any, is mNodeRitems[node].
+	SceneGraph mSceneGraph;
+	std::vector<RenderItemPool::Handle> mNodeRitems;
+
+	// Static scene items are merged into a few batch render items when the scene
+	// loads.  Items below a movable node are never merged, so moving the node moves
+	// them.  The batches are not solid, so the boxes of the static occluders are
+	// kept here for the occlusion culler.
+	struct StaticOccluder
+	{
+		BoundingBox Bounds;
+		XMFLOAT4X4 World;
+	};
+	std::vector<StaticOccluder> mStaticOccluders;
 
-	// Render items divided by PSO.
-	std::vector<RenderItem*> mOpaqueRitems;
+	// Pool positions of the items that passed occlusion culling this frame.  When
+	// culling is disabled this is every item.  Results are reused across frames
+	// while the camera barely moves; see VisibilityCache.
+	bool mOcclusionCulling = true;
+	OcclusionCuller mOcclusionCuller;
+	VisibilityCache mVisibilityCache;
+	std::vector<UINT> mRitemsToTest;
+	std::vector<UINT> mVisibleRitems;
 
     PassConstants mMainPassCB;
 
+	// CPU copy of every render item's constants, indexed by ObjCBIndex.  Only dirty
+	// items are rebuilt; the whole array is copied to the frame's upload memory.
+	std::vector<ObjectConstants> mObjectConstants;
+
+	// This frame's sub-allocations from mCurrFrameResource->UploadAlloc.  In packed
+	// mode mObjectCBAlloc is a structured buffer rather than a constant buffer.
+	LinearUploadAllocator::Allocation mObjectCBAlloc;
+	LinearUploadAllocator::Allocation mPassCBAlloc;
+
 	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
 	XMFLOAT4X4 mView = MathHelper::Identity4x4();
 	XMFLOAT4X4 mProj = MathHelper::Identity4x4();
@@ -173,15 +312,33 @@ bool ShapesApp::Initialize()
 	// so we have to query this information.
     mCbvSrvDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
 
+    mHeapManager = std::make_unique<HeapManager>(md3dDevice.Get(), D3D12_HEAP_TYPE_DEFAULT, 16 * 1024 * 1024);
+    mUploadBatcher = std::make_unique<UploadBatcher>(md3dDevice.Get(), mHeapManager.get());
+    mGeometryPool = std::make_unique<GeometryPool>(md3dDevice.Get(), mUploadBatcher.get(), mHeapManager.get());
+    mShaderCache = std::make_unique<ShaderCache>();
+    mThreadPool = std::make_unique<ThreadPool>();
+    mDescriptorHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(), 256, 256 * gNumFrameResources);
+    mCommandRecorder = std::make_unique<D3D12CommandRecorder>(mCommandList.Get());
+    mCaptureReplay = std::make_unique<CommandReplay>(mCommandRecorder.get());
+    mCapture.SetSession((UINT64)std::chrono::system_clock::now().time_since_epoch().count());
+    mSoftwareRasterizer = std::make_unique<SoftwareRasterizer>(mClientWidth, mClientHeight, mThreadPool.get());
+    mPipelineCache = std::make_unique<PipelineCache>(md3dDevice.Get(), mThreadPool.get(),
+        mShaderCache->Directory() + L"Pipelines.bin");
+
+    BuildLights();
     BuildRootSignature();
     BuildShadersAndInputLayout();
     BuildShapeGeometry();
 	BuildSkullGeometry();
 	BuildMaterials();
+	BuildTextureDescriptors();
     BuildRenderItems();
     BuildFrameResources();
     BuildPSOs();
 
+    // Record all geometry uploads in one batch.  FlushCommandQueue signals the next fence value.
+    mUploadBatcher->Flush(mCommandList.Get(), mCurrentFence + 1);
+
     // Execute the initialization commands.
     ThrowIfFailed(mCommandList->Close());
     ID3D12CommandList* cmdsLists[] = { mCommandList.Get() };
@@ -190,6 +347,44 @@ bool ShapesApp::Initialize()
     // Wait until initialization is complete.
     FlushCommandQueue();
 
+    // The PSOs were compiling on worker threads while the GPU ran the uploads.
+    mPipelineCache->WaitAll();
+    mPipelineCache->SaveLibrary();
+
+    // The copies have executed, so the staging memory can be reused.
+    mUploadBatcher->ReleaseCompleted(mFence->GetCompletedValue());
+
+    const UploadBatcher::Stats& uploadStats = mUploadBatcher->GetStats();
+    std::wstring uploadText = L"Staged " + std::to_wstring(uploadStats.BytesStaged) +
+        L" bytes in " + std::to_wstring(uploadStats.UploadCount) +
+        L" uploads, peak staging " + std::to_wstring(uploadStats.PeakStagingBytes) + L" bytes\n";
+    ::OutputDebugString(uploadText.c_str());
+
+    const HeapManager::Stats heapStats = mHeapManager->GetStats();
+    std::wstring heapText = L"Placed " + std::to_wstring(heapStats.AllocationCount) +
+        L" buffers in " + std::to_wstring(heapStats.HeapCount) + L" heaps, " +
+        std::to_wstring(heapStats.AllocatedBytes) + L"/" + std::to_wstring(heapStats.ReservedBytes) +
+        L" bytes used, external fragmentation " + std::to_wstring(heapStats.ExternalFragmentation()) + L"\n";
+    ::OutputDebugString(heapText.c_str());
+
+    const DescriptorHeap::Stats descriptorStats = mDescriptorHeap->GetStats();
+    std::wstring descriptorText = L"Descriptors: " + std::to_wstring(descriptorStats.Allocator.PersistentUsed) +
+        L"/" + std::to_wstring(descriptorStats.Allocator.PersistentCapacity) + L" persistent, " +
+        std::to_wstring(descriptorStats.DescriptorsCopied) + L" copied in " +
+        std::to_wstring(descriptorStats.CopyCalls) + L" CopyDescriptors calls\n";
+    ::OutputDebugString(descriptorText.c_str());
+
+    const ShaderCache::Stats shaderStats = mShaderCache->GetStats();
+    std::wstring shaderText = L"Shader cache: " + std::to_wstring(shaderStats.Hits) + L" hits, " +
+        std::to_wstring(shaderStats.Misses) + L" misses\n";
+    ::OutputDebugString(shaderText.c_str());
+
+    const PipelineCache::Stats psoStats = mPipelineCache->GetStats();
+    std::wstring psoText = L"Pipeline cache: " + std::to_wstring(psoStats.LibraryHits) + L" loaded, " +
+        std::to_wstring(psoStats.Compiled) + L" compiled, " +
+        std::to_wstring(psoStats.Deduplicated) + L" deduplicated\n";
+    ::OutputDebugString(psoText.c_str());
+
     return true;
 }
  
@@ -200,12 +395,22 @@ void ShapesApp::OnResize()
     // The window resized, so update the aspect ratio and recompute the projection matrix.
     XMMATRIX P = XMMatrixPerspectiveFovLH(0.25f*MathHelper::Pi, AspectRatio(), 1.0f, 1000.0f);
     XMStoreFloat4x4(&mProj, P);
+
+    mLightCuller.SetProjection(mProj, 1.0f, 1000.0f);
+
+    // A wider view can reveal items the cache would otherwise keep culled.
+    mVisibilityCache.Invalidate();
+
+    if(mSoftwareRasterizer != nullptr)
+        mSoftwareRasterizer->Resize(mClientWidth, mClientHeight);
 }
 
 void ShapesApp::Update(const GameTimer& gt)
 {
     OnKeyboardInput(gt);
 	UpdateCamera(gt);
+	UpdateSceneGraph(gt);
+	CullRenderItems(gt);
 
     // Cycle through the circular frame resource array.
     mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
@@ -215,16 +420,52 @@ void ShapesApp::Update(const GameTimer& gt)
     // If not, wait until the GPU has completed commands up to this fence point.
     if(mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
     {
+        ClockSource& clock = gt.GetClock();
+        std::int64_t waitStart = clock.Now();
+
         HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
         ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
         WaitForSingleObject(eventHandle, INFINITE);
         CloseHandle(eventHandle);
+
+        mFrameStats.AddTime(FrameStats::TimingFenceWait, (clock.Now() - waitStart) * clock.SecondsPerCount() * 1000.0);
     }
 
+	// The GPU is done with this frame resource, so its transient memory can be reused.
+	mCurrFrameResource->UploadAlloc->Reset();
+	mDescriptorHeap->BeginFrame(mCurrFrameResourceIndex);
+	mUploadBatcher->ReleaseCompleted(mFence->GetCompletedValue());
+
 	AnimateMaterials(gt);
 	UpdateObjectCBs(gt);
 	UpdateMaterialCBs(gt);
 	UpdateMainPassCB(gt);
+	UpdateClusteredLights(gt);
+	BuildIndirectArguments();
+
+	if(mSoftwareFrameRequested)
+	{
+		DrawSoftwareFrame();
+		mSoftwareFrameRequested = false;
+	}
+
+	if(mSubmissionBenchmarkRequested)
+	{
+		BenchmarkSubmission();
+		mSubmissionBenchmarkRequested = false;
+	}
+
+	if(mReplayRequested)
+	{
+		ReplayCapture();
+		mReplayRequested = false;
+	}
+
+	if(mFrameStatsExportRequested)
+	{
+		ExportFrameStats();
+		mFrameStatsExportRequested = false;
+	}
 }
 
 void ShapesApp::Draw(const GameTimer& gt)
@@ -237,32 +478,23 @@ void ShapesApp::Draw(const GameTimer& gt)
 
     // A command list can be reset after it has been added to the command queue via ExecuteCommandList.
     // Reusing the command list reuses memory.
-    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mOpaquePSO.Get()));
-
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
-
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-
-    // Clear the back buffer and depth buffer.
-    mCommandList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
-    mCommandList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-
-    // Specify the buffers we are going to render to.
-    mCommandList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
-
-	mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+    ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), nullptr));
 
-	auto passCB = mCurrFrameResource->PassCB->Resource();
-	mCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+    // Record any uploads queued since the last frame before they are used.
+    mUploadBatcher->Flush(mCommandList.Get(), mCurrentFence + 1);
 
-    DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
+	// Descriptors staged since the last frame go to the shader-visible heap in one copy.
+	mDescriptorHeap->FlushCopies();
 
-    // Indicate a state transition on the resource usage.
-	mCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+	if(mDeviceReplayRequested)
+	{
+		ReplayCaptureOnDevice();
+		mDeviceReplayRequested = false;
+	}
+	else if(mCaptureFramesLeft > 0)
+		CaptureFrame();
+	else
+		RecordFrame(mCommandRecorder.get());
 
     // Done recording commands.
     ThrowIfFailed(mCommandList->Close());
@@ -331,6 +563,35 @@ void ShapesApp::OnMouseMove(WPARAM btnState, int x, int y)
  
 void ShapesApp::OnKeyboardInput(const GameTimer& gt)
 {
+	// Render one software frame per key press.
+	bool softwareFrameKeyDown = (GetAsyncKeyState('R') & 0x8000) != 0;
+	if(softwareFrameKeyDown && !mSoftwareFrameKeyDown)
+		mSoftwareFrameRequested = true;
+	mSoftwareFrameKeyDown = softwareFrameKeyDown;
+
+	bool benchmarkKeyDown = (GetAsyncKeyState('B') & 0x8000) != 0;
+	if(benchmarkKeyDown && !mSubmissionBenchmarkKeyDown)
+		mSubmissionBenchmarkRequested = true;
+	mSubmissionBenchmarkKeyDown = benchmarkKeyDown;
+
+	bool captureKeyDown = (GetAsyncKeyState('C') & 0x8000) != 0;
+	if(captureKeyDown && !mCaptureKeyDown && mCaptureFramesLeft == 0)
+	{
+		mCapture.Clear();
+		mCaptureReplay->ResetReport();
+		mCaptureFramesLeft = CaptureFrameCount;
+	}
+	mCaptureKeyDown = captureKeyDown;
+
+	bool replayKeyDown = (GetAsyncKeyState('P') & 0x8000) != 0;
+	if(replayKeyDown && !mReplayKeyDown)
+		mReplayRequested = true;
+	mReplayKeyDown = replayKeyDown;
+
+	bool frameStatsKeyDown = (GetAsyncKeyState('F') & 0x8000) != 0;
+	if(frameStatsKeyDown && !mFrameStatsKeyDown)
+		mFrameStatsExportRequested = true;
+	mFrameStatsKeyDown = frameStatsKeyDown;
 }
  
 void ShapesApp::UpdateCamera(const GameTimer& gt)
@@ -349,6 +610,89 @@ void ShapesApp::UpdateCamera(const GameTimer& gt)
 	XMStoreFloat4x4(&mView, view);
 }
 
+void ShapesApp::UpdateSceneGraph(const GameTimer& gt)
+{
+	// Only nodes below a changed transform come back, so only their items are
+	// marked for a constant rebuild.
+	for(SceneGraph::NodeHandle node : mSceneGraph.Update())
+	{
+		RenderItemPool::Handle ri = mNodeRitems[node];
+		if(mRitems.IsValid(ri))
+		{
+			RenderItemInfo& info = mRitems.GetInfo(ri);
+			info.World = mSceneGraph.GetWorldTransform(node);
+			info.NumFramesDirty = gNumFrameResources;
+		}
+	}
+}
+
+void ShapesApp::CullRenderItems(const GameTimer& gt)
+{
+	const RenderItem* items = mRitems.Items();
+	const RenderItemInfo* infos = mRitems.Infos();
+	const UINT count = mRitems.Size();
+
+	mVisibleRitems.clear();
+	if(!mOcclusionCulling)
+	{
+		for(UINT i = 0; i < count; ++i)
+			mVisibleRitems.push_back(i);
+		return;
+	}
+
+	// A moved occluder can change the visibility of anything behind it.
+	for(UINT i = 0; i < count; ++i)
+	{
+		if(infos[i].Occluder && infos[i].NumFramesDirty > 0)
+			mVisibilityCache.Invalidate();
+	}
+
+	// Object constants are rebuilt after culling, so NumFramesDirty still marks
+	// the items whose transform changed this frame.  Items are identified by
+	// their object constant slot, which does not change when items move.
+	mVisibilityCache.Begin(mView, mRitems.ObjectCount());
+
+	mRitemsToTest.clear();
+	for(UINT i = 0; i < count; ++i)
+	{
+		if(mVisibilityCache.NeedsTest(items[i].ObjCBIndex, infos[i].NumFramesDirty > 0))
+			mRitemsToTest.push_back(i);
+	}
+
+	// The occluders only need rasterizing when something is tested.
+	if(!mRitemsToTest.empty())
+	{
+		XMFLOAT4X4 viewProj;
+		XMStoreFloat4x4(&viewProj, XMMatrixMultiply(XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj)));
+
+		mOcclusionCuller.Begin(viewProj);
+		for(const StaticOccluder& occluder : mStaticOccluders)
+			mOcclusionCuller.AddOccluder(occluder.Bounds, occluder.World);
+		for(UINT i = 0; i < count; ++i)
+		{
+			if(infos[i].Occluder)
+				mOcclusionCuller.AddOccluder(infos[i].Bounds, infos[i].World);
+		}
+		mOcclusionCuller.RasterizeOccluders(mThreadPool.get());
+
+		// Occluders are tested too; one wall can hide another.  Hidden items are
+		// tested again with a margin to find the ones close to becoming visible.
+		for(UINT i : mRitemsToTest)
+		{
+			bool visible = mOcclusionCuller.IsVisible(infos[i].Bounds, infos[i].World);
+			bool nearBoundary = !visible &&
+				mOcclusionCuller.IsVisible(infos[i].Bounds, infos[i].World, mVisibilityCache.BoundaryMargin());
+			mVisibilityCache.Store(items[i].ObjCBIndex, visible, nearBoundary);
+		}
+	}
+
+	for(UINT i = 0; i < count; ++i)
+	{
+		if(mVisibilityCache.IsVisible(items[i].ObjCBIndex))
+			mVisibleRitems.push_back(i);
+	}
+}
+
 void ShapesApp::AnimateMaterials(const GameTimer& gt)
 {
 	
@@ -356,36 +700,56 @@ void ShapesApp::AnimateMaterials(const GameTimer& gt)
 
 void ShapesApp::UpdateObjectCBs(const GameTimer& gt)
 {
-	auto currObjectCB = mCurrFrameResource->ObjectCB.get();
-	for(auto& e : mAllRitems)
+	if(mObjectConstants.size() < mRitems.ObjectCount())
+		mObjectConstants.resize(mRitems.ObjectCount());
+
+	const RenderItem* items = mRitems.Items();
+	RenderItemInfo* infos = mRitems.Infos();
+	for(UINT i = 0; i < mRitems.Size(); ++i)
 	{
-		// Only update the cbuffer data if the constants have changed.  
-		// This needs to be tracked per frame resource.
-		if(e->NumFramesDirty > 0)
+		// Only rebuild the constants if they have changed.
+		RenderItemInfo& e = infos[i];
+		if(e.NumFramesDirty > 0)
 		{
-			XMMATRIX world = XMLoadFloat4x4(&e->World);
-			XMMATRIX texTransform = XMLoadFloat4x4(&e->TexTransform);
+			XMMATRIX world = XMLoadFloat4x4(&e.World);
+			XMMATRIX texTransform = XMLoadFloat4x4(&e.TexTransform);
 
-			ObjectConstants objConstants;
+			ObjectConstants& objConstants = mObjectConstants[items[i].ObjCBIndex];
 			XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
 			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
 
-			currObjectCB->CopyData(e->ObjCBIndex, objConstants);
-
-			// Next FrameResource need to be updated too.
-			e->NumFramesDirty--;
+			e.NumFramesDirty = 0;
 		}
 	}
+
+	// Transient memory is reset every frame, so every object is copied.  The block is
+	// sized from the current item count, which lets render items be added at runtime.
+	auto uploadAlloc = mCurrFrameResource->UploadAlloc.get();
+	if(mPackedObjectData)
+	{
+		// Tightly packed, so the whole array goes up with a single copy.
+		mObjectCBAlloc = uploadAlloc->AllocateArray<ObjectConstants>(
+			(UINT)mObjectConstants.size(), D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT);
+		memcpy(mObjectCBAlloc.CpuAddress, mObjectConstants.data(),
+			mObjectConstants.size()*sizeof(ObjectConstants));
+	}
+	else
+	{
+		mObjectCBAlloc = uploadAlloc->AllocateConstants<ObjectConstants>(
+			(UINT)mObjectConstants.size());
+		for(size_t i = 0; i < mObjectConstants.size(); ++i)
+			mObjectCBAlloc.CopyData((int)i, mObjectConstants[i]);
+	}
 }
 
 void ShapesApp::UpdateMaterialCBs(const GameTimer& gt)
 {
 	auto currMaterialCB = mCurrFrameResource->MaterialCB.get();
-	for(auto& e : mMaterials)
+	for(Material& e : mMaterials)
 	{
 		// Only update the cbuffer data if the constants have changed.  If the cbuffer
 		// data changes, it needs to be updated for each FrameResource.
-		Material* mat = e.second.get();
+		Material* mat = &e;
 		if(mat->NumFramesDirty > 0)
 		{
 			XMMATRIX matTransform = XMLoadFloat4x4(&mat->MatTransform);
@@ -428,29 +792,452 @@ void ShapesApp::UpdateMainPassCB(const GameTimer& gt)
 	mMainPassCB.TotalTime = gt.TotalTime();
 	mMainPassCB.DeltaTime = gt.DeltaTime();
 	mMainPassCB.AmbientLight = { 0.2f, 0.2f, 0.2f, 1.0f };
-	mMainPassCB.Lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
-	mMainPassCB.Lights[0].Strength = { 0.6f, 0.6f, 0.6f };
-	mMainPassCB.Lights[1].Direction = { -0.57735f, -0.57735f, 0.57735f };
-	mMainPassCB.Lights[1].Strength = { 0.3f, 0.3f, 0.3f };
-	mMainPassCB.Lights[2].Direction = { 0.0f, -0.707f, -0.707f };
-	mMainPassCB.Lights[2].Strength = { 0.15f, 0.15f, 0.15f };
-
-	auto currPassCB = mCurrFrameResource->PassCB.get();
-	currPassCB->CopyData(0, mMainPassCB);
+
+	// The shader variant may have more slots of a type than there are lights; the
+	// spare slots get a zero strength light so they contribute nothing.
+	const std::vector<int>& slotCounts = mOpaquePSVariants->GetVariantValues(mOpaquePSVariant);
+	const std::vector<Light>* lightsByType[] = { &mDirLights, &mPointLights, &mSpotLights };
+
+	Light unusedLight;
+	unusedLight.Strength = { 0.0f, 0.0f, 0.0f };
+
+	UINT slot = 0;
+	for(UINT type = 0; type < _countof(lightsByType); ++type)
+	{
+		for(int i = 0; i < slotCounts[type]; ++i)
+		{
+			const std::vector<Light>& lights = *lightsByType[type];
+			mMainPassCB.Lights[slot++] = i < (int)lights.size() ? lights[i] : unusedLight;
+		}
+	}
+
+	mMainPassCB.ClusterCountX = mLightCuller.CountX();
+	mMainPassCB.ClusterCountY = mLightCuller.CountY();
+	mMainPassCB.ClusterCountZ = mLightCuller.CountZ();
+	mMainPassCB.ClusterDepthScale = mLightCuller.DepthScale();
+	mMainPassCB.ClusterDepthBias = mLightCuller.DepthBias();
+
+	mPassCBAlloc = mCurrFrameResource->UploadAlloc->AllocateConstants<PassConstants>();
+	mPassCBAlloc.CopyData(0, mMainPassCB);
+}
+
+void ShapesApp::UpdateClusteredLights(const GameTimer& gt)
+{
+	if(!mClusteredLighting)
+		return;
+
+	mLightCuller.Cull(mView, mPointLights, mSpotLights, mThreadPool.get());
+
+	const std::vector<ClusteredLightCuller::ClusterRange>& ranges = mLightCuller.GetClusterRanges();
+	const std::vector<UINT>& indices = mLightCuller.GetLightIndices();
+
+	// Root SRVs need a valid address even when there is nothing to read, so never
+	// allocate empty arrays.
+	auto uploadAlloc = mCurrFrameResource->UploadAlloc.get();
+	UINT lightCount = (UINT)(mPointLights.size() + mSpotLights.size());
+
+	mClusterLightsAlloc = uploadAlloc->AllocateArray<Light>(MathHelper::Max(lightCount, 1u));
+	if(!mPointLights.empty())
+		memcpy(mClusterLightsAlloc.CpuAddress, mPointLights.data(), mPointLights.size()*sizeof(Light));
+	if(!mSpotLights.empty())
+		memcpy(mClusterLightsAlloc.CpuAddress + mPointLights.size()*sizeof(Light), mSpotLights.data(),
+			mSpotLights.size()*sizeof(Light));
+
+	mClusterRangesAlloc = uploadAlloc->AllocateArray<ClusteredLightCuller::ClusterRange>((UINT)ranges.size());
+	memcpy(mClusterRangesAlloc.CpuAddress, ranges.data(), ranges.size()*sizeof(ranges[0]));
+
+	mClusterIndicesAlloc = uploadAlloc->AllocateArray<UINT>(MathHelper::Max((UINT)indices.size(), 1u));
+	if(!indices.empty())
+		memcpy(mClusterIndicesAlloc.CpuAddress, indices.data(), indices.size()*sizeof(UINT));
+}
+
+void ShapesApp::DrawSoftwareFrame()
+{
+	// Gather the lights the GPU pass uses: the pass constant slots of the current
+	// variant, and with clustered lighting every point and spot light as well.
+	const std::vector<int>& slotCounts = mOpaquePSVariants->GetVariantValues(mOpaquePSVariant);
+	const std::vector<Light>* clusteredByType[] = { nullptr, &mPointLights, &mSpotLights };
+
+	std::vector<Light> lights;
+	int lightCounts[3] = {};
+	UINT slot = 0;
+	for(UINT type = 0; type < _countof(clusteredByType); ++type)
+	{
+		lights.insert(lights.end(), mMainPassCB.Lights + slot, mMainPassCB.Lights + slot + slotCounts[type]);
+		slot += slotCounts[type];
+		lightCounts[type] = slotCounts[type];
+
+		if(mClusteredLighting && clusteredByType[type] != nullptr)
+		{
+			lights.insert(lights.end(), clusteredByType[type]->begin(), clusteredByType[type]->end());
+			lightCounts[type] += (int)clusteredByType[type]->size();
+		}
+	}
+
+	// The rasterizer reads the geometry's CPU copies and the material as the shader sees it.
+	auto makeDraw = [](const MeshGeometry& geo, const ObjectConstants& object, const Material& mat)
+	{
+		SoftwareRasterizer::DrawCall draw;
+		draw.VertexData = geo.VertexBufferCPU->GetBufferPointer();
+		draw.VertexBufferByteSize = geo.VertexBufferByteSize;
+		draw.VertexByteStride = geo.VertexByteStride;
+		draw.IndexData = geo.IndexBufferCPU->GetBufferPointer();
+		draw.IndexBufferByteSize = geo.IndexBufferByteSize;
+		draw.IndexFormat = geo.IndexFormat;
+		draw.World = object.World;
+		draw.Material.DiffuseAlbedo = mat.DiffuseAlbedo;
+		draw.Material.FresnelR0 = mat.FresnelR0;
+		draw.Material.Shininess = 1.0f - mat.Roughness;
+		return draw;
+	};
+
+	std::vector<SoftwareRasterizer::DrawCall> draws;
+	if(mIndirectArgsReady)
+	{
+		// Render what the GPU's ExecuteIndirect gets: decode this frame's argument
+		// buffer and look the root constants up the way the shaders do.
+		std::vector<const Material*> materialsByCBIndex(mMaterials.Size(), nullptr);
+		for(const Material& mat : mMaterials)
+			materialsByCBIndex[mat.MatCBIndex] = &mat;
+
+		const MeshGeometry* geo = &mGeometries[mRitems.Items()[mVisibleRitems[0]].Geo];
+		IndirectEmulator emulator;
+		emulator.Execute(mIndirectBuilder.GetSignatureDesc(), mIndirectBuilder.CommandCount(),
+			mIndirectArgsAlloc.CpuAddress, mIndirectArgsAlloc.Size, nullptr,
+			geo->IndexBufferByteSize / sizeof(std::uint32_t),
+			[&](const IndirectEmulator& state, const D3D12_DRAW_INDEXED_ARGUMENTS& args)
+		{
+			const Material* mat = materialsByCBIndex[state.GetRootConstant(0, 1)];
+
+			SoftwareRasterizer::DrawCall draw = makeDraw(*geo, mObjectConstants[state.GetRootConstant(0, 0)], *mat);
+			draw.IndexCount = args.IndexCountPerInstance;
+			draw.StartIndexLocation = args.StartIndexLocation;
+			draw.BaseVertexLocation = args.BaseVertexLocation;
+			draws.push_back(draw);
+		});
+
+		const IndirectEmulator::Stats& indirectStats = emulator.GetStats();
+		std::wstring indirectText = L"Indirect arguments: " + std::to_wstring(indirectStats.Commands) + L" commands, " +
+			std::to_wstring(indirectStats.Indices) + L" indices, " +
+			std::to_wstring(indirectStats.OutOfRange) + L" out of range\n";
+		::OutputDebugString(indirectText.c_str());
+	}
+	else
+	{
+		// The same culled list DrawRenderItems submits.
+		draws.resize(mVisibleRitems.size());
+		for(size_t i = 0; i < mVisibleRitems.size(); ++i)
+		{
+			const RenderItem* ri = &mRitems.Items()[mVisibleRitems[i]];
+			SoftwareRasterizer::DrawCall& draw = draws[i];
+			draw = makeDraw(mGeometries[ri->Geo], mObjectConstants[ri->ObjCBIndex], mMaterials[ri->Mat]);
+			draw.IndexCount = ri->IndexCount;
+			draw.StartIndexLocation = ri->StartIndexLocation;
+			draw.BaseVertexLocation = ri->BaseVertexLocation;
+		}
+	}
+
+	XMFLOAT4 clearColor;
+	XMStoreFloat4(&clearColor, Colors::LightSteelBlue);
+	SoftwareRasterizer::PassData pass;
+	pass.ViewProj = mMainPassCB.ViewProj;
+	pass.EyePosW = mMainPassCB.EyePosW;
+	pass.AmbientLight = mMainPassCB.AmbientLight;
+
+	mSoftwareRasterizer->Clear(clearColor);
+	mSoftwareRasterizer->Draw(pass, lights.data(), lightCounts[0], lightCounts[1], lightCounts[2], draws);
+
+	const SoftwareRasterizer::Stats& stats = mSoftwareRasterizer->GetStats();
+	std::wstring text = L"Software frame " + std::to_wstring(mSoftwareRasterizer->ColorHash()) + L": " +
+		std::to_wstring(stats.Triangles) + L" triangles, " + std::to_wstring(stats.CulledTriangles) + L" culled, " +
+		std::to_wstring(stats.PixelsShaded) + L" pixels shaded, setup " + std::to_wstring(stats.SetupMilliseconds) +
+		L" ms, raster " + std::to_wstring(stats.RasterMilliseconds) + L" ms\n";
+	::OutputDebugString(text.c_str());
+}
+
+void ShapesApp::BenchmarkSubmission()
+{
+	using Clock = std::chrono::steady_clock;
+	const UINT frameCount = 100;
+
+	const Clock::time_point startTime = Clock::now();
+	for(UINT i = 0; i < frameCount; ++i)
+	{
+		mCommandStream.Clear();
+		RecordFrame(&mCommandStream);
+	}
+	const Clock::time_point endTime = Clock::now();
+
+	double frameMicroseconds = std::chrono::duration<double, std::micro>(endTime - startTime).count() / frameCount;
+
+	const CommandStreamRecorder::Stats& stats = mCommandStream.GetStats();
+	std::wstring text = L"Submission benchmark: " + std::to_wstring(frameMicroseconds) + L" us per frame, " +
+		std::to_wstring(stats.Commands) + L" commands, " + std::to_wstring(stats.Bytes) + L" bytes, " +
+		std::to_wstring(stats.Indices) + L" indices, hash " + std::to_wstring(mCommandStream.Hash()) + L"\n";
+	for(UINT type = 0; type < CommandStreamRecorder::CommandTypeCount; ++type)
+	{
+		if(stats.Calls[type] != 0)
+		{
+			text += L"    " + AnsiToWString(CommandStreamRecorder::CommandName(type)) + L" " +
+				std::to_wstring(stats.Calls[type]) + L"\n";
+		}
+	}
+	::OutputDebugString(text.c_str());
+}
+
+void ShapesApp::CaptureFrame()
+{
+	// Record into the stream first and submit what was captured, so the file holds
+	// exactly the commands the GPU got.
+	mCommandStream.Clear();
+	RecordFrame(&mCommandStream);
+
+	mCapture.BeginFrame();
+	mCapture.AddBufferData(mPassCBAlloc.GpuAddress, mPassCBAlloc.CpuAddress, mPassCBAlloc.Size);
+	mCapture.AddBufferData(mObjectCBAlloc.GpuAddress, mObjectCBAlloc.CpuAddress, mObjectCBAlloc.Size);
+
+	auto materialCB = mCurrFrameResource->MaterialCB.get();
+	mCapture.AddBufferData(materialCB->Resource()->GetGPUVirtualAddress(), materialCB->MappedData(), materialCB->ByteSize());
+
+	if(mClusteredLighting)
+	{
+		for(const LinearUploadAllocator::Allocation* alloc : { &mClusterLightsAlloc, &mClusterRangesAlloc, &mClusterIndicesAlloc })
+			mCapture.AddBufferData(alloc->GpuAddress, alloc->CpuAddress, alloc->Size);
+	}
+
+	if(mIndirectArgsReady)
+		mCapture.AddBufferData(mIndirectArgsAlloc.GpuAddress, mIndirectArgsAlloc.CpuAddress, mIndirectArgsAlloc.Size);
+
+	std::unordered_map<void*, std::string> names;
+	for(const auto& object : CaptureObjects())
+		names[object.second] = object.first;
+
+	mCapture.EndFrame(mCommandStream, [&names](void* object)
+	{
+		auto it = names.find(object);
+		return it != names.end() ? it->second : std::string();
+	});
+
+	const std::vector<void*>& objects = mCommandStream.GetObjects();
+	mCaptureReplay->ReplayFrame(mCapture.GetFrame(mCapture.FrameCount() - 1), objects.data(), (UINT)objects.size());
+
+	if(--mCaptureFramesLeft == 0)
+	{
+		CreateDirectoryW(CaptureDirectory.c_str(), nullptr);
+		if(!mCapture.Save(CaptureFile))
+			::OutputDebugString(L"Could not write the capture file\n");
+
+		std::string text = "Captured " + std::to_string(mCapture.FrameCount()) + " frames.  On the device:\n" +
+			mCaptureReplay->FormatReport();
+		::OutputDebugStringA(text.c_str());
+	}
+}
+
+void ShapesApp::ReplayCapture()
+{
+	if(!mReplayCapture.Load(CaptureFile))
+	{
+		::OutputDebugString(L"No valid capture to replay\n");
+		return;
+	}
+
+	CommandStreamRecorder stream;
+	CommandReplay replay(&stream);
+	try
+	{
+		for(UINT i = 0; i < mReplayCapture.FrameCount(); ++i)
+			replay.ReplayFrame(mReplayCapture.GetFrame(i));
+	}
+	catch(const std::invalid_argument&)
+	{
+		// Load only checks the file's framing; the commands are checked as they replay.
+		::OutputDebugString(L"Capture holds a malformed command stream\n");
+		return;
+	}
+
+	std::string text = "Replay against the recording backend, stream hash " + std::to_string(stream.Hash()) + ":\n" +
+		replay.FormatReport();
+	::OutputDebugStringA(text.c_str());
+
+	// A capture from an earlier run holds GPU addresses that are no longer ours.
+	if(mReplayCapture.GetSession() == mCapture.GetSession())
+		mDeviceReplayRequested = true;
+	else
+		::OutputDebugString(L"Capture is from an earlier run; not replaying it on the device\n");
+}
+
+void ShapesApp::ReplayCaptureOnDevice()
+{
+	std::unordered_map<std::string, void*> live = CaptureObjects();
+	auto find = [&live](const std::string& name) -> void*
+	{
+		auto it = live.find(name);
+		return it != live.end() ? it->second : nullptr;
+	};
+
+	// Every frame is resolved before any is replayed, so a frame is either replayed
+	// whole or recorded as usual.
+	std::vector<std::vector<void*>> objects(mReplayCapture.FrameCount());
+	for(UINT i = 0; i < mReplayCapture.FrameCount(); ++i)
+	{
+		std::vector<std::string> missing;
+		if(!CommandCapture::ResolveObjects(mReplayCapture.GetFrame(i), find, objects[i], &missing))
+		{
+			std::string text = "Capture frame " + std::to_string(i) + " uses objects that cannot be found:";
+			for(const std::string& name : missing)
+				text += " '" + name + "'";
+			::OutputDebugStringA((text + "\n").c_str());
+
+			RecordFrame(mCommandRecorder.get());
+			return;
+		}
+	}
+
+	// Each captured frame draws the whole scene into the current back buffer, so
+	// the last one is what is presented.
+	CommandReplay replay(mCommandRecorder.get());
+	for(UINT i = 0; i < mReplayCapture.FrameCount(); ++i)
+		replay.ReplayFrame(mReplayCapture.GetFrame(i), objects[i].data(), (UINT)objects[i].size());
+
+	std::string text = "Replay on the device:\n" + replay.FormatReport();
+	::OutputDebugStringA(text.c_str());
+}
+
+std::unordered_map<std::string, void*> ShapesApp::CaptureObjects()
+{
+	std::unordered_map<std::string, void*> objects;
+	auto add = [&objects](const std::string& name, void* object)
+	{
+		if(object != nullptr)
+			objects[name] = object;
+	};
+
+	// The back buffer is named for its role, so a replay draws into whichever one
+	// is current rather than one the swap chain may still be showing.
+	add("BackBuffer", CurrentBackBuffer());
+	add("DepthStencil", mDepthStencilBuffer.Get());
+	add("DescriptorHeap", mDescriptorHeap->Heap());
+	add("RootSignature", mRootSignature.Get());
+	add("CommandSignature", mCommandSignature.Get());
+	add("OpaquePSO", mPipelineCache->Get(mOpaquePSO));
+
+	// Indirect arguments live in the frame resources' upload pages.
+	for(size_t f = 0; f < mFrameResources.size(); ++f)
+	{
+		const LinearUploadAllocator* uploadAlloc = mFrameResources[f]->UploadAlloc.get();
+		for(UINT page = 0; page < uploadAlloc->PageCount(); ++page)
+			add("Upload" + std::to_string(f) + "." + std::to_string(page), uploadAlloc->PageResource(page));
+	}
+
+	return objects;
+}
+
+void ShapesApp::ExportFrameStats()
+{
+	CreateDirectoryW(FrameStatsDirectory.c_str(), nullptr);
+
+	WriteFileAtomic(FrameStatsCsvFile, [this](std::ostream& out) { mFrameStats.WriteCsv(out); }, false);
+	WriteFileAtomic(FrameStatsJsonFile, [this](std::ostream& out) { mFrameStats.WriteJson(out); }, false);
+
+	std::wstring text = L"Frame stats over the last " + std::to_wstring(mFrameStats.Size()) + L" frames (ms):\n";
+	for(int t = 0; t < FrameStats::TimingCount; ++t)
+	{
+		FrameStats::Summary summary = mFrameStats.Summarize((FrameStats::Timing)t);
+		std::string name = FrameStats::TimingName((FrameStats::Timing)t);
+		text += L"  " + std::wstring(name.begin(), name.end()) +
+			L": mean " + std::to_wstring(summary.Mean) +
+			L"  p50 " + std::to_wstring(summary.P50) +
+			L"  p95 " + std::to_wstring(summary.P95) +
+			L"  p99 " + std::to_wstring(summary.P99) +
+			L"  max " + std::to_wstring(summary.Max) + L"\n";
+	}
+	text += L"  over budget: " + std::to_wstring(mFrameStats.FlaggedCount(FrameStats::FrameOverBudget)) +
+		L"  spikes: " + std::to_wstring(mFrameStats.FlaggedCount(FrameStats::FrameSpike)) + L"\n";
+	::OutputDebugString(text.c_str());
+}
+
+void ShapesApp::BuildLights()
+{
+	Light light;
+
+	light.Direction = { 0.57735f, -0.57735f, 0.57735f };
+	light.Strength = { 0.6f, 0.6f, 0.6f };
+	mDirLights.push_back(light);
+
+	light.Direction = { -0.57735f, -0.57735f, 0.57735f };
+	light.Strength = { 0.3f, 0.3f, 0.3f };
+	mDirLights.push_back(light);
+
+	light.Direction = { 0.0f, -0.707f, -0.707f };
+	light.Strength = { 0.15f, 0.15f, 0.15f };
+	mDirLights.push_back(light);
+
+	// Without clustering, point and spot lights are limited to the slots of the
+	// largest shader variant.
+	if(!mClusteredLighting)
+		return;
+
+	// Small colored point lights scattered over the courtyard and along the walls.
+	for(int i = 0; i < 192; ++i)
+	{
+		Light pointLight;
+		pointLight.Position = { MathHelper::RandF(-18.0f, 18.0f), MathHelper::RandF(0.5f, 8.0f), MathHelper::RandF(-22.0f, 16.0f) };
+		pointLight.Strength = { MathHelper::RandF(0.1f, 0.5f), MathHelper::RandF(0.1f, 0.5f), MathHelper::RandF(0.1f, 0.5f) };
+		pointLight.FalloffStart = 0.5f;
+		pointLight.FalloffEnd = MathHelper::RandF(2.0f, 5.0f);
+		mPointLights.push_back(pointLight);
+	}
+
+	// Spot lights shining down from above the walls and towers.
+	for(int i = 0; i < 64; ++i)
+	{
+		Light spotLight;
+		spotLight.Position = { MathHelper::RandF(-16.0f, 16.0f), MathHelper::RandF(10.0f, 16.0f), MathHelper::RandF(-20.0f, 14.0f) };
+		XMStoreFloat3(&spotLight.Direction, XMVector3Normalize(XMVectorSet(
+			MathHelper::RandF(-0.3f, 0.3f), -1.0f, MathHelper::RandF(-0.3f, 0.3f), 0.0f)));
+		spotLight.Strength = { 0.4f, 0.4f, 0.3f };
+		spotLight.FalloffStart = 4.0f;
+		spotLight.FalloffEnd = 20.0f;
+		spotLight.SpotPower = MathHelper::RandF(16.0f, 64.0f);
+		mSpotLights.push_back(spotLight);
+	}
 }
 
 void ShapesApp::BuildRootSignature()
 {
 	// Root parameter can be a table, root descriptor or root constants.
-	CD3DX12_ROOT_PARAMETER slotRootParameter[3];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[7];
+	UINT numRootParameters = 3;
 
-	// Create root CBV.
-	slotRootParameter[0].InitAsConstantBufferView(0);
-	slotRootParameter[1].InitAsConstantBufferView(1);
-	slotRootParameter[2].InitAsConstantBufferView(2);
+	if(mPackedObjectData)
+	{
+		// Object and material indices as root constants, the packed object and
+		// material arrays as root SRVs.  The pass CBV stays in slot 2.
+		slotRootParameter[0].InitAsConstants(2, 0);
+		slotRootParameter[1].InitAsShaderResourceView(0);
+		slotRootParameter[2].InitAsConstantBufferView(2);
+		slotRootParameter[3].InitAsShaderResourceView(1);
+		numRootParameters = 4;
+	}
+	else
+	{
+		// Create root CBV.
+		slotRootParameter[0].InitAsConstantBufferView(0);
+		slotRootParameter[1].InitAsConstantBufferView(1);
+		slotRootParameter[2].InitAsConstantBufferView(2);
+	}
+
+	if(mClusteredLighting)
+	{
+		// Cluster lights, ranges and light indices as root SRVs.
+		mClusterRootParameter = numRootParameters;
+		slotRootParameter[numRootParameters++].InitAsShaderResourceView(2);
+		slotRootParameter[numRootParameters++].InitAsShaderResourceView(3);
+		slotRootParameter[numRootParameters++].InitAsShaderResourceView(4);
+	}
 
 	// A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(3, slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(numRootParameters, slotRootParameter, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 	// create a root signature with a single slot which points to a descriptor range consisting of a single constant buffer
 	ComPtr<ID3DBlob> serializedRootSig = nullptr;
@@ -469,6 +1256,12 @@ void ShapesApp::BuildRootSignature()
 		serializedRootSig->GetBufferPointer(),
 		serializedRootSig->GetBufferSize(),
 		IID_PPV_ARGS(mRootSignature.GetAddressOf())));
+
+	mPipelineCache->RegisterRootSignature(mRootSignature.Get(), serializedRootSig.Get());
+
+	// Indirect commands set the two root constants of the packed layout.
+	if(mPackedObjectData)
+		mCommandSignature = mIndirectBuilder.CreateCommandSignature(md3dDevice.Get(), mRootSignature.Get());
 }
 
 void ShapesApp::BuildShadersAndInputLayout()
@@ -479,8 +1272,41 @@ void ShapesApp::BuildShadersAndInputLayout()
 		NULL, NULL
 	};
 
-	mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_1");
-	mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\Default.hlsl", nullptr, "PS", "ps_5_1");
+	std::vector<D3D_SHADER_MACRO> shaderDefines;
+	if(mPackedObjectData)
+		shaderDefines.push_back({ "PACKED_OBJECT_DATA", "1" });
+	if(mClusteredLighting)
+		shaderDefines.push_back({ "CLUSTERED_LIGHTING", "1" });
+	shaderDefines.push_back({ NULL, NULL });
+
+	const D3D_SHADER_MACRO* defines = shaderDefines.data();
+
+	mStandardVS = mShaders.Insert(mShaderCache->CompileShader(L"Shaders\\Default.hlsl", defines, "VS", "vs_5_1"),
+		mNames.Intern("standardVS"));
+
+	// The pixel shader only loops over the light slots it was compiled for, so
+	// compile it for a range of light counts.  The slot counts must add up to at
+	// most MaxLights.
+	mOpaquePSVariants = std::make_unique<ShaderPermutations>(L"Shaders\\Default.hlsl", "PS", "ps_5_1", defines);
+	mOpaquePSVariants->AddAxis("NUM_DIR_LIGHTS", { 0, 1, 2, 3 });
+	mOpaquePSVariants->AddAxis("NUM_POINT_LIGHTS", { 0, 2, 4, 8 });
+	mOpaquePSVariants->AddAxis("NUM_SPOT_LIGHTS", { 0, 2, 4 });
+
+	const std::wstring archiveFile = mShaderCache->Directory() + L"DefaultPS.variants";
+	if(!mOpaquePSVariants->LoadArchive(archiveFile))
+	{
+		mOpaquePSVariants->Build(*mThreadPool, mShaderCache.get());
+		mOpaquePSVariants->SaveArchive(archiveFile);
+	}
+
+	// Clustered point and spot lights do not use the light slots.
+	int pointSlots = mClusteredLighting ? 0 : (int)mPointLights.size();
+	int spotSlots = mClusteredLighting ? 0 : (int)mSpotLights.size();
+	mOpaquePSVariant = mOpaquePSVariants->FindVariant({ (int)mDirLights.size(), pointSlots, spotSlots });
+
+	// More lights than any variant has slots for.
+	if(mOpaquePSVariant == ShaderPermutations::InvalidVariant)
+		ThrowIfFailed(E_INVALIDARG);
 	
     mInputLayout =
     {
@@ -649,53 +1475,54 @@ void ShapesApp::BuildShapeGeometry()
 		vertices[k].Normal = wedge.Vertices[i].Normal;
 	}
 
-	std::vector<std::uint16_t> indices;
-	indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-	indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
-	indices.insert(indices.end(), std::begin(sphere.GetIndices16()), std::end(sphere.GetIndices16()));
-	indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
-	indices.insert(indices.end(), std::begin(diamond.GetIndices16()), std::end(diamond.GetIndices16()));
-	indices.insert(indices.end(), std::begin(torus.GetIndices16()), std::end(torus.GetIndices16()));
-	indices.insert(indices.end(), std::begin(pyramid.GetIndices16()), std::end(pyramid.GetIndices16()));
-	indices.insert(indices.end(), std::begin(prism.GetIndices16()), std::end(prism.GetIndices16()));
-	indices.insert(indices.end(), std::begin(wedge.GetIndices16()), std::end(wedge.GetIndices16()));
-
-
-    const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-    const UINT ibByteSize = (UINT)indices.size()  * sizeof(std::uint16_t);
-
-	auto geo = std::make_unique<MeshGeometry>();
-	geo->Name = "shapeGeo";
-
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	// The geometry pool uses 32-bit indices for every mesh.
+	std::vector<std::uint32_t> indices;
+	indices.insert(indices.end(), std::begin(box.Indices32), std::end(box.Indices32));
+	indices.insert(indices.end(), std::begin(grid.Indices32), std::end(grid.Indices32));
+	indices.insert(indices.end(), std::begin(sphere.Indices32), std::end(sphere.Indices32));
+	indices.insert(indices.end(), std::begin(cylinder.Indices32), std::end(cylinder.Indices32));
+	indices.insert(indices.end(), std::begin(diamond.Indices32), std::end(diamond.Indices32));
+	indices.insert(indices.end(), std::begin(torus.Indices32), std::end(torus.Indices32));
+	indices.insert(indices.end(), std::begin(pyramid.Indices32), std::end(pyramid.Indices32));
+	indices.insert(indices.end(), std::begin(prism.Indices32), std::end(prism.Indices32));
+	indices.insert(indices.end(), std::begin(wedge.Indices32), std::end(wedge.Indices32));
+
+	MeshGeometry geo;
+	geo.Name = "shapeGeo";
+
+	// Sub-allocate the concatenated shapes in the geometry pool and rebase the
+	// submeshes so they are offsets into the pool buffers.
+	SubmeshGeometry poolRange = mGeometryPool->AddMesh(vertices, indices);
+	mGeometryPool->BindMeshGeometry(&geo, sizeof(Vertex));
+
+	SubmeshGeometry* submeshes[] = { &boxSubmesh, &gridSubmesh, &sphereSubmesh, &cylinderSubmesh,
+		&diamondSubmesh, &torusSubmesh, &pyramidSubmesh, &prismSubmesh, &wedgeSubmesh };
+	const GeometryGenerator::MeshData* meshes[] = { &box, &grid, &sphere, &cylinder,
+		&diamond, &torus, &pyramid, &prism, &wedge };
+
+	for(UINT i = 0; i < _countof(submeshes); ++i)
+	{
+		submeshes[i]->StartIndexLocation += poolRange.StartIndexLocation;
+		submeshes[i]->BaseVertexLocation += poolRange.BaseVertexLocation;
 
-	geo->VertexByteStride = sizeof(Vertex);
-	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
-	geo->IndexBufferByteSize = ibByteSize;
+		// The pool only knows the bounds of the concatenated vertices.
+		BoundingBox::CreateFromPoints(submeshes[i]->Bounds, meshes[i]->Vertices.size(),
+			&meshes[i]->Vertices[0].Position, sizeof(GeometryGenerator::Vertex));
+	}
 
-	geo->DrawArgs["box"] = boxSubmesh;
-	geo->DrawArgs["grid"] = gridSubmesh;
-	geo->DrawArgs["sphere"] = sphereSubmesh;
-	geo->DrawArgs["cylinder"] = cylinderSubmesh;
-	geo->DrawArgs["diamond"] = diamondSubmesh;
-	geo->DrawArgs["torus"] = torusSubmesh;
-	geo->DrawArgs["pyramid"] = pyramidSubmesh;
-	geo->DrawArgs["prism"] = prismSubmesh;
-	geo->DrawArgs["wedge"] = wedgeSubmesh;
+	geo.AddSubmesh("box", boxSubmesh);
+	geo.AddSubmesh("grid", gridSubmesh);
+	geo.AddSubmesh("sphere", sphereSubmesh);
+	geo.AddSubmesh("cylinder", cylinderSubmesh);
+	geo.AddSubmesh("diamond", diamondSubmesh);
+	geo.AddSubmesh("torus", torusSubmesh);
+	geo.AddSubmesh("pyramid", pyramidSubmesh);
+	geo.AddSubmesh("prism", prismSubmesh);
+	geo.AddSubmesh("wedge", wedgeSubmesh);
 
 
-	mGeometries[geo->Name] = std::move(geo);
+	NameRegistry::NameId name = mNames.Intern(geo.Name);
+	mGeometries.Insert(std::move(geo), name);
 }
 
 void ShapesApp::BuildSkullGeometry()
@@ -727,7 +1554,7 @@ void ShapesApp::BuildSkullGeometry()
 	fin >> ignore;
 	fin >> ignore;
 
-	std::vector<std::int32_t> indices(3 * tcount);
+	std::vector<std::uint32_t> indices(3 * tcount);
 	for(UINT i = 0; i < tcount; ++i)
 	{
 		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
@@ -736,41 +1563,18 @@ void ShapesApp::BuildSkullGeometry()
 	fin.close();
 
 	//
-	// Pack the indices of all the meshes into one index buffer.
+	// Sub-allocate the skull in the same geometry pool as the shapes, so both
+	// share the IA bindings.
 	//
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::int32_t);
-
-	auto geo = std::make_unique<MeshGeometry>();
-	geo->Name = "skullGeo";
-
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	MeshGeometry geo;
+	geo.Name = "skullGeo";
 
-	geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo.AddSubmesh("skull", mGeometryPool->AddMesh(vertices, indices));
+	mGeometryPool->BindMeshGeometry(&geo, sizeof(Vertex));
 
-	geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(),
-		mCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
-
-	geo->VertexByteStride = sizeof(Vertex);
-	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
-	geo->IndexBufferByteSize = ibByteSize;
-
-	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
-	submesh.StartIndexLocation = 0;
-	submesh.BaseVertexLocation = 0;
-
-	geo->DrawArgs["skull"] = submesh;
-
-	mGeometries[geo->Name] = std::move(geo);
+	NameRegistry::NameId name = mNames.Intern(geo.Name);
+	mGeometries.Insert(std::move(geo), name);
 }
 
 void ShapesApp::BuildPSOs()
@@ -785,14 +1589,10 @@ void ShapesApp::BuildPSOs()
 	opaquePsoDesc.pRootSignature = mRootSignature.Get();
 	opaquePsoDesc.VS = 
 	{ 
-		reinterpret_cast<BYTE*>(mShaders["standardVS"]->GetBufferPointer()), 
-		mShaders["standardVS"]->GetBufferSize()
-	};
-	opaquePsoDesc.PS = 
-	{ 
-		reinterpret_cast<BYTE*>(mShaders["opaquePS"]->GetBufferPointer()),
-		mShaders["opaquePS"]->GetBufferSize()
+		reinterpret_cast<BYTE*>(mShaders[mStandardVS]->GetBufferPointer()), 
+		mShaders[mStandardVS]->GetBufferSize()
 	};
+	opaquePsoDesc.PS = mOpaquePSVariants->GetBytecode(mOpaquePSVariant);
 	opaquePsoDesc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
 	opaquePsoDesc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
 	opaquePsoDesc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
@@ -803,7 +1603,7 @@ void ShapesApp::BuildPSOs()
 	opaquePsoDesc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
 	opaquePsoDesc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = mDepthStencilFormat;
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mOpaquePSO)));
+    mOpaquePSO = mPipelineCache->Request(opaquePsoDesc);
 }
 
 void ShapesApp::BuildFrameResources()
@@ -811,7 +1611,7 @@ void ShapesApp::BuildFrameResources()
     for(int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(std::make_unique<FrameResource>(md3dDevice.Get(),
-            1, (UINT)mAllRitems.size(), (UINT)mMaterials.size()));
+            1, mRitems.ObjectCount(), mMaterials.Size(), mPackedObjectData));
     }
 }
 
@@ -820,555 +1620,469 @@ void ShapesApp::BuildMaterials()
 	int cbIndex = 0;
 	int srvHeapIndex = 0;
 
-	auto gold = std::make_unique<Material>();
-	gold->Name = "gold";
-	gold->MatCBIndex = cbIndex++;
-	gold->DiffuseSrvHeapIndex = srvHeapIndex++;
-	gold->DiffuseAlbedo = XMFLOAT4(Colors::Gold);
-	gold->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	gold->Roughness = 0.01f;
-
-	auto stone0 = std::make_unique<Material>();
-	stone0->Name = "stone0";
-	stone0->MatCBIndex = cbIndex++;
-	stone0->DiffuseSrvHeapIndex = srvHeapIndex++;
-	stone0->DiffuseAlbedo = XMFLOAT4(Colors::LightSteelBlue);
-	stone0->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
-	stone0->Roughness = 0.8f;
+	Material gold;
+	gold.Name = "gold";
+	gold.MatCBIndex = cbIndex++;
+	gold.DiffuseSrvHeapIndex = srvHeapIndex++;
+	gold.DiffuseAlbedo = XMFLOAT4(Colors::Gold);
+	gold.FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
+	gold.Roughness = 0.01f;
+
+	Material stone0;
+	stone0.Name = "stone0";
+	stone0.MatCBIndex = cbIndex++;
+	stone0.DiffuseSrvHeapIndex = srvHeapIndex++;
+	stone0.DiffuseAlbedo = XMFLOAT4(Colors::LightSteelBlue);
+	stone0.FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
+	stone0.Roughness = 0.8f;
  
-	auto tile0 = std::make_unique<Material>();
-	tile0->Name = "tile0";
-	tile0->MatCBIndex = cbIndex++;
-	tile0->DiffuseSrvHeapIndex = srvHeapIndex++;
-	tile0->DiffuseAlbedo = XMFLOAT4(Colors::ForestGreen);
-	tile0->FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
-	tile0->Roughness = 0.8f;
-
-	auto skullMat = std::make_unique<Material>();
-	skullMat->Name = "skullMat";
-	skullMat->MatCBIndex = cbIndex++; 
-	skullMat->DiffuseSrvHeapIndex = srvHeapIndex++;
-	skullMat->DiffuseAlbedo = XMFLOAT4(0.3f, 0.3f, 0.5f, 0.5f);
-	skullMat->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
-	skullMat->Roughness = 0.3f;
-
-	auto diamond1Mat = std::make_unique<Material>();
-	diamond1Mat->Name = "diamond1Mat";
-	diamond1Mat->MatCBIndex = cbIndex++;
-	diamond1Mat->DiffuseSrvHeapIndex = srvHeapIndex++;
-	diamond1Mat->DiffuseAlbedo = XMFLOAT4(0.45f, 0.15f, 0.2f, 0.8f);
-	diamond1Mat->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
-	diamond1Mat->Roughness = 0.3f;
-
-	auto diamond2Mat = std::make_unique<Material>();
-	diamond2Mat->Name = "diamond2Mat";
-	diamond2Mat->MatCBIndex = cbIndex++;
-	diamond2Mat->DiffuseSrvHeapIndex = srvHeapIndex++;
-	diamond2Mat->DiffuseAlbedo = XMFLOAT4(Colors::DimGray);
-	diamond2Mat->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
-	diamond2Mat->Roughness = 0.8f;
-
-	auto torusMat = std::make_unique<Material>();
-	torusMat->Name = "torusMat";
-	torusMat->MatCBIndex = cbIndex++;
-	torusMat->DiffuseSrvHeapIndex = srvHeapIndex++;
-	torusMat->DiffuseAlbedo = XMFLOAT4(Colors::Green);
-	torusMat->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
-	torusMat->Roughness = 0.4f;
-
-	auto pyramidMat = std::make_unique<Material>();
-	pyramidMat->Name = "pyramidMat";
-	pyramidMat->MatCBIndex = cbIndex++;
-	pyramidMat->DiffuseSrvHeapIndex = srvHeapIndex++;
-	pyramidMat->DiffuseAlbedo = XMFLOAT4(Colors::SandyBrown);
-	pyramidMat->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
-	pyramidMat->Roughness = 0.8f;
-
-	auto prismMat = std::make_unique<Material>();
-	prismMat->Name = "prismMat";
-	prismMat->MatCBIndex = cbIndex++;
-	prismMat->DiffuseSrvHeapIndex = srvHeapIndex++;
-	prismMat->DiffuseAlbedo = XMFLOAT4(Colors::CornflowerBlue);
-	prismMat->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
-	prismMat->Roughness = 0.7f;
-
-	auto wedgeMat = std::make_unique<Material>();
-	wedgeMat->Name = "wedgeMat";
-	wedgeMat->MatCBIndex = cbIndex++;
-	wedgeMat->DiffuseSrvHeapIndex = srvHeapIndex++;
-	wedgeMat->DiffuseAlbedo = XMFLOAT4(Colors::Sienna);
-	wedgeMat->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
-	wedgeMat->Roughness = 0.55f;
-
-	mMaterials["gold"] = std::move(gold);
-	mMaterials["stone0"] = std::move(stone0);
-	mMaterials["tile0"] = std::move(tile0);
-	mMaterials["skullMat"] = std::move(skullMat);
-	mMaterials["diamond1Mat"] = std::move(diamond1Mat);
-	mMaterials["diamond2Mat"] = std::move(diamond2Mat);
-	mMaterials["torusMat"] = std::move(torusMat);
-	mMaterials["pyramidMat"] = std::move(pyramidMat);
-	mMaterials["prismMat"] = std::move(prismMat);
-	mMaterials["wedgeMat"] = std::move(wedgeMat);
+	Material tile0;
+	tile0.Name = "tile0";
+	tile0.MatCBIndex = cbIndex++;
+	tile0.DiffuseSrvHeapIndex = srvHeapIndex++;
+	tile0.DiffuseAlbedo = XMFLOAT4(Colors::ForestGreen);
+	tile0.FresnelR0 = XMFLOAT3(0.02f, 0.02f, 0.02f);
+	tile0.Roughness = 0.8f;
+
+	Material skullMat;
+	skullMat.Name = "skullMat";
+	skullMat.MatCBIndex = cbIndex++; 
+	skullMat.DiffuseSrvHeapIndex = srvHeapIndex++;
+	skullMat.DiffuseAlbedo = XMFLOAT4(0.3f, 0.3f, 0.5f, 0.5f);
+	skullMat.FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
+	skullMat.Roughness = 0.3f;
+
+	Material diamond1Mat;
+	diamond1Mat.Name = "diamond1Mat";
+	diamond1Mat.MatCBIndex = cbIndex++;
+	diamond1Mat.DiffuseSrvHeapIndex = srvHeapIndex++;
+	diamond1Mat.DiffuseAlbedo = XMFLOAT4(0.45f, 0.15f, 0.2f, 0.8f);
+	diamond1Mat.FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
+	diamond1Mat.Roughness = 0.3f;
+
+	Material diamond2Mat;
+	diamond2Mat.Name = "diamond2Mat";
+	diamond2Mat.MatCBIndex = cbIndex++;
+	diamond2Mat.DiffuseSrvHeapIndex = srvHeapIndex++;
+	diamond2Mat.DiffuseAlbedo = XMFLOAT4(Colors::DimGray);
+	diamond2Mat.FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
+	diamond2Mat.Roughness = 0.8f;
+
+	Material torusMat;
+	torusMat.Name = "torusMat";
+	torusMat.MatCBIndex = cbIndex++;
+	torusMat.DiffuseSrvHeapIndex = srvHeapIndex++;
+	torusMat.DiffuseAlbedo = XMFLOAT4(Colors::Green);
+	torusMat.FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
+	torusMat.Roughness = 0.4f;
+
+	Material pyramidMat;
+	pyramidMat.Name = "pyramidMat";
+	pyramidMat.MatCBIndex = cbIndex++;
+	pyramidMat.DiffuseSrvHeapIndex = srvHeapIndex++;
+	pyramidMat.DiffuseAlbedo = XMFLOAT4(Colors::SandyBrown);
+	pyramidMat.FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
+	pyramidMat.Roughness = 0.8f;
+
+	Material prismMat;
+	prismMat.Name = "prismMat";
+	prismMat.MatCBIndex = cbIndex++;
+	prismMat.DiffuseSrvHeapIndex = srvHeapIndex++;
+	prismMat.DiffuseAlbedo = XMFLOAT4(Colors::CornflowerBlue);
+	prismMat.FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
+	prismMat.Roughness = 0.7f;
+
+	Material wedgeMat;
+	wedgeMat.Name = "wedgeMat";
+	wedgeMat.MatCBIndex = cbIndex++;
+	wedgeMat.DiffuseSrvHeapIndex = srvHeapIndex++;
+	wedgeMat.DiffuseAlbedo = XMFLOAT4(Colors::Sienna);
+	wedgeMat.FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05);
+	wedgeMat.Roughness = 0.55f;
+
+	for(Material* mat : { &gold, &stone0, &tile0, &skullMat, &diamond1Mat, &diamond2Mat, &torusMat, &pyramidMat, &prismMat, &wedgeMat })
+	{
+		NameRegistry::NameId name = mNames.Intern(mat->Name);
+		mMaterials.Insert(std::move(*mat), name);
+	}
 
 
 }
 
+void ShapesApp::BuildTextureDescriptors()
+{
+	// Each texture gets a persistent SRV.  The views are staged and reach the
+	// shader-visible heap in a single copy.
+	for(Texture& tex : mTextures)
+	{
+		if(tex.Resource == nullptr)
+			continue;
+
+		tex.SrvHeapIndex = (int)mDescriptorHeap->AllocatePersistent();
+		if(tex.SrvHeapIndex < 0)
+			ThrowIfFailed(E_OUTOFMEMORY);
+
+		mDescriptorHeap->CreateShaderResourceView(tex.Resource.Get(), nullptr, (UINT)tex.SrvHeapIndex);
+	}
+
+	mDescriptorHeap->FlushCopies();
+}
+
 void ShapesApp::BuildRenderItems()
 {
-	UINT objCBIndex = 0;
-
-	//Keep
-	auto keepBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&keepBox->World, XMMatrixScaling(10.0f, 14.0f, 6.0f)*XMMatrixTranslation(0.0f, 7.0f, 0.0f));
-	XMStoreFloat4x4(&keepBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	keepBox->ObjCBIndex = objCBIndex++;
-	keepBox->Mat = mMaterials["stone0"].get();
-	keepBox->Geo = mGeometries["shapeGeo"].get();
-	keepBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	keepBox->IndexCount = keepBox->Geo->DrawArgs["box"].IndexCount;
-	keepBox->StartIndexLocation = keepBox->Geo->DrawArgs["box"].StartIndexLocation;
-	keepBox->BaseVertexLocation = keepBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(keepBox));
-
-	//Keep Roof
-	auto keepRoofPyramid = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&keepRoofPyramid->World, XMMatrixScaling(12.0f, 4.0f, 8.0f)*XMMatrixTranslation(0.0f, 16.0f, 0.0f));
-	XMStoreFloat4x4(&keepRoofPyramid->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	keepRoofPyramid->ObjCBIndex = objCBIndex++;
-	keepRoofPyramid->Mat = mMaterials["wedgeMat"].get();
-	keepRoofPyramid->Geo = mGeometries["shapeGeo"].get();
-	keepRoofPyramid->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	keepRoofPyramid->IndexCount = keepRoofPyramid->Geo->DrawArgs["pyramid"].IndexCount;
-	keepRoofPyramid->StartIndexLocation = keepRoofPyramid->Geo->DrawArgs["pyramid"].StartIndexLocation;
-	keepRoofPyramid->BaseVertexLocation = keepRoofPyramid->Geo->DrawArgs["pyramid"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(keepRoofPyramid));
-
-	//Keep Stairs
-	auto keepStairsWedge = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&keepStairsWedge->World, XMMatrixScaling(5.0f, 2.0f, 3.0f)*XMMatrixRotationRollPitchYaw(0.0f, XM_PI, 0.0f)*XMMatrixTranslation(0.0f, 1.0f, -4.5f));
-	XMStoreFloat4x4(&keepStairsWedge->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	keepStairsWedge->ObjCBIndex = objCBIndex++;
-	keepStairsWedge->Mat = mMaterials["wedgeMat"].get();
-	keepStairsWedge->Geo = mGeometries["shapeGeo"].get();
-	keepStairsWedge->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	keepStairsWedge->IndexCount = keepStairsWedge->Geo->DrawArgs["wedge"].IndexCount;
-	keepStairsWedge->StartIndexLocation = keepStairsWedge->Geo->DrawArgs["wedge"].StartIndexLocation;
-	keepStairsWedge->BaseVertexLocation = keepStairsWedge->Geo->DrawArgs["wedge"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(keepStairsWedge));
-
-	//Back Wall
-	auto backWallBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&backWallBox->World, XMMatrixScaling(28.0f, 6.0f, 1.0f)*XMMatrixTranslation(0.0f, 3.0f, 12.0f));
-	XMStoreFloat4x4(&backWallBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	backWallBox->ObjCBIndex = objCBIndex++;
-	backWallBox->Mat = mMaterials["stone0"].get();
-	backWallBox->Geo = mGeometries["shapeGeo"].get();
-	backWallBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	backWallBox->IndexCount = backWallBox->Geo->DrawArgs["box"].IndexCount;
-	backWallBox->StartIndexLocation = backWallBox->Geo->DrawArgs["box"].StartIndexLocation;
-	backWallBox->BaseVertexLocation = backWallBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(backWallBox));
-
-	//Front Right Wall
-	auto RfrontWallBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&RfrontWallBox->World, XMMatrixScaling(9.0f, 6.0f, 1.0f)*XMMatrixTranslation(7.0f, 3.0f, -18.0f));
-	XMStoreFloat4x4(&RfrontWallBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	RfrontWallBox->ObjCBIndex = objCBIndex++;
-	RfrontWallBox->Mat = mMaterials["stone0"].get();
-	RfrontWallBox->Geo = mGeometries["shapeGeo"].get();
-	RfrontWallBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	RfrontWallBox->IndexCount = RfrontWallBox->Geo->DrawArgs["box"].IndexCount;
-	RfrontWallBox->StartIndexLocation = RfrontWallBox->Geo->DrawArgs["box"].StartIndexLocation;
-	RfrontWallBox->BaseVertexLocation = RfrontWallBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(RfrontWallBox));
-
-	//Front Left Wall
-	auto LfrontWallBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&LfrontWallBox->World, XMMatrixScaling(9.0f, 6.0f, 1.0f)*XMMatrixTranslation(-7.0f, 3.0f, -18.0f));
-	XMStoreFloat4x4(&LfrontWallBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	LfrontWallBox->ObjCBIndex = objCBIndex++;
-	LfrontWallBox->Mat = mMaterials["stone0"].get();
-	LfrontWallBox->Geo = mGeometries["shapeGeo"].get();
-	LfrontWallBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	LfrontWallBox->IndexCount = LfrontWallBox->Geo->DrawArgs["box"].IndexCount;
-	LfrontWallBox->StartIndexLocation = LfrontWallBox->Geo->DrawArgs["box"].StartIndexLocation;
-	LfrontWallBox->BaseVertexLocation = LfrontWallBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(LfrontWallBox));
-
-	//Left Wall
-	auto leftWallBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&leftWallBox->World, XMMatrixScaling(1.0f, 6.0f, 28.0f)*XMMatrixTranslation(-14.0f, 3.0f, -3.0f));
-	XMStoreFloat4x4(&leftWallBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	leftWallBox->ObjCBIndex = objCBIndex++;
-	leftWallBox->Mat = mMaterials["stone0"].get();
-	leftWallBox->Geo = mGeometries["shapeGeo"].get();
-	leftWallBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	leftWallBox->IndexCount = leftWallBox->Geo->DrawArgs["box"].IndexCount;
-	leftWallBox->StartIndexLocation = leftWallBox->Geo->DrawArgs["box"].StartIndexLocation;
-	leftWallBox->BaseVertexLocation = leftWallBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(leftWallBox));
-
-	//Right Wall
-	auto rightWallBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&rightWallBox->World, XMMatrixScaling(1.0f, 6.0f, 28.0f)*XMMatrixTranslation(14.0f, 3.0f, -3.0f));
-	XMStoreFloat4x4(&rightWallBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	rightWallBox->ObjCBIndex = objCBIndex++;
-	rightWallBox->Mat = mMaterials["stone0"].get();
-	rightWallBox->Geo = mGeometries["shapeGeo"].get();
-	rightWallBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	rightWallBox->IndexCount = rightWallBox->Geo->DrawArgs["box"].IndexCount;
-	rightWallBox->StartIndexLocation = rightWallBox->Geo->DrawArgs["box"].StartIndexLocation;
-	rightWallBox->BaseVertexLocation = rightWallBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(rightWallBox));
-
-	//Rear Left Tower
-	auto RLTowerBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&RLTowerBox->World, XMMatrixScaling(4.0f, 8.0f, 4.0f)*XMMatrixTranslation(-13.0f, 4.0f, 11.0f));
-	XMStoreFloat4x4(&RLTowerBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	RLTowerBox->ObjCBIndex = objCBIndex++;
-	RLTowerBox->Mat = mMaterials["diamond2Mat"].get();
-	RLTowerBox->Geo = mGeometries["shapeGeo"].get();
-	RLTowerBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	RLTowerBox->IndexCount = RLTowerBox->Geo->DrawArgs["box"].IndexCount;
-	RLTowerBox->StartIndexLocation = RLTowerBox->Geo->DrawArgs["box"].StartIndexLocation;
-	RLTowerBox->BaseVertexLocation = RLTowerBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(RLTowerBox));
-
-	//Rear Right Tower
-	auto RRTowerBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&RRTowerBox->World, XMMatrixScaling(4.0f, 8.0f, 4.0f)*XMMatrixTranslation(13.0f, 4.0f, 11.0f));
-	XMStoreFloat4x4(&RRTowerBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	RRTowerBox->ObjCBIndex = objCBIndex++;
-	RRTowerBox->Mat = mMaterials["diamond2Mat"].get();
-	RRTowerBox->Geo = mGeometries["shapeGeo"].get();
-	RRTowerBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	RRTowerBox->IndexCount = RRTowerBox->Geo->DrawArgs["box"].IndexCount;
-	RRTowerBox->StartIndexLocation = RRTowerBox->Geo->DrawArgs["box"].StartIndexLocation;
-	RRTowerBox->BaseVertexLocation = RRTowerBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(RRTowerBox));
-
-	//Front Left Tower
-	auto FLTowerBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&FLTowerBox->World, XMMatrixScaling(4.0f, 8.0f, 4.0f)*XMMatrixTranslation(-13.0f, 4.0f, -17.0f));
-	XMStoreFloat4x4(&FLTowerBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	FLTowerBox->ObjCBIndex = objCBIndex++;
-	FLTowerBox->Mat = mMaterials["diamond2Mat"].get();
-	FLTowerBox->Geo = mGeometries["shapeGeo"].get();
-	FLTowerBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	FLTowerBox->IndexCount = FLTowerBox->Geo->DrawArgs["box"].IndexCount;
-	FLTowerBox->StartIndexLocation = FLTowerBox->Geo->DrawArgs["box"].StartIndexLocation;
-	FLTowerBox->BaseVertexLocation = FLTowerBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(FLTowerBox));
-
-	//Front Right Tower
-	auto FRTowerBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&FRTowerBox->World, XMMatrixScaling(4.0f, 8.0f, 4.0f)*XMMatrixTranslation(13.0f, 4.0f, -17.0f));
-	XMStoreFloat4x4(&FRTowerBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	FRTowerBox->ObjCBIndex = objCBIndex++;
-	FRTowerBox->Mat = mMaterials["diamond2Mat"].get();
-	FRTowerBox->Geo = mGeometries["shapeGeo"].get();
-	FRTowerBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	FRTowerBox->IndexCount = FRTowerBox->Geo->DrawArgs["box"].IndexCount;
-	FRTowerBox->StartIndexLocation = FRTowerBox->Geo->DrawArgs["box"].StartIndexLocation;
-	FRTowerBox->BaseVertexLocation = FRTowerBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(FRTowerBox));
-
-
-
-	//Rear Left Tower Cap
-	auto RLTowerCap = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&RLTowerCap->World, XMMatrixScaling(3.0f, 4.0f, 3.0f)*XMMatrixTranslation(-13.0f, 10.0f, 11.0f));
-	XMStoreFloat4x4(&RLTowerCap->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	RLTowerCap->ObjCBIndex = objCBIndex++;
-	RLTowerCap->Mat = mMaterials["prismMat"].get();
-	RLTowerCap->Geo = mGeometries["shapeGeo"].get();
-	RLTowerCap->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	RLTowerCap->IndexCount = RLTowerCap->Geo->DrawArgs["cylinder"].IndexCount;
-	RLTowerCap->StartIndexLocation = RLTowerCap->Geo->DrawArgs["cylinder"].StartIndexLocation;
-	RLTowerCap->BaseVertexLocation = RLTowerCap->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(RLTowerCap));
-
-	//Rear Right Tower Cap
-	auto RRTowerCap = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&RRTowerCap->World, XMMatrixScaling(3.0f, 4.0f, 3.0f)*XMMatrixTranslation(13.0f, 10.0f, 11.0f));
-	XMStoreFloat4x4(&RRTowerCap->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	RRTowerCap->ObjCBIndex = objCBIndex++;
-	RRTowerCap->Mat = mMaterials["prismMat"].get();
-	RRTowerCap->Geo = mGeometries["shapeGeo"].get();
-	RRTowerCap->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	RRTowerCap->IndexCount = RRTowerCap->Geo->DrawArgs["cylinder"].IndexCount;
-	RRTowerCap->StartIndexLocation = RRTowerCap->Geo->DrawArgs["cylinder"].StartIndexLocation;
-	RRTowerCap->BaseVertexLocation = RRTowerCap->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(RRTowerCap));
-
-	//Front Left Tower Cap
-	auto FLTowerCap = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&FLTowerCap->World, XMMatrixScaling(3.0f, 4.0f, 3.0f)*XMMatrixTranslation(-13.0f, 10.0f, -17.0f));
-	XMStoreFloat4x4(&FLTowerCap->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	FLTowerCap->ObjCBIndex = objCBIndex++;
-	FLTowerCap->Mat = mMaterials["prismMat"].get();
-	FLTowerCap->Geo = mGeometries["shapeGeo"].get();
-	FLTowerCap->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	FLTowerCap->IndexCount = FLTowerCap->Geo->DrawArgs["cylinder"].IndexCount;
-	FLTowerCap->StartIndexLocation = FLTowerCap->Geo->DrawArgs["cylinder"].StartIndexLocation;
-	FLTowerCap->BaseVertexLocation = FLTowerCap->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(FLTowerCap));
-
-	//Front Right Tower Cap
-	auto FRTowerCap = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&FRTowerCap->World, XMMatrixScaling(3.0f, 4.0f, 3.0f)*XMMatrixTranslation(13.0f, 10.0f, -17.0f));
-	XMStoreFloat4x4(&FRTowerCap->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	FRTowerCap->ObjCBIndex = objCBIndex++;
-	FRTowerCap->Mat = mMaterials["prismMat"].get();
-	FRTowerCap->Geo = mGeometries["shapeGeo"].get();
-	FRTowerCap->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	FRTowerCap->IndexCount = FRTowerCap->Geo->DrawArgs["cylinder"].IndexCount;
-	FRTowerCap->StartIndexLocation = FRTowerCap->Geo->DrawArgs["cylinder"].StartIndexLocation;
-	FRTowerCap->BaseVertexLocation = FRTowerCap->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(FRTowerCap));
-
-
-
-
-
-
-	//Left Gate
-	auto leftGateBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&leftGateBox->World, XMMatrixScaling(4.0f, 8.0f, 3.0f)*XMMatrixTranslation(-4.0f, 4.0f, -18.0f));
-	XMStoreFloat4x4(&leftGateBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	leftGateBox->ObjCBIndex = objCBIndex++;
-	leftGateBox->Mat = mMaterials["diamond2Mat"].get();
-	leftGateBox->Geo = mGeometries["shapeGeo"].get();
-	leftGateBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	leftGateBox->IndexCount = leftGateBox->Geo->DrawArgs["box"].IndexCount;
-	leftGateBox->StartIndexLocation = leftGateBox->Geo->DrawArgs["box"].StartIndexLocation;
-	leftGateBox->BaseVertexLocation = leftGateBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(leftGateBox));
-
-	//Right Gate
-	auto rightGateBox = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&rightGateBox->World, XMMatrixScaling(4.0f, 8.0f, 3.0f)*XMMatrixTranslation(4.0f, 4.0f, -18.0f));
-	XMStoreFloat4x4(&rightGateBox->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	rightGateBox->ObjCBIndex = objCBIndex++;
-	rightGateBox->Mat = mMaterials["diamond2Mat"].get();
-	rightGateBox->Geo = mGeometries["shapeGeo"].get();
-	rightGateBox->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	rightGateBox->IndexCount = rightGateBox->Geo->DrawArgs["box"].IndexCount;
-	rightGateBox->StartIndexLocation = rightGateBox->Geo->DrawArgs["box"].StartIndexLocation;
-	rightGateBox->BaseVertexLocation = rightGateBox->Geo->DrawArgs["box"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(rightGateBox));
-
-	//Left Gate Roof
-	auto leftGateWedge = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&leftGateWedge->World, XMMatrixScaling(3.0f, 3.0f, 6.0f)*XMMatrixRotationRollPitchYaw(0.0f, -XM_PI/2, 0.0f)*XMMatrixTranslation(-3.0f, 9.5f, -18.0f));
-	XMStoreFloat4x4(&leftGateWedge->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	leftGateWedge->ObjCBIndex = objCBIndex++;
-	leftGateWedge->Mat = mMaterials["wedgeMat"].get();
-	leftGateWedge->Geo = mGeometries["shapeGeo"].get();
-	leftGateWedge->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	leftGateWedge->IndexCount = leftGateWedge->Geo->DrawArgs["wedge"].IndexCount;
-	leftGateWedge->StartIndexLocation = leftGateWedge->Geo->DrawArgs["wedge"].StartIndexLocation;
-	leftGateWedge->BaseVertexLocation = leftGateWedge->Geo->DrawArgs["wedge"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(leftGateWedge));
-
-	//Right Gate Roof
-	auto rightGateWedge = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&rightGateWedge->World, XMMatrixScaling(3.0f, 3.0f, 6.0f)*XMMatrixRotationRollPitchYaw(0.0f, XM_PI / 2, 0.0f)*XMMatrixTranslation(3.0f, 9.5f, -18.0f));
-	XMStoreFloat4x4(&rightGateWedge->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	rightGateWedge->ObjCBIndex = objCBIndex++;
-	rightGateWedge->Mat = mMaterials["wedgeMat"].get();
-	rightGateWedge->Geo = mGeometries["shapeGeo"].get();
-	rightGateWedge->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	rightGateWedge->IndexCount = rightGateWedge->Geo->DrawArgs["wedge"].IndexCount;
-	rightGateWedge->StartIndexLocation = rightGateWedge->Geo->DrawArgs["wedge"].StartIndexLocation;
-	rightGateWedge->BaseVertexLocation = rightGateWedge->Geo->DrawArgs["wedge"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(rightGateWedge));
-
-	//Diamond Pedestal
-	auto diamond1 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&diamond1->World, XMMatrixScaling(1.0f, 3.0f, 1.0f)*XMMatrixTranslation(-5.0f, 0.0f, -8.0f));
-	XMStoreFloat4x4(&diamond1->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	diamond1->ObjCBIndex = objCBIndex++;
-	diamond1->Mat = mMaterials["skullMat"].get();
-	diamond1->Geo = mGeometries["shapeGeo"].get();
-	diamond1->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	diamond1->IndexCount = diamond1->Geo->DrawArgs["diamond"].IndexCount;
-	diamond1->StartIndexLocation = diamond1->Geo->DrawArgs["diamond"].StartIndexLocation;
-	diamond1->BaseVertexLocation = diamond1->Geo->DrawArgs["diamond"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(diamond1));
-
-	//Diamond Pedestal 2
-	auto diamond2 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&diamond2->World, XMMatrixScaling(1.0f, 3.0f, 1.0f)*XMMatrixTranslation(5.0f, 0.0f, -8.0f));
-	XMStoreFloat4x4(&diamond2->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	diamond2->ObjCBIndex = objCBIndex++;
-	diamond2->Mat = mMaterials["skullMat"].get();
-	diamond2->Geo = mGeometries["shapeGeo"].get();
-	diamond2->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	diamond2->IndexCount = diamond2->Geo->DrawArgs["diamond"].IndexCount;
-	diamond2->StartIndexLocation = diamond2->Geo->DrawArgs["diamond"].StartIndexLocation;
-	diamond2->BaseVertexLocation = diamond2->Geo->DrawArgs["diamond"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(diamond2));
-
-	//Torus
-	auto torus = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&torus->World, XMMatrixScaling(0.75f, 0.75f, 0.75f)*XMMatrixRotationRollPitchYaw(XM_PI/2, 0.0f, 0.0f)*XMMatrixTranslation(5.0f, 4.1f, -8.0f));
-	XMStoreFloat4x4(&torus->TexTransform, XMMatrixScaling(1.0f, 1.0f, 1.0f));
-	torus->ObjCBIndex = objCBIndex++;
-	torus->Mat = mMaterials["gold"].get();
-	torus->Geo = mGeometries["shapeGeo"].get();
-	torus->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	torus->IndexCount = torus->Geo->DrawArgs["torus"].IndexCount;
-	torus->StartIndexLocation = torus->Geo->DrawArgs["torus"].StartIndexLocation;
-	torus->BaseVertexLocation = torus->Geo->DrawArgs["torus"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(torus));
-
-	//Skull
-	auto skullRitem = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&skullRitem->World, XMMatrixScaling(0.2f, 0.2f, 0.2f)*XMMatrixTranslation(-5.0f, 3.0f, -8.0f));
-	skullRitem->TexTransform = MathHelper::Identity4x4();
-	skullRitem->ObjCBIndex = objCBIndex++;
-	skullRitem->Mat = mMaterials["diamond1Mat"].get();
-	skullRitem->Geo = mGeometries["skullGeo"].get();
-	skullRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
-	skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
-	skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(skullRitem));
+	// The scene is authored as text and loaded from its binary form.  Convert it
+	// again when the text has been edited since the last conversion.
+	const std::wstring textFile = L"Scenes/Castle.txt";
+	const std::wstring sceneFile = L"Scenes/Castle.scnb";
+	if(SceneFile::IsOutOfDate(textFile, sceneFile))
+		SceneFile::ConvertText(textFile, sceneFile);
+
+	// A binary from an earlier version of the format is converted again too.
+	SceneFile scene;
+	bool loaded = scene.Load(sceneFile);
+	if(!loaded)
+	{
+		SceneFile::ConvertText(textFile, sceneFile);
+		loaded = scene.Load(sceneFile);
+	}
+	if(!loaded)
+	{
+		MessageBox(0, L"Scenes/Castle.scnb is missing or invalid.", 0, 0);
+		ThrowIfFailed(E_INVALIDARG);
+	}
+
+	// Names are resolved to handles once per table entry, not once per item.
+	std::vector<SlotHandle> geos(scene.GeometryCount());
+	std::vector<SubmeshGeometry> submeshes(scene.GeometryCount());
+	for(UINT i = 0; i < scene.GeometryCount(); ++i)
+	{
+		const SceneFile::GeometryRef& ref = scene.Geometries()[i];
+		geos[i] = mGeometries.Find(mNames.Find(scene.GetString(ref.GeometryName)));
+		if(!mGeometries.IsValid(geos[i]))
+			ThrowIfFailed(E_INVALIDARG);
+
+		const MeshGeometry& geo = mGeometries[geos[i]];
+		UINT submesh = geo.FindSubmesh(scene.GetString(ref.SubmeshName));
+		if(submesh >= geo.Submeshes.size())
+			ThrowIfFailed(E_INVALIDARG);
+
+		submeshes[i] = geo.Submeshes[submesh];
+	}
+
+	std::vector<SlotHandle> mats(scene.MaterialCount());
+	for(UINT i = 0; i < scene.MaterialCount(); ++i)
+	{
+		mats[i] = mMaterials.Find(mNames.Find(scene.GetString(scene.Materials()[i])));
+		if(!mMaterials.IsValid(mats[i]))
+			ThrowIfFailed(E_INVALIDARG);
+	}
+
+	// Scene nodes only ever refer to earlier nodes, so they can be created in order.
+	// A node below a movable node can move too.
+	std::vector<SceneGraph::NodeHandle> nodes(scene.NodeCount());
+	std::vector<bool> movable(scene.NodeCount());
+	for(UINT i = 0; i < scene.NodeCount(); ++i)
+	{
+		const SceneFile::Node& node = scene.Nodes()[i];
+		SceneGraph::NodeHandle parent = node.Parent == SceneFile::InvalidIndex ?
+			SceneGraph::InvalidNode : nodes[node.Parent];
+		nodes[i] = mSceneGraph.CreateNode(parent, scene.Transforms()[node.Transform]);
+		movable[i] = (node.Flags & SceneFile::NodeMovable) != 0 ||
+			(node.Parent != SceneFile::InvalidIndex && movable[node.Parent]);
+	}
+
+	StaticBatcher staticBatcher(sizeof(Vertex), offsetof(Vertex, Pos), offsetof(Vertex, Normal));
+
+	// Each dynamic item gets its own node under its parent, holding its local
+	// transform.  Static items are only queued for baking, unless a movable node
+	// above them would leave the baked vertices behind when it moves.
+	for(UINT i = 0; i < scene.ItemCount(); ++i)
+	{
+		const SceneFile::Item& item = scene.Items()[i];
+		const SubmeshGeometry& submesh = submeshes[item.Geometry];
+
+		const bool underMovable = item.Parent != SceneFile::InvalidIndex && movable[item.Parent];
+		if((item.Flags & SceneFile::ItemStatic) && !underMovable)
+		{
+			XMMATRIX world = XMLoadFloat4x4(&scene.Transforms()[item.Transform]);
+			if(item.Parent != SceneFile::InvalidIndex)
+			{
+				XMFLOAT4X4 parentWorld = mSceneGraph.ComputeWorldTransform(nodes[item.Parent]);
+				world = XMMatrixMultiply(world, XMLoadFloat4x4(&parentWorld));
+			}
+
+			StaticOccluder occluder;
+			occluder.Bounds = submesh.Bounds;
+			XMStoreFloat4x4(&occluder.World, world);
+
+			// The pool keeps a system memory copy of its buffers to bake from.
+			const MeshGeometry& geo = mGeometries[geos[item.Geometry]];
+			if(geo.VertexByteStride != sizeof(Vertex))
+				ThrowIfFailed(E_INVALIDARG);
+
+			const BYTE* vertices = reinterpret_cast<const BYTE*>(geo.VertexBufferCPU->GetBufferPointer()) +
+				(size_t)submesh.BaseVertexLocation*sizeof(Vertex);
+			const std::uint32_t* indices = reinterpret_cast<const std::uint32_t*>(geo.IndexBufferCPU->GetBufferPointer()) +
+				submesh.StartIndexLocation;
+			staticBatcher.Add(i, item.Material, vertices, indices, submesh.IndexCount, occluder.World, submesh.Bounds);
+
+			if(item.Flags & SceneFile::ItemOccluder)
+				mStaticOccluders.push_back(occluder);
+			continue;
+		}
+
+		RenderItem ritem;
+		ritem.Mat = mats[item.Material];
+		ritem.Geo = geos[item.Geometry];
+		ritem.PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		ritem.IndexCount = submesh.IndexCount;
+		ritem.StartIndexLocation = submesh.StartIndexLocation;
+		ritem.BaseVertexLocation = submesh.BaseVertexLocation;
+
+		RenderItemInfo info;
+		info.TexTransform = scene.Transforms()[item.TexTransform];
+		info.Bounds = submesh.Bounds;
+		info.Occluder = (item.Flags & SceneFile::ItemOccluder) != 0;
+		info.Name = scene.GetString(scene.Geometries()[item.Geometry].SubmeshName);
+
+		SceneGraph::NodeHandle parent = item.Parent == SceneFile::InvalidIndex ?
+			SceneGraph::InvalidNode : nodes[item.Parent];
+		info.Node = mSceneGraph.CreateNode(parent, scene.Transforms()[item.Transform]);
+		info.World = mSceneGraph.ComputeWorldTransform(info.Node);
+
+		SceneGraph::NodeHandle node = info.Node;
+		RenderItemPool::Handle handle = mRitems.Add(ritem, std::move(info));
+
+		mNodeRitems.resize(mSceneGraph.NodeCount());
+		mNodeRitems[node] = handle;
+	}
+
+	// Bake the static items into the geometry pool, so the batches share the IA
+	// bindings of everything else.  Their vertices are in world space.
+	staticBatcher.Build(mThreadPool.get());
+
+	MeshGeometry staticGeo;
+	staticGeo.Name = "staticBatchGeo";
+	mGeometryPool->BindMeshGeometry(&staticGeo, sizeof(Vertex));
+
+	const std::vector<StaticBatcher::Batch>& batches = staticBatcher.GetBatches();
+	for(size_t i = 0; i < batches.size(); ++i)
+	{
+		const StaticBatcher::Batch& batch = batches[i];
+		staticGeo.AddSubmesh("batch" + std::to_string(i), mGeometryPool->AddMesh(
+			batch.Vertices.data(), batch.VertexCount, sizeof(Vertex),
+			batch.Indices.data(), (UINT)batch.Indices.size()));
+	}
+
+	NameRegistry::NameId staticGeoName = mNames.Intern(staticGeo.Name);
+	SlotHandle staticGeoHandle = mGeometries.Insert(std::move(staticGeo), staticGeoName);
+	const MeshGeometry& bakedGeo = mGeometries[staticGeoHandle];
+
+	for(size_t i = 0; i < batches.size(); ++i)
+	{
+		const SubmeshGeometry& submesh = bakedGeo.Submeshes[i];
+
+		RenderItem ritem;
+		ritem.Mat = mats[batches[i].Material];
+		ritem.Geo = staticGeoHandle;
+		ritem.PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		ritem.IndexCount = submesh.IndexCount;
+		ritem.StartIndexLocation = submesh.StartIndexLocation;
+		ritem.BaseVertexLocation = submesh.BaseVertexLocation;
+
+		RenderItemInfo info;
+		info.Bounds = batches[i].Bounds;
+		info.Name = bakedGeo.SubmeshNames[i];
+		mRitems.Add(ritem, std::move(info));
+	}
+
+	const StaticBatcher::Stats& batchStats = staticBatcher.GetStats();
+	std::wstring batchText = L"Static batching: " + std::to_wstring(batchStats.Instances) + L" items in " +
+		std::to_wstring(batchStats.Batches) + L" batches, " + std::to_wstring(batchStats.Vertices) + L" vertices, " +
+		std::to_wstring(batchStats.Milliseconds) + L" ms\n";
+	::OutputDebugString(batchText.c_str());
+}
+
+// Records the frame's passes.  Draw records into the command list; the submission
+// benchmark records the same calls into a command stream.
+void ShapesApp::RecordFrame(CommandRecorder* cmdList)
+{
+	ID3D12DescriptorHeap* descriptorHeaps[] = { mDescriptorHeap->Heap() };
+	cmdList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+
+	// The back buffer is only presented, so it is the graph's output.  The depth
+	// buffer stays in DEPTH_WRITE between frames.
+	mRenderGraph.Reset();
+	RenderGraph::ResourceHandle backBuffer = mRenderGraph.ImportResource("BackBuffer", CurrentBackBuffer(),
+		D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT, true);
+	RenderGraph::ResourceHandle depthBuffer = mRenderGraph.ImportResource("DepthStencil", mDepthStencilBuffer.Get(),
+		D3D12_RESOURCE_STATE_DEPTH_WRITE, D3D12_RESOURCE_STATE_DEPTH_WRITE, false);
+
+	RenderGraph::PassHandle clearPass = mRenderGraph.AddPass("Clear", [this](CommandRecorder* cmdList)
+	{
+		cmdList->ClearRenderTargetView(CurrentBackBufferView(), Colors::LightSteelBlue, 0, nullptr);
+		cmdList->ClearDepthStencilView(DepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+	});
+	mRenderGraph.Write(clearPass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	mRenderGraph.Write(clearPass, depthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+	RenderGraph::PassHandle opaquePass = mRenderGraph.AddPass("Opaque", [this](CommandRecorder* cmdList)
+	{
+		cmdList->RSSetViewports(1, &mScreenViewport);
+		cmdList->RSSetScissorRects(1, &mScissorRect);
+		cmdList->OMSetRenderTargets(1, &CurrentBackBufferView(), true, &DepthStencilView());
 
+		cmdList->SetPipelineState(mPipelineCache->Get(mOpaquePSO));
+		cmdList->SetGraphicsRootSignature(mRootSignature.Get());
+		cmdList->SetGraphicsRootConstantBufferView(2, mPassCBAlloc.GpuAddress);
 
-	
-    auto gridRitem = std::make_unique<RenderItem>();
-    gridRitem->World = MathHelper::Identity4x4();
-	XMStoreFloat4x4(&gridRitem->TexTransform, XMMatrixScaling(40.0f, 40.0f, 1.0f));
-	gridRitem->ObjCBIndex = objCBIndex++;
-	gridRitem->Mat = mMaterials["tile0"].get();
-	gridRitem->Geo = mGeometries["shapeGeo"].get();
-	gridRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-    gridRitem->IndexCount = gridRitem->Geo->DrawArgs["grid"].IndexCount;
-    gridRitem->StartIndexLocation = gridRitem->Geo->DrawArgs["grid"].StartIndexLocation;
-    gridRitem->BaseVertexLocation = gridRitem->Geo->DrawArgs["grid"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(gridRitem));
-	
-	
-	
-	/*
+		if(mClusteredLighting)
+		{
+			cmdList->SetGraphicsRootShaderResourceView(mClusterRootParameter, mClusterLightsAlloc.GpuAddress);
+			cmdList->SetGraphicsRootShaderResourceView(mClusterRootParameter + 1, mClusterRangesAlloc.GpuAddress);
+			cmdList->SetGraphicsRootShaderResourceView(mClusterRootParameter + 2, mClusterIndicesAlloc.GpuAddress);
+		}
+
+		if(mIndirectArgsReady)
+			DrawRenderItemsIndirect(cmdList);
+		else
+			DrawRenderItems(cmdList, mVisibleRitems);
+	});
+	mRenderGraph.Write(opaquePass, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+	mRenderGraph.Write(opaquePass, depthBuffer, D3D12_RESOURCE_STATE_DEPTH_WRITE);
 
-	XMMATRIX brickTexTransform = XMMatrixScaling(1.0f, 1.0f, 1.0f);
-	for(int i = 0; i < 5; ++i)
+	mRenderGraph.Compile();
+	if(!mRenderGraphLogged)
 	{
-		auto leftCylRitem = std::make_unique<RenderItem>();
-		auto rightCylRitem = std::make_unique<RenderItem>();
-		auto leftSphereRitem = std::make_unique<RenderItem>();
-		auto rightSphereRitem = std::make_unique<RenderItem>();
-	
-		XMMATRIX leftCylWorld = XMMatrixTranslation(-5.0f, 1.5f, -10.0f + i*5.0f);
-		XMMATRIX rightCylWorld = XMMatrixTranslation(+5.0f, 1.5f, -10.0f + i*5.0f);
-	
-		XMMATRIX leftSphereWorld = XMMatrixTranslation(-5.0f, 3.5f, -10.0f + i*5.0f);
-		XMMATRIX rightSphereWorld = XMMatrixTranslation(+5.0f, 3.5f, -10.0f + i*5.0f);
-	
-		XMStoreFloat4x4(&leftCylRitem->World, rightCylWorld);
-		XMStoreFloat4x4(&leftCylRitem->TexTransform, brickTexTransform);
-		leftCylRitem->ObjCBIndex = objCBIndex++;
-		leftCylRitem->Mat = mMaterials["gold"].get();
-		leftCylRitem->Geo = mGeometries["shapeGeo"].get();
-		leftCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
-		leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
-		leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-	
-		XMStoreFloat4x4(&rightCylRitem->World, leftCylWorld);
-		XMStoreFloat4x4(&rightCylRitem->TexTransform, brickTexTransform);
-		rightCylRitem->ObjCBIndex = objCBIndex++;
-		rightCylRitem->Mat = mMaterials["gold"].get();
-		rightCylRitem->Geo = mGeometries["shapeGeo"].get();
-		rightCylRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
-		rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
-		rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
-	
-		XMStoreFloat4x4(&leftSphereRitem->World, leftSphereWorld);
-		leftSphereRitem->TexTransform = MathHelper::Identity4x4();
-		leftSphereRitem->ObjCBIndex = objCBIndex++;
-		leftSphereRitem->Mat = mMaterials["stone0"].get();
-		leftSphereRitem->Geo = mGeometries["shapeGeo"].get();
-		leftSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
-		leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
-		leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
-	
-		XMStoreFloat4x4(&rightSphereRitem->World, rightSphereWorld);
-		rightSphereRitem->TexTransform = MathHelper::Identity4x4();
-		rightSphereRitem->ObjCBIndex = objCBIndex++;
-		rightSphereRitem->Mat = mMaterials["stone0"].get();
-		rightSphereRitem->Geo = mGeometries["shapeGeo"].get();
-		rightSphereRitem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-		rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
-		rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
-		rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
-	
-		mAllRitems.push_back(std::move(leftCylRitem));
-		mAllRitems.push_back(std::move(rightCylRitem));
-		mAllRitems.push_back(std::move(leftSphereRitem));
-		mAllRitems.push_back(std::move(rightSphereRitem));
+		::OutputDebugStringA(mRenderGraph.DumpSchedule().c_str());
+		mRenderGraphLogged = true;
 	}
-	
-	auto diamond1 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&diamond1->World, XMMatrixScaling(0.4f, 0.6f, 0.4f)*XMMatrixTranslation(-0.65f, 2.6f, -0.65f));
-	diamond1->TexTransform = MathHelper::Identity4x4();
-	diamond1->ObjCBIndex = objCBIndex++;
-	diamond1->Mat = mMaterials["diamond1Mat"].get();
-	diamond1->Geo = mGeometries["shapeGeo"].get();
-	diamond1->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	diamond1->IndexCount = diamond1->Geo->DrawArgs["diamond"].IndexCount;
-	diamond1->StartIndexLocation = diamond1->Geo->DrawArgs["diamond"].StartIndexLocation;
-	diamond1->BaseVertexLocation = diamond1->Geo->DrawArgs["diamond"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(diamond1));
-	
-	auto diamond2 = std::make_unique<RenderItem>();
-	XMStoreFloat4x4(&diamond2->World, XMMatrixScaling(0.4f, 0.6f, 0.4f)*XMMatrixTranslation(0.65f, 2.6f, -0.65f));
-	diamond2->TexTransform = MathHelper::Identity4x4();
-	diamond2->ObjCBIndex = objCBIndex++;
-	diamond2->Mat = mMaterials["diamond2Mat"].get();
-	diamond2->Geo = mGeometries["shapeGeo"].get();
-	diamond2->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
-	diamond2->IndexCount = diamond2->Geo->DrawArgs["diamond"].IndexCount;
-	diamond2->StartIndexLocation = diamond2->Geo->DrawArgs["diamond"].StartIndexLocation;
-	diamond2->BaseVertexLocation = diamond2->Geo->DrawArgs["diamond"].BaseVertexLocation;
-	mAllRitems.push_back(std::move(diamond2));
-
-	*/
-
-	// All the render items are opaque.
-	for(auto& e : mAllRitems)
-		mOpaqueRitems.push_back(e.get());
+
+	mRenderGraph.Execute(cmdList);
 }
 
-void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& ritems)
+void ShapesApp::DrawRenderItems(CommandRecorder* cmdList, const std::vector<UINT>& ritems)
 {
-    UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
     UINT matCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(MaterialConstants));
  
-	auto objectCB = mCurrFrameResource->ObjectCB->Resource();
 	auto matCB = mCurrFrameResource->MaterialCB->Resource();
 
+	if(mPackedObjectData)
+	{
+		// The object and material arrays are bound once for the whole pass.
+		cmdList->SetGraphicsRootShaderResourceView(1, mObjectCBAlloc.GpuAddress);
+		cmdList->SetGraphicsRootShaderResourceView(3, matCB->GetGPUVirtualAddress());
+	}
+
+	// Geometry lives in the shared pool, so the IA state normally only has to be
+	// bound once per pass.  Only rebind when it actually changes.
+	D3D12_GPU_VIRTUAL_ADDRESS currVertexBuffer = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS currIndexBuffer = 0;
+	D3D12_PRIMITIVE_TOPOLOGY currTopology = D3D_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
     // For each render item...
     for(size_t i = 0; i < ritems.size(); ++i)
     {
-        auto ri = ritems[i];
+        const RenderItem* ri = &mRitems.Items()[ritems[i]];
 
-        cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-        cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-        cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+		const MeshGeometry& geo = mGeometries[ri->Geo];
+		const Material& mat = mMaterials[ri->Mat];
 
-        D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->ObjCBIndex*objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex*matCBByteSize;
+		D3D12_VERTEX_BUFFER_VIEW vbv = geo.VertexBufferView();
+		if(vbv.BufferLocation != currVertexBuffer)
+		{
+			cmdList->IASetVertexBuffers(0, 1, &vbv);
+			currVertexBuffer = vbv.BufferLocation;
+		}
+
+		D3D12_INDEX_BUFFER_VIEW ibv = geo.IndexBufferView();
+		if(ibv.BufferLocation != currIndexBuffer)
+		{
+			cmdList->IASetIndexBuffer(&ibv);
+			currIndexBuffer = ibv.BufferLocation;
+		}
 
-        cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
-		cmdList->SetGraphicsRootConstantBufferView(1, matCBAddress);
+		if(ri->PrimitiveType != currTopology)
+		{
+			cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+			currTopology = ri->PrimitiveType;
+		}
+
+		if(mPackedObjectData)
+		{
+			UINT drawIndices[2] = { ri->ObjCBIndex, (UINT)mat.MatCBIndex };
+			cmdList->SetGraphicsRoot32BitConstants(0, 2, drawIndices, 0);
+		}
+		else
+		{
+			D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = mObjectCBAlloc.ElementGpuAddress(ri->ObjCBIndex);
+			D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + mat.MatCBIndex*matCBByteSize;
+
+			cmdList->SetGraphicsRootConstantBufferView(0, objCBAddress);
+			cmdList->SetGraphicsRootConstantBufferView(1, matCBAddress);
+		}
 
         cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
     }
 }
+
+void ShapesApp::BuildIndirectArguments()
+{
+	mIndirectArgsReady = false;
+	mIndirectBuilder.Reset();
+	if(!mIndirectDraws || mCommandSignature == nullptr || mVisibleRitems.empty())
+		return;
+
+	// One ExecuteIndirect can only change root constants between draws, so every
+	// item must use the IA state of the first.
+	const RenderItem* items = mRitems.Items();
+	const MeshGeometry& firstGeo = mGeometries[items[mVisibleRitems[0]].Geo];
+	const D3D12_GPU_VIRTUAL_ADDRESS vertexBuffer = firstGeo.VertexBufferView().BufferLocation;
+	const D3D12_GPU_VIRTUAL_ADDRESS indexBuffer = firstGeo.IndexBufferView().BufferLocation;
+	const D3D12_PRIMITIVE_TOPOLOGY topology = items[mVisibleRitems[0]].PrimitiveType;
+
+	for(UINT i : mVisibleRitems)
+	{
+		const RenderItem& ri = items[i];
+		const MeshGeometry& geo = mGeometries[ri.Geo];
+		if(geo.VertexBufferView().BufferLocation != vertexBuffer ||
+		   geo.IndexBufferView().BufferLocation != indexBuffer || ri.PrimitiveType != topology)
+		{
+			mIndirectBuilder.Reset();
+			return;
+		}
+
+		UINT drawIndices[2] = { ri.ObjCBIndex, (UINT)mMaterials[ri.Mat].MatCBIndex };
+
+		D3D12_DRAW_INDEXED_ARGUMENTS args;
+		args.IndexCountPerInstance = ri.IndexCount;
+		args.InstanceCount = 1;
+		args.StartIndexLocation = ri.StartIndexLocation;
+		args.BaseVertexLocation = ri.BaseVertexLocation;
+		args.StartInstanceLocation = 0;
+		mIndirectBuilder.AddDraw(drawIndices, args);
+	}
+
+	// Upload heap memory is readable as indirect arguments without a transition.
+	mIndirectArgsAlloc = mCurrFrameResource->UploadAlloc->Allocate(mIndirectBuilder.ByteSize(), sizeof(UINT));
+	memcpy(mIndirectArgsAlloc.CpuAddress, mIndirectBuilder.Data(), (size_t)mIndirectBuilder.ByteSize());
+	mIndirectArgsReady = true;
+}
+
+void ShapesApp::DrawRenderItemsIndirect(CommandRecorder* cmdList)
+{
+	const RenderItem& first = mRitems.Items()[mVisibleRitems[0]];
+	const MeshGeometry& geo = mGeometries[first.Geo];
+
+	cmdList->SetGraphicsRootShaderResourceView(1, mObjectCBAlloc.GpuAddress);
+	cmdList->SetGraphicsRootShaderResourceView(3, mCurrFrameResource->MaterialCB->Resource()->GetGPUVirtualAddress());
+
+	D3D12_VERTEX_BUFFER_VIEW vbv = geo.VertexBufferView();
+	D3D12_INDEX_BUFFER_VIEW ibv = geo.IndexBufferView();
+	cmdList->IASetVertexBuffers(0, 1, &vbv);
+	cmdList->IASetIndexBuffer(&ibv);
+	cmdList->IASetPrimitiveTopology(first.PrimitiveType);
+
+	cmdList->ExecuteIndirect(mCommandSignature.Get(), mIndirectBuilder.CommandCount(),
+		mIndirectArgsAlloc.Resource, mIndirectArgsAlloc.Offset, nullptr, 0);
+}
@@ -0,0 +1,169 @@
+#include "BuddyAllocator.h"
+#include <algorithm>
+#include <cassert>
+#include <map>
+
+[[maybe_unused]] static bool IsPow2(uint64_t x)
+{
+    return x != 0 && (x & (x - 1)) == 0;
+}
+
+BuddyAllocator::BuddyAllocator(uint64_t totalSize, uint64_t minBlockSize) :
+    mTotalSize(totalSize),
+    mMinBlockSize(minBlockSize)
+{
+    assert(IsPow2(totalSize) && IsPow2(minBlockSize) && minBlockSize <= totalSize);
+
+    while(OrderSize(mMaxOrder) < mTotalSize)
+        ++mMaxOrder;
+
+    mFreeBlocks.resize(mMaxOrder + 1);
+    mFreeBlocks[mMaxOrder].insert(0);
+}
+
+uint64_t BuddyAllocator::Allocate(uint64_t byteSize)
+{
+    if(byteSize == 0 || byteSize > mTotalSize)
+        return InvalidOffset;
+
+    uint32_t order = OrderForSize(byteSize);
+
+    // Find the smallest free block that fits.
+    uint32_t freeOrder = order;
+    while(freeOrder <= mMaxOrder && mFreeBlocks[freeOrder].empty())
+        ++freeOrder;
+
+    if(freeOrder > mMaxOrder)
+        return InvalidOffset;
+
+    uint64_t offset = *mFreeBlocks[freeOrder].begin();
+    mFreeBlocks[freeOrder].erase(mFreeBlocks[freeOrder].begin());
+
+    // Split it down to the requested order, freeing the upper halves.
+    while(freeOrder > order)
+    {
+        --freeOrder;
+        mFreeBlocks[freeOrder].insert(offset + OrderSize(freeOrder));
+    }
+
+    Block block;
+    block.Order = order;
+    block.RequestedSize = byteSize;
+    mAllocations[offset] = block;
+
+    mAllocatedBytes += OrderSize(order);
+    mRequestedBytes += byteSize;
+
+    return offset;
+}
+
+void BuddyAllocator::Free(uint64_t offset)
+{
+    auto it = mAllocations.find(offset);
+    assert(it != mAllocations.end());
+    if(it == mAllocations.end())
+        return;
+
+    uint32_t order = it->second.Order;
+    mAllocatedBytes -= OrderSize(order);
+    mRequestedBytes -= it->second.RequestedSize;
+    mAllocations.erase(it);
+
+    // Merge with the buddy as long as it is free too.
+    while(order < mMaxOrder)
+    {
+        uint64_t buddy = offset ^ OrderSize(order);
+        auto buddyIt = mFreeBlocks[order].find(buddy);
+        if(buddyIt == mFreeBlocks[order].end())
+            break;
+
+        mFreeBlocks[order].erase(buddyIt);
+        offset = std::min(offset, buddy);
+        ++order;
+    }
+
+    mFreeBlocks[order].insert(offset);
+}
+
+uint64_t BuddyAllocator::BlockSize(uint64_t byteSize)const
+{
+    return OrderSize(OrderForSize(byteSize));
+}
+
+BuddyAllocator::Stats BuddyAllocator::GetStats()const
+{
+    Stats stats;
+    stats.TotalBytes = mTotalSize;
+    stats.AllocatedBytes = mAllocatedBytes;
+    stats.RequestedBytes = mRequestedBytes;
+    stats.FreeBytes = mTotalSize - mAllocatedBytes;
+    stats.AllocationCount = (uint32_t)mAllocations.size();
+
+    for(uint32_t order = 0; order <= mMaxOrder; ++order)
+    {
+        stats.FreeBlockCount += (uint32_t)mFreeBlocks[order].size();
+        if(!mFreeBlocks[order].empty())
+            stats.LargestFreeBlock = OrderSize(order);
+    }
+
+    return stats;
+}
+
+bool BuddyAllocator::Validate()const
+{
+    // Gather every block, free or allocated, sorted by offset.
+    std::map<uint64_t, uint64_t> blocks;
+    uint64_t freeBytes = 0;
+
+    for(uint32_t order = 0; order <= mMaxOrder; ++order)
+    {
+        for(uint64_t offset : mFreeBlocks[order])
+        {
+            // Blocks are aligned to their own size.
+            if(offset % OrderSize(order) != 0)
+                return false;
+
+            // An unmerged pair of free buddies means Free went wrong.
+            if(order < mMaxOrder && mFreeBlocks[order].count(offset ^ OrderSize(order)) != 0)
+                return false;
+
+            if(!blocks.emplace(offset, OrderSize(order)).second)
+                return false;
+            freeBytes += OrderSize(order);
+        }
+    }
+
+    uint64_t allocatedBytes = 0;
+    for(auto& a : mAllocations)
+    {
+        uint64_t size = OrderSize(a.second.Order);
+        if(a.first % size != 0 || a.second.RequestedSize > size)
+            return false;
+        if(!blocks.emplace(a.first, size).second)
+            return false;
+        allocatedBytes += size;
+    }
+
+    if(allocatedBytes != mAllocatedBytes || freeBytes + allocatedBytes != mTotalSize)
+        return false;
+
+    // The blocks must tile [0, mTotalSize) exactly.
+    uint64_t expected = 0;
+    for(auto& b : blocks)
+    {
+        if(b.first != expected)
+            return false;
+        expected += b.second;
+    }
+
+    return expected == mTotalSize;
+}
+
+uint32_t BuddyAllocator::OrderForSize(uint64_t byteSize)const
+{
+    uint32_t order = 0;
+    while(OrderSize(order) < byteSize)
+        ++order;
+
+    return order;
+}
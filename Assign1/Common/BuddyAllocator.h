@@ -0,0 +1,87 @@
+//***************************************************************************************
+// BuddyAllocator.h
+//
+// Binary buddy allocator over an abstract address range.  It only hands out offsets
+// and has no dependency on Direct3D, so it can be driven and validated on the CPU
+// without a device (see HeapManager for the placed resource front end).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+class BuddyAllocator
+{
+public:
+    static const uint64_t InvalidOffset = ~0ull;
+
+    struct Stats
+    {
+        uint64_t TotalBytes = 0;
+        uint64_t AllocatedBytes = 0;   // Sum of the (power of two) blocks in use.
+        uint64_t RequestedBytes = 0;   // Sum of the sizes that were asked for.
+        uint64_t FreeBytes = 0;
+        uint64_t LargestFreeBlock = 0;
+        uint32_t AllocationCount = 0;
+        uint32_t FreeBlockCount = 0;
+
+        // Share of the allocated bytes lost to rounding up to a block size.
+        float InternalFragmentation()const
+        {
+            return AllocatedBytes == 0 ? 0.0f : 1.0f - (float)RequestedBytes / (float)AllocatedBytes;
+        }
+
+        // Share of the free bytes that cannot be handed out as one allocation.
+        float ExternalFragmentation()const
+        {
+            return FreeBytes == 0 ? 0.0f : 1.0f - (float)LargestFreeBlock / (float)FreeBytes;
+        }
+    };
+
+    // totalSize and minBlockSize must be powers of two with minBlockSize <= totalSize.
+    BuddyAllocator(uint64_t totalSize, uint64_t minBlockSize);
+
+    // Returns the offset of a block of at least byteSize bytes, aligned to the
+    // block size, or InvalidOffset if no block is large enough.
+    uint64_t Allocate(uint64_t byteSize);
+    void Free(uint64_t offset);
+
+    // Size of the block backing a byteSize request.
+    uint64_t BlockSize(uint64_t byteSize)const;
+
+    uint64_t TotalSize()const { return mTotalSize; }
+    uint64_t MinBlockSize()const { return mMinBlockSize; }
+    bool Empty()const { return mAllocations.empty(); }
+
+    Stats GetStats()const;
+
+    // Checks that the free and allocated blocks tile the whole range without
+    // overlapping and that no two free buddies were left unmerged.
+    bool Validate()const;
+
+private:
+    uint32_t OrderForSize(uint64_t byteSize)const;
+    uint64_t OrderSize(uint32_t order)const { return mMinBlockSize << order; }
+
+private:
+    struct Block
+    {
+        uint32_t Order = 0;
+        uint64_t RequestedSize = 0;
+    };
+
+    uint64_t mTotalSize = 0;
+    uint64_t mMinBlockSize = 0;
+    uint32_t mMaxOrder = 0;
+
+    // Free block offsets per order.  Ordered so allocation is deterministic and
+    // prefers low addresses, which keeps the top of the range free for big blocks.
+    std::vector<std::set<uint64_t>> mFreeBlocks;
+    std::unordered_map<uint64_t, Block> mAllocations;
+
+    uint64_t mAllocatedBytes = 0;
+    uint64_t mRequestedBytes = 0;
+};
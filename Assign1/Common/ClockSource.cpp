@@ -0,0 +1,103 @@
+#include "ClockSource.h"
+
+#include <algorithm>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(CLOCK_SOURCE_HAS_TSC)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+double ClockSource::MeasureOverhead(int sampleCount)
+{
+    if(sampleCount < 1)
+        sampleCount = 1;
+
+    std::vector<std::int64_t> deltas(sampleCount);
+    for(int i = 0; i < sampleCount; ++i)
+    {
+        std::int64_t t0 = Now();
+        std::int64_t t1 = Now();
+        deltas[i] = t1 - t0;
+    }
+
+    // The median ignores the samples an interrupt or context switch landed in.
+    std::nth_element(deltas.begin(), deltas.begin() + sampleCount / 2, deltas.end());
+    return deltas[sampleCount / 2] * SecondsPerCount();
+}
+
+#if defined(_WIN32)
+QpcClockSource::QpcClockSource()
+{
+    LARGE_INTEGER countsPerSec;
+    QueryPerformanceFrequency(&countsPerSec);
+    mSecondsPerCount = 1.0 / (double)countsPerSec.QuadPart;
+}
+
+std::int64_t QpcClockSource::Now()
+{
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+std::int64_t MonotonicClockSource::Now()
+{
+    // CLOCK_MONOTONIC_RAW is not slewed by NTP, so intervals measured with it are
+    // not stretched or squeezed while the system clock is being corrected.
+    timespec ts;
+#if defined(CLOCK_MONOTONIC_RAW)
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (std::int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+#if defined(CLOCK_SOURCE_HAS_TSC)
+TscClockSource::TscClockSource(double calibrationSeconds)
+{
+    std::unique_ptr<ClockSource> reference = CreateDefaultClock();
+    const double referenceSeconds = reference->SecondsPerCount();
+
+    // Spin rather than sleep: the reads on either end are what is being compared,
+    // and a spin keeps the thread on one core for the whole interval.
+    std::int64_t start = reference->Now();
+    std::uint64_t tscStart = __rdtsc();
+    std::int64_t end = start;
+    while((end - start) * referenceSeconds < calibrationSeconds)
+        end = reference->Now();
+    std::uint64_t tscEnd = __rdtsc();
+
+    double elapsed = (end - start) * referenceSeconds;
+    mSecondsPerCount = tscEnd > tscStart ? elapsed / (double)(tscEnd - tscStart) : 0.0;
+}
+
+std::int64_t TscClockSource::Now()
+{
+    return (std::int64_t)__rdtsc();
+}
+#endif
+
+std::unique_ptr<ClockSource> CreateDefaultClock()
+{
+#if defined(_WIN32)
+    return std::make_unique<QpcClockSource>();
+#elif defined(__unix__) || defined(__APPLE__)
+    return std::make_unique<MonotonicClockSource>();
+#else
+    return std::make_unique<ManualClockSource>();
+#endif
+}
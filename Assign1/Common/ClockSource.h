@@ -0,0 +1,97 @@
+//***************************************************************************************
+// ClockSource.h
+//
+// Monotonic tick counters GameTimer can be built on:
+//
+//   QpcClockSource        QueryPerformanceCounter (Windows).
+//   MonotonicClockSource  clock_gettime(CLOCK_MONOTONIC_RAW) (Linux and other POSIX).
+//   TscClockSource        The x86 time stamp counter, read with rdtsc.  Its frequency
+//                         is measured against the default clock when it is created,
+//                         so it assumes an invariant TSC.
+//   ManualClockSource     Only moves when told to, for deterministic tests and replays.
+//
+// CreateDefaultClock returns the platform's usual high-resolution clock.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+class ClockSource
+{
+public:
+    virtual ~ClockSource() = default;
+
+    // Ticks since an arbitrary fixed point.  Never decreases.
+    virtual std::int64_t Now() = 0;
+    virtual double SecondsPerCount()const = 0;
+    virtual const char* Name()const = 0;
+
+    // Seconds one call to Now() takes, as the median of sampleCount back-to-back
+    // pairs of reads.  Zero for a clock that does not move on its own.
+    double MeasureOverhead(int sampleCount = 1001);
+};
+
+#if defined(_WIN32)
+class QpcClockSource : public ClockSource
+{
+public:
+    QpcClockSource();
+
+    std::int64_t Now()override;
+    double SecondsPerCount()const override { return mSecondsPerCount; }
+    const char* Name()const override { return "QPC"; }
+
+private:
+    double mSecondsPerCount = 0.0;
+};
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+class MonotonicClockSource : public ClockSource
+{
+public:
+    std::int64_t Now()override;
+    double SecondsPerCount()const override { return 1e-9; }
+    const char* Name()const override { return "CLOCK_MONOTONIC_RAW"; }
+};
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CLOCK_SOURCE_HAS_TSC 1
+
+class TscClockSource : public ClockSource
+{
+public:
+    // Counts ticks against the default clock for calibrationSeconds to find the
+    // TSC frequency.
+    explicit TscClockSource(double calibrationSeconds = 0.02);
+
+    std::int64_t Now()override;
+    double SecondsPerCount()const override { return mSecondsPerCount; }
+    const char* Name()const override { return "TSC"; }
+
+private:
+    double mSecondsPerCount = 0.0;
+};
+#endif
+
+class ManualClockSource : public ClockSource
+{
+public:
+    // Counts are nanoseconds.
+    explicit ManualClockSource(std::int64_t start = 0) : mNow(start) {}
+
+    std::int64_t Now()override { return mNow; }
+    double SecondsPerCount()const override { return 1e-9; }
+    const char* Name()const override { return "Manual"; }
+
+    void Advance(double seconds) { mNow += (std::int64_t)(seconds * 1e9 + 0.5); }
+    void Set(std::int64_t now) { mNow = now; }
+
+private:
+    std::int64_t mNow = 0;
+};
+
+std::unique_ptr<ClockSource> CreateDefaultClock();
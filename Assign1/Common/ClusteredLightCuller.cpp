@@ -0,0 +1,260 @@
+#include "ClusteredLightCuller.h"
+#include "ThreadPool.h"
+
+using namespace DirectX;
+
+// A spot light's cone ends where its spot factor drops below this.
+static const float SpotCutoff = 1.0f / 256.0f;
+
+ClusteredLightCuller::ClusteredLightCuller(UINT countX, UINT countY, UINT countZ) :
+    mCountX(countX),
+    mCountY(countY),
+    mCountZ(countZ),
+    mGroupsPerSlice((countX*countY + 3) / 4)
+{
+    mGroups.resize(mGroupsPerSlice*mCountZ);
+    mSliceNear.resize(mCountZ + 1);
+    mSliceResults.resize(mCountZ);
+}
+
+void ClusteredLightCuller::SetProjection(const XMFLOAT4X4& proj, float nearZ, float farZ)
+{
+    const float logDepthRange = logf(farZ / nearZ);
+    mDepthScale = mCountZ / logDepthRange;
+    mDepthBias = -(mCountZ*logf(nearZ)) / logDepthRange;
+
+    for(UINT z = 0; z <= mCountZ; ++z)
+        mSliceNear[z] = nearZ*powf(farZ / nearZ, (float)z / mCountZ);
+
+    for(UINT z = 0; z < mCountZ; ++z)
+    {
+        const float depths[2] = { mSliceNear[z], mSliceNear[z + 1] };
+
+        for(UINT i = 0; i < mGroupsPerSlice*4; ++i)
+        {
+            ClusterGroup& group = mGroups[z*mGroupsPerSlice + i/4];
+            float* lanes[10] =
+            {
+                &group.MinX.x, &group.MinY.x, &group.MinZ.x,
+                &group.MaxX.x, &group.MaxY.x, &group.MaxZ.x,
+                &group.CenterX.x, &group.CenterY.x, &group.CenterZ.x, &group.Radius.x
+            };
+
+            XMFLOAT3 boxMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+            XMFLOAT3 boxMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            float radius = -1.0f;
+
+            // Padding lanes past the last cluster keep an empty box.
+            if(i < mCountX*mCountY)
+            {
+                UINT x = i % mCountX;
+                UINT y = i / mCountX;
+
+                float ndcX[2] = { -1.0f + 2.0f*x / mCountX, -1.0f + 2.0f*(x + 1) / mCountX };
+                float ndcY[2] = { 1.0f - 2.0f*y / mCountY, 1.0f - 2.0f*(y + 1) / mCountY };
+
+                // With w = z, NDC x = (x*_11 + z*_31)/z, so x = (ndcX - _31)*z/_11.
+                for(float depth : depths)
+                {
+                    for(int corner = 0; corner < 4; ++corner)
+                    {
+                        float vx = (ndcX[corner & 1] - proj._31)*depth / proj._11;
+                        float vy = (ndcY[corner >> 1] - proj._32)*depth / proj._22;
+
+                        boxMin = { MathHelper::Min(boxMin.x, vx), MathHelper::Min(boxMin.y, vy), depths[0] };
+                        boxMax = { MathHelper::Max(boxMax.x, vx), MathHelper::Max(boxMax.y, vy), depths[1] };
+                    }
+                }
+
+                float halfX = 0.5f*(boxMax.x - boxMin.x);
+                float halfY = 0.5f*(boxMax.y - boxMin.y);
+                float halfZ = 0.5f*(boxMax.z - boxMin.z);
+                radius = sqrtf(halfX*halfX + halfY*halfY + halfZ*halfZ);
+            }
+
+            float values[10] =
+            {
+                boxMin.x, boxMin.y, boxMin.z,
+                boxMax.x, boxMax.y, boxMax.z,
+                0.5f*(boxMin.x + boxMax.x), 0.5f*(boxMin.y + boxMax.y), 0.5f*(boxMin.z + boxMax.z), radius
+            };
+
+            for(int v = 0; v < 10; ++v)
+                lanes[v][i % 4] = values[v];
+        }
+    }
+}
+
+void ClusteredLightCuller::Cull(const XMFLOAT4X4& view,
+    const std::vector<Light>& pointLights,
+    const std::vector<Light>& spotLights,
+    ThreadPool* pool)
+{
+    XMMATRIX V = XMLoadFloat4x4(&view);
+
+    mPointLights.resize(pointLights.size());
+    for(size_t i = 0; i < pointLights.size(); ++i)
+    {
+        ViewLight& light = mPointLights[i];
+        XMStoreFloat3(&light.Position, XMVector3TransformCoord(XMLoadFloat3(&pointLights[i].Position), V));
+        light.Range = pointLights[i].FalloffEnd;
+        light.Index = (UINT)i;
+    }
+
+    mSpotLights.resize(spotLights.size());
+    for(size_t i = 0; i < spotLights.size(); ++i)
+    {
+        ViewLight& light = mSpotLights[i];
+        XMStoreFloat3(&light.Position, XMVector3TransformCoord(XMLoadFloat3(&spotLights[i].Position), V));
+        XMStoreFloat3(&light.Direction, XMVector3Normalize(
+            XMVector3TransformNormal(XMLoadFloat3(&spotLights[i].Direction), V)));
+        light.Range = spotLights[i].FalloffEnd;
+
+        // pow(cos(angle), SpotPower) = SpotCutoff at the edge of the cone.
+        light.CosAngle = powf(SpotCutoff, 1.0f / MathHelper::Max(spotLights[i].SpotPower, 1.0f));
+        light.SinAngle = sqrtf(1.0f - light.CosAngle*light.CosAngle);
+        light.Index = (UINT)(pointLights.size() + i);
+    }
+
+    if(pool != nullptr)
+        pool->ParallelFor(mCountZ, [this](UINT slice) { CullSlice(slice); });
+    else
+    {
+        for(UINT slice = 0; slice < mCountZ; ++slice)
+            CullSlice(slice);
+    }
+
+    // Concatenate the slices into one index list.
+    mRanges.clear();
+    mIndices.clear();
+    for(const SliceResult& result : mSliceResults)
+    {
+        UINT base = (UINT)mIndices.size();
+        for(ClusterRange range : result.Ranges)
+        {
+            range.Offset += base;
+            mRanges.push_back(range);
+        }
+        mIndices.insert(mIndices.end(), result.Indices.begin(), result.Indices.end());
+    }
+}
+
+void ClusteredLightCuller::CullSlice(UINT slice)
+{
+    const float sliceNear = mSliceNear[slice];
+    const float sliceFar = mSliceNear[slice + 1];
+
+    // Only lights whose bounding sphere overlaps the slice depth range can touch it.
+    std::vector<const ViewLight*> candidates;
+    for(const std::vector<ViewLight>* lights : { &mPointLights, &mSpotLights })
+    {
+        for(const ViewLight& light : *lights)
+        {
+            if(light.Position.z + light.Range >= sliceNear && light.Position.z - light.Range <= sliceFar)
+                candidates.push_back(&light);
+        }
+    }
+    const size_t pointCandidates = std::count_if(candidates.begin(), candidates.end(),
+        [this](const ViewLight* light) { return light->Index < mPointLights.size(); });
+
+    SliceResult& result = mSliceResults[slice];
+    result.Ranges.assign(mCountX*mCountY, ClusterRange());
+    result.Indices.clear();
+
+    const XMVECTOR zero = XMVectorZero();
+
+    std::vector<UINT> clusterLights[4];
+    for(UINT g = 0; g < mGroupsPerSlice; ++g)
+    {
+        const ClusterGroup& group = mGroups[slice*mGroupsPerSlice + g];
+
+        XMVECTOR minX = XMLoadFloat4A(&group.MinX);
+        XMVECTOR minY = XMLoadFloat4A(&group.MinY);
+        XMVECTOR minZ = XMLoadFloat4A(&group.MinZ);
+        XMVECTOR maxX = XMLoadFloat4A(&group.MaxX);
+        XMVECTOR maxY = XMLoadFloat4A(&group.MaxY);
+        XMVECTOR maxZ = XMLoadFloat4A(&group.MaxZ);
+        XMVECTOR centerX = XMLoadFloat4A(&group.CenterX);
+        XMVECTOR centerY = XMLoadFloat4A(&group.CenterY);
+        XMVECTOR centerZ = XMLoadFloat4A(&group.CenterZ);
+        XMVECTOR radius = XMLoadFloat4A(&group.Radius);
+
+        for(auto& lights : clusterLights)
+            lights.clear();
+
+        for(size_t c = 0; c < candidates.size(); ++c)
+        {
+            const ViewLight& light = *candidates[c];
+
+            XMVECTOR px = XMVectorReplicate(light.Position.x);
+            XMVECTOR py = XMVectorReplicate(light.Position.y);
+            XMVECTOR pz = XMVectorReplicate(light.Position.z);
+            XMVECTOR range = XMVectorReplicate(light.Range);
+
+            // Sphere against four boxes: squared distance from the center to each box.
+            XMVECTOR dx = XMVectorMax(XMVectorMax(minX - px, px - maxX), zero);
+            XMVECTOR dy = XMVectorMax(XMVectorMax(minY - py, py - maxY), zero);
+            XMVECTOR dz = XMVectorMax(XMVectorMax(minZ - pz, pz - maxZ), zero);
+            XMVECTOR distSq = dx*dx + dy*dy + dz*dz;
+            XMVECTOR inside = XMVectorLessOrEqual(distSq, range*range);
+
+            if(c >= pointCandidates)
+            {
+                // Cone against the boxes' bounding spheres.  The distance from a
+                // sphere center to the cone is measured along the direction
+                // perpendicular to the cone's edge.
+                XMVECTOR vx = centerX - px;
+                XMVECTOR vy = centerY - py;
+                XMVECTOR vz = centerZ - pz;
+                XMVECTOR lenSq = vx*vx + vy*vy + vz*vz;
+                XMVECTOR axial = vx*XMVectorReplicate(light.Direction.x) +
+                                 vy*XMVectorReplicate(light.Direction.y) +
+                                 vz*XMVectorReplicate(light.Direction.z);
+                XMVECTOR radial = XMVectorSqrt(XMVectorMax(lenSq - axial*axial, zero));
+                XMVECTOR distance = XMVectorReplicate(light.CosAngle)*radial - XMVectorReplicate(light.SinAngle)*axial;
+
+                XMVECTOR outside = XMVectorGreater(distance, radius);
+                outside = XMVectorOrInt(outside, XMVectorGreater(axial, radius + range));
+                outside = XMVectorOrInt(outside, XMVectorLess(axial, -radius));
+                inside = XMVectorAndCInt(inside, outside);
+            }
+
+            XMUINT4 mask;
+            XMStoreUInt4(&mask, inside);
+            const UINT lanes[4] = { mask.x, mask.y, mask.z, mask.w };
+            for(int lane = 0; lane < 4; ++lane)
+            {
+                if(lanes[lane] != 0)
+                    clusterLights[lane].push_back(light.Index);
+            }
+        }
+
+        // Candidates are ordered point lights first, so each list is too.
+        for(UINT lane = 0; lane < 4 && g*4 + lane < mCountX*mCountY; ++lane)
+        {
+            ClusterRange& range = result.Ranges[g*4 + lane];
+            range.Offset = (UINT)result.Indices.size();
+            range.PointCount = (UINT)std::count_if(clusterLights[lane].begin(), clusterLights[lane].end(),
+                [this](UINT index) { return index < mPointLights.size(); });
+            range.SpotCount = (UINT)clusterLights[lane].size() - range.PointCount;
+
+            result.Indices.insert(result.Indices.end(), clusterLights[lane].begin(), clusterLights[lane].end());
+        }
+    }
+}
+
+ClusteredLightCuller::Stats ClusteredLightCuller::GetStats()const
+{
+    Stats stats;
+    stats.IndexCount = (UINT)mIndices.size();
+
+    for(const ClusterRange& range : mRanges)
+    {
+        UINT count = range.PointCount + range.SpotCount;
+        if(count > 0)
+            stats.OccupiedClusters++;
+        stats.MaxLightsPerCluster = MathHelper::Max(stats.MaxLightsPerCluster, count);
+    }
+
+    return stats;
+}
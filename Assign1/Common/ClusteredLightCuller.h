@@ -0,0 +1,113 @@
+//***************************************************************************************
+// ClusteredLightCuller.h
+//
+// Splits the view frustum into a CountX x CountY x CountZ grid of clusters (screen
+// tiles times exponentially spaced depth slices) and finds the point and spot lights
+// that touch each cluster.  Lights are tested four clusters at a time with SIMD
+// sphere-versus-AABB tests, plus a cone test for spot lights.  Depth slices are
+// culled in parallel on a ThreadPool.
+//
+// The result is a compact index list: cluster c uses LightIndices[Offset,
+// Offset+PointCount+SpotCount) of its ClusterRange, point lights first.  Point light
+// i has index i and spot light j has index pointLightCount+j, so the lights are
+// uploaded as one array of the point lights followed by the spot lights.
+//
+// Clusters are numbered x + CountX*(y + CountY*z), with y = 0 at the top of the
+// screen.  A pixel at view depth d is in slice floor(log(d)*DepthScale + DepthBias).
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class ThreadPool;
+
+class ClusteredLightCuller
+{
+public:
+    // Matches the ClusterRange struct in Default.hlsl.
+    struct ClusterRange
+    {
+        UINT Offset = 0;
+        UINT PointCount = 0;
+        UINT SpotCount = 0;
+    };
+
+    struct Stats
+    {
+        UINT IndexCount = 0;
+        UINT OccupiedClusters = 0;
+        UINT MaxLightsPerCluster = 0;
+    };
+
+    ClusteredLightCuller(UINT countX = 16, UINT countY = 9, UINT countZ = 24);
+    ClusteredLightCuller(const ClusteredLightCuller& rhs) = delete;
+    ClusteredLightCuller& operator=(const ClusteredLightCuller& rhs) = delete;
+
+    // Rebuilds the cluster bounds.  proj is a left-handed perspective projection.
+    void SetProjection(const DirectX::XMFLOAT4X4& proj, float nearZ, float farZ);
+
+    // Lights are in world space.  pool may be null to cull on the calling thread.
+    void Cull(const DirectX::XMFLOAT4X4& view,
+        const std::vector<Light>& pointLights,
+        const std::vector<Light>& spotLights,
+        ThreadPool* pool);
+
+    const std::vector<ClusterRange>& GetClusterRanges()const { return mRanges; }
+    const std::vector<UINT>& GetLightIndices()const { return mIndices; }
+
+    UINT CountX()const { return mCountX; }
+    UINT CountY()const { return mCountY; }
+    UINT CountZ()const { return mCountZ; }
+    float DepthScale()const { return mDepthScale; }
+    float DepthBias()const { return mDepthBias; }
+
+    Stats GetStats()const;
+
+private:
+    // Bounds of four clusters of a slice, structure-of-arrays, in view space.
+    struct ClusterGroup
+    {
+        DirectX::XMFLOAT4A MinX, MinY, MinZ;
+        DirectX::XMFLOAT4A MaxX, MaxY, MaxZ;
+        DirectX::XMFLOAT4A CenterX, CenterY, CenterZ, Radius;   // Bounding spheres.
+    };
+
+    // A light's bounding volume in view space.
+    struct ViewLight
+    {
+        DirectX::XMFLOAT3 Position;
+        float Range = 0.0f;
+        DirectX::XMFLOAT3 Direction;   // Spot lights only.
+        float CosAngle = 0.0f;
+        float SinAngle = 0.0f;
+        UINT Index = 0;
+    };
+
+    struct SliceResult
+    {
+        std::vector<ClusterRange> Ranges;   // Offsets relative to Indices.
+        std::vector<UINT> Indices;
+    };
+
+    void CullSlice(UINT slice);
+
+private:
+    UINT mCountX = 0;
+    UINT mCountY = 0;
+    UINT mCountZ = 0;
+    UINT mGroupsPerSlice = 0;
+
+    float mDepthScale = 0.0f;
+    float mDepthBias = 0.0f;
+
+    std::vector<ClusterGroup> mGroups;
+    std::vector<float> mSliceNear;   // CountZ+1 slice boundaries.
+
+    std::vector<ViewLight> mPointLights;
+    std::vector<ViewLight> mSpotLights;
+
+    std::vector<SliceResult> mSliceResults;
+    std::vector<ClusterRange> mRanges;
+    std::vector<UINT> mIndices;
+};
@@ -0,0 +1,313 @@
+#include "CommandCapture.h"
+#include "FileUtil.h"
+
+#include <cassert>
+#include <cstring>
+#include <iterator>
+#include <unordered_map>
+
+static const UINT CaptureMagic = 0x50414343;   // "CCAP"
+static const UINT CaptureVersion = 2;
+
+namespace
+{
+    struct FileHeader
+    {
+        UINT Magic = 0;
+        UINT Version = 0;
+        UINT FrameCount = 0;
+        UINT Reserved = 0;
+        UINT64 Session = 0;
+    };
+
+    // The commands follow, then the object names, each terminated by a null.
+    struct FrameHeader
+    {
+        UINT64 CommandBytes = 0;
+        UINT64 NameBytes = 0;
+        UINT ObjectCount = 0;
+        UINT BufferCount = 0;
+    };
+
+    enum BufferFlags : UINT
+    {
+        BufferRepeat = 0x1,   // Same contents as the previous frame's buffer at this address.
+    };
+
+    struct BufferHeader
+    {
+        UINT64 GpuAddress = 0;
+        UINT64 ByteSize = 0;
+        UINT Flags = 0;
+        UINT Reserved = 0;
+    };
+
+    // Marks the snapshots of frame that equal previous's at the same address.
+    void MarkRepeats(const CommandCapture::Frame* previous, CommandCapture::Frame& frame)
+    {
+        std::unordered_map<D3D12_GPU_VIRTUAL_ADDRESS, const CommandCapture::BufferData*> last;
+        if(previous != nullptr)
+        {
+            for(const CommandCapture::BufferData& buffer : previous->Buffers)
+                last[buffer.GpuAddress] = &buffer;
+        }
+
+        for(CommandCapture::BufferData& buffer : frame.Buffers)
+        {
+            auto it = last.find(buffer.GpuAddress);
+            buffer.Repeat = it != last.end() && it->second->Data == buffer.Data;
+        }
+    }
+}
+
+UINT64 CommandCapture::Frame::UploadedBytes()const
+{
+    UINT64 bytes = 0;
+    for(const BufferData& buffer : Buffers)
+        bytes += buffer.Repeat ? 0 : buffer.Data.size();
+
+    return bytes;
+}
+
+void CommandCapture::Clear()
+{
+    mFrames.clear();
+    mFrameOpen = false;
+}
+
+void CommandCapture::BeginFrame()
+{
+    assert(!mFrameOpen);
+    mFrames.emplace_back();
+    mFrameOpen = true;
+}
+
+void CommandCapture::AddBufferData(D3D12_GPU_VIRTUAL_ADDRESS gpuAddress, const void* data, UINT64 byteSize)
+{
+    assert(mFrameOpen);
+
+    BufferData buffer;
+    buffer.GpuAddress = gpuAddress;
+    buffer.Data.assign(reinterpret_cast<const BYTE*>(data), reinterpret_cast<const BYTE*>(data) + byteSize);
+    mFrames.back().Buffers.push_back(std::move(buffer));
+}
+
+void CommandCapture::EndFrame(const CommandStreamRecorder& stream, const NameFunc& nameOf)
+{
+    assert(mFrameOpen);
+
+    Frame& frame = mFrames.back();
+    frame.Commands = stream.GetStream();
+
+    const std::vector<void*>& objects = stream.GetObjects();
+    frame.ObjectNames.resize(objects.size());
+    for(size_t i = 0; i < objects.size(); ++i)
+    {
+        if(nameOf)
+            frame.ObjectNames[i] = nameOf(objects[i]);
+
+        // A null inside a name would split it in two in the file.
+        assert(frame.ObjectNames[i].find('\0') == std::string::npos);
+    }
+
+    MarkRepeats(mFrames.size() > 1 ? &mFrames[mFrames.size() - 2] : nullptr, frame);
+    mFrameOpen = false;
+}
+
+bool CommandCapture::ResolveObjects(const Frame& frame, const FindFunc& find, std::vector<void*>& objects,
+    std::vector<std::string>* missing)
+{
+    objects.assign(frame.ObjectNames.size(), nullptr);
+    if(missing != nullptr)
+        missing->clear();
+
+    bool resolved = true;
+    for(size_t i = 0; i < objects.size(); ++i)
+    {
+        const std::string& name = frame.ObjectNames[i];
+        if(!name.empty())
+            objects[i] = find(name);
+
+        if(objects[i] == nullptr)
+        {
+            resolved = false;
+            if(missing != nullptr)
+                missing->push_back(name);
+        }
+    }
+
+    return resolved;
+}
+
+bool CommandCapture::Save(const std::wstring& filename)const
+{
+    return WriteFileAtomic(filename, [this](std::ostream& out) { Save(out); });
+}
+
+bool CommandCapture::Save(std::ostream& out)const
+{
+    FileHeader header;
+    header.Magic = CaptureMagic;
+    header.Version = CaptureVersion;
+    header.FrameCount = (UINT)mFrames.size();
+    header.Session = mSession;
+    out.write((const char*)&header, sizeof(header));
+
+    for(const Frame& frame : mFrames)
+    {
+        std::string names;
+        for(const std::string& name : frame.ObjectNames)
+        {
+            names += name;
+            names += '\0';
+        }
+
+        FrameHeader frameHeader;
+        frameHeader.CommandBytes = frame.Commands.size();
+        frameHeader.NameBytes = names.size();
+        frameHeader.ObjectCount = frame.ObjectCount();
+        frameHeader.BufferCount = (UINT)frame.Buffers.size();
+        out.write((const char*)&frameHeader, sizeof(frameHeader));
+        out.write((const char*)frame.Commands.data(), frame.Commands.size());
+        out.write(names.data(), names.size());
+
+        for(const BufferData& buffer : frame.Buffers)
+        {
+            BufferHeader bufferHeader;
+            bufferHeader.GpuAddress = buffer.GpuAddress;
+            bufferHeader.ByteSize = buffer.Data.size();
+            bufferHeader.Flags = buffer.Repeat ? (UINT)BufferRepeat : 0;
+
+            out.write((const char*)&bufferHeader, sizeof(bufferHeader));
+            if(!buffer.Repeat)
+                out.write((const char*)buffer.Data.data(), buffer.Data.size());
+        }
+    }
+
+    return (bool)out;
+}
+
+bool CommandCapture::Load(const std::wstring& filename)
+{
+    Clear();
+
+    std::vector<BYTE> data;
+    if(!ReadFileContents(filename, data))
+        return false;
+
+    return Load(data.data(), data.size());
+}
+
+bool CommandCapture::Load(std::istream& in)
+{
+    Clear();
+
+    std::vector<BYTE> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if(in.bad())
+        return false;
+
+    return Load(data.data(), data.size());
+}
+
+bool CommandCapture::Load(const BYTE* data, UINT64 fileSize)
+{
+    mSession = 0;
+    UINT64 offset = 0;
+
+    // Copies byteSize bytes out of the file, failing instead of reading past its end.
+    auto read = [&](void* dest, UINT64 byteSize)
+    {
+        if(byteSize > fileSize - offset)
+            return false;
+        if(byteSize > 0)
+            memcpy(dest, data + offset, (size_t)byteSize);
+        offset += byteSize;
+        return true;
+    };
+
+    auto fail = [this]()
+    {
+        Clear();
+        mSession = 0;
+        return false;
+    };
+
+    FileHeader header;
+    if(!read(&header, sizeof(header)) || header.Magic != CaptureMagic || header.Version != CaptureVersion)
+        return false;
+
+    if(header.FrameCount > (fileSize - offset) / sizeof(FrameHeader))
+        return false;
+
+    mSession = header.Session;
+
+    std::unordered_map<D3D12_GPU_VIRTUAL_ADDRESS, const BufferData*> previous;
+    mFrames.resize(header.FrameCount);
+    for(Frame& frame : mFrames)
+    {
+        FrameHeader frameHeader;
+        if(!read(&frameHeader, sizeof(frameHeader)) || frameHeader.CommandBytes > fileSize - offset)
+            return fail();
+
+        frame.Commands.resize((size_t)frameHeader.CommandBytes);
+        read(frame.Commands.data(), frameHeader.CommandBytes);
+
+        // Every name ends in a null, which bounds the count.
+        if(frameHeader.NameBytes > fileSize - offset || frameHeader.ObjectCount > frameHeader.NameBytes)
+            return fail();
+
+        std::string names((size_t)frameHeader.NameBytes, '\0');
+        read(&names[0], frameHeader.NameBytes);
+
+        frame.ObjectNames.resize(frameHeader.ObjectCount);
+        size_t nameStart = 0;
+        for(std::string& name : frame.ObjectNames)
+        {
+            size_t nameEnd = names.find('\0', nameStart);
+            if(nameEnd == std::string::npos)
+                return fail();
+            name = names.substr(nameStart, nameEnd - nameStart);
+            nameStart = nameEnd + 1;
+        }
+        if(nameStart != names.size())
+            return fail();
+
+        // Each buffer needs at least its header, which bounds the count.
+        if(frameHeader.BufferCount > (fileSize - offset) / sizeof(BufferHeader))
+            return fail();
+
+        frame.Buffers.resize(frameHeader.BufferCount);
+        std::unordered_map<D3D12_GPU_VIRTUAL_ADDRESS, const BufferData*> current;
+        for(BufferData& buffer : frame.Buffers)
+        {
+            BufferHeader bufferHeader;
+            if(!read(&bufferHeader, sizeof(bufferHeader)))
+                return fail();
+
+            buffer.GpuAddress = bufferHeader.GpuAddress;
+            buffer.Repeat = (bufferHeader.Flags & BufferRepeat) != 0;
+            if(buffer.Repeat)
+            {
+                auto it = previous.find(bufferHeader.GpuAddress);
+                if(it == previous.end() || it->second->Data.size() != bufferHeader.ByteSize)
+                    return fail();
+                buffer.Data = it->second->Data;
+            }
+            else
+            {
+                if(bufferHeader.ByteSize > fileSize - offset)
+                    return fail();
+                buffer.Data.resize((size_t)bufferHeader.ByteSize);
+                read(buffer.Data.data(), bufferHeader.ByteSize);
+            }
+
+            current[buffer.GpuAddress] = &buffer;
+        }
+        previous = std::move(current);
+    }
+
+    if(offset != fileSize)
+        return fail();
+
+    return true;
+}
@@ -0,0 +1,111 @@
+//***************************************************************************************
+// CommandCapture.h
+//
+// Frames of recorded commands together with the buffer contents they read, saved to
+// and loaded from a compact binary file so a slow frame can be replayed offline (see
+// CommandReplay and Tools/ReplayCapture).  Each frame holds a CommandStreamRecorder
+// stream, a name for each entry of its object table and a list of buffer snapshots
+// keyed by GPU virtual address.
+//
+// A snapshot that is byte for byte the same as the previous frame's snapshot at the
+// same address is stored as a reference to it, so static data such as material
+// constants costs nothing after the first frame.  Such snapshots are marked Repeat,
+// and UploadedBytes counts only the others: the data the frame actually changed.
+//
+// The snapshots are a record of what each frame read, for reports and for comparing
+// frames; CommandReplay does not write them back into the target's buffers, so a
+// replay on a device reads whatever the buffers hold at the time.
+//
+// The object names are what lets a frame be replayed on a device: ResolveObjects
+// turns them back into the live objects the ids stand for.  GPU virtual addresses
+// are replayed as they were captured, so the buffers must also still be where they
+// were, which in practice means the run that made the capture; Session tells such a
+// capture apart from one loaded from an earlier run.
+//
+// Only D3D12Types.h is needed, so captures can be saved, loaded and replayed against
+// the recording backend without windows.h or a device (see Tests/).
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandStream.h"
+
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class CommandCapture
+{
+public:
+    struct BufferData
+    {
+        D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+        std::vector<BYTE> Data;
+        bool Repeat = false;   // Same as the previous frame's snapshot at this address.
+    };
+
+    struct Frame
+    {
+        std::vector<BYTE> Commands;
+        std::vector<std::string> ObjectNames;   // For object ids 1, 2, ...; empty if unnamed.
+        std::vector<BufferData> Buffers;
+
+        UINT ObjectCount()const { return (UINT)ObjectNames.size(); }
+
+        // Bytes of the snapshots that are not repeats.
+        UINT64 UploadedBytes()const;
+    };
+
+    // Names an object of the recorded stream, or returns an empty string.
+    typedef std::function<std::string(void* object)> NameFunc;
+
+    // Returns the live object with the given name, or null.
+    typedef std::function<void*(const std::string& name)> FindFunc;
+
+    CommandCapture() = default;
+    CommandCapture(const CommandCapture& rhs) = delete;
+    CommandCapture& operator=(const CommandCapture& rhs) = delete;
+
+    // Forgets the frames; the session is kept.
+    void Clear();
+
+    // An id for the run that makes the capture, saved with it.  0 if not set.
+    void SetSession(UINT64 session) { mSession = session; }
+    UINT64 GetSession()const { return mSession; }
+
+    // Buffer snapshots are added between BeginFrame and EndFrame; EndFrame takes a
+    // copy of the stream the frame was recorded into, names its objects with
+    // nameOf (if given) and marks the repeats.
+    void BeginFrame();
+    void AddBufferData(D3D12_GPU_VIRTUAL_ADDRESS gpuAddress, const void* data, UINT64 byteSize);
+    void EndFrame(const CommandStreamRecorder& stream, const NameFunc& nameOf = NameFunc());
+
+    UINT FrameCount()const { return (UINT)mFrames.size(); }
+    const Frame& GetFrame(UINT i)const { return mFrames[i]; }
+
+    // Looks up each of frame's objects by name with find and fills objects with the
+    // table ReplayFrame takes.  Returns false, and the names not found in missing if
+    // it is not null, if an object is unnamed or find does not know it.
+    static bool ResolveObjects(const Frame& frame, const FindFunc& find, std::vector<void*>& objects,
+        std::vector<std::string>* missing = nullptr);
+
+    // Writes to a temporary file and renames it, so an interrupted save never
+    // leaves a truncated capture behind.  Returns false if the file was not written.
+    bool Save(const std::wstring& filename)const;
+    bool Save(std::ostream& out)const;
+
+    // Returns false if the file is missing or not a valid capture.  The session
+    // is the one saved with it.
+    bool Load(const std::wstring& filename);
+    bool Load(std::istream& in);
+
+private:
+    bool Load(const BYTE* data, UINT64 byteSize);
+
+private:
+    std::vector<Frame> mFrames;
+    UINT64 mSession = 0;
+    bool mFrameOpen = false;
+};
@@ -0,0 +1,51 @@
+//***************************************************************************************
+// CommandRecorder.h
+//
+// The subset of ID3D12GraphicsCommandList the renderer records through, with the same
+// names and arguments.  Frame recording is written against this interface so it can
+// go to a real command list (D3D12CommandRecorder.h) or be serialized into memory
+// without a device (CommandStreamRecorder in CommandStream.h).
+//
+// Only the D3D12 types are needed, so this and the device-free recorders build
+// without windows.h or a device (see D3D12Types.h).
+//***************************************************************************************
+
+#pragma once
+
+#include "D3D12Types.h"
+
+class CommandRecorder
+{
+public:
+    virtual ~CommandRecorder() = default;
+
+    virtual void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers) = 0;
+
+    virtual void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT colorRGBA[4],
+        UINT numRects, const D3D12_RECT* rects) = 0;
+    virtual void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags,
+        FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects) = 0;
+
+    virtual void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports) = 0;
+    virtual void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects) = 0;
+    virtual void OMSetRenderTargets(UINT numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs,
+        BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv) = 0;
+
+    virtual void SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps) = 0;
+    virtual void SetPipelineState(ID3D12PipelineState* pso) = 0;
+    virtual void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) = 0;
+    virtual void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+    virtual void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) = 0;
+    virtual void SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValues,
+        const void* srcData, UINT destOffsetIn32BitValues) = 0;
+
+    virtual void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) = 0;
+    virtual void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) = 0;
+    virtual void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) = 0;
+
+    virtual void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount,
+        UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) = 0;
+    virtual void ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount,
+        ID3D12Resource* argumentBuffer, UINT64 argumentBufferOffset,
+        ID3D12Resource* countBuffer, UINT64 countBufferOffset) = 0;
+};
@@ -0,0 +1,304 @@
+#include "CommandReplay.h"
+
+#include <cassert>
+#include <cstring>
+#include <sstream>
+
+CommandReplay::CommandReplay(CommandRecorder* target) :
+    mTarget(target),
+    mClock(CreateDefaultClock())
+{
+    assert(mTarget != nullptr);
+
+    mClockOverhead = mClock->MeasureOverhead();
+    mReport.ClockOverheadNs = mClockOverhead * 1e9;
+}
+
+void CommandReplay::ReplayFrame(const CommandCapture::Frame& frame, void* const* objects, UINT objectCount)
+{
+    std::vector<void*> ids;
+    if(objects == nullptr)
+    {
+        ids.resize(frame.ObjectCount());
+        for(size_t i = 0; i < ids.size(); ++i)
+            ids[i] = reinterpret_cast<void*>((uintptr_t)(i + 1));
+
+        objects = ids.data();
+        objectCount = (UINT)ids.size();
+    }
+
+    BeginFrame();
+    CommandStreamRecorder::Replay(frame.Commands.data(), frame.Commands.size(), objects, objectCount, this);
+
+    ++mReport.Frames;
+    mReport.BytesUploaded += frame.UploadedBytes();
+}
+
+void CommandReplay::BeginFrame()
+{
+    mViewports.clear();
+    mScissorRects.clear();
+    mRenderTargets.clear();
+    mDescriptorHeaps.clear();
+    mPipelineState.clear();
+    mRootSignature.clear();
+    mIndexBuffer.clear();
+    mTopology.clear();
+    mVertexBuffers.clear();
+    mRootViews.clear();
+    mRootConstants.clear();
+    mRootConstantsSet.clear();
+}
+
+void CommandReplay::ResetReport()
+{
+    mReport = Report();
+    mReport.ClockOverheadNs = mClockOverhead * 1e9;
+}
+
+std::string CommandReplay::FormatReport()const
+{
+    std::ostringstream out;
+    out << "Replayed " << mReport.Frames << " frames: " << mReport.Commands << " commands, " <<
+        mReport.RedundantCommands << " redundant, " << mReport.BytesUploaded << " bytes uploaded, " <<
+        mReport.Milliseconds << " ms (less " << mReport.ClockOverheadNs << " ns of clock reads per call)\n";
+
+    for(UINT type = 0; type < CommandStreamRecorder::CommandTypeCount; ++type)
+    {
+        const CallStats& calls = mReport.Calls[type];
+        if(calls.Calls == 0)
+            continue;
+
+        out << "    " << CommandStreamRecorder::CommandName(type) << ": " << calls.Calls << " calls, " <<
+            calls.Redundant << " redundant, " << calls.Milliseconds << " ms, " <<
+            calls.Milliseconds * 1000000.0 / calls.Calls << " ns per call\n";
+    }
+
+    return out.str();
+}
+
+template<typename F>
+void CommandReplay::Forward(UINT type, bool redundant, F f)
+{
+    std::int64_t startTime = mClock->Now();
+    f();
+    std::int64_t endTime = mClock->Now();
+
+    // A call faster than the clock's own noise counts as free rather than negative.
+    double seconds = (endTime - startTime) * mClock->SecondsPerCount() - mClockOverhead;
+    double ms = seconds > 0.0 ? seconds * 1000.0 : 0.0;
+
+    CallStats& calls = mReport.Calls[type];
+    ++calls.Calls;
+    calls.Milliseconds += ms;
+    ++mReport.Commands;
+    mReport.Milliseconds += ms;
+
+    if(redundant)
+    {
+        ++calls.Redundant;
+        ++mReport.RedundantCommands;
+    }
+}
+
+bool CommandReplay::SetState(std::vector<BYTE>& state, const void* value, size_t byteSize)
+{
+    // The state is stored after a marker byte, so a value of no bytes still
+    // differs from a state that was never set.
+    const BYTE* bytes = reinterpret_cast<const BYTE*>(value);
+    bool same = state.size() == byteSize + 1 && (byteSize == 0 || memcmp(state.data() + 1, bytes, byteSize) == 0);
+
+    state.resize(byteSize + 1);
+    state[0] = 1;
+    if(byteSize > 0)
+        memcpy(state.data() + 1, bytes, byteSize);
+
+    return same;
+}
+
+void CommandReplay::ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers)
+{
+    Forward(CommandStreamRecorder::CmdResourceBarrier, false,
+        [&]() { mTarget->ResourceBarrier(numBarriers, barriers); });
+}
+
+void CommandReplay::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT colorRGBA[4],
+    UINT numRects, const D3D12_RECT* rects)
+{
+    Forward(CommandStreamRecorder::CmdClearRenderTargetView, false,
+        [&]() { mTarget->ClearRenderTargetView(rtv, colorRGBA, numRects, rects); });
+}
+
+void CommandReplay::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags,
+    FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects)
+{
+    Forward(CommandStreamRecorder::CmdClearDepthStencilView, false,
+        [&]() { mTarget->ClearDepthStencilView(dsv, clearFlags, depth, stencil, numRects, rects); });
+}
+
+void CommandReplay::RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports)
+{
+    bool redundant = SetState(mViewports, viewports, numViewports*sizeof(D3D12_VIEWPORT));
+    Forward(CommandStreamRecorder::CmdRSSetViewports, redundant,
+        [&]() { mTarget->RSSetViewports(numViewports, viewports); });
+}
+
+void CommandReplay::RSSetScissorRects(UINT numRects, const D3D12_RECT* rects)
+{
+    bool redundant = SetState(mScissorRects, rects, numRects*sizeof(D3D12_RECT));
+    Forward(CommandStreamRecorder::CmdRSSetScissorRects, redundant,
+        [&]() { mTarget->RSSetScissorRects(numRects, rects); });
+}
+
+void CommandReplay::OMSetRenderTargets(UINT numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs,
+    BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv)
+{
+    UINT handleCount = rtvs == nullptr ? 0 :
+        (singleHandleToDescriptorRange && numRenderTargets > 0 ? 1 : numRenderTargets);
+
+    std::vector<SIZE_T> value;
+    value.push_back(numRenderTargets);
+    value.push_back(singleHandleToDescriptorRange);
+    for(UINT i = 0; i < handleCount; ++i)
+        value.push_back(rtvs[i].ptr);
+    value.push_back(dsv != nullptr ? dsv->ptr : 0);
+
+    bool redundant = SetState(mRenderTargets, value.data(), value.size()*sizeof(SIZE_T));
+    Forward(CommandStreamRecorder::CmdOMSetRenderTargets, redundant,
+        [&]() { mTarget->OMSetRenderTargets(numRenderTargets, rtvs, singleHandleToDescriptorRange, dsv); });
+}
+
+void CommandReplay::SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps)
+{
+    bool redundant = SetState(mDescriptorHeaps, heaps, numHeaps*sizeof(ID3D12DescriptorHeap*));
+    Forward(CommandStreamRecorder::CmdSetDescriptorHeaps, redundant,
+        [&]() { mTarget->SetDescriptorHeaps(numHeaps, heaps); });
+}
+
+void CommandReplay::SetPipelineState(ID3D12PipelineState* pso)
+{
+    bool redundant = SetState(mPipelineState, &pso, sizeof(pso));
+    Forward(CommandStreamRecorder::CmdSetPipelineState, redundant,
+        [&]() { mTarget->SetPipelineState(pso); });
+}
+
+void CommandReplay::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+    bool redundant = SetState(mRootSignature, &rootSignature, sizeof(rootSignature));
+
+    // A different root signature discards every root argument.
+    if(!redundant)
+    {
+        mRootViews.clear();
+        mRootConstants.clear();
+        mRootConstantsSet.clear();
+    }
+
+    Forward(CommandStreamRecorder::CmdSetGraphicsRootSignature, redundant,
+        [&]() { mTarget->SetGraphicsRootSignature(rootSignature); });
+}
+
+void CommandReplay::SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    if(rootParameterIndex >= mRootViews.size())
+        mRootViews.resize(rootParameterIndex + 1);
+
+    bool redundant = SetState(mRootViews[rootParameterIndex], &address, sizeof(address));
+    Forward(CommandStreamRecorder::CmdSetGraphicsRootConstantBufferView, redundant,
+        [&]() { mTarget->SetGraphicsRootConstantBufferView(rootParameterIndex, address); });
+}
+
+void CommandReplay::SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    if(rootParameterIndex >= mRootViews.size())
+        mRootViews.resize(rootParameterIndex + 1);
+
+    bool redundant = SetState(mRootViews[rootParameterIndex], &address, sizeof(address));
+    Forward(CommandStreamRecorder::CmdSetGraphicsRootShaderResourceView, redundant,
+        [&]() { mTarget->SetGraphicsRootShaderResourceView(rootParameterIndex, address); });
+}
+
+void CommandReplay::SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValues,
+    const void* srcData, UINT destOffsetIn32BitValues)
+{
+    if(rootParameterIndex >= mRootConstants.size())
+    {
+        mRootConstants.resize(rootParameterIndex + 1);
+        mRootConstantsSet.resize(rootParameterIndex + 1);
+    }
+
+    std::vector<UINT>& values = mRootConstants[rootParameterIndex];
+    std::vector<bool>& set = mRootConstantsSet[rootParameterIndex];
+    if(values.size() < destOffsetIn32BitValues + num32BitValues)
+    {
+        values.resize(destOffsetIn32BitValues + num32BitValues, 0);
+        set.resize(destOffsetIn32BitValues + num32BitValues, false);
+    }
+
+    const UINT* src = reinterpret_cast<const UINT*>(srcData);
+    bool redundant = num32BitValues > 0;
+    for(UINT i = 0; i < num32BitValues; ++i)
+    {
+        UINT slot = destOffsetIn32BitValues + i;
+        redundant = redundant && set[slot] && values[slot] == src[i];
+        values[slot] = src[i];
+        set[slot] = true;
+    }
+
+    Forward(CommandStreamRecorder::CmdSetGraphicsRoot32BitConstants, redundant,
+        [&]() { mTarget->SetGraphicsRoot32BitConstants(rootParameterIndex, num32BitValues, srcData, destOffsetIn32BitValues); });
+}
+
+void CommandReplay::IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+    if(mVertexBuffers.size() < startSlot + numViews)
+        mVertexBuffers.resize(startSlot + numViews);
+
+    // Null views unbind the slots.
+    D3D12_VERTEX_BUFFER_VIEW unbound = {};
+    bool redundant = numViews > 0;
+    for(UINT i = 0; i < numViews; ++i)
+    {
+        const D3D12_VERTEX_BUFFER_VIEW* view = views != nullptr ? &views[i] : &unbound;
+        redundant = SetState(mVertexBuffers[startSlot + i], view, sizeof(D3D12_VERTEX_BUFFER_VIEW)) && redundant;
+    }
+
+    Forward(CommandStreamRecorder::CmdIASetVertexBuffers, redundant,
+        [&]() { mTarget->IASetVertexBuffers(startSlot, numViews, views); });
+}
+
+void CommandReplay::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+    D3D12_INDEX_BUFFER_VIEW value = view != nullptr ? *view : D3D12_INDEX_BUFFER_VIEW{};
+    bool redundant = SetState(mIndexBuffer, &value, sizeof(value));
+    Forward(CommandStreamRecorder::CmdIASetIndexBuffer, redundant,
+        [&]() { mTarget->IASetIndexBuffer(view); });
+}
+
+void CommandReplay::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+    bool redundant = SetState(mTopology, &topology, sizeof(topology));
+    Forward(CommandStreamRecorder::CmdIASetPrimitiveTopology, redundant,
+        [&]() { mTarget->IASetPrimitiveTopology(topology); });
+}
+
+void CommandReplay::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount,
+    UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation)
+{
+    Forward(CommandStreamRecorder::CmdDrawIndexedInstanced, false, [&]()
+    {
+        mTarget->DrawIndexedInstanced(indexCountPerInstance, instanceCount,
+            startIndexLocation, baseVertexLocation, startInstanceLocation);
+    });
+}
+
+void CommandReplay::ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount,
+    ID3D12Resource* argumentBuffer, UINT64 argumentBufferOffset,
+    ID3D12Resource* countBuffer, UINT64 countBufferOffset)
+{
+    Forward(CommandStreamRecorder::CmdExecuteIndirect, false, [&]()
+    {
+        mTarget->ExecuteIndirect(commandSignature, maxCommandCount,
+            argumentBuffer, argumentBufferOffset, countBuffer, countBufferOffset);
+    });
+}
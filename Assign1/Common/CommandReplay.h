@@ -0,0 +1,132 @@
+//***************************************************************************************
+// CommandReplay.h
+//
+// Replays captured frames (see CommandCapture) onto another CommandRecorder and
+// reports what they cost: the time spent in each type of call on the target, the
+// state changes that set what was already set, and the bytes of buffer data the
+// frames uploaded (the snapshots that changed since the previous frame).
+//
+// Each call is timed with two clock reads.  The median cost of a read, measured
+// when the replayer is created, is taken off every call, so cheap calls are not
+// swamped by the clock itself.
+//
+// Only the commands are replayed.  The captured buffer contents are counted for the
+// report but not written back, so on a device the calls read the buffers' current
+// contents rather than what they held when the frame was captured.
+//
+// The replayer is itself a CommandRecorder that forwards to the target, so it can
+// also be placed in front of a live recording.  Against a CommandStreamRecorder the
+// object ids in the capture can be passed through as they are; against a device the
+// caller maps them to live objects, by name with CommandCapture::ResolveObjects.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandCapture.h"
+#include "ClockSource.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class CommandReplay : public CommandRecorder
+{
+public:
+    struct CallStats
+    {
+        UINT64 Calls = 0;
+        UINT64 Redundant = 0;   // Set state to the value it already had.
+        double Milliseconds = 0.0;
+    };
+
+    struct Report
+    {
+        CallStats Calls[CommandStreamRecorder::CommandTypeCount];
+        UINT Frames = 0;
+        UINT64 Commands = 0;
+        UINT64 RedundantCommands = 0;
+        UINT64 BytesUploaded = 0;
+        double Milliseconds = 0.0;   // Sum of the calls, excluding decoding.
+        double ClockOverheadNs = 0.0;   // Taken off each call's time.
+    };
+
+    explicit CommandReplay(CommandRecorder* target);
+    CommandReplay(const CommandReplay& rhs) = delete;
+    CommandReplay& operator=(const CommandReplay& rhs) = delete;
+
+    // Replays a captured frame.  Object id i (i > 0) is passed to the target as
+    // objects[i - 1]; with objects null the ids themselves are passed as pointers,
+    // which only a recorder that does not dereference them can take.
+    void ReplayFrame(const CommandCapture::Frame& frame, void* const* objects = nullptr, UINT objectCount = 0);
+
+    // Starts a new command list: the tracked state is forgotten, so the first
+    // setting of each state is not counted as redundant.
+    void BeginFrame();
+
+    void ResetReport();
+    const Report& GetReport()const { return mReport; }
+
+    // The report as text, one line per call type that was used.
+    std::string FormatReport()const;
+
+    void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers) override;
+
+    void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT colorRGBA[4],
+        UINT numRects, const D3D12_RECT* rects) override;
+    void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags,
+        FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects) override;
+
+    void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports) override;
+    void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects) override;
+    void OMSetRenderTargets(UINT numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs,
+        BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv) override;
+
+    void SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps) override;
+    void SetPipelineState(ID3D12PipelineState* pso) override;
+    void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) override;
+    void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValues,
+        const void* srcData, UINT destOffsetIn32BitValues) override;
+
+    void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) override;
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override;
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override;
+
+    void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount,
+        UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) override;
+    void ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount,
+        ID3D12Resource* argumentBuffer, UINT64 argumentBufferOffset,
+        ID3D12Resource* countBuffer, UINT64 countBufferOffset) override;
+
+private:
+    // Times f, a call on the target, and counts it under type.
+    template<typename F>
+    void Forward(UINT type, bool redundant, F f);
+
+    // Replaces state with the bytes of value and returns whether they were
+    // already equal.  An empty state has never been set.
+    static bool SetState(std::vector<BYTE>& state, const void* value, size_t byteSize);
+
+private:
+    CommandRecorder* mTarget = nullptr;
+
+    std::unique_ptr<ClockSource> mClock;
+    double mClockOverhead = 0.0;   // Seconds per Now().
+
+    // The state the current command list has set, as raw bytes.
+    std::vector<BYTE> mViewports;
+    std::vector<BYTE> mScissorRects;
+    std::vector<BYTE> mRenderTargets;
+    std::vector<BYTE> mDescriptorHeaps;
+    std::vector<BYTE> mPipelineState;
+    std::vector<BYTE> mRootSignature;
+    std::vector<BYTE> mIndexBuffer;
+    std::vector<BYTE> mTopology;
+    std::vector<std::vector<BYTE>> mVertexBuffers;   // Per slot.
+    std::vector<std::vector<BYTE>> mRootViews;       // Per root parameter.
+    std::vector<std::vector<UINT>> mRootConstants;   // Per root parameter, 32-bit values.
+    std::vector<std::vector<bool>> mRootConstantsSet;
+
+    Report mReport;
+};
@@ -0,0 +1,745 @@
+#include "CommandStream.h"
+
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+static const char* CommandNames[CommandStreamRecorder::CommandTypeCount] =
+{
+    "ResourceBarrier",
+    "ClearRenderTargetView",
+    "ClearDepthStencilView",
+    "RSSetViewports",
+    "RSSetScissorRects",
+    "OMSetRenderTargets",
+    "SetDescriptorHeaps",
+    "SetPipelineState",
+    "SetGraphicsRootSignature",
+    "SetGraphicsRootConstantBufferView",
+    "SetGraphicsRootShaderResourceView",
+    "SetGraphicsRoot32BitConstants",
+    "IASetVertexBuffers",
+    "IASetIndexBuffer",
+    "IASetPrimitiveTopology",
+    "DrawIndexedInstanced",
+    "ExecuteIndirect",
+};
+
+const char* CommandStreamRecorder::CommandName(UINT type)
+{
+    return type < CommandTypeCount ? CommandNames[type] : "Unknown";
+}
+
+void CommandStreamRecorder::Clear()
+{
+    mStream.clear();
+    mObjects.clear();
+    mObjectIds.clear();
+    mStats = Stats();
+}
+
+std::uint64_t CommandStreamRecorder::Hash()const
+{
+    // FNV-1a, as d3dUtil::HashBytes, which is not available without windows.h.
+    std::uint64_t hash = 14695981039346656037ull;
+    for(BYTE b : mStream)
+    {
+        hash ^= b;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+UINT CommandStreamRecorder::ObjectId(void* object)
+{
+    if(object == nullptr)
+        return 0;
+
+    auto it = mObjectIds.find(object);
+    if(it != mObjectIds.end())
+        return it->second;
+
+    mObjects.push_back(object);
+    UINT id = (UINT)mObjects.size();
+    mObjectIds[object] = id;
+    return id;
+}
+
+void CommandStreamRecorder::BeginCommand(CommandType type)
+{
+    mCommandStart = mStream.size();
+
+    CommandHeader header;
+    header.Type = type;
+    Write(header);
+
+    ++mStats.Calls[type];
+    ++mStats.Commands;
+}
+
+void CommandStreamRecorder::EndCommand()
+{
+    // Patch the argument size into the header now that it is known.
+    UINT byteSize = (UINT)(mStream.size() - mCommandStart - sizeof(CommandHeader));
+    memcpy(&mStream[mCommandStart] + offsetof(CommandHeader, ByteSize), &byteSize, sizeof(UINT));
+
+    mStats.Bytes = mStream.size();
+}
+
+void CommandStreamRecorder::ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers)
+{
+    BeginCommand(CmdResourceBarrier);
+    Write(numBarriers);
+    for(UINT i = 0; i < numBarriers; ++i)
+    {
+        const D3D12_RESOURCE_BARRIER& b = barriers[i];
+
+        BarrierRecord record;
+        record.Type = b.Type;
+        record.Flags = b.Flags;
+        switch(b.Type)
+        {
+        case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+            record.Resource = ObjectId(b.Transition.pResource);
+            record.Subresource = b.Transition.Subresource;
+            record.StateBefore = b.Transition.StateBefore;
+            record.StateAfter = b.Transition.StateAfter;
+            break;
+        case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+            record.Resource = ObjectId(b.Aliasing.pResourceBefore);
+            record.ResourceAfter = ObjectId(b.Aliasing.pResourceAfter);
+            break;
+        case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+            record.Resource = ObjectId(b.UAV.pResource);
+            break;
+        }
+        Write(record);
+    }
+    EndCommand();
+
+    mStats.Barriers += numBarriers;
+}
+
+void CommandStreamRecorder::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT colorRGBA[4],
+    UINT numRects, const D3D12_RECT* rects)
+{
+    BeginCommand(CmdClearRenderTargetView);
+    Write((UINT64)rtv.ptr);
+    WriteArray(colorRGBA, 4);
+    Write(numRects);
+    WriteArray(rects, numRects);
+    EndCommand();
+}
+
+void CommandStreamRecorder::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags,
+    FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects)
+{
+    BeginCommand(CmdClearDepthStencilView);
+    Write((UINT64)dsv.ptr);
+    Write((UINT)clearFlags);
+    Write(depth);
+    Write((UINT)stencil);
+    Write(numRects);
+    WriteArray(rects, numRects);
+    EndCommand();
+}
+
+void CommandStreamRecorder::RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports)
+{
+    BeginCommand(CmdRSSetViewports);
+    Write(numViewports);
+    WriteArray(viewports, numViewports);
+    EndCommand();
+}
+
+void CommandStreamRecorder::RSSetScissorRects(UINT numRects, const D3D12_RECT* rects)
+{
+    BeginCommand(CmdRSSetScissorRects);
+    Write(numRects);
+    WriteArray(rects, numRects);
+    EndCommand();
+}
+
+void CommandStreamRecorder::OMSetRenderTargets(UINT numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs,
+    BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv)
+{
+    // With a single handle the render targets are consecutive descriptors
+    // starting at rtvs[0].
+    UINT handleCount = rtvs == nullptr ? 0 :
+        (singleHandleToDescriptorRange && numRenderTargets > 0 ? 1 : numRenderTargets);
+
+    BeginCommand(CmdOMSetRenderTargets);
+    Write(numRenderTargets);
+    Write((UINT)singleHandleToDescriptorRange);
+    Write(handleCount);
+    for(UINT i = 0; i < handleCount; ++i)
+        Write((UINT64)rtvs[i].ptr);
+    Write((UINT)(dsv != nullptr));
+    Write((UINT64)(dsv != nullptr ? dsv->ptr : 0));
+    EndCommand();
+}
+
+void CommandStreamRecorder::SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps)
+{
+    BeginCommand(CmdSetDescriptorHeaps);
+    Write(numHeaps);
+    for(UINT i = 0; i < numHeaps; ++i)
+        Write(ObjectId(heaps[i]));
+    EndCommand();
+}
+
+void CommandStreamRecorder::SetPipelineState(ID3D12PipelineState* pso)
+{
+    BeginCommand(CmdSetPipelineState);
+    Write(ObjectId(pso));
+    EndCommand();
+}
+
+void CommandStreamRecorder::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+    BeginCommand(CmdSetGraphicsRootSignature);
+    Write(ObjectId(rootSignature));
+    EndCommand();
+}
+
+void CommandStreamRecorder::SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    BeginCommand(CmdSetGraphicsRootConstantBufferView);
+    Write(rootParameterIndex);
+    Write((UINT64)address);
+    EndCommand();
+}
+
+void CommandStreamRecorder::SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    BeginCommand(CmdSetGraphicsRootShaderResourceView);
+    Write(rootParameterIndex);
+    Write((UINT64)address);
+    EndCommand();
+}
+
+void CommandStreamRecorder::SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValues,
+    const void* srcData, UINT destOffsetIn32BitValues)
+{
+    BeginCommand(CmdSetGraphicsRoot32BitConstants);
+    Write(rootParameterIndex);
+    Write(num32BitValues);
+    Write(destOffsetIn32BitValues);
+    WriteArray(reinterpret_cast<const UINT*>(srcData), num32BitValues);
+    EndCommand();
+}
+
+void CommandStreamRecorder::IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+    BeginCommand(CmdIASetVertexBuffers);
+    Write(startSlot);
+    Write(numViews);
+    WriteArray(views, views != nullptr ? numViews : 0);
+    EndCommand();
+}
+
+void CommandStreamRecorder::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+    BeginCommand(CmdIASetIndexBuffer);
+    Write((UINT)(view != nullptr));
+    Write(view != nullptr ? *view : D3D12_INDEX_BUFFER_VIEW{});
+    EndCommand();
+}
+
+void CommandStreamRecorder::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+    BeginCommand(CmdIASetPrimitiveTopology);
+    Write((UINT)topology);
+    EndCommand();
+}
+
+void CommandStreamRecorder::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount,
+    UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation)
+{
+    BeginCommand(CmdDrawIndexedInstanced);
+    Write(indexCountPerInstance);
+    Write(instanceCount);
+    Write(startIndexLocation);
+    Write(baseVertexLocation);
+    Write(startInstanceLocation);
+    EndCommand();
+
+    mStats.Indices += (UINT64)indexCountPerInstance*instanceCount;
+}
+
+void CommandStreamRecorder::ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount,
+    ID3D12Resource* argumentBuffer, UINT64 argumentBufferOffset,
+    ID3D12Resource* countBuffer, UINT64 countBufferOffset)
+{
+    BeginCommand(CmdExecuteIndirect);
+    Write(ObjectId(commandSignature));
+    Write(maxCommandCount);
+    Write(ObjectId(argumentBuffer));
+    Write(argumentBufferOffset);
+    Write(ObjectId(countBuffer));
+    Write(countBufferOffset);
+    EndCommand();
+}
+
+namespace
+{
+    [[noreturn]] void ThrowMalformed()
+    {
+        throw std::invalid_argument("Malformed command stream");
+    }
+
+    // Reads the arguments of one command, throwing if they run past its end.
+    class CommandReader
+    {
+    public:
+        CommandReader(const BYTE* data, size_t byteSize, void* const* objects, UINT objectCount) :
+            mData(data), mByteSize(byteSize), mObjects(objects), mObjectCount(objectCount)
+        {
+        }
+
+        template<typename T>
+        T Read()
+        {
+            T value;
+            ReadArray(&value, 1);
+            return value;
+        }
+
+        template<typename T>
+        void ReadArray(T* values, UINT count)
+        {
+            size_t byteSize = sizeof(T)*count;
+            if(byteSize > mByteSize - mOffset)
+                ThrowMalformed();
+
+            if(byteSize > 0)
+                memcpy(values, mData + mOffset, byteSize);
+            mOffset += byteSize;
+        }
+
+        // Counts come from the stream, so check them against what is left
+        // before sizing anything with them.
+        UINT ReadCount(size_t elementSize)
+        {
+            UINT count = Read<UINT>();
+            if((UINT64)count*elementSize > mByteSize - mOffset)
+                ThrowMalformed();
+            return count;
+        }
+
+        template<typename T>
+        T* ReadObject()
+        {
+            UINT id = Read<UINT>();
+            if(id > mObjectCount)
+                ThrowMalformed();
+            return id == 0 ? nullptr : reinterpret_cast<T*>(mObjects[id - 1]);
+        }
+
+        bool AtEnd()const { return mOffset == mByteSize; }
+
+    private:
+        const BYTE* mData = nullptr;
+        size_t mByteSize = 0;
+        size_t mOffset = 0;
+
+        void* const* mObjects = nullptr;
+        UINT mObjectCount = 0;
+    };
+
+    // Prints each call as a line of text.  Dump replays with objects that are
+    // their own ids, so the pointers printed here are the stream's object ids.
+    class CommandTextWriter : public CommandRecorder
+    {
+    public:
+        explicit CommandTextWriter(std::ostringstream& out) : mOut(out)
+        {
+        }
+
+        void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers) override
+        {
+            mOut << "ResourceBarrier " << numBarriers << "\n";
+            for(UINT i = 0; i < numBarriers; ++i)
+            {
+                const D3D12_RESOURCE_BARRIER& b = barriers[i];
+                if(b.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+                {
+                    mOut << "    transition " << Id(b.Transition.pResource) << " " << b.Transition.Subresource << " " <<
+                        b.Transition.StateBefore << " -> " << b.Transition.StateAfter << "\n";
+                }
+                else if(b.Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING)
+                    mOut << "    aliasing " << Id(b.Aliasing.pResourceBefore) << " " << Id(b.Aliasing.pResourceAfter) << "\n";
+                else
+                    mOut << "    uav " << Id(b.UAV.pResource) << "\n";
+            }
+        }
+
+        void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT colorRGBA[4],
+            UINT numRects, const D3D12_RECT* rects) override
+        {
+            mOut << "ClearRenderTargetView " << Hex(rtv.ptr) << " " << Float(colorRGBA[0]) << " " << Float(colorRGBA[1]) <<
+                " " << Float(colorRGBA[2]) << " " << Float(colorRGBA[3]) << " " << numRects;
+            Rects(numRects, rects);
+            mOut << "\n";
+        }
+
+        void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags,
+            FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects) override
+        {
+            mOut << "ClearDepthStencilView " << Hex(dsv.ptr) << " " << clearFlags << " " << Float(depth) << " " <<
+                (UINT)stencil << " " << numRects;
+            Rects(numRects, rects);
+            mOut << "\n";
+        }
+
+        void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports) override
+        {
+            mOut << "RSSetViewports " << numViewports;
+            for(UINT i = 0; i < numViewports; ++i)
+            {
+                const D3D12_VIEWPORT& v = viewports[i];
+                mOut << " (" << Float(v.TopLeftX) << " " << Float(v.TopLeftY) << " " << Float(v.Width) << " " <<
+                    Float(v.Height) << " " << Float(v.MinDepth) << " " << Float(v.MaxDepth) << ")";
+            }
+            mOut << "\n";
+        }
+
+        void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects) override
+        {
+            mOut << "RSSetScissorRects " << numRects;
+            Rects(numRects, rects);
+            mOut << "\n";
+        }
+
+        void OMSetRenderTargets(UINT numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs,
+            BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv) override
+        {
+            mOut << "OMSetRenderTargets " << numRenderTargets << " " << singleHandleToDescriptorRange;
+            if(rtvs != nullptr && numRenderTargets > 0)
+                mOut << " " << Hex(rtvs[0].ptr);
+            mOut << " " << Hex(dsv != nullptr ? dsv->ptr : 0) << "\n";
+        }
+
+        void SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps) override
+        {
+            mOut << "SetDescriptorHeaps " << numHeaps;
+            for(UINT i = 0; i < numHeaps; ++i)
+                mOut << " " << Id(heaps[i]);
+            mOut << "\n";
+        }
+
+        void SetPipelineState(ID3D12PipelineState* pso) override
+        {
+            mOut << "SetPipelineState " << Id(pso) << "\n";
+        }
+
+        void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) override
+        {
+            mOut << "SetGraphicsRootSignature " << Id(rootSignature) << "\n";
+        }
+
+        void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override
+        {
+            mOut << "SetGraphicsRootConstantBufferView " << rootParameterIndex << " " << Hex(address) << "\n";
+        }
+
+        void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override
+        {
+            mOut << "SetGraphicsRootShaderResourceView " << rootParameterIndex << " " << Hex(address) << "\n";
+        }
+
+        void SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValues,
+            const void* srcData, UINT destOffsetIn32BitValues) override
+        {
+            mOut << "SetGraphicsRoot32BitConstants " << rootParameterIndex << " " << destOffsetIn32BitValues;
+            const UINT* values = reinterpret_cast<const UINT*>(srcData);
+            for(UINT i = 0; i < num32BitValues; ++i)
+                mOut << " " << values[i];
+            mOut << "\n";
+        }
+
+        void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) override
+        {
+            mOut << "IASetVertexBuffers " << startSlot << " " << numViews;
+            for(UINT i = 0; views != nullptr && i < numViews; ++i)
+                mOut << " (" << Hex(views[i].BufferLocation) << " " << views[i].SizeInBytes << " " << views[i].StrideInBytes << ")";
+            mOut << "\n";
+        }
+
+        void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override
+        {
+            mOut << "IASetIndexBuffer";
+            if(view != nullptr)
+                mOut << " " << Hex(view->BufferLocation) << " " << view->SizeInBytes << " " << view->Format;
+            mOut << "\n";
+        }
+
+        void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override
+        {
+            mOut << "IASetPrimitiveTopology " << topology << "\n";
+        }
+
+        void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount,
+            UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) override
+        {
+            mOut << "DrawIndexedInstanced " << indexCountPerInstance << " " << instanceCount << " " <<
+                startIndexLocation << " " << baseVertexLocation << " " << startInstanceLocation << "\n";
+        }
+
+        void ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount,
+            ID3D12Resource* argumentBuffer, UINT64 argumentBufferOffset,
+            ID3D12Resource* countBuffer, UINT64 countBufferOffset) override
+        {
+            mOut << "ExecuteIndirect " << Id(commandSignature) << " " << maxCommandCount << " " <<
+                Id(argumentBuffer) << " " << argumentBufferOffset << " " << Id(countBuffer) << " " << countBufferOffset << "\n";
+        }
+
+    private:
+        void Rects(UINT numRects, const D3D12_RECT* rects)
+        {
+            for(UINT i = 0; i < numRects; ++i)
+                mOut << " (" << rects[i].left << " " << rects[i].top << " " << rects[i].right << " " << rects[i].bottom << ")";
+        }
+
+        static std::string Id(const void* object)
+        {
+            return "#" + std::to_string((UINT64)(uintptr_t)object);
+        }
+
+        static std::string Hex(UINT64 value)
+        {
+            std::ostringstream out;
+            out << "0x" << std::hex << value;
+            return out.str();
+        }
+
+        // Floats as their bit patterns, so equal text means equal values.
+        static std::string Float(float f)
+        {
+            UINT bits;
+            memcpy(&bits, &f, sizeof(UINT));
+            return Hex(bits);
+        }
+
+    private:
+        std::ostringstream& mOut;
+    };
+}
+
+void CommandStreamRecorder::Replay(const BYTE* data, size_t byteSize, void* const* objects, UINT objectCount,
+    CommandRecorder* target)
+{
+    size_t offset = 0;
+    while(offset < byteSize)
+    {
+        if(byteSize - offset < sizeof(CommandHeader))
+            ThrowMalformed();
+
+        CommandHeader header;
+        memcpy(&header, data + offset, sizeof(CommandHeader));
+        offset += sizeof(CommandHeader);
+
+        if(header.ByteSize > byteSize - offset)
+            ThrowMalformed();
+
+        CommandReader in(data + offset, header.ByteSize, objects, objectCount);
+        offset += header.ByteSize;
+
+        switch(header.Type)
+        {
+        case CmdResourceBarrier:
+        {
+            UINT count = in.ReadCount(sizeof(BarrierRecord));
+            std::vector<D3D12_RESOURCE_BARRIER> barriers(count);
+            for(D3D12_RESOURCE_BARRIER& b : barriers)
+            {
+                BarrierRecord record = in.Read<BarrierRecord>();
+
+                // Ids are resolved by hand here since the record holds two of them.
+                auto object = [&](UINT id) -> ID3D12Resource*
+                {
+                    if(id > objectCount)
+                        ThrowMalformed();
+                    return id == 0 ? nullptr : reinterpret_cast<ID3D12Resource*>(objects[id - 1]);
+                };
+
+                b = {};
+                b.Type = (D3D12_RESOURCE_BARRIER_TYPE)record.Type;
+                b.Flags = (D3D12_RESOURCE_BARRIER_FLAGS)record.Flags;
+                if(b.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+                {
+                    b.Transition.pResource = object(record.Resource);
+                    b.Transition.Subresource = record.Subresource;
+                    b.Transition.StateBefore = (D3D12_RESOURCE_STATES)record.StateBefore;
+                    b.Transition.StateAfter = (D3D12_RESOURCE_STATES)record.StateAfter;
+                }
+                else if(b.Type == D3D12_RESOURCE_BARRIER_TYPE_ALIASING)
+                {
+                    b.Aliasing.pResourceBefore = object(record.Resource);
+                    b.Aliasing.pResourceAfter = object(record.ResourceAfter);
+                }
+                else
+                    b.UAV.pResource = object(record.Resource);
+            }
+            target->ResourceBarrier(count, barriers.data());
+            break;
+        }
+        case CmdClearRenderTargetView:
+        {
+            D3D12_CPU_DESCRIPTOR_HANDLE rtv;
+            rtv.ptr = (SIZE_T)in.Read<UINT64>();
+            FLOAT color[4];
+            in.ReadArray(color, 4);
+            std::vector<D3D12_RECT> rects(in.ReadCount(sizeof(D3D12_RECT)));
+            in.ReadArray(rects.data(), (UINT)rects.size());
+            target->ClearRenderTargetView(rtv, color, (UINT)rects.size(), rects.empty() ? nullptr : rects.data());
+            break;
+        }
+        case CmdClearDepthStencilView:
+        {
+            D3D12_CPU_DESCRIPTOR_HANDLE dsv;
+            dsv.ptr = (SIZE_T)in.Read<UINT64>();
+            D3D12_CLEAR_FLAGS flags = (D3D12_CLEAR_FLAGS)in.Read<UINT>();
+            FLOAT depth = in.Read<FLOAT>();
+            UINT8 stencil = (UINT8)in.Read<UINT>();
+            std::vector<D3D12_RECT> rects(in.ReadCount(sizeof(D3D12_RECT)));
+            in.ReadArray(rects.data(), (UINT)rects.size());
+            target->ClearDepthStencilView(dsv, flags, depth, stencil, (UINT)rects.size(),
+                rects.empty() ? nullptr : rects.data());
+            break;
+        }
+        case CmdRSSetViewports:
+        {
+            std::vector<D3D12_VIEWPORT> viewports(in.ReadCount(sizeof(D3D12_VIEWPORT)));
+            in.ReadArray(viewports.data(), (UINT)viewports.size());
+            target->RSSetViewports((UINT)viewports.size(), viewports.data());
+            break;
+        }
+        case CmdRSSetScissorRects:
+        {
+            std::vector<D3D12_RECT> rects(in.ReadCount(sizeof(D3D12_RECT)));
+            in.ReadArray(rects.data(), (UINT)rects.size());
+            target->RSSetScissorRects((UINT)rects.size(), rects.data());
+            break;
+        }
+        case CmdOMSetRenderTargets:
+        {
+            UINT numRenderTargets = in.Read<UINT>();
+            BOOL single = (BOOL)in.Read<UINT>();
+            std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> rtvs(in.ReadCount(sizeof(UINT64)));
+            for(D3D12_CPU_DESCRIPTOR_HANDLE& rtv : rtvs)
+                rtv.ptr = (SIZE_T)in.Read<UINT64>();
+            bool hasDsv = in.Read<UINT>() != 0;
+            D3D12_CPU_DESCRIPTOR_HANDLE dsv;
+            dsv.ptr = (SIZE_T)in.Read<UINT64>();
+            target->OMSetRenderTargets(numRenderTargets, rtvs.empty() ? nullptr : rtvs.data(), single,
+                hasDsv ? &dsv : nullptr);
+            break;
+        }
+        case CmdSetDescriptorHeaps:
+        {
+            std::vector<ID3D12DescriptorHeap*> heaps(in.ReadCount(sizeof(UINT)));
+            for(ID3D12DescriptorHeap*& heap : heaps)
+                heap = in.ReadObject<ID3D12DescriptorHeap>();
+            target->SetDescriptorHeaps((UINT)heaps.size(), heaps.data());
+            break;
+        }
+        case CmdSetPipelineState:
+            target->SetPipelineState(in.ReadObject<ID3D12PipelineState>());
+            break;
+        case CmdSetGraphicsRootSignature:
+            target->SetGraphicsRootSignature(in.ReadObject<ID3D12RootSignature>());
+            break;
+        case CmdSetGraphicsRootConstantBufferView:
+        {
+            UINT parameter = in.Read<UINT>();
+            target->SetGraphicsRootConstantBufferView(parameter, in.Read<UINT64>());
+            break;
+        }
+        case CmdSetGraphicsRootShaderResourceView:
+        {
+            UINT parameter = in.Read<UINT>();
+            target->SetGraphicsRootShaderResourceView(parameter, in.Read<UINT64>());
+            break;
+        }
+        case CmdSetGraphicsRoot32BitConstants:
+        {
+            UINT parameter = in.Read<UINT>();
+            UINT count = in.Read<UINT>();
+            UINT destOffset = in.Read<UINT>();
+            if((UINT64)count*sizeof(UINT) != header.ByteSize - 3*sizeof(UINT))
+                ThrowMalformed();
+            std::vector<UINT> values(count);
+            in.ReadArray(values.data(), count);
+            target->SetGraphicsRoot32BitConstants(parameter, count, values.data(), destOffset);
+            break;
+        }
+        case CmdIASetVertexBuffers:
+        {
+            UINT startSlot = in.Read<UINT>();
+            UINT numViews = in.Read<UINT>();
+            UINT storedViews = in.AtEnd() ? 0 : numViews;
+            if((UINT64)storedViews*sizeof(D3D12_VERTEX_BUFFER_VIEW) != header.ByteSize - 2*sizeof(UINT))
+                ThrowMalformed();
+            std::vector<D3D12_VERTEX_BUFFER_VIEW> views(storedViews);
+            in.ReadArray(views.data(), storedViews);
+            target->IASetVertexBuffers(startSlot, numViews, views.empty() ? nullptr : views.data());
+            break;
+        }
+        case CmdIASetIndexBuffer:
+        {
+            bool hasView = in.Read<UINT>() != 0;
+            D3D12_INDEX_BUFFER_VIEW view = in.Read<D3D12_INDEX_BUFFER_VIEW>();
+            target->IASetIndexBuffer(hasView ? &view : nullptr);
+            break;
+        }
+        case CmdIASetPrimitiveTopology:
+            target->IASetPrimitiveTopology((D3D12_PRIMITIVE_TOPOLOGY)in.Read<UINT>());
+            break;
+        case CmdDrawIndexedInstanced:
+        {
+            UINT indexCount = in.Read<UINT>();
+            UINT instanceCount = in.Read<UINT>();
+            UINT startIndex = in.Read<UINT>();
+            INT baseVertex = in.Read<INT>();
+            UINT startInstance = in.Read<UINT>();
+            target->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+            break;
+        }
+        case CmdExecuteIndirect:
+        {
+            ID3D12CommandSignature* signature = in.ReadObject<ID3D12CommandSignature>();
+            UINT maxCount = in.Read<UINT>();
+            ID3D12Resource* argumentBuffer = in.ReadObject<ID3D12Resource>();
+            UINT64 argumentOffset = in.Read<UINT64>();
+            ID3D12Resource* countBuffer = in.ReadObject<ID3D12Resource>();
+            UINT64 countOffset = in.Read<UINT64>();
+            target->ExecuteIndirect(signature, maxCount, argumentBuffer, argumentOffset, countBuffer, countOffset);
+            break;
+        }
+        default:
+            ThrowMalformed();
+        }
+
+        if(!in.AtEnd())
+            ThrowMalformed();
+    }
+}
+
+void CommandStreamRecorder::Replay(CommandRecorder* target)const
+{
+    Replay(mStream.data(), mStream.size(), mObjects.data(), (UINT)mObjects.size(), target);
+}
+
+std::string CommandStreamRecorder::Dump()const
+{
+    std::vector<void*> ids(mObjects.size());
+    for(size_t i = 0; i < ids.size(); ++i)
+        ids[i] = reinterpret_cast<void*>((uintptr_t)(i + 1));
+
+    std::ostringstream out;
+    CommandTextWriter writer(out);
+    Replay(mStream.data(), mStream.size(), ids.data(), (UINT)ids.size(), &writer);
+
+    return out.str();
+}
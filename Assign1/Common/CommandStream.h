@@ -0,0 +1,161 @@
+//***************************************************************************************
+// CommandStream.h
+//
+// CommandRecorder backend that serializes every call into an in-memory command
+// stream instead of talking to a device, counting calls by type.  It lets frame
+// recording be benchmarked on machines without a GPU, and the streams of two builds
+// be compared by Hash or, command by command, as Dump text.
+//
+// Each command is a CommandHeader followed by its arguments.  Pointers to D3D objects
+// (resources, heaps, root signatures, PSOs, command signatures) are stored as ids:
+// 0 for null, otherwise one more than the object's index in GetObjects(), in order of
+// first use.  GPU virtual addresses and descriptor handles are stored as they are.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandRecorder.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class CommandStreamRecorder : public CommandRecorder
+{
+public:
+    enum CommandType : UINT
+    {
+        CmdResourceBarrier,
+        CmdClearRenderTargetView,
+        CmdClearDepthStencilView,
+        CmdRSSetViewports,
+        CmdRSSetScissorRects,
+        CmdOMSetRenderTargets,
+        CmdSetDescriptorHeaps,
+        CmdSetPipelineState,
+        CmdSetGraphicsRootSignature,
+        CmdSetGraphicsRootConstantBufferView,
+        CmdSetGraphicsRootShaderResourceView,
+        CmdSetGraphicsRoot32BitConstants,
+        CmdIASetVertexBuffers,
+        CmdIASetIndexBuffer,
+        CmdIASetPrimitiveTopology,
+        CmdDrawIndexedInstanced,
+        CmdExecuteIndirect,
+        CommandTypeCount
+    };
+
+    struct CommandHeader
+    {
+        UINT Type = 0;
+        UINT ByteSize = 0;   // Size of the arguments that follow.
+    };
+
+    struct Stats
+    {
+        UINT64 Calls[CommandTypeCount] = {};
+        UINT64 Commands = 0;
+        UINT64 Bytes = 0;
+        UINT64 Barriers = 0;
+        UINT64 Indices = 0;   // Index count times instance count of the direct draws.
+    };
+
+    static const char* CommandName(UINT type);
+
+    CommandStreamRecorder() = default;
+    CommandStreamRecorder(const CommandStreamRecorder& rhs) = delete;
+    CommandStreamRecorder& operator=(const CommandStreamRecorder& rhs) = delete;
+
+    // Empties the stream, the object table and the counters.  Memory is kept for
+    // the next recording.
+    void Clear();
+
+    const std::vector<BYTE>& GetStream()const { return mStream; }
+    const std::vector<void*>& GetObjects()const { return mObjects; }
+    const Stats& GetStats()const { return mStats; }
+
+    // Hash of the stream.  Equal for identical submissions within a run; GPU
+    // addresses and descriptor handles can differ between runs.
+    std::uint64_t Hash()const;
+
+    // Decodes a stream and makes the same calls on target.  Object id i (i > 0)
+    // is passed on as objects[i - 1].  Throws std::invalid_argument on a malformed
+    // stream.
+    static void Replay(const BYTE* data, size_t byteSize, void* const* objects, UINT objectCount,
+        CommandRecorder* target);
+    void Replay(CommandRecorder* target)const;
+
+    // The stream as text, one command per line.
+    std::string Dump()const;
+
+    void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers) override;
+
+    void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT colorRGBA[4],
+        UINT numRects, const D3D12_RECT* rects) override;
+    void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags,
+        FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects) override;
+
+    void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports) override;
+    void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects) override;
+    void OMSetRenderTargets(UINT numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs,
+        BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv) override;
+
+    void SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps) override;
+    void SetPipelineState(ID3D12PipelineState* pso) override;
+    void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) override;
+    void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValues,
+        const void* srcData, UINT destOffsetIn32BitValues) override;
+
+    void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) override;
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override;
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override;
+
+    void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount,
+        UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) override;
+    void ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount,
+        ID3D12Resource* argumentBuffer, UINT64 argumentBufferOffset,
+        ID3D12Resource* countBuffer, UINT64 countBufferOffset) override;
+
+private:
+    // A barrier with its resources replaced by object ids.
+    struct BarrierRecord
+    {
+        UINT Type = 0;
+        UINT Flags = 0;
+        UINT Resource = 0;      // Transition and UAV resource, or the aliasing "before" resource.
+        UINT ResourceAfter = 0; // Aliasing "after" resource.
+        UINT Subresource = 0;
+        UINT StateBefore = 0;
+        UINT StateAfter = 0;
+    };
+
+    UINT ObjectId(void* object);
+
+    void BeginCommand(CommandType type);
+    void EndCommand();
+
+    template<typename T>
+    void Write(const T& value)
+    {
+        const BYTE* bytes = reinterpret_cast<const BYTE*>(&value);
+        mStream.insert(mStream.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    void WriteArray(const T* values, UINT count)
+    {
+        const BYTE* bytes = reinterpret_cast<const BYTE*>(values);
+        mStream.insert(mStream.end(), bytes, bytes + sizeof(T)*count);
+    }
+
+private:
+    std::vector<BYTE> mStream;
+    size_t mCommandStart = 0;
+
+    std::vector<void*> mObjects;
+    std::unordered_map<void*, UINT> mObjectIds;
+
+    Stats mStats;
+};
@@ -0,0 +1,101 @@
+#include "D3D12CommandRecorder.h"
+
+D3D12CommandRecorder::D3D12CommandRecorder(ID3D12GraphicsCommandList* cmdList) :
+    mCommandList(cmdList)
+{
+    assert(mCommandList != nullptr);
+}
+
+void D3D12CommandRecorder::ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers)
+{
+    mCommandList->ResourceBarrier(numBarriers, barriers);
+}
+
+void D3D12CommandRecorder::ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT colorRGBA[4],
+    UINT numRects, const D3D12_RECT* rects)
+{
+    mCommandList->ClearRenderTargetView(rtv, colorRGBA, numRects, rects);
+}
+
+void D3D12CommandRecorder::ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags,
+    FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects)
+{
+    mCommandList->ClearDepthStencilView(dsv, clearFlags, depth, stencil, numRects, rects);
+}
+
+void D3D12CommandRecorder::RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports)
+{
+    mCommandList->RSSetViewports(numViewports, viewports);
+}
+
+void D3D12CommandRecorder::RSSetScissorRects(UINT numRects, const D3D12_RECT* rects)
+{
+    mCommandList->RSSetScissorRects(numRects, rects);
+}
+
+void D3D12CommandRecorder::OMSetRenderTargets(UINT numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs,
+    BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv)
+{
+    mCommandList->OMSetRenderTargets(numRenderTargets, rtvs, singleHandleToDescriptorRange, dsv);
+}
+
+void D3D12CommandRecorder::SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps)
+{
+    mCommandList->SetDescriptorHeaps(numHeaps, heaps);
+}
+
+void D3D12CommandRecorder::SetPipelineState(ID3D12PipelineState* pso)
+{
+    mCommandList->SetPipelineState(pso);
+}
+
+void D3D12CommandRecorder::SetGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+    mCommandList->SetGraphicsRootSignature(rootSignature);
+}
+
+void D3D12CommandRecorder::SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    mCommandList->SetGraphicsRootConstantBufferView(rootParameterIndex, address);
+}
+
+void D3D12CommandRecorder::SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address)
+{
+    mCommandList->SetGraphicsRootShaderResourceView(rootParameterIndex, address);
+}
+
+void D3D12CommandRecorder::SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValues,
+    const void* srcData, UINT destOffsetIn32BitValues)
+{
+    mCommandList->SetGraphicsRoot32BitConstants(rootParameterIndex, num32BitValues, srcData, destOffsetIn32BitValues);
+}
+
+void D3D12CommandRecorder::IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+    mCommandList->IASetVertexBuffers(startSlot, numViews, views);
+}
+
+void D3D12CommandRecorder::IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+    mCommandList->IASetIndexBuffer(view);
+}
+
+void D3D12CommandRecorder::IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology)
+{
+    mCommandList->IASetPrimitiveTopology(topology);
+}
+
+void D3D12CommandRecorder::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount,
+    UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation)
+{
+    mCommandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount,
+        startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+void D3D12CommandRecorder::ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount,
+    ID3D12Resource* argumentBuffer, UINT64 argumentBufferOffset,
+    ID3D12Resource* countBuffer, UINT64 countBufferOffset)
+{
+    mCommandList->ExecuteIndirect(commandSignature, maxCommandCount,
+        argumentBuffer, argumentBufferOffset, countBuffer, countBufferOffset);
+}
@@ -0,0 +1,54 @@
+//***************************************************************************************
+// D3D12CommandRecorder.h
+//
+// CommandRecorder that forwards every call to an ID3D12GraphicsCommandList.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "CommandRecorder.h"
+
+// Forwards every call to a command list.
+class D3D12CommandRecorder : public CommandRecorder
+{
+public:
+    explicit D3D12CommandRecorder(ID3D12GraphicsCommandList* cmdList);
+    D3D12CommandRecorder(const D3D12CommandRecorder& rhs) = delete;
+    D3D12CommandRecorder& operator=(const D3D12CommandRecorder& rhs) = delete;
+
+    ID3D12GraphicsCommandList* CommandList()const { return mCommandList; }
+
+    void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers) override;
+
+    void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const FLOAT colorRGBA[4],
+        UINT numRects, const D3D12_RECT* rects) override;
+    void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags,
+        FLOAT depth, UINT8 stencil, UINT numRects, const D3D12_RECT* rects) override;
+
+    void RSSetViewports(UINT numViewports, const D3D12_VIEWPORT* viewports) override;
+    void RSSetScissorRects(UINT numRects, const D3D12_RECT* rects) override;
+    void OMSetRenderTargets(UINT numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs,
+        BOOL singleHandleToDescriptorRange, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv) override;
+
+    void SetDescriptorHeaps(UINT numHeaps, ID3D12DescriptorHeap* const* heaps) override;
+    void SetPipelineState(ID3D12PipelineState* pso) override;
+    void SetGraphicsRootSignature(ID3D12RootSignature* rootSignature) override;
+    void SetGraphicsRootConstantBufferView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void SetGraphicsRootShaderResourceView(UINT rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS address) override;
+    void SetGraphicsRoot32BitConstants(UINT rootParameterIndex, UINT num32BitValues,
+        const void* srcData, UINT destOffsetIn32BitValues) override;
+
+    void IASetVertexBuffers(UINT startSlot, UINT numViews, const D3D12_VERTEX_BUFFER_VIEW* views) override;
+    void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override;
+    void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY topology) override;
+
+    void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount,
+        UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) override;
+    void ExecuteIndirect(ID3D12CommandSignature* commandSignature, UINT maxCommandCount,
+        ID3D12Resource* argumentBuffer, UINT64 argumentBufferOffset,
+        ID3D12Resource* countBuffer, UINT64 countBufferOffset) override;
+
+private:
+    ID3D12GraphicsCommandList* mCommandList = nullptr;
+};
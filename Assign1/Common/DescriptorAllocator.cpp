@@ -0,0 +1,202 @@
+#include "DescriptorAllocator.h"
+#include <cassert>
+#include <iterator>
+
+DescriptorAllocator::DescriptorAllocator(uint32_t persistentCount, uint32_t transientCount) :
+    mPersistentCount(persistentCount),
+    mTransientCount(transientCount)
+{
+    if(mPersistentCount > 0)
+        mFreeRanges[0] = mPersistentCount;
+}
+
+uint32_t DescriptorAllocator::AllocatePersistent(uint32_t count)
+{
+    if(count == 0)
+        return InvalidIndex;
+
+    // First fit keeps the low end of the region packed.
+    for(auto it = mFreeRanges.begin(); it != mFreeRanges.end(); ++it)
+    {
+        if(it->second < count)
+            continue;
+
+        uint32_t index = it->first;
+        uint32_t remaining = it->second - count;
+        mFreeRanges.erase(it);
+        if(remaining > 0)
+            mFreeRanges[index + count] = remaining;
+
+        mAllocations[index] = count;
+        mPersistentUsed += count;
+        return index;
+    }
+
+    ++mFailedAllocations;
+    return InvalidIndex;
+}
+
+void DescriptorAllocator::FreePersistent(uint32_t index)
+{
+    auto it = mAllocations.find(index);
+    assert(it != mAllocations.end());
+    if(it == mAllocations.end())
+        return;
+
+    uint32_t count = it->second;
+    mPersistentUsed -= count;
+    mAllocations.erase(it);
+
+    // Merge with the free ranges on either side.
+    auto next = mFreeRanges.lower_bound(index);
+    if(next != mFreeRanges.end() && next->first == index + count)
+    {
+        count += next->second;
+        next = mFreeRanges.erase(next);
+    }
+
+    if(next != mFreeRanges.begin())
+    {
+        auto prev = std::prev(next);
+        if(prev->first + prev->second == index)
+        {
+            prev->second += count;
+            return;
+        }
+    }
+
+    mFreeRanges[index] = count;
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t frameIndex)
+{
+    if(mFrameOpen)
+    {
+        mLastFrameUsed = mCurrFrame.Used;
+        mFrames.push_back(mCurrFrame);
+    }
+
+    // Frames complete in submission order, so everything up to the last use of
+    // frameIndex is done.
+    bool found = false;
+    for(const Frame& frame : mFrames)
+        found = found || frame.FrameIndex == frameIndex;
+
+    while(found && !mFrames.empty())
+    {
+        Frame frame = mFrames.front();
+        mFrames.pop_front();
+        mTransientUsed -= frame.Used;
+        found = frame.FrameIndex != frameIndex;
+    }
+
+    // Nothing in flight: start again at the bottom of the ring so the next
+    // allocations do not have to skip slots at the wrap.
+    if(mTransientUsed == 0)
+        mHead = 0;
+
+    mCurrFrame = Frame();
+    mCurrFrame.FrameIndex = frameIndex;
+    mFrameOpen = true;
+}
+
+uint32_t DescriptorAllocator::AllocateTransient(uint32_t count)
+{
+    assert(mFrameOpen);
+
+    if(count == 0 || count > mTransientCount)
+    {
+        ++mFailedAllocations;
+        return InvalidIndex;
+    }
+
+    // The free slots run from the head round to the oldest live frame.  A range
+    // must not straddle the end of the ring, so the slots up to the end are
+    // skipped when it would.
+    uint32_t position = mHead;
+    uint32_t skipped = 0;
+    if(position + count > mTransientCount)
+    {
+        skipped = mTransientCount - position;
+        position = 0;
+    }
+
+    if(count + skipped > mTransientCount - mTransientUsed)
+    {
+        ++mFailedAllocations;
+        return InvalidIndex;
+    }
+
+    mHead = (position + count) % mTransientCount;
+    mTransientUsed += count + skipped;
+    mCurrFrame.Used += count + skipped;
+    mTransientPeak = mTransientUsed > mTransientPeak ? mTransientUsed : mTransientPeak;
+
+    return mPersistentCount + position;
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::GetStats()const
+{
+    Stats stats;
+    stats.PersistentCapacity = mPersistentCount;
+    stats.PersistentUsed = mPersistentUsed;
+    stats.PersistentAllocations = (uint32_t)mAllocations.size();
+    stats.FreeRangeCount = (uint32_t)mFreeRanges.size();
+    for(auto& range : mFreeRanges)
+        stats.LargestFreeRange = range.second > stats.LargestFreeRange ? range.second : stats.LargestFreeRange;
+
+    stats.TransientCapacity = mTransientCount;
+    stats.TransientUsed = mTransientUsed;
+    stats.TransientPeak = mTransientPeak;
+    stats.LastFrameUsed = mLastFrameUsed;
+    stats.FailedAllocations = mFailedAllocations;
+
+    return stats;
+}
+
+bool DescriptorAllocator::Validate()const
+{
+    // Free ranges and allocations, in index order, must tile [0, mPersistentCount).
+    std::map<uint32_t, uint32_t> ranges;
+    uint32_t used = 0;
+
+    for(auto& a : mAllocations)
+    {
+        if(a.second == 0 || !ranges.emplace(a.first, a.second).second)
+            return false;
+        used += a.second;
+    }
+
+    uint32_t prevFreeEnd = InvalidIndex;
+    for(auto& f : mFreeRanges)
+    {
+        // Touching free ranges mean FreePersistent failed to merge them.
+        if(f.second == 0 || f.first == prevFreeEnd)
+            return false;
+        if(!ranges.emplace(f.first, f.second).second)
+            return false;
+        prevFreeEnd = f.first + f.second;
+    }
+
+    if(used != mPersistentUsed)
+        return false;
+
+    uint32_t expected = 0;
+    for(auto& r : ranges)
+    {
+        if(r.first != expected)
+            return false;
+        expected += r.second;
+    }
+
+    if(expected != mPersistentCount)
+        return false;
+
+    // The live frames and the open one account for every used ring slot.
+    uint32_t transientUsed = mFrameOpen ? mCurrFrame.Used : 0;
+    for(const Frame& frame : mFrames)
+        transientUsed += frame.Used;
+
+    return transientUsed == mTransientUsed && mTransientUsed <= mTransientCount &&
+        (mTransientCount == 0 || mHead < mTransientCount);
+}
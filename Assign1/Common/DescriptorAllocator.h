@@ -0,0 +1,102 @@
+//***************************************************************************************
+// DescriptorAllocator.h
+//
+// Hands out descriptor indices in one heap split into two regions.  The persistent
+// region [0, persistentCount) serves long-lived descriptors (texture SRVs) from a
+// first-fit free-list of ranges that merges neighbours on Free.  The transient region
+// after it is a ring: each frame allocates linearly, and the descriptors of a frame
+// are released together when its frame resource comes round again.
+//
+// Like BuddyAllocator it only deals in indices and has no dependency on Direct3D,
+// so it can be driven and validated on the CPU (see DescriptorHeap for the device
+// front end).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+
+class DescriptorAllocator
+{
+public:
+    static const uint32_t InvalidIndex = ~0u;
+
+    struct Stats
+    {
+        uint32_t PersistentCapacity = 0;
+        uint32_t PersistentUsed = 0;
+        uint32_t PersistentAllocations = 0;
+        uint32_t LargestFreeRange = 0;
+        uint32_t FreeRangeCount = 0;
+
+        uint32_t TransientCapacity = 0;
+        uint32_t TransientUsed = 0;       // Live frames, including slots skipped at the wrap.
+        uint32_t TransientPeak = 0;
+        uint32_t LastFrameUsed = 0;       // Slots taken by the last completed BeginFrame..BeginFrame.
+        uint32_t FailedAllocations = 0;
+
+        float PersistentOccupancy()const
+        {
+            return PersistentCapacity == 0 ? 0.0f : (float)PersistentUsed / (float)PersistentCapacity;
+        }
+
+        float TransientOccupancy()const
+        {
+            return TransientCapacity == 0 ? 0.0f : (float)TransientUsed / (float)TransientCapacity;
+        }
+    };
+
+    DescriptorAllocator(uint32_t persistentCount, uint32_t transientCount);
+
+    // Returns the first index of count contiguous persistent descriptors, or
+    // InvalidIndex if no free range is large enough.
+    uint32_t AllocatePersistent(uint32_t count = 1);
+    void FreePersistent(uint32_t index);
+
+    // Starts recording for frame resource frameIndex.  The caller must have waited
+    // for the GPU to finish the previous frame that used frameIndex; its transient
+    // descriptors, and those of every frame before it, are released.
+    void BeginFrame(uint32_t frameIndex);
+
+    // Returns the first index of count contiguous transient descriptors that stay
+    // valid until the current frame is retired, or InvalidIndex if the ring is full.
+    uint32_t AllocateTransient(uint32_t count);
+
+    uint32_t PersistentCount()const { return mPersistentCount; }
+    uint32_t TransientCount()const { return mTransientCount; }
+    uint32_t Capacity()const { return mPersistentCount + mTransientCount; }
+
+    Stats GetStats()const;
+
+    // Checks that the free ranges and allocations tile the persistent region
+    // without overlapping, no two free ranges touch, and the ring's bookkeeping adds up.
+    bool Validate()const;
+
+private:
+    struct Frame
+    {
+        uint32_t FrameIndex = 0;
+        uint32_t Used = 0;   // Slots the frame took, including any skipped at the wrap.
+    };
+
+    uint32_t mPersistentCount = 0;
+    uint32_t mTransientCount = 0;
+
+    // Free persistent ranges, first index -> count, and live allocations likewise.
+    std::map<uint32_t, uint32_t> mFreeRanges;
+    std::map<uint32_t, uint32_t> mAllocations;
+    uint32_t mPersistentUsed = 0;
+
+    // Frames whose transient descriptors may still be read by the GPU, oldest first.
+    std::deque<Frame> mFrames;
+    bool mFrameOpen = false;
+    Frame mCurrFrame;
+
+    uint32_t mHead = 0;
+    uint32_t mTransientUsed = 0;
+    uint32_t mTransientPeak = 0;
+    uint32_t mLastFrameUsed = 0;
+    uint32_t mFailedAllocations = 0;
+};
@@ -0,0 +1,141 @@
+#include "DescriptorHeap.h"
+
+DescriptorHeap::DescriptorHeap(ID3D12Device* device, UINT persistentCount, UINT transientCount) :
+    md3dDevice(device),
+    mAllocator(persistentCount, transientCount)
+{
+    if(IsCpuOnly())
+        return;
+
+    mDescriptorSize = md3dDevice->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc = {};
+    heapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heapDesc.NumDescriptors = mAllocator.Capacity();
+    heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    heapDesc.NodeMask = 0;
+    ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(mHeap.GetAddressOf())));
+
+    // Shader-visible heaps may be write-combined memory, so views are written to
+    // and copied from a CPU-only heap instead.
+    if(persistentCount > 0)
+    {
+        heapDesc.NumDescriptors = persistentCount;
+        heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+        ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(mStagingHeap.GetAddressOf())));
+    }
+}
+
+UINT DescriptorHeap::AllocatePersistent(UINT count)
+{
+    return mAllocator.AllocatePersistent(count);
+}
+
+void DescriptorHeap::FreePersistent(UINT index)
+{
+    mAllocator.FreePersistent(index);
+}
+
+void DescriptorHeap::BeginFrame(UINT frameIndex)
+{
+    mAllocator.BeginFrame(frameIndex);
+}
+
+UINT DescriptorHeap::AllocateTransient(UINT count)
+{
+    return mAllocator.AllocateTransient(count);
+}
+
+void DescriptorHeap::CreateShaderResourceView(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc, UINT index)
+{
+    assert(index < mAllocator.PersistentCount());
+
+    if(!IsCpuOnly())
+        md3dDevice->CreateShaderResourceView(resource, desc, StagingCpuHandle(index));
+
+    StageCopy(index, StagingCpuHandle(index));
+}
+
+void DescriptorHeap::CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, UINT index)
+{
+    assert(index < mAllocator.PersistentCount());
+
+    if(!IsCpuOnly())
+        md3dDevice->CreateConstantBufferView(&desc, StagingCpuHandle(index));
+
+    StageCopy(index, StagingCpuHandle(index));
+}
+
+void DescriptorHeap::StageCopy(UINT index, D3D12_CPU_DESCRIPTOR_HANDLE src, UINT count)
+{
+    assert(count > 0 && index + count <= mAllocator.Capacity());
+
+    mCopyDst.push_back(CpuHandle(index));
+    mCopySrc.push_back(src);
+    mCopySizes.push_back(count);
+
+    ++mCopiesStaged;
+    mDescriptorsCopied += count;
+}
+
+void DescriptorHeap::FlushCopies()
+{
+    if(mCopySizes.empty())
+        return;
+
+    if(!IsCpuOnly())
+    {
+        UINT rangeCount = (UINT)mCopySizes.size();
+        md3dDevice->CopyDescriptors(
+            rangeCount, mCopyDst.data(), mCopySizes.data(),
+            rangeCount, mCopySrc.data(), mCopySizes.data(),
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+
+    ++mCopyCalls;
+
+    mCopyDst.clear();
+    mCopySrc.clear();
+    mCopySizes.clear();
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::StagingCpuHandle(UINT index)const
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = {};
+    if(mStagingHeap != nullptr)
+        handle = mStagingHeap->GetCPUDescriptorHandleForHeapStart();
+
+    handle.ptr += (SIZE_T)index*mDescriptorSize;
+    return handle;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::CpuHandle(UINT index)const
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE handle = {};
+    if(mHeap != nullptr)
+        handle = mHeap->GetCPUDescriptorHandleForHeapStart();
+
+    handle.ptr += (SIZE_T)index*mDescriptorSize;
+    return handle;
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GpuHandle(UINT index)const
+{
+    D3D12_GPU_DESCRIPTOR_HANDLE handle = {};
+    if(mHeap != nullptr)
+        handle = mHeap->GetGPUDescriptorHandleForHeapStart();
+
+    handle.ptr += (UINT64)index*mDescriptorSize;
+    return handle;
+}
+
+DescriptorHeap::Stats DescriptorHeap::GetStats()const
+{
+    Stats stats;
+    stats.Allocator = mAllocator.GetStats();
+    stats.CopiesStaged = mCopiesStaged;
+    stats.DescriptorsCopied = mDescriptorsCopied;
+    stats.CopyCalls = mCopyCalls;
+
+    return stats;
+}
@@ -0,0 +1,91 @@
+//***************************************************************************************
+// DescriptorHeap.h
+//
+// One shader-visible CBV/SRV/UAV heap whose indices are managed by a
+// DescriptorAllocator: persistent descriptors from a free-list, transient ones from
+// a ring shared by the frame resources.
+//
+// Views are not written into the shader-visible heap directly.  Persistent views
+// are created in a CPU-only staging heap at the same index, and copies into the
+// shader-visible heap are queued and issued together by FlushCopies, as a single
+// CopyDescriptors call.
+//
+// Constructed with a null device no heaps are created and the handles are left
+// zero, but allocation, staging and statistics behave the same, so descriptor usage
+// can be exercised without a GPU.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include "DescriptorAllocator.h"
+
+class DescriptorHeap
+{
+public:
+    static const UINT InvalidIndex = DescriptorAllocator::InvalidIndex;
+
+    struct Stats
+    {
+        DescriptorAllocator::Stats Allocator;
+        UINT64 CopiesStaged = 0;       // Ranges queued by StageCopy.
+        UINT64 DescriptorsCopied = 0;
+        UINT64 CopyCalls = 0;          // CopyDescriptors calls made by FlushCopies.
+    };
+
+    // device may be null for the CPU-only mode described above.
+    DescriptorHeap(ID3D12Device* device, UINT persistentCount, UINT transientCount);
+    DescriptorHeap(const DescriptorHeap& rhs) = delete;
+    DescriptorHeap& operator=(const DescriptorHeap& rhs) = delete;
+
+    UINT AllocatePersistent(UINT count = 1);
+
+    // The caller must make sure the GPU no longer reads the descriptors.
+    void FreePersistent(UINT index);
+
+    // See DescriptorAllocator::BeginFrame.
+    void BeginFrame(UINT frameIndex);
+    UINT AllocateTransient(UINT count);
+
+    // Creates a view in the staging heap at persistent index and queues its copy
+    // into the shader-visible heap.
+    void CreateShaderResourceView(ID3D12Resource* resource, const D3D12_SHADER_RESOURCE_VIEW_DESC* desc, UINT index);
+    void CreateConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, UINT index);
+
+    // Queues a copy of count descriptors starting at src, in a CPU-only heap, to
+    // the shader-visible heap at index.  Used to gather persistent descriptors
+    // into contiguous transient tables.
+    void StageCopy(UINT index, D3D12_CPU_DESCRIPTOR_HANDLE src, UINT count = 1);
+
+    // Issues the queued copies.  Call before the command lists that use them execute.
+    void FlushCopies();
+
+    // Staging copy of persistent descriptor index; valid as a StageCopy source.
+    D3D12_CPU_DESCRIPTOR_HANDLE StagingCpuHandle(UINT index)const;
+    D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle(UINT index)const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle(UINT index)const;
+
+    ID3D12DescriptorHeap* Heap()const { return mHeap.Get(); }
+    bool IsCpuOnly()const { return md3dDevice == nullptr; }
+
+    Stats GetStats()const;
+    bool Validate()const { return mAllocator.Validate(); }
+
+private:
+    ID3D12Device* md3dDevice = nullptr;
+    UINT mDescriptorSize = 0;
+
+    DescriptorAllocator mAllocator;
+
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap = nullptr;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mStagingHeap = nullptr;
+
+    // Pending copies as the source and destination ranges CopyDescriptors takes.
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> mCopyDst;
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> mCopySrc;
+    std::vector<UINT> mCopySizes;
+
+    UINT64 mCopiesStaged = 0;
+    UINT64 mDescriptorsCopied = 0;
+    UINT64 mCopyCalls = 0;
+};
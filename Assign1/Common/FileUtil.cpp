@@ -0,0 +1,115 @@
+#include "FileUtil.h"
+
+#include <cstdio>
+#include <fstream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace
+{
+#if defined(_WIN32)
+    // MSVC's streams take wide names directly.
+    const std::wstring& NativePath(const std::wstring& filename)
+    {
+        return filename;
+    }
+
+    bool MoveOver(const std::wstring& from, const std::wstring& to)
+    {
+        return MoveFileExW(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+    }
+
+    void RemoveFile(const std::wstring& filename)
+    {
+        DeleteFileW(filename.c_str());
+    }
+#else
+    // Elsewhere file names are bytes, taken to be UTF-8.
+    std::string NativePath(const std::wstring& filename)
+    {
+        std::string path;
+        for(wchar_t wc : filename)
+        {
+            unsigned long c = (unsigned long)wc;
+            if(c < 0x80)
+                path += (char)c;
+            else if(c < 0x800)
+            {
+                path += (char)(0xC0 | (c >> 6));
+                path += (char)(0x80 | (c & 0x3F));
+            }
+            else if(c < 0x10000)
+            {
+                path += (char)(0xE0 | (c >> 12));
+                path += (char)(0x80 | ((c >> 6) & 0x3F));
+                path += (char)(0x80 | (c & 0x3F));
+            }
+            else
+            {
+                path += (char)(0xF0 | (c >> 18));
+                path += (char)(0x80 | ((c >> 12) & 0x3F));
+                path += (char)(0x80 | ((c >> 6) & 0x3F));
+                path += (char)(0x80 | (c & 0x3F));
+            }
+        }
+        return path;
+    }
+
+    // rename replaces the destination atomically on POSIX.
+    bool MoveOver(const std::wstring& from, const std::wstring& to)
+    {
+        return std::rename(NativePath(from).c_str(), NativePath(to).c_str()) == 0;
+    }
+
+    void RemoveFile(const std::wstring& filename)
+    {
+        std::remove(NativePath(filename).c_str());
+    }
+#endif
+}
+
+bool WriteFileAtomic(const std::wstring& filename, const void* data, std::size_t size)
+{
+    return WriteFileAtomic(filename, [&](std::ostream& out)
+    {
+        out.write((const char*)data, size);
+    });
+}
+
+bool WriteFileAtomic(const std::wstring& filename, const std::function<void(std::ostream& out)>& write,
+    bool binary)
+{
+    std::wstring tempFile = filename + L".tmp";
+
+    std::ofstream fout(NativePath(tempFile), binary ? std::ios::binary : std::ios::openmode());
+    if(fout)
+        write(fout);
+    fout.close();
+
+    if(fout && MoveOver(tempFile, filename))
+        return true;
+
+    RemoveFile(tempFile);
+    return false;
+}
+
+bool ReadFileContents(const std::wstring& filename, std::vector<unsigned char>& data)
+{
+    data.clear();
+
+    std::ifstream fin(NativePath(filename), std::ios::binary | std::ios::ate);
+    if(!fin)
+        return false;
+
+    std::streamoff size = fin.tellg();
+    if(size < 0)
+        return false;
+
+    data.resize((size_t)size);
+    fin.seekg(0, std::ios::beg);
+    fin.read((char*)data.data(), size);
+
+    return (bool)fin;
+}
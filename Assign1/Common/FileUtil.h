@@ -0,0 +1,30 @@
+//***************************************************************************************
+// FileUtil.h
+//
+// Writing files so that a reader never sees a partial one: the contents go to a
+// temporary file next to the destination, which is renamed over it only once the
+// write has succeeded.  Used by the shader, permutation and pipeline caches, the
+// scene and capture files, and the frame stats export.  Needs no D3D headers, so
+// the portable code can use it too, and takes the same wide file names on every
+// platform (UTF-8 outside Windows).  ReadFileContents is the matching read.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Writes size bytes of data to filename.  Returns false, with any existing file left
+// as it was and no temporary file left behind, if the write or the rename fails.
+bool WriteFileAtomic(const std::wstring& filename, const void* data, std::size_t size);
+
+// Same, with the contents written by write.  binary is false for text files, which
+// get the platform's line endings.
+bool WriteFileAtomic(const std::wstring& filename, const std::function<void(std::ostream& out)>& write,
+    bool binary = true);
+
+// Reads the whole of filename into data.  Returns false if it cannot be opened or read.
+bool ReadFileContents(const std::wstring& filename, std::vector<unsigned char>& data);
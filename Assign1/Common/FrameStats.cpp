@@ -0,0 +1,229 @@
+#include "FrameStats.h"
+
+#include <cassert>
+
+namespace
+{
+    const char* const JsonTimingNames[FrameStats::TimingCount] =
+    {
+        "frame",
+        "update",
+        "draw",
+        "fenceWait",
+    };
+}
+
+FrameStats::FrameStats(std::uint32_t capacity, double budgetMs, double spikeFactor)
+    : mRecords(capacity > 0 ? capacity : 1), mBudgetMs(budgetMs), mSpikeFactor(spikeFactor)
+{
+}
+
+void FrameStats::BeginFrame(double time, double frameMs)
+{
+    assert(!mFrameOpen);
+
+    mCurrent = Record();
+    mCurrent.Index = mFrameCount;
+    mCurrent.Time = time;
+    mCurrent.Ms[TimingFrame] = frameMs;
+    mFrameOpen = true;
+}
+
+void FrameStats::AddTime(Timing timing, double ms)
+{
+    assert(mFrameOpen);
+    mCurrent.Ms[timing] += ms;
+}
+
+void FrameStats::EndFrame()
+{
+    assert(mFrameOpen);
+    mFrameOpen = false;
+
+    // Flag against the window before this frame joins it, so a spike does not
+    // raise the median it is compared with.
+    double frameMs = mCurrent.Ms[TimingFrame];
+    if(frameMs > mBudgetMs)
+    {
+        mCurrent.Flags |= FrameOverBudget;
+        ++mOverBudgetCount;
+    }
+    if(mSize >= SpikeMinFrames && frameMs > mSpikeFactor * mSketches[TimingFrame].Quantile(0.5))
+    {
+        mCurrent.Flags |= FrameSpike;
+        ++mSpikeCount;
+    }
+
+    const std::uint32_t capacity = (std::uint32_t)mRecords.size();
+    if(mSize == capacity)
+    {
+        const Record& oldest = mRecords[mHead];
+        for(int t = 0; t < TimingCount; ++t)
+            mSketches[t].Remove(oldest.Ms[t]);
+
+        mRecords[mHead] = mCurrent;
+        mHead = (mHead + 1) % capacity;
+    }
+    else
+    {
+        mRecords[(mHead + mSize) % capacity] = mCurrent;
+        ++mSize;
+    }
+
+    for(int t = 0; t < TimingCount; ++t)
+        mSketches[t].Add(mCurrent.Ms[t]);
+
+    ++mFrameCount;
+}
+
+void FrameStats::Clear()
+{
+    mHead = 0;
+    mSize = 0;
+    for(QuantileSketch& sketch : mSketches)
+        sketch.Clear();
+
+    mFrameOpen = false;
+    mFrameCount = 0;
+    mOverBudgetCount = 0;
+    mSpikeCount = 0;
+}
+
+const FrameStats::Record& FrameStats::GetRecord(std::uint32_t i)const
+{
+    assert(i < mSize);
+    return mRecords[(mHead + i) % mRecords.size()];
+}
+
+FrameStats::Summary FrameStats::Summarize(Timing timing)const
+{
+    Summary summary;
+    summary.Count = mSize;
+    if(mSize == 0)
+        return summary;
+
+    double total = 0.0;
+    summary.Min = GetRecord(0).Ms[timing];
+    for(std::uint32_t i = 0; i < mSize; ++i)
+    {
+        double ms = GetRecord(i).Ms[timing];
+        total += ms;
+        if(ms < summary.Min)
+            summary.Min = ms;
+        if(ms > summary.Max)
+            summary.Max = ms;
+    }
+
+    const QuantileSketch& sketch = mSketches[timing];
+    summary.Mean = total / mSize;
+    summary.P50 = sketch.Quantile(0.50);
+    summary.P95 = sketch.Quantile(0.95);
+    summary.P99 = sketch.Quantile(0.99);
+
+    // A bucket's representative value can lie just past the values in it.
+    for(double* p : { &summary.P50, &summary.P95, &summary.P99 })
+    {
+        *p = *p < summary.Max ? *p : summary.Max;
+        *p = *p > summary.Min ? *p : summary.Min;
+    }
+
+    return summary;
+}
+
+double FrameStats::FramesPerSecond(double time, double seconds)const
+{
+    std::uint32_t frames = 0;
+    double totalMs = 0.0;
+    for(std::uint32_t i = mSize; i-- > 0; )
+    {
+        const Record& record = GetRecord(i);
+        if(record.Time < time - seconds)
+            break;
+
+        ++frames;
+        totalMs += record.Ms[TimingFrame];
+    }
+
+    return totalMs > 0.0 ? frames * 1000.0 / totalMs : 0.0;
+}
+
+std::uint32_t FrameStats::FlaggedCount(std::uint32_t flags)const
+{
+    std::uint32_t count = 0;
+    for(std::uint32_t i = 0; i < mSize; ++i)
+    {
+        if(GetRecord(i).Flags & flags)
+            ++count;
+    }
+
+    return count;
+}
+
+void FrameStats::WriteCsv(std::ostream& out)const
+{
+    out << "Index,Time";
+    for(int t = 0; t < TimingCount; ++t)
+        out << ',' << TimingName((Timing)t) << "Ms";
+    out << ",OverBudget,Spike\n";
+
+    for(std::uint32_t i = 0; i < mSize; ++i)
+    {
+        const Record& record = GetRecord(i);
+        out << record.Index << ',' << record.Time;
+        for(int t = 0; t < TimingCount; ++t)
+            out << ',' << record.Ms[t];
+        out << ',' << ((record.Flags & FrameOverBudget) ? 1 : 0)
+            << ',' << ((record.Flags & FrameSpike) ? 1 : 0) << '\n';
+    }
+}
+
+void FrameStats::WriteJson(std::ostream& out)const
+{
+    out << "{\n";
+    out << "  \"budgetMs\": " << mBudgetMs << ",\n";
+    out << "  \"frameCount\": " << mFrameCount << ",\n";
+    out << "  \"overBudgetCount\": " << mOverBudgetCount << ",\n";
+    out << "  \"spikeCount\": " << mSpikeCount << ",\n";
+
+    out << "  \"summary\": {\n";
+    for(int t = 0; t < TimingCount; ++t)
+    {
+        Summary summary = Summarize((Timing)t);
+        out << "    \"" << JsonTimingNames[t] << "\": { "
+            << "\"count\": " << summary.Count
+            << ", \"mean\": " << summary.Mean
+            << ", \"p50\": " << summary.P50
+            << ", \"p95\": " << summary.P95
+            << ", \"p99\": " << summary.P99
+            << ", \"min\": " << summary.Min
+            << ", \"max\": " << summary.Max
+            << (t + 1 < TimingCount ? " },\n" : " }\n");
+    }
+    out << "  },\n";
+
+    out << "  \"frames\": [\n";
+    for(std::uint32_t i = 0; i < mSize; ++i)
+    {
+        const Record& record = GetRecord(i);
+        out << "    { \"index\": " << record.Index << ", \"time\": " << record.Time;
+        for(int t = 0; t < TimingCount; ++t)
+            out << ", \"" << JsonTimingNames[t] << "Ms\": " << record.Ms[t];
+        out << ", \"overBudget\": " << ((record.Flags & FrameOverBudget) ? "true" : "false")
+            << ", \"spike\": " << ((record.Flags & FrameSpike) ? "true" : "false")
+            << (i + 1 < mSize ? " },\n" : " }\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+const char* FrameStats::TimingName(Timing timing)
+{
+    switch(timing)
+    {
+    case TimingFrame: return "Frame";
+    case TimingUpdate: return "Update";
+    case TimingDraw: return "Draw";
+    case TimingFenceWait: return "FenceWait";
+    default: return "Unknown";
+    }
+}
@@ -0,0 +1,120 @@
+//***************************************************************************************
+// FrameStats.h
+//
+// Per-frame CPU timings kept in a ring buffer of the most recent frames:
+//
+//   Frame      The interval between consecutive frames, from GameTimer.
+//   Update     D3DApp::Update, including any wait on the fence.
+//   Draw       D3DApp::Draw.
+//   FenceWait  Time blocked waiting for the GPU to release a frame resource.
+//
+// Each timing also feeds a QuantileSketch that follows the same window, so rolling
+// p50/p95/p99 come from the sketch instead of sorting the ring.  A frame whose
+// interval is over the budget, or more than spikeFactor times the rolling median,
+// is flagged.  The window can be written out as CSV or JSON.
+//***************************************************************************************
+
+#pragma once
+
+#include "QuantileSketch.h"
+
+#include <ostream>
+
+class FrameStats
+{
+public:
+    enum Timing
+    {
+        TimingFrame,
+        TimingUpdate,
+        TimingDraw,
+        TimingFenceWait,
+        TimingCount
+    };
+
+    enum FrameFlags : std::uint32_t
+    {
+        FrameOverBudget = 0x1,
+        FrameSpike = 0x2,
+    };
+
+    struct Record
+    {
+        std::uint64_t Index = 0;
+        double Time = 0.0;                 // Seconds, from GameTimer::TotalTime.
+        double Ms[TimingCount] = {};
+        std::uint32_t Flags = 0;
+    };
+
+    struct Summary
+    {
+        std::uint32_t Count = 0;
+        double Mean = 0.0;
+        double P50 = 0.0;
+        double P95 = 0.0;
+        double P99 = 0.0;
+        double Min = 0.0;
+        double Max = 0.0;
+    };
+
+    explicit FrameStats(std::uint32_t capacity = 1024, double budgetMs = 1000.0 / 60.0, double spikeFactor = 2.0);
+    FrameStats(const FrameStats& rhs) = delete;
+    FrameStats& operator=(const FrameStats& rhs) = delete;
+
+    void SetBudget(double budgetMs) { mBudgetMs = budgetMs; }
+    double Budget()const { return mBudgetMs; }
+
+    // Timings are added between BeginFrame and EndFrame; a timing added more than
+    // once in a frame is summed.
+    void BeginFrame(double time, double frameMs);
+    void AddTime(Timing timing, double ms);
+    void EndFrame();
+
+    void Clear();
+
+    // Frames in the window, oldest first.
+    std::uint32_t Size()const { return mSize; }
+    const Record& GetRecord(std::uint32_t i)const;
+
+    // Rolling statistics over the window.  Min and Max are exact; the percentiles
+    // are within the sketch's relative accuracy and never outside [Min, Max].
+    Summary Summarize(Timing timing)const;
+
+    // Frames per second over the frames in the window that began in the last
+    // seconds before time, rather than over the whole window.  0 if there are none.
+    double FramesPerSecond(double time, double seconds = 1.0)const;
+    std::uint32_t FlaggedCount(std::uint32_t flags)const;
+
+    // Totals since the last Clear.
+    std::uint64_t FrameCount()const { return mFrameCount; }
+    std::uint64_t OverBudgetCount()const { return mOverBudgetCount; }
+    std::uint64_t SpikeCount()const { return mSpikeCount; }
+
+    // One row per frame in the window.
+    void WriteCsv(std::ostream& out)const;
+
+    // The budget, the rolling summary of each timing and every frame in the window.
+    void WriteJson(std::ostream& out)const;
+
+    static const char* TimingName(Timing timing);
+
+private:
+    // Frames needed in the window before spikes are detected.
+    static const std::uint32_t SpikeMinFrames = 16;
+
+    std::vector<Record> mRecords;
+    std::uint32_t mHead = 0;   // Slot of the oldest record.
+    std::uint32_t mSize = 0;
+
+    QuantileSketch mSketches[TimingCount];
+
+    double mBudgetMs = 0.0;
+    double mSpikeFactor = 0.0;
+
+    Record mCurrent;
+    bool mFrameOpen = false;
+
+    std::uint64_t mFrameCount = 0;
+    std::uint64_t mOverBudgetCount = 0;
+    std::uint64_t mSpikeCount = 0;
+};
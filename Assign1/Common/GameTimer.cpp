@@ -2,16 +2,19 @@
 // GameTimer.cpp by Frank Luna (C) 2011 All Rights Reserved.
 //***************************************************************************************
 
-#include <windows.h>
 #include "GameTimer.h"
 
-GameTimer::GameTimer()
-: mSecondsPerCount(0.0), mDeltaTime(-1.0), mBaseTime(0), 
-  mPausedTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
+GameTimer::GameTimer(ClockSource* clock)
+: mClock(clock), mSecondsPerCount(0.0), mDeltaTime(-1.0), mTickOverhead(0.0),
+  mBaseTime(0), mPausedTime(0), mStopTime(0), mPrevTime(0), mCurrTime(0), mStopped(false)
 {
-	__int64 countsPerSec;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&countsPerSec);
-	mSecondsPerCount = 1.0 / (double)countsPerSec;
+	if( mClock == nullptr )
+	{
+		mOwnedClock = CreateDefaultClock();
+		mClock = mOwnedClock.get();
+	}
+
+	mSecondsPerCount = mClock->SecondsPerCount();
 }
 
 // Returns the total time elapsed since Reset() was called, NOT counting any
@@ -55,19 +58,21 @@ float GameTimer::DeltaTime()const
 
 void GameTimer::Reset()
 {
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+	CalibrateOverhead();
+
+	std::int64_t currTime = mClock->Now();
 
 	mBaseTime = currTime;
 	mPrevTime = currTime;
+	mCurrTime = currTime;
+	mPausedTime = 0;
 	mStopTime = 0;
 	mStopped  = false;
 }
 
 void GameTimer::Start()
 {
-	__int64 startTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&startTime);
+	std::int64_t startTime = mClock->Now();
 
 
 	// Accumulate the time elapsed between stop and start pairs.
@@ -90,8 +95,7 @@ void GameTimer::Stop()
 {
 	if( !mStopped )
 	{
-		__int64 currTime;
-		QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
+		std::int64_t currTime = mClock->Now();
 
 		mStopTime = currTime;
 		mStopped  = true;
@@ -106,9 +110,7 @@ void GameTimer::Tick()
 		return;
 	}
 
-	__int64 currTime;
-	QueryPerformanceCounter((LARGE_INTEGER*)&currTime);
-	mCurrTime = currTime;
+	mCurrTime = mClock->Now();
 
 	// Time difference between this frame and the previous.
 	mDeltaTime = (mCurrTime - mPrevTime)*mSecondsPerCount;
@@ -125,3 +127,7 @@ void GameTimer::Tick()
 	}
 }
 
+void GameTimer::CalibrateOverhead(int sampleCount)
+{
+	mTickOverhead = mClock->MeasureOverhead(sampleCount);
+}
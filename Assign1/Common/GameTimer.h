@@ -5,10 +5,16 @@
 #ifndef GAMETIMER_H
 #define GAMETIMER_H
 
+#include "ClockSource.h"
+
 class GameTimer
 {
 public:
-	GameTimer();
+	// The timer reads clock, which must outlive it.  With no clock it owns one
+	// from CreateDefaultClock().
+	explicit GameTimer(ClockSource* clock = nullptr);
+	GameTimer(const GameTimer& rhs) = delete;
+	GameTimer& operator=(const GameTimer& rhs) = delete;
 
 	float TotalTime()const; // in seconds
 	float DeltaTime()const; // in seconds
@@ -18,15 +24,26 @@ public:
 	void Stop();  // Call when paused.
 	void Tick();  // Call every frame.
 
+	// Measures how long the clock read in Tick() takes.  Reset() calibrates once;
+	// call again after changing power or affinity settings.
+	void CalibrateOverhead(int sampleCount = 1001);
+	double TickOverhead()const { return mTickOverhead; } // in seconds
+
+	ClockSource& GetClock()const { return *mClock; }
+
 private:
+	std::unique_ptr<ClockSource> mOwnedClock;
+	ClockSource* mClock;
+
 	double mSecondsPerCount;
 	double mDeltaTime;
+	double mTickOverhead;
 
-	__int64 mBaseTime;
-	__int64 mPausedTime;
-	__int64 mStopTime;
-	__int64 mPrevTime;
-	__int64 mCurrTime;
+	std::int64_t mBaseTime;
+	std::int64_t mPausedTime;
+	std::int64_t mStopTime;
+	std::int64_t mPrevTime;
+	std::int64_t mCurrTime;
 
 	bool mStopped;
 };
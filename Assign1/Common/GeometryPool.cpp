@@ -0,0 +1,150 @@
+#include "GeometryPool.h"
+#include "UploadBatcher.h"
+#include "HeapManager.h"
+
+using Microsoft::WRL::ComPtr;
+
+GeometryPool::GeometryPool(ID3D12Device* device, UploadBatcher* batcher, HeapManager* heaps,
+    UINT64 vertexCapacityBytes, UINT indexCapacity) :
+    md3dDevice(device),
+    mBatcher(batcher),
+    mHeaps(heaps),
+    mVertexCapacity(vertexCapacityBytes)
+{
+    CreateBuffer(mIndexBuffer, (UINT64)indexCapacity*sizeof(std::uint32_t));
+}
+
+GeometryPool::~GeometryPool()
+{
+    if(mHeaps == nullptr)
+        return;
+
+    // The owner has made sure the GPU is done with the pool before destroying it.
+    for(auto& vb : mVertexBuffers)
+        mHeaps->FreeBuffer(vb.second.Resource.Get());
+    mHeaps->FreeBuffer(mIndexBuffer.Resource.Get());
+}
+
+SubmeshGeometry GeometryPool::AddMesh(
+    const void* vertices, UINT vertexCount, UINT vertexByteStride,
+    const std::uint32_t* indices, UINT indexCount)
+{
+    PooledBuffer& vb = GetVertexBuffer(vertexByteStride);
+
+    UINT64 vbByteSize = (UINT64)vertexCount*vertexByteStride;
+    UINT64 ibByteSize = (UINT64)indexCount*sizeof(std::uint32_t);
+
+    // The pool is sized up front; running out means the capacity passed to the
+    // constructor is too small for the scene.
+    if(vb.Used + vbByteSize > vb.Capacity || mIndexBuffer.Used + ibByteSize > mIndexBuffer.Capacity)
+        ThrowIfFailed(E_OUTOFMEMORY);
+
+    SubmeshGeometry submesh;
+    submesh.IndexCount = indexCount;
+    submesh.StartIndexLocation = mIndexCount;
+    submesh.BaseVertexLocation = (INT)(vb.Used / vertexByteStride);
+
+    // Every vertex format starts with an XMFLOAT3 position.
+    DirectX::BoundingBox::CreateFromPoints(submesh.Bounds, vertexCount,
+        reinterpret_cast<const DirectX::XMFLOAT3*>(vertices), vertexByteStride);
+
+    Upload(vb, vb.Used, vertices, vbByteSize);
+    Upload(mIndexBuffer, mIndexBuffer.Used, indices, ibByteSize);
+
+    vb.Used += vbByteSize;
+    mIndexBuffer.Used += ibByteSize;
+    mIndexCount += indexCount;
+
+    return submesh;
+}
+
+void GeometryPool::BindMeshGeometry(MeshGeometry* geo, UINT vertexByteStride)
+{
+    PooledBuffer& vb = GetVertexBuffer(vertexByteStride);
+
+    geo->VertexBufferCPU = vb.CpuCopy;
+    geo->IndexBufferCPU = mIndexBuffer.CpuCopy;
+    geo->VertexBufferGPU = vb.Resource;
+    geo->IndexBufferGPU = mIndexBuffer.Resource;
+    geo->VertexByteStride = vertexByteStride;
+    geo->VertexBufferByteSize = (UINT)vb.Capacity;
+    geo->IndexFormat = DXGI_FORMAT_R32_UINT;
+    geo->IndexBufferByteSize = (UINT)mIndexBuffer.Capacity;
+}
+
+D3D12_VERTEX_BUFFER_VIEW GeometryPool::VertexBufferView(UINT vertexByteStride)const
+{
+    const PooledBuffer& vb = mVertexBuffers.at(vertexByteStride);
+
+    D3D12_VERTEX_BUFFER_VIEW vbv;
+    vbv.BufferLocation = vb.Resource->GetGPUVirtualAddress();
+    vbv.StrideInBytes = vertexByteStride;
+    vbv.SizeInBytes = (UINT)vb.Capacity;
+
+    return vbv;
+}
+
+D3D12_INDEX_BUFFER_VIEW GeometryPool::IndexBufferView()const
+{
+    D3D12_INDEX_BUFFER_VIEW ibv;
+    ibv.BufferLocation = mIndexBuffer.Resource->GetGPUVirtualAddress();
+    ibv.Format = DXGI_FORMAT_R32_UINT;
+    ibv.SizeInBytes = (UINT)mIndexBuffer.Capacity;
+
+    return ibv;
+}
+
+UINT64 GeometryPool::VertexBytesUsed(UINT vertexByteStride)const
+{
+    auto it = mVertexBuffers.find(vertexByteStride);
+    return it == mVertexBuffers.end() ? 0 : it->second.Used;
+}
+
+GeometryPool::PooledBuffer& GeometryPool::GetVertexBuffer(UINT vertexByteStride)
+{
+    PooledBuffer& vb = mVertexBuffers[vertexByteStride];
+    if(vb.Resource == nullptr)
+    {
+        // Round down so the buffer holds a whole number of vertices.
+        CreateBuffer(vb, mVertexCapacity - mVertexCapacity % vertexByteStride);
+    }
+
+    return vb;
+}
+
+void GeometryPool::CreateBuffer(PooledBuffer& buffer, UINT64 byteSize)
+{
+    if(mHeaps != nullptr)
+    {
+        buffer.Resource = mHeaps->CreateBuffer(byteSize, D3D12_RESOURCE_STATE_COMMON);
+    }
+    else
+    {
+        ThrowIfFailed(md3dDevice->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+            D3D12_RESOURCE_STATE_COMMON,
+            nullptr,
+            IID_PPV_ARGS(buffer.Resource.GetAddressOf())));
+    }
+
+    ThrowIfFailed(D3DCreateBlob((SIZE_T)byteSize, buffer.CpuCopy.GetAddressOf()));
+
+    buffer.State = D3D12_RESOURCE_STATE_COMMON;
+    buffer.Capacity = byteSize;
+    buffer.Used = 0;
+}
+
+void GeometryPool::Upload(PooledBuffer& buffer, UINT64 offset, const void* data, UINT64 byteSize)
+{
+    if(byteSize == 0)
+        return;
+
+    BYTE* cpuData = reinterpret_cast<BYTE*>(buffer.CpuCopy->GetBufferPointer());
+    memcpy(cpuData + offset, data, (size_t)byteSize);
+
+    mBatcher->QueueBufferUpload(buffer.Resource.Get(), offset, data, byteSize,
+        buffer.State, D3D12_RESOURCE_STATE_GENERIC_READ);
+    buffer.State = D3D12_RESOURCE_STATE_GENERIC_READ;
+}
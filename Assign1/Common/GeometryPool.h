@@ -0,0 +1,84 @@
+//***************************************************************************************
+// GeometryPool.h
+//
+// Unified geometry storage: one large vertex buffer per vertex format and one shared
+// 32-bit index buffer.  Meshes are sub-allocated into them, and the SubmeshGeometry
+// returned for a mesh is its offset into the pool, so every mesh of a vertex format
+// can be drawn with the same IA bindings.  A system memory copy of each buffer is
+// kept alongside, laid out exactly like the GPU buffer.
+//
+// When a HeapManager is given, the pool buffers are placed in its heaps and returned
+// to it when the pool is destroyed.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class UploadBatcher;
+class HeapManager;
+
+class GeometryPool
+{
+public:
+    static const UINT64 DefaultVertexCapacity = 8 * 1024 * 1024;  // bytes per vertex format
+    static const UINT DefaultIndexCapacity = 1024 * 1024;         // indices
+
+    GeometryPool(ID3D12Device* device, UploadBatcher* batcher, HeapManager* heaps = nullptr,
+        UINT64 vertexCapacityBytes = DefaultVertexCapacity,
+        UINT indexCapacity = DefaultIndexCapacity);
+    GeometryPool(const GeometryPool& rhs) = delete;
+    GeometryPool& operator=(const GeometryPool& rhs) = delete;
+    ~GeometryPool();
+
+    // Sub-allocates the mesh and queues its upload on the batcher.  Vertex formats
+    // are identified by their stride.  Indices are relative to the mesh's first
+    // vertex; the returned BaseVertexLocation/StartIndexLocation locate it in the pool.
+    // The vertex format must begin with an XMFLOAT3 position, which the returned
+    // Bounds are computed from.
+    SubmeshGeometry AddMesh(
+        const void* vertices, UINT vertexCount, UINT vertexByteStride,
+        const std::uint32_t* indices, UINT indexCount);
+
+    template<typename VertexT>
+    SubmeshGeometry AddMesh(const std::vector<VertexT>& vertices, const std::vector<std::uint32_t>& indices)
+    {
+        return AddMesh(vertices.data(), (UINT)vertices.size(), sizeof(VertexT),
+            indices.data(), (UINT)indices.size());
+    }
+
+    // Points geo's CPU/GPU buffers and buffer views at the pool buffers for the
+    // given vertex format.  Submeshes are left to the caller.
+    void BindMeshGeometry(MeshGeometry* geo, UINT vertexByteStride);
+
+    D3D12_VERTEX_BUFFER_VIEW VertexBufferView(UINT vertexByteStride)const;
+    D3D12_INDEX_BUFFER_VIEW IndexBufferView()const;
+
+    UINT64 VertexBytesUsed(UINT vertexByteStride)const;
+    UINT IndexCount()const { return mIndexCount; }
+
+private:
+    struct PooledBuffer
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
+        Microsoft::WRL::ComPtr<ID3DBlob> CpuCopy = nullptr;
+        D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+        UINT64 Capacity = 0;
+        UINT64 Used = 0;
+    };
+
+    PooledBuffer& GetVertexBuffer(UINT vertexByteStride);
+    void CreateBuffer(PooledBuffer& buffer, UINT64 byteSize);
+    void Upload(PooledBuffer& buffer, UINT64 offset, const void* data, UINT64 byteSize);
+
+private:
+    ID3D12Device* md3dDevice = nullptr;
+    UploadBatcher* mBatcher = nullptr;
+    HeapManager* mHeaps = nullptr;
+
+    UINT64 mVertexCapacity = DefaultVertexCapacity;
+
+    std::unordered_map<UINT, PooledBuffer> mVertexBuffers;
+    PooledBuffer mIndexBuffer;
+    UINT mIndexCount = 0;
+};
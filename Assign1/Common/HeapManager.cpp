@@ -0,0 +1,160 @@
+#include "HeapManager.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(_WIN32)
+#include "d3dUtil.h"
+
+using Microsoft::WRL::ComPtr;
+#endif
+
+// Placed buffers must start on a 64KB boundary, so that is the smallest block.
+static const UINT64 MinBlockSize = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+static UINT64 NextPow2(UINT64 x)
+{
+    UINT64 p = 1;
+    while(p < x)
+        p <<= 1;
+
+    return p;
+}
+
+HeapManager::HeapManager(ID3D12Device* device, D3D12_HEAP_TYPE heapType, UINT64 heapSize) :
+    md3dDevice(device),
+    mHeapType(heapType),
+    mHeapSize(NextPow2(std::max<UINT64>(heapSize, MinBlockSize)))
+{
+}
+
+HeapManager::Allocation HeapManager::Allocate(UINT64 byteSize)
+{
+    Allocation alloc;
+
+    for(UINT i = 0; i < (UINT)mHeaps.size(); ++i)
+    {
+        UINT64 offset = mHeaps[i].Allocator->Allocate(byteSize);
+        if(offset != BuddyAllocator::InvalidOffset)
+        {
+            alloc.HeapIndex = i;
+            alloc.Offset = offset;
+            alloc.Size = mHeaps[i].Allocator->BlockSize(byteSize);
+            return alloc;
+        }
+    }
+
+    // No room anywhere; reserve another heap.  Oversized requests get a heap of their own.
+    CreateHeap(std::max<UINT64>(mHeapSize, NextPow2(byteSize)));
+
+    alloc.HeapIndex = (UINT)mHeaps.size() - 1;
+    alloc.Offset = mHeaps.back().Allocator->Allocate(byteSize);
+    alloc.Size = mHeaps.back().Allocator->BlockSize(byteSize);
+    assert(alloc.Offset != BuddyAllocator::InvalidOffset);
+
+    return alloc;
+}
+
+void HeapManager::Free(const Allocation& allocation)
+{
+    assert(allocation.HeapIndex < mHeaps.size());
+    mHeaps[allocation.HeapIndex].Allocator->Free(allocation.Offset);
+}
+
+#if defined(_WIN32)
+ComPtr<ID3D12Resource> HeapManager::CreateBuffer(
+    UINT64 byteSize,
+    D3D12_RESOURCE_STATES initialState,
+    D3D12_RESOURCE_FLAGS flags)
+{
+    assert(!IsCpuOnly());
+
+    Allocation alloc = Allocate(byteSize);
+
+    ComPtr<ID3D12Resource> buffer;
+    HRESULT hr = md3dDevice->CreatePlacedResource(
+        mHeaps[alloc.HeapIndex].Resource.Get(),
+        alloc.Offset,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize, flags),
+        initialState,
+        nullptr,
+        IID_PPV_ARGS(buffer.GetAddressOf()));
+    if(FAILED(hr))
+    {
+        Free(alloc);
+        ThrowIfFailed(hr);
+    }
+
+    // A live entry for the same pointer means a buffer was released without
+    // FreeBuffer and its address reused.
+    assert(mPlacedBuffers.find(buffer.Get()) == mPlacedBuffers.end());
+    mPlacedBuffers[buffer.Get()] = alloc;
+
+    return buffer;
+}
+
+void HeapManager::FreeBuffer(ID3D12Resource* resource)
+{
+    auto it = mPlacedBuffers.find(resource);
+    assert(it != mPlacedBuffers.end());
+    if(it == mPlacedBuffers.end())
+        return;
+
+    Free(it->second);
+    mPlacedBuffers.erase(it);
+}
+#endif
+
+HeapManager::Stats HeapManager::GetStats()const
+{
+    Stats stats;
+    stats.HeapCount = (UINT)mHeaps.size();
+
+    for(auto& heap : mHeaps)
+    {
+        BuddyAllocator::Stats heapStats = heap.Allocator->GetStats();
+        stats.ReservedBytes += heapStats.TotalBytes;
+        stats.AllocatedBytes += heapStats.AllocatedBytes;
+        stats.RequestedBytes += heapStats.RequestedBytes;
+        stats.LargestFreeBlock = std::max<UINT64>(stats.LargestFreeBlock, heapStats.LargestFreeBlock);
+        stats.AllocationCount += heapStats.AllocationCount;
+        stats.FreeBlockCount += heapStats.FreeBlockCount;
+    }
+
+    return stats;
+}
+
+bool HeapManager::Validate()const
+{
+    for(auto& heap : mHeaps)
+    {
+        if(!heap.Allocator->Validate())
+            return false;
+    }
+
+    return true;
+}
+
+void HeapManager::CreateHeap(UINT64 byteSize)
+{
+    Heap heap;
+
+#if defined(_WIN32)
+    if(!IsCpuOnly())
+    {
+        // Buffers only, so the heap is usable on resource heap tier 1 hardware.
+        D3D12_HEAP_DESC heapDesc = {};
+        heapDesc.SizeInBytes = byteSize;
+        heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(mHeapType);
+        heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+
+        ThrowIfFailed(md3dDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(heap.Resource.GetAddressOf())));
+    }
+#else
+    assert(IsCpuOnly());
+#endif
+
+    heap.Allocator = std::make_unique<BuddyAllocator>(byteSize, MinBlockSize);
+    mHeaps.push_back(std::move(heap));
+}
@@ -0,0 +1,122 @@
+//***************************************************************************************
+// HeapManager.h
+//
+// Reserves large ID3D12Heaps and sub-allocates buffers from them as placed resources,
+// instead of creating one committed resource (and one implicit heap) per buffer.
+// Each heap is managed by a BuddyAllocator.
+//
+// The manager does not own the buffers it places.  It only remembers which range
+// each one occupies, so a buffer's range is returned by FreeBuffer, not by releasing
+// the last reference to it; the stats therefore track what is live, and fragment as
+// buffers of different sizes come and go.
+//
+// Constructed with a null device the manager runs in a pure CPU mode: no heaps or
+// resources are created, but Allocate/Free/GetStats/Validate behave exactly the same,
+// so allocation patterns can be exercised and inspected without a GPU.  Only the
+// placed buffer calls need d3d12.h, so elsewhere the manager builds in that mode
+// alone over D3D12Types.h (see Tests/).
+//***************************************************************************************
+
+#pragma once
+
+#include "D3D12Types.h"
+#include "BuddyAllocator.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#include <wrl.h>
+#endif
+
+class HeapManager
+{
+public:
+    static const UINT64 DefaultHeapSize = 64 * 1024 * 1024;
+
+    struct Allocation
+    {
+        UINT HeapIndex = 0;
+        UINT64 Offset = 0;
+        UINT64 Size = 0;   // Block size reserved in the heap.
+    };
+
+    struct Stats
+    {
+        UINT HeapCount = 0;
+        UINT64 ReservedBytes = 0;     // Sum of all heap sizes.
+        UINT64 AllocatedBytes = 0;    // Bytes in blocks handed out.
+        UINT64 RequestedBytes = 0;    // Bytes actually asked for.
+        UINT64 LargestFreeBlock = 0;
+        UINT AllocationCount = 0;
+        UINT FreeBlockCount = 0;
+
+        float InternalFragmentation()const
+        {
+            return AllocatedBytes == 0 ? 0.0f : 1.0f - (float)RequestedBytes / (float)AllocatedBytes;
+        }
+
+        float ExternalFragmentation()const
+        {
+            UINT64 freeBytes = ReservedBytes - AllocatedBytes;
+            return freeBytes == 0 ? 0.0f : 1.0f - (float)LargestFreeBlock / (float)freeBytes;
+        }
+    };
+
+    // device may be null for the CPU-only mode described above.
+    HeapManager(ID3D12Device* device,
+        D3D12_HEAP_TYPE heapType = D3D12_HEAP_TYPE_DEFAULT,
+        UINT64 heapSize = DefaultHeapSize);
+    HeapManager(const HeapManager& rhs) = delete;
+    HeapManager& operator=(const HeapManager& rhs) = delete;
+
+    // Reserves a byteSize range; reserves a new heap when none has room.
+    Allocation Allocate(UINT64 byteSize);
+    void Free(const Allocation& allocation);
+
+#if defined(_WIN32)
+    // Creates a buffer placed in one of the heaps.  Requires a device.  The caller
+    // holds the only reference and must pass the buffer to FreeBuffer before
+    // releasing it, or its range stays reserved until the manager is destroyed.
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(
+        UINT64 byteSize,
+        D3D12_RESOURCE_STATES initialState,
+        D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+
+    // Returns the range of a buffer created by CreateBuffer to its heap.  The
+    // caller must make sure the GPU no longer uses the resource, and must not use
+    // it afterwards: other buffers may be placed over the same memory.
+    void FreeBuffer(ID3D12Resource* resource);
+
+    UINT PlacedBufferCount()const { return (UINT)mPlacedBuffers.size(); }
+#endif
+
+    bool IsCpuOnly()const { return md3dDevice == nullptr; }
+
+    Stats GetStats()const;
+    bool Validate()const;
+
+private:
+    struct Heap
+    {
+#if defined(_WIN32)
+        Microsoft::WRL::ComPtr<ID3D12Heap> Resource = nullptr;
+#endif
+        std::unique_ptr<BuddyAllocator> Allocator = nullptr;
+    };
+
+    void CreateHeap(UINT64 byteSize);
+
+private:
+    ID3D12Device* md3dDevice = nullptr;
+    D3D12_HEAP_TYPE mHeapType = D3D12_HEAP_TYPE_DEFAULT;
+    UINT64 mHeapSize = DefaultHeapSize;
+
+    std::vector<Heap> mHeaps;
+#if defined(_WIN32)
+    // Ranges of the buffers CreateBuffer placed, keyed by the (non-owning) resource
+    // pointer.  An entry lives from CreateBuffer to FreeBuffer.
+    std::unordered_map<ID3D12Resource*, Allocation> mPlacedBuffers;
+#endif
+};
@@ -0,0 +1,128 @@
+#include "IndirectDraw.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#include "d3dUtil.h"
+
+using Microsoft::WRL::ComPtr;
+#endif
+
+IndirectDrawBuilder::IndirectDrawBuilder(UINT rootParameterIndex, UINT rootConstantCount) :
+    mRootConstantCount(rootConstantCount),
+    mByteStride(rootConstantCount*sizeof(UINT) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS))
+{
+    mArgumentDescs[0] = {};
+    mArgumentDescs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+    mArgumentDescs[0].Constant.RootParameterIndex = rootParameterIndex;
+    mArgumentDescs[0].Constant.DestOffsetIn32BitValues = 0;
+    mArgumentDescs[0].Constant.Num32BitValuesToSet = rootConstantCount;
+
+    mArgumentDescs[1] = {};
+    mArgumentDescs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+    // Without constants the signature is just the draw.
+    mSignatureDesc.ByteStride = mByteStride;
+    mSignatureDesc.NumArgumentDescs = rootConstantCount > 0 ? 2 : 1;
+    mSignatureDesc.pArgumentDescs = rootConstantCount > 0 ? &mArgumentDescs[0] : &mArgumentDescs[1];
+    mSignatureDesc.NodeMask = 0;
+}
+
+void IndirectDrawBuilder::AddDraw(const UINT* rootConstants, const D3D12_DRAW_INDEXED_ARGUMENTS& args)
+{
+    mArguments.insert(mArguments.end(), rootConstants, rootConstants + mRootConstantCount);
+
+    const UINT* argWords = reinterpret_cast<const UINT*>(&args);
+    mArguments.insert(mArguments.end(), argWords, argWords + sizeof(args) / sizeof(UINT));
+}
+
+#if defined(_WIN32)
+ComPtr<ID3D12CommandSignature> IndirectDrawBuilder::CreateCommandSignature(
+    ID3D12Device* device, ID3D12RootSignature* rootSignature)const
+{
+    // A root signature is only needed when the arguments change root arguments.
+    ComPtr<ID3D12CommandSignature> signature;
+    ThrowIfFailed(device->CreateCommandSignature(&mSignatureDesc,
+        mRootConstantCount > 0 ? rootSignature : nullptr, IID_PPV_ARGS(&signature)));
+    return signature;
+}
+#endif
+
+void IndirectEmulator::Execute(const D3D12_COMMAND_SIGNATURE_DESC& signature, UINT maxCommandCount,
+    const void* arguments, UINT64 argumentBytes, const UINT* countBuffer, UINT indexCount,
+    const DrawFunc& draw)
+{
+    mStats = Stats();
+
+    UINT commandCount = maxCommandCount;
+    if(countBuffer != nullptr)
+        commandCount = std::min<UINT>(commandCount, *countBuffer);
+
+    if((UINT64)commandCount*signature.ByteStride > argumentBytes)
+        throw std::invalid_argument("IndirectEmulator: argument buffer too small for the commands");
+
+    const BYTE* command = reinterpret_cast<const BYTE*>(arguments);
+    for(UINT i = 0; i < commandCount; ++i, command += signature.ByteStride)
+    {
+        mStats.Commands++;
+
+        // Arguments are packed in the order of the descs.  The stride may be larger
+        // than the packed arguments, never smaller, and that is checked before each
+        // argument is read so a bad signature cannot read past the command.
+        const BYTE* arg = command;
+        const BYTE* commandEnd = command + signature.ByteStride;
+        for(UINT a = 0; a < signature.NumArgumentDescs; ++a)
+        {
+            const D3D12_INDIRECT_ARGUMENT_DESC& desc = signature.pArgumentDescs[a];
+            if(desc.Type == D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT)
+            {
+                const size_t size = (size_t)desc.Constant.Num32BitValuesToSet*sizeof(UINT);
+                if(size > (size_t)(commandEnd - arg))
+                    throw std::invalid_argument("IndirectEmulator: stride too small for the arguments");
+
+                if(desc.Constant.RootParameterIndex >= mRootConstants.size())
+                    mRootConstants.resize(desc.Constant.RootParameterIndex + 1);
+
+                std::vector<UINT>& constants = mRootConstants[desc.Constant.RootParameterIndex];
+                const UINT end = desc.Constant.DestOffsetIn32BitValues + desc.Constant.Num32BitValuesToSet;
+                if(end > constants.size())
+                    constants.resize(end, 0);
+
+                memcpy(&constants[desc.Constant.DestOffsetIn32BitValues], arg, size);
+                arg += size;
+            }
+            else if(desc.Type == D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED)
+            {
+                D3D12_DRAW_INDEXED_ARGUMENTS args;
+                if(sizeof(args) > (size_t)(commandEnd - arg))
+                    throw std::invalid_argument("IndirectEmulator: stride too small for the arguments");
+
+                memcpy(&args, arg, sizeof(args));
+                arg += sizeof(args);
+
+                if((UINT64)args.StartIndexLocation + args.IndexCountPerInstance > indexCount)
+                {
+                    mStats.OutOfRange++;
+                    continue;
+                }
+
+                mStats.Draws++;
+                mStats.Indices += (UINT64)args.IndexCountPerInstance*args.InstanceCount;
+                draw(*this, args);
+            }
+            else
+            {
+                throw std::invalid_argument("IndirectEmulator: unsupported argument type");
+            }
+        }
+    }
+}
+
+UINT IndirectEmulator::GetRootConstant(UINT rootParameterIndex, UINT offset)const
+{
+    if(rootParameterIndex >= mRootConstants.size() || offset >= mRootConstants[rootParameterIndex].size())
+        return 0;
+    return mRootConstants[rootParameterIndex][offset];
+}
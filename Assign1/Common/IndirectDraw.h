@@ -0,0 +1,100 @@
+//***************************************************************************************
+// IndirectDraw.h
+//
+// Argument buffers for ExecuteIndirect.  IndirectDrawBuilder packs indexed draws, each
+// preceded by a few root constants, in the layout of the command signature it
+// describes, so a whole pass can be issued with one ExecuteIndirect.
+//
+// IndirectEmulator walks an argument buffer the way the GPU's command processor does
+// for a given command signature and reports each draw with the root constants in
+// effect, so argument generation can be checked without a device.  Only
+// CreateCommandSignature needs d3d12.h; the rest builds over D3D12Types.h (see Tests/).
+//***************************************************************************************
+
+#pragma once
+
+#include "D3D12Types.h"
+
+#include <functional>
+#include <vector>
+
+#if defined(_WIN32)
+#include <wrl.h>
+#endif
+
+class IndirectDrawBuilder
+{
+public:
+    // Each command sets rootConstantCount 32-bit constants of root parameter
+    // rootParameterIndex, then draws.
+    IndirectDrawBuilder(UINT rootParameterIndex, UINT rootConstantCount);
+    IndirectDrawBuilder(const IndirectDrawBuilder& rhs) = delete;
+    IndirectDrawBuilder& operator=(const IndirectDrawBuilder& rhs) = delete;
+
+    void Reset() { mArguments.clear(); }
+
+    // rootConstants holds rootConstantCount values.
+    void AddDraw(const UINT* rootConstants, const D3D12_DRAW_INDEXED_ARGUMENTS& args);
+
+    UINT CommandCount()const { return (UINT)(mArguments.size() / (mByteStride / sizeof(UINT))); }
+    UINT ByteStride()const { return mByteStride; }
+
+    const void* Data()const { return mArguments.data(); }
+    UINT64 ByteSize()const { return (UINT64)mArguments.size()*sizeof(UINT); }
+
+    // The command signature the arguments are laid out for.  The pointers in the
+    // description stay valid as long as the builder does.
+    const D3D12_COMMAND_SIGNATURE_DESC& GetSignatureDesc()const { return mSignatureDesc; }
+
+#if defined(_WIN32)
+    Microsoft::WRL::ComPtr<ID3D12CommandSignature> CreateCommandSignature(
+        ID3D12Device* device, ID3D12RootSignature* rootSignature)const;
+#endif
+
+private:
+    UINT mRootConstantCount = 0;
+    UINT mByteStride = 0;
+
+    D3D12_INDIRECT_ARGUMENT_DESC mArgumentDescs[2];
+    D3D12_COMMAND_SIGNATURE_DESC mSignatureDesc;
+
+    std::vector<UINT> mArguments;
+};
+
+class IndirectEmulator
+{
+public:
+    struct Stats
+    {
+        UINT Commands = 0;
+        UINT Draws = 0;
+        UINT64 Indices = 0;
+        UINT OutOfRange = 0;   // Draws reading past the index buffer; not reported.
+    };
+
+    typedef std::function<void(const IndirectEmulator& emulator, const D3D12_DRAW_INDEXED_ARGUMENTS& args)> DrawFunc;
+
+    IndirectEmulator() = default;
+    IndirectEmulator(const IndirectEmulator& rhs) = delete;
+    IndirectEmulator& operator=(const IndirectEmulator& rhs) = delete;
+
+    // Runs maxCommandCount commands, or the smaller *countBuffer if countBuffer is
+    // not null, from arguments (argumentBytes long).  indexCount is the size of the
+    // bound index buffer.  Only constant and indexed draw arguments are supported.
+    // Throws std::invalid_argument if the buffer is too small for the commands, the
+    // stride too small for the arguments, or an argument type is not supported.
+    void Execute(const D3D12_COMMAND_SIGNATURE_DESC& signature, UINT maxCommandCount,
+        const void* arguments, UINT64 argumentBytes, const UINT* countBuffer, UINT indexCount,
+        const DrawFunc& draw);
+
+    // A root constant as last set by the arguments.  Root constants persist between
+    // Execute calls, as they do on a command list.
+    UINT GetRootConstant(UINT rootParameterIndex, UINT offset)const;
+
+    // Statistics of the last Execute.
+    const Stats& GetStats()const { return mStats; }
+
+private:
+    std::vector<std::vector<UINT>> mRootConstants;
+    Stats mStats;
+};
@@ -0,0 +1,23 @@
+//***************************************************************************************
+// Light.h
+//
+// The Light struct the shaders read (see LightingUtil.hlsl), with the same layout.
+// Kept apart from d3dUtil.h so code that only shades on the CPU needs DirectXMath
+// and nothing else.
+//***************************************************************************************
+
+#pragma once
+
+#include <DirectXMath.h>
+
+struct Light
+{
+    DirectX::XMFLOAT3 Strength = { 0.5f, 0.5f, 0.5f };
+    float FalloffStart = 1.0f;                          // point/spot light only
+    DirectX::XMFLOAT3 Direction = { 0.0f, -1.0f, 0.0f };// directional/spot light only
+    float FalloffEnd = 10.0f;                           // point/spot light only
+    DirectX::XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };  // point/spot light only
+    float SpotPower = 64.0f;                            // spot light only
+};
+
+#define MaxLights 16
@@ -0,0 +1,318 @@
+#include "LightingReference.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+//
+// Scalar float3 helpers, named after their HLSL counterparts.
+//
+
+static XMFLOAT3 Add(const XMFLOAT3& a, const XMFLOAT3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+static XMFLOAT3 Sub(const XMFLOAT3& a, const XMFLOAT3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+static XMFLOAT3 Mul(const XMFLOAT3& a, const XMFLOAT3& b) { return { a.x*b.x, a.y*b.y, a.z*b.z }; }
+static XMFLOAT3 Mul(const XMFLOAT3& a, float s) { return { a.x*s, a.y*s, a.z*s }; }
+static float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x*b.x + a.y*b.y + a.z*b.z; }
+static float Length(const XMFLOAT3& a) { return sqrtf(Dot(a, a)); }
+static XMFLOAT3 Div(const XMFLOAT3& a, float s) { return { a.x / s, a.y / s, a.z / s }; }
+static XMFLOAT3 Normalize(const XMFLOAT3& a) { return Div(a, Length(a)); }
+static float Saturate(float x) { return std::min(std::max(x, 0.0f), 1.0f); }
+
+float LightingReference::CalcAttenuation(float d, float falloffStart, float falloffEnd)
+{
+    // Linear falloff.
+    return Saturate((falloffEnd - d) / (falloffEnd - falloffStart));
+}
+
+XMFLOAT3 LightingReference::SchlickFresnel(const XMFLOAT3& R0, const XMFLOAT3& normal, const XMFLOAT3& lightVec)
+{
+    float cosIncidentAngle = Saturate(Dot(normal, lightVec));
+
+    float f0 = 1.0f - cosIncidentAngle;
+    float f5 = f0*f0*f0*f0*f0;
+
+    return { R0.x + (1.0f - R0.x)*f5, R0.y + (1.0f - R0.y)*f5, R0.z + (1.0f - R0.z)*f5 };
+}
+
+XMFLOAT3 LightingReference::BlinnPhong(const XMFLOAT3& lightStrength, const XMFLOAT3& lightVec,
+    const XMFLOAT3& normal, const XMFLOAT3& toEye, const ShadingMaterial& mat)
+{
+    const float m = mat.Shininess*256.0f;
+    XMFLOAT3 halfVec = Normalize(Add(toEye, lightVec));
+
+    float roughnessFactor = (m + 8.0f)*powf(std::max(Dot(halfVec, normal), 0.0f), m) / 8.0f;
+    XMFLOAT3 fresnelFactor = SchlickFresnel(mat.FresnelR0, halfVec, lightVec);
+
+    XMFLOAT3 specAlbedo = Mul(fresnelFactor, roughnessFactor);
+
+    // Same LDR scale down as the shader.
+    specAlbedo = { specAlbedo.x / (specAlbedo.x + 1.0f), specAlbedo.y / (specAlbedo.y + 1.0f), specAlbedo.z / (specAlbedo.z + 1.0f) };
+
+    XMFLOAT3 diffuse = { mat.DiffuseAlbedo.x, mat.DiffuseAlbedo.y, mat.DiffuseAlbedo.z };
+    return Mul(Add(diffuse, specAlbedo), lightStrength);
+}
+
+XMFLOAT3 LightingReference::ComputeDirectionalLight(const Light& L, const ShadingMaterial& mat,
+    const XMFLOAT3& normal, const XMFLOAT3& toEye)
+{
+    // The light vector aims opposite the direction the light rays travel.
+    XMFLOAT3 lightVec = Mul(L.Direction, -1.0f);
+
+    // Scale light down by Lambert's cosine law.
+    float ndotl = std::max(Dot(lightVec, normal), 0.0f);
+    XMFLOAT3 lightStrength = Mul(L.Strength, ndotl);
+
+    return BlinnPhong(lightStrength, lightVec, normal, toEye, mat);
+}
+
+XMFLOAT3 LightingReference::ComputePointLight(const Light& L, const ShadingMaterial& mat,
+    const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT3& toEye)
+{
+    // The vector from the surface to the light.
+    XMFLOAT3 lightVec = Sub(L.Position, pos);
+
+    // The distance from surface to light.
+    float d = Length(lightVec);
+
+    // Range test.
+    if(d > L.FalloffEnd)
+        return { 0.0f, 0.0f, 0.0f };
+
+    // Normalize the light vector.
+    lightVec = Div(lightVec, d);
+
+    // Scale light down by Lambert's cosine law.
+    float ndotl = std::max(Dot(lightVec, normal), 0.0f);
+    XMFLOAT3 lightStrength = Mul(L.Strength, ndotl);
+
+    // Attenuate light by distance.
+    float att = CalcAttenuation(d, L.FalloffStart, L.FalloffEnd);
+    lightStrength = Mul(lightStrength, att);
+
+    return BlinnPhong(lightStrength, lightVec, normal, toEye, mat);
+}
+
+XMFLOAT3 LightingReference::ComputeSpotLight(const Light& L, const ShadingMaterial& mat,
+    const XMFLOAT3& pos, const XMFLOAT3& normal, const XMFLOAT3& toEye)
+{
+    // The vector from the surface to the light.
+    XMFLOAT3 lightVec = Sub(L.Position, pos);
+
+    // The distance from surface to light.
+    float d = Length(lightVec);
+
+    // Range test.
+    if(d > L.FalloffEnd)
+        return { 0.0f, 0.0f, 0.0f };
+
+    // Normalize the light vector.
+    lightVec = Div(lightVec, d);
+
+    // Scale light down by Lambert's cosine law.
+    float ndotl = std::max(Dot(lightVec, normal), 0.0f);
+    XMFLOAT3 lightStrength = Mul(L.Strength, ndotl);
+
+    // Attenuate light by distance.
+    float att = CalcAttenuation(d, L.FalloffStart, L.FalloffEnd);
+    lightStrength = Mul(lightStrength, att);
+
+    // Scale by spotlight
+    float spotFactor = powf(std::max(-Dot(lightVec, L.Direction), 0.0f), L.SpotPower);
+    lightStrength = Mul(lightStrength, spotFactor);
+
+    return BlinnPhong(lightStrength, lightVec, normal, toEye, mat);
+}
+
+XMFLOAT4 LightingReference::ComputeLighting(const Light* lights, int numDir, int numPoint, int numSpot,
+    const ShadingMaterial& mat, const XMFLOAT3& pos, const XMFLOAT3& normal,
+    const XMFLOAT3& toEye, const XMFLOAT3& shadowFactor)
+{
+    const float shadow[3] = { shadowFactor.x, shadowFactor.y, shadowFactor.z };
+
+    XMFLOAT3 result = { 0.0f, 0.0f, 0.0f };
+
+    int i = 0;
+    for(; i < numDir; ++i)
+        result = Add(result, Mul(ComputeDirectionalLight(lights[i], mat, normal, toEye), i < 3 ? shadow[i] : 1.0f));
+
+    for(; i < numDir + numPoint; ++i)
+        result = Add(result, ComputePointLight(lights[i], mat, pos, normal, toEye));
+
+    for(; i < numDir + numPoint + numSpot; ++i)
+        result = Add(result, ComputeSpotLight(lights[i], mat, pos, normal, toEye));
+
+    return { result.x, result.y, result.z, 0.0f };
+}
+
+//
+// Eight-wide versions.  A Float8 holds one value for eight samples in two vectors.
+//
+
+namespace
+{
+    struct Float8
+    {
+        XMVECTOR V[2];
+    };
+
+    inline Float8 Load8(const float* p) { return { { XMLoadFloat4((const XMFLOAT4*)p), XMLoadFloat4((const XMFLOAT4*)(p + 4)) } }; }
+    inline void Store8(float* p, const Float8& a) { XMStoreFloat4((XMFLOAT4*)p, a.V[0]); XMStoreFloat4((XMFLOAT4*)(p + 4), a.V[1]); }
+    inline Float8 Splat8(float s) { XMVECTOR v = XMVectorReplicate(s); return { { v, v } }; }
+
+    inline Float8 operator+(const Float8& a, const Float8& b) { return { { XMVectorAdd(a.V[0], b.V[0]), XMVectorAdd(a.V[1], b.V[1]) } }; }
+    inline Float8 operator-(const Float8& a, const Float8& b) { return { { XMVectorSubtract(a.V[0], b.V[0]), XMVectorSubtract(a.V[1], b.V[1]) } }; }
+    inline Float8 operator*(const Float8& a, const Float8& b) { return { { XMVectorMultiply(a.V[0], b.V[0]), XMVectorMultiply(a.V[1], b.V[1]) } }; }
+    inline Float8 operator/(const Float8& a, const Float8& b) { return { { XMVectorDivide(a.V[0], b.V[0]), XMVectorDivide(a.V[1], b.V[1]) } }; }
+
+    inline Float8 Max8(const Float8& a, const Float8& b) { return { { XMVectorMax(a.V[0], b.V[0]), XMVectorMax(a.V[1], b.V[1]) } }; }
+    inline Float8 Sqrt8(const Float8& a) { return { { XMVectorSqrt(a.V[0]), XMVectorSqrt(a.V[1]) } }; }
+    inline Float8 Pow8(const Float8& a, const Float8& b) { return { { XMVectorPow(a.V[0], b.V[0]), XMVectorPow(a.V[1], b.V[1]) } }; }
+    inline Float8 Saturate8(const Float8& a) { return { { XMVectorSaturate(a.V[0]), XMVectorSaturate(a.V[1]) } }; }
+
+    // All bits set in the lanes where a > b.
+    inline Float8 Greater8(const Float8& a, const Float8& b) { return { { XMVectorGreater(a.V[0], b.V[0]), XMVectorGreater(a.V[1], b.V[1]) } }; }
+
+    // b where mask is set, otherwise a.
+    inline Float8 Select8(const Float8& a, const Float8& b, const Float8& mask)
+    {
+        return { { XMVectorSelect(a.V[0], b.V[0], mask.V[0]), XMVectorSelect(a.V[1], b.V[1], mask.V[1]) } };
+    }
+
+    struct Float3x8
+    {
+        Float8 X, Y, Z;
+    };
+
+    inline Float3x8 operator+(const Float3x8& a, const Float3x8& b) { return { a.X + b.X, a.Y + b.Y, a.Z + b.Z }; }
+    inline Float3x8 operator*(const Float3x8& a, const Float3x8& b) { return { a.X*b.X, a.Y*b.Y, a.Z*b.Z }; }
+    inline Float3x8 operator*(const Float3x8& a, const Float8& s) { return { a.X*s, a.Y*s, a.Z*s }; }
+    inline Float8 Dot8(const Float3x8& a, const Float3x8& b) { return a.X*b.X + a.Y*b.Y + a.Z*b.Z; }
+    inline Float3x8 Splat3x8(const XMFLOAT3& v) { return { Splat8(v.x), Splat8(v.y), Splat8(v.z) }; }
+    inline Float3x8 Normalize8(const Float3x8& a) { Float8 len = Sqrt8(Dot8(a, a)); return { a.X / len, a.Y / len, a.Z / len }; }
+
+    struct Material8
+    {
+        Float3x8 Diffuse;
+        Float3x8 FresnelR0;
+        Float8 Shininess;
+    };
+
+    Float3x8 SchlickFresnel8(const Float3x8& R0, const Float3x8& normal, const Float3x8& lightVec)
+    {
+        Float8 cosIncidentAngle = Saturate8(Dot8(normal, lightVec));
+
+        Float8 one = Splat8(1.0f);
+        Float8 f0 = one - cosIncidentAngle;
+        Float8 f5 = f0*f0*f0*f0*f0;
+
+        return { R0.X + (one - R0.X)*f5, R0.Y + (one - R0.Y)*f5, R0.Z + (one - R0.Z)*f5 };
+    }
+
+    Float3x8 BlinnPhong8(const Float3x8& lightStrength, const Float3x8& lightVec,
+        const Float3x8& normal, const Float3x8& toEye, const Material8& mat)
+    {
+        const Float8 m = mat.Shininess*Splat8(256.0f);
+        Float3x8 halfVec = Normalize8(toEye + lightVec);
+
+        Float8 eight = Splat8(8.0f);
+        Float8 roughnessFactor = (m + eight)*Pow8(Max8(Dot8(halfVec, normal), Splat8(0.0f)), m) / eight;
+        Float3x8 fresnelFactor = SchlickFresnel8(mat.FresnelR0, halfVec, lightVec);
+
+        Float3x8 specAlbedo = fresnelFactor*roughnessFactor;
+
+        Float8 one = Splat8(1.0f);
+        specAlbedo = { specAlbedo.X / (specAlbedo.X + one), specAlbedo.Y / (specAlbedo.Y + one), specAlbedo.Z / (specAlbedo.Z + one) };
+
+        return (mat.Diffuse + specAlbedo)*lightStrength;
+    }
+
+    Float3x8 ComputeDirectionalLight8(const Light& L, const Material8& mat,
+        const Float3x8& normal, const Float3x8& toEye)
+    {
+        Float3x8 lightVec = Splat3x8({ -L.Direction.x, -L.Direction.y, -L.Direction.z });
+
+        Float8 ndotl = Max8(Dot8(lightVec, normal), Splat8(0.0f));
+        Float3x8 lightStrength = Splat3x8(L.Strength)*ndotl;
+
+        return BlinnPhong8(lightStrength, lightVec, normal, toEye, mat);
+    }
+
+    // Point and spot lights share everything but the spot factor.
+    Float3x8 ComputeLocalLight8(const Light& L, bool spot, const Material8& mat,
+        const Float3x8& pos, const Float3x8& normal, const Float3x8& toEye)
+    {
+        Float3x8 lightPos = Splat3x8(L.Position);
+        Float3x8 lightVec = { lightPos.X - pos.X, lightPos.Y - pos.Y, lightPos.Z - pos.Z };
+
+        Float8 d = Sqrt8(Dot8(lightVec, lightVec));
+
+        // The shader returns early when out of range; here the lanes are masked
+        // at the end instead.
+        Float8 outOfRange = Greater8(d, Splat8(L.FalloffEnd));
+
+        lightVec = { lightVec.X / d, lightVec.Y / d, lightVec.Z / d };
+
+        Float8 ndotl = Max8(Dot8(lightVec, normal), Splat8(0.0f));
+        Float3x8 lightStrength = Splat3x8(L.Strength)*ndotl;
+
+        Float8 att = Saturate8((Splat8(L.FalloffEnd) - d) / Splat8(L.FalloffEnd - L.FalloffStart));
+        lightStrength = lightStrength*att;
+
+        if(spot)
+        {
+            Float8 cosAngle = Splat8(0.0f) - Dot8(lightVec, Splat3x8(L.Direction));
+            Float8 spotFactor = Pow8(Max8(cosAngle, Splat8(0.0f)), Splat8(L.SpotPower));
+            lightStrength = lightStrength*spotFactor;
+        }
+
+        Float3x8 color = BlinnPhong8(lightStrength, lightVec, normal, toEye, mat);
+
+        Float8 zero = Splat8(0.0f);
+        return { Select8(color.X, zero, outOfRange), Select8(color.Y, zero, outOfRange), Select8(color.Z, zero, outOfRange) };
+    }
+}
+
+void LightingReference::SampleBatch::SetSample(int i, const XMFLOAT3& pos, const XMFLOAT3& normal,
+    const XMFLOAT3& toEye, const ShadingMaterial& mat)
+{
+    PosX[i] = pos.x; PosY[i] = pos.y; PosZ[i] = pos.z;
+    NormalX[i] = normal.x; NormalY[i] = normal.y; NormalZ[i] = normal.z;
+    ToEyeX[i] = toEye.x; ToEyeY[i] = toEye.y; ToEyeZ[i] = toEye.z;
+    DiffuseR[i] = mat.DiffuseAlbedo.x; DiffuseG[i] = mat.DiffuseAlbedo.y;
+    DiffuseB[i] = mat.DiffuseAlbedo.z; DiffuseA[i] = mat.DiffuseAlbedo.w;
+    FresnelR[i] = mat.FresnelR0.x; FresnelG[i] = mat.FresnelR0.y; FresnelB[i] = mat.FresnelR0.z;
+    Shininess[i] = mat.Shininess;
+}
+
+void LightingReference::ComputeLighting8(const Light* lights, int numDir, int numPoint, int numSpot,
+    const SampleBatch& samples, ColorBatch& result, const XMFLOAT3& shadowFactor)
+{
+    Float3x8 pos = { Load8(samples.PosX), Load8(samples.PosY), Load8(samples.PosZ) };
+    Float3x8 normal = { Load8(samples.NormalX), Load8(samples.NormalY), Load8(samples.NormalZ) };
+    Float3x8 toEye = { Load8(samples.ToEyeX), Load8(samples.ToEyeY), Load8(samples.ToEyeZ) };
+
+    Material8 mat;
+    mat.Diffuse = { Load8(samples.DiffuseR), Load8(samples.DiffuseG), Load8(samples.DiffuseB) };
+    mat.FresnelR0 = { Load8(samples.FresnelR), Load8(samples.FresnelG), Load8(samples.FresnelB) };
+    mat.Shininess = Load8(samples.Shininess);
+
+    const float shadow[3] = { shadowFactor.x, shadowFactor.y, shadowFactor.z };
+
+    Float3x8 color = Splat3x8({ 0.0f, 0.0f, 0.0f });
+
+    int i = 0;
+    for(; i < numDir; ++i)
+        color = color + ComputeDirectionalLight8(lights[i], mat, normal, toEye)*Splat8(i < 3 ? shadow[i] : 1.0f);
+
+    for(; i < numDir + numPoint; ++i)
+        color = color + ComputeLocalLight8(lights[i], false, mat, pos, normal, toEye);
+
+    for(; i < numDir + numPoint + numSpot; ++i)
+        color = color + ComputeLocalLight8(lights[i], true, mat, pos, normal, toEye);
+
+    Store8(result.R, color.X);
+    Store8(result.G, color.Y);
+    Store8(result.B, color.Z);
+    Store8(result.A, Splat8(0.0f));
+}
@@ -0,0 +1,87 @@
+//***************************************************************************************
+// LightingReference.h
+//
+// CPU port of the lighting model in LightingUtil.hlsl, written to match the shader
+// line for line so results can be compared against GPU output.  It comes in two
+// forms: scalar functions mirroring each HLSL function, and a structure-of-arrays
+// version that shades eight samples at once with DirectXMath vectors (two 4-wide
+// registers per value).  Both take the light counts at runtime where the shader
+// takes NUM_DIR_LIGHTS/NUM_POINT_LIGHTS/NUM_SPOT_LIGHTS at compile time.
+//
+// Needs only DirectXMath, so it builds without windows.h (see Tests/).
+//***************************************************************************************
+
+#pragma once
+
+#include "Light.h"
+
+class LightingReference
+{
+public:
+    // Matches the Material struct in LightingUtil.hlsl.
+    struct ShadingMaterial
+    {
+        DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
+        DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
+        float Shininess = 0.75f;
+    };
+
+    static const int BatchSize = 8;
+
+    // Eight samples to shade, one array per component.  Normals must be normalized.
+    struct SampleBatch
+    {
+        float PosX[BatchSize], PosY[BatchSize], PosZ[BatchSize];
+        float NormalX[BatchSize], NormalY[BatchSize], NormalZ[BatchSize];
+        float ToEyeX[BatchSize], ToEyeY[BatchSize], ToEyeZ[BatchSize];
+        float DiffuseR[BatchSize], DiffuseG[BatchSize], DiffuseB[BatchSize], DiffuseA[BatchSize];
+        float FresnelR[BatchSize], FresnelG[BatchSize], FresnelB[BatchSize];
+        float Shininess[BatchSize];
+
+        void SetSample(int i, const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT3& normal,
+            const DirectX::XMFLOAT3& toEye, const ShadingMaterial& mat);
+    };
+
+    struct ColorBatch
+    {
+        float R[BatchSize], G[BatchSize], B[BatchSize], A[BatchSize];
+
+        DirectX::XMFLOAT4 GetSample(int i)const { return { R[i], G[i], B[i], A[i] }; }
+    };
+
+    //
+    // Scalar versions.
+    //
+
+    static float CalcAttenuation(float d, float falloffStart, float falloffEnd);
+
+    static DirectX::XMFLOAT3 SchlickFresnel(const DirectX::XMFLOAT3& R0,
+        const DirectX::XMFLOAT3& normal, const DirectX::XMFLOAT3& lightVec);
+
+    static DirectX::XMFLOAT3 BlinnPhong(const DirectX::XMFLOAT3& lightStrength,
+        const DirectX::XMFLOAT3& lightVec, const DirectX::XMFLOAT3& normal,
+        const DirectX::XMFLOAT3& toEye, const ShadingMaterial& mat);
+
+    static DirectX::XMFLOAT3 ComputeDirectionalLight(const Light& L, const ShadingMaterial& mat,
+        const DirectX::XMFLOAT3& normal, const DirectX::XMFLOAT3& toEye);
+
+    static DirectX::XMFLOAT3 ComputePointLight(const Light& L, const ShadingMaterial& mat,
+        const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT3& normal, const DirectX::XMFLOAT3& toEye);
+
+    static DirectX::XMFLOAT3 ComputeSpotLight(const Light& L, const ShadingMaterial& mat,
+        const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT3& normal, const DirectX::XMFLOAT3& toEye);
+
+    // lights holds numDir directional, then numPoint point, then numSpot spot lights.
+    // shadowFactor scales the first three directional lights, as in the shader.
+    static DirectX::XMFLOAT4 ComputeLighting(const Light* lights, int numDir, int numPoint, int numSpot,
+        const ShadingMaterial& mat, const DirectX::XMFLOAT3& pos, const DirectX::XMFLOAT3& normal,
+        const DirectX::XMFLOAT3& toEye, const DirectX::XMFLOAT3& shadowFactor = { 1.0f, 1.0f, 1.0f });
+
+    //
+    // Eight-wide structure-of-arrays version of ComputeLighting.
+    //
+
+    static void ComputeLighting8(const Light* lights, int numDir, int numPoint, int numSpot,
+        const SampleBatch& samples, ColorBatch& result,
+        const DirectX::XMFLOAT3& shadowFactor = { 1.0f, 1.0f, 1.0f });
+};
@@ -0,0 +1,93 @@
+#include "LinearUploadAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+LinearUploadAllocator::LinearUploadAllocator(ID3D12Device* device, UINT64 pageSize) :
+    md3dDevice(device),
+    mPageSize(pageSize)
+{
+    mPages.push_back(CreatePage(mPageSize));
+}
+
+LinearUploadAllocator::~LinearUploadAllocator()
+{
+    for(auto& page : mPages)
+        page->Resource->Unmap(0, nullptr);
+}
+
+LinearUploadAllocator::Allocation LinearUploadAllocator::Allocate(UINT64 byteSize, UINT64 alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+    UINT64 offset = (mCurrOffset + alignment - 1) & ~(alignment - 1);
+
+    if(offset + byteSize > mPages[mCurrPage]->Size)
+    {
+        // The current page is full.  Move on to the next page we kept from a
+        // previous frame if it is big enough, otherwise grow by inserting a new
+        // page after the current one.  Page bases are 64KB aligned, so offset 0
+        // satisfies any alignment we are asked for.
+        size_t next = mCurrPage + 1;
+        if(next == mPages.size() || mPages[next]->Size < byteSize)
+        {
+            UINT64 size = MathHelper::Max(mPageSize, (byteSize + 0xFFFF) & ~0xFFFFull);
+            mPages.insert(mPages.begin() + next, CreatePage(size));
+        }
+
+        mCurrPage = next;
+        offset = 0;
+    }
+
+    Page* page = mPages[mCurrPage].get();
+
+    Allocation alloc;
+    alloc.Resource = page->Resource.Get();
+    alloc.Offset = offset;
+    alloc.Size = byteSize;
+    alloc.ElementByteSize = (UINT)byteSize;
+    alloc.CpuAddress = page->CpuBase + offset;
+    alloc.GpuAddress = page->GpuBase + offset;
+
+    mCurrOffset = offset + byteSize;
+    mBytesAllocated += byteSize;
+    mPeakBytesAllocated = MathHelper::Max(mPeakBytesAllocated, mBytesAllocated);
+
+    return alloc;
+}
+
+void LinearUploadAllocator::Reset()
+{
+    mCurrPage = 0;
+    mCurrOffset = 0;
+    mBytesAllocated = 0;
+}
+
+UINT64 LinearUploadAllocator::Capacity()const
+{
+    UINT64 capacity = 0;
+    for(auto& page : mPages)
+        capacity += page->Size;
+
+    return capacity;
+}
+
+std::unique_ptr<LinearUploadAllocator::Page> LinearUploadAllocator::CreatePage(UINT64 byteSize)
+{
+    auto page = std::make_unique<Page>();
+    page->Size = byteSize;
+
+    ThrowIfFailed(md3dDevice->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(page->Resource.GetAddressOf())));
+
+    // Upload heap pages stay mapped for their whole lifetime; we only have to make
+    // sure we do not write memory the GPU is still reading (see Reset).
+    ThrowIfFailed(page->Resource->Map(0, nullptr, reinterpret_cast<void**>(&page->CpuBase)));
+    page->GpuBase = page->Resource->GetGPUVirtualAddress();
+
+    return page;
+}
@@ -0,0 +1,105 @@
+//***************************************************************************************
+// LinearUploadAllocator.h
+//
+// Per-frame linear allocator over persistently mapped upload heap pages.  Hands out
+// aligned sub-allocations for transient data (constants, dynamic vertices, instance
+// data) that only has to live until the GPU has finished the frame that uses it.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class LinearUploadAllocator
+{
+public:
+    // Default size of a page.  Requests larger than a page get a dedicated page.
+    static const UINT64 DefaultPageSize = 2 * 1024 * 1024;
+
+    struct Allocation
+    {
+        ID3D12Resource* Resource = nullptr;
+        UINT64 Offset = 0;   // Offset of the allocation inside Resource.
+        UINT64 Size = 0;
+        UINT ElementByteSize = 0;
+
+        BYTE* CpuAddress = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS GpuAddress = 0;
+
+        template<typename T>
+        void CopyData(int elementIndex, const T& data)
+        {
+            assert(sizeof(T) <= ElementByteSize);
+            assert((UINT64)(elementIndex + 1)*ElementByteSize <= Size);
+            memcpy(&CpuAddress[elementIndex*ElementByteSize], &data, sizeof(T));
+        }
+
+        D3D12_GPU_VIRTUAL_ADDRESS ElementGpuAddress(int elementIndex)const
+        {
+            return GpuAddress + (UINT64)elementIndex*ElementByteSize;
+        }
+    };
+
+    LinearUploadAllocator(ID3D12Device* device, UINT64 pageSize = DefaultPageSize);
+    LinearUploadAllocator(const LinearUploadAllocator& rhs) = delete;
+    LinearUploadAllocator& operator=(const LinearUploadAllocator& rhs) = delete;
+    ~LinearUploadAllocator();
+
+    // Returns byteSize bytes aligned to alignment (a power of two).  Grows by
+    // adding a page when the current one cannot hold the request.
+    Allocation Allocate(UINT64 byteSize, UINT64 alignment);
+
+    // elementCount constant buffer elements, each padded to 256 bytes so
+    // every element can be bound as a root CBV.
+    template<typename T>
+    Allocation AllocateConstants(UINT elementCount = 1)
+    {
+        UINT elementByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(T));
+        Allocation alloc = Allocate((UINT64)elementByteSize*elementCount,
+            D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+        alloc.ElementByteSize = elementByteSize;
+        return alloc;
+    }
+
+    // Tightly packed array of elementCount elements, e.g. dynamic vertices,
+    // instance data or structured buffer contents.
+    template<typename T>
+    Allocation AllocateArray(UINT elementCount, UINT64 alignment = 16)
+    {
+        Allocation alloc = Allocate((UINT64)sizeof(T)*elementCount, alignment);
+        alloc.ElementByteSize = sizeof(T);
+        return alloc;
+    }
+
+    // Releases every allocation at once.  Only call this after the fence of the
+    // frame that used the memory has completed.  The pages are kept for reuse.
+    void Reset();
+
+    UINT64 BytesAllocated()const { return mBytesAllocated; }
+    UINT64 PeakBytesAllocated()const { return mPeakBytesAllocated; }
+    UINT64 Capacity()const;
+    UINT PageCount()const { return (UINT)mPages.size(); }
+    ID3D12Resource* PageResource(UINT page)const { return mPages[page]->Resource.Get(); }
+
+private:
+    struct Page
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        BYTE* CpuBase = nullptr;
+        D3D12_GPU_VIRTUAL_ADDRESS GpuBase = 0;
+        UINT64 Size = 0;
+    };
+
+    std::unique_ptr<Page> CreatePage(UINT64 byteSize);
+
+private:
+    ID3D12Device* md3dDevice = nullptr;
+
+    std::vector<std::unique_ptr<Page>> mPages;
+    size_t mCurrPage = 0;
+    UINT64 mCurrOffset = 0;
+
+    UINT64 mPageSize = DefaultPageSize;
+    UINT64 mBytesAllocated = 0;
+    UINT64 mPeakBytesAllocated = 0;
+};
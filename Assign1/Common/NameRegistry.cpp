@@ -0,0 +1,19 @@
+#include "NameRegistry.h"
+
+NameRegistry::NameId NameRegistry::Intern(const std::string& name)
+{
+    auto it = mIds.find(name);
+    if(it != mIds.end())
+        return it->second;
+
+    NameId id = (NameId)mNames.size();
+    mNames.push_back(name);
+    mIds[name] = id;
+    return id;
+}
+
+NameRegistry::NameId NameRegistry::Find(const std::string& name)const
+{
+    auto it = mIds.find(name);
+    return it != mIds.end() ? it->second : InvalidName;
+}
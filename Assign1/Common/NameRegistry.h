@@ -0,0 +1,37 @@
+//***************************************************************************************
+// NameRegistry.h
+//
+// Interns names as dense integer ids.  A name is hashed once, when it is interned or
+// looked up while loading; from then on it is passed around as an id that indexes
+// plain arrays.  The strings are only kept for lookups and debug output.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class NameRegistry
+{
+public:
+    typedef UINT NameId;
+    static const NameId InvalidName = 0xffffffff;
+
+    NameRegistry() = default;
+    NameRegistry(const NameRegistry& rhs) = delete;
+    NameRegistry& operator=(const NameRegistry& rhs) = delete;
+
+    // Returns the id of name, adding it if it is new.  Ids are handed out in order
+    // starting at 0.
+    NameId Intern(const std::string& name);
+
+    // Returns the id of name, or InvalidName if it was never interned.
+    NameId Find(const std::string& name)const;
+
+    const std::string& GetName(NameId id)const { return mNames[id]; }
+
+    UINT Count()const { return (UINT)mNames.size(); }
+
+private:
+    std::vector<std::string> mNames;
+    std::unordered_map<std::string, NameId> mIds;
+};
@@ -0,0 +1,303 @@
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+
+using namespace DirectX;
+
+// Occludees are moved this much closer so that an occluder never hides itself
+// through rounding in its own depth.
+static const float DepthEpsilon = 1.0e-6f;
+
+// Box corner i is at max along x if bit 0 is set, y for bit 1 and z for bit 2.
+static const int BoxFaces[6][4] =
+{
+    { 0, 2, 6, 4 }, { 1, 5, 7, 3 },   // -x, +x
+    { 0, 4, 5, 1 }, { 2, 3, 7, 6 },   // -y, +y
+    { 0, 1, 3, 2 }, { 4, 6, 7, 5 },   // -z, +z
+};
+
+OcclusionCuller::OcclusionCuller(UINT width, UINT height) :
+    mWidth((width + BlockSize - 1) / BlockSize * BlockSize),
+    mHeight(height)
+{
+    mBlocksX = mWidth / BlockSize;
+    mBlocksY = (mHeight + BlockSize - 1) / BlockSize;
+
+    mDepth.resize((size_t)mWidth*mHeight, 1.0f);
+    mBlockMaxDepth.resize((size_t)mBlocksX*mBlocksY, 1.0f);
+}
+
+void OcclusionCuller::Begin(const XMFLOAT4X4& viewProj)
+{
+    mViewProj = viewProj;
+    mTriangles.clear();
+    mStats = Stats();
+}
+
+bool OcclusionCuller::ProjectBox(const BoundingBox& bounds, const XMFLOAT4X4& world, XMFLOAT4 corners[8])const
+{
+    XMMATRIX worldViewProj = XMMatrixMultiply(XMLoadFloat4x4(&world), XMLoadFloat4x4(&mViewProj));
+    XMVECTOR center = XMLoadFloat3(&bounds.Center);
+    XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+
+    bool inFront = true;
+    for(int i = 0; i < 8; ++i)
+    {
+        XMVECTOR sign = XMVectorSet((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 0.0f);
+        XMStoreFloat4(&corners[i], XMVector3Transform(XMVectorMultiplyAdd(extents, sign, center), worldViewProj));
+
+        // D3D clip space has 0 <= z <= w.
+        if(corners[i].z < 0.0f)
+            inFront = false;
+    }
+
+    return inFront;
+}
+
+void OcclusionCuller::AddOccluder(const BoundingBox& bounds, const XMFLOAT4X4& world)
+{
+    mStats.Occluders++;
+
+    // Clipping would be needed for boxes crossing the near plane; leaving them out
+    // only makes the culling less effective.
+    XMFLOAT4 corners[8];
+    if(!ProjectBox(bounds, world, corners))
+    {
+        mStats.SkippedOccluders++;
+        return;
+    }
+
+    XMFLOAT3 screen[8];
+    for(int i = 0; i < 8; ++i)
+    {
+        float invW = 1.0f / corners[i].w;
+        screen[i].x = (0.5f + 0.5f*corners[i].x*invW)*mWidth;
+        screen[i].y = (0.5f - 0.5f*corners[i].y*invW)*mHeight;
+        screen[i].z = corners[i].z*invW;
+    }
+
+    for(const int* face : BoxFaces)
+    {
+        const int triangles[2][3] = { { face[0], face[1], face[2] }, { face[0], face[2], face[3] } };
+        for(const int* corner : triangles)
+        {
+            ScreenTriangle tri;
+            for(int k = 0; k < 3; ++k)
+            {
+                tri.X[k] = screen[corner[k]].x;
+                tri.Y[k] = screen[corner[k]].y;
+                tri.Z[k] = screen[corner[k]].z;
+            }
+
+            float minX = MathHelper::Min(tri.X[0], MathHelper::Min(tri.X[1], tri.X[2]));
+            float minY = MathHelper::Min(tri.Y[0], MathHelper::Min(tri.Y[1], tri.Y[2]));
+            float maxX = MathHelper::Max(tri.X[0], MathHelper::Max(tri.X[1], tri.X[2]));
+            float maxY = MathHelper::Max(tri.Y[0], MathHelper::Max(tri.Y[1], tri.Y[2]));
+
+            tri.MinX = MathHelper::Max((int)floorf(minX), 0);
+            tri.MinY = MathHelper::Max((int)floorf(minY), 0);
+            tri.MaxX = MathHelper::Min((int)floorf(maxX), (int)mWidth - 1);
+            tri.MaxY = MathHelper::Min((int)floorf(maxY), (int)mHeight - 1);
+            if(tri.MinX > tri.MaxX || tri.MinY > tri.MaxY)
+                continue;
+
+            // Both windings are rasterized; the nearer face wins the depth test.
+            float area = (tri.X[1] - tri.X[0])*(tri.Y[2] - tri.Y[0]) - (tri.Y[1] - tri.Y[0])*(tri.X[2] - tri.X[0]);
+            if(area == 0.0f)
+                continue;
+            if(area < 0.0f)
+            {
+                std::swap(tri.X[1], tri.X[2]);
+                std::swap(tri.Y[1], tri.Y[2]);
+                std::swap(tri.Z[1], tri.Z[2]);
+            }
+
+            mTriangles.push_back(tri);
+        }
+    }
+}
+
+void OcclusionCuller::RasterizeOccluders(ThreadPool* pool)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point startTime = Clock::now();
+
+    mStats.OccluderTriangles = (UINT)mTriangles.size();
+
+    if(pool != nullptr)
+        pool->ParallelFor(mBlocksY, [this](UINT band) { RasterizeBand(band); });
+    else
+    {
+        for(UINT band = 0; band < mBlocksY; ++band)
+            RasterizeBand(band);
+    }
+
+    mStats.RasterMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+}
+
+void OcclusionCuller::RasterizeBand(UINT band)
+{
+    const int bandMinY = (int)(band*BlockSize);
+    const int bandMaxY = MathHelper::Min(bandMinY + (int)BlockSize, (int)mHeight) - 1;
+
+    for(int y = bandMinY; y <= bandMaxY; ++y)
+        std::fill_n(&mDepth[(size_t)y*mWidth], mWidth, 1.0f);
+
+    const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+    const XMVECTOR zero = XMVectorZero();
+
+    for(const ScreenTriangle& tri : mTriangles)
+    {
+        const int minY = MathHelper::Max(tri.MinY, bandMinY);
+        const int maxY = MathHelper::Min(tri.MaxY, bandMaxY);
+        if(minY > maxY)
+            continue;
+
+        // Edge i runs from vertex i to vertex i+1 and is >= 0 inside:
+        // E(x, y) = A*x + B*y + C.  Its value is the weight of the opposite vertex.
+        float a[3], b[3], c[3];
+        for(int e = 0; e < 3; ++e)
+        {
+            int next = (e + 1) % 3;
+            a[e] = -(tri.Y[next] - tri.Y[e]);
+            b[e] = tri.X[next] - tri.X[e];
+            c[e] = -a[e]*tri.X[e] - b[e]*tri.Y[e];
+        }
+
+        // Depth is linear in screen space: z = ZA*x + ZB*y + ZC.
+        const float invArea = 1.0f / (a[0]*tri.X[2] + b[0]*tri.Y[2] + c[0]);
+        const float za = (a[1]*tri.Z[0] + a[2]*tri.Z[1] + a[0]*tri.Z[2])*invArea;
+        const float zb = (b[1]*tri.Z[0] + b[2]*tri.Z[1] + b[0]*tri.Z[2])*invArea;
+        const float zc = (c[1]*tri.Z[0] + c[2]*tri.Z[1] + c[0]*tri.Z[2])*invArea;
+
+        // Keep interpolated depth within the triangle's own range.
+        const XMVECTOR triMinZ = XMVectorReplicate(MathHelper::Min(tri.Z[0], MathHelper::Min(tri.Z[1], tri.Z[2])));
+        const XMVECTOR triMaxZ = XMVectorReplicate(MathHelper::Max(tri.Z[0], MathHelper::Max(tri.Z[1], tri.Z[2])));
+
+        const XMVECTOR edgeA0 = XMVectorReplicate(a[0]);
+        const XMVECTOR edgeA1 = XMVectorReplicate(a[1]);
+        const XMVECTOR edgeA2 = XMVectorReplicate(a[2]);
+        const XMVECTOR depthA = XMVectorReplicate(za);
+
+        // Four pixels at a time from a 4-aligned start; the width is a multiple of 4.
+        const int minX = tri.MinX & ~3;
+        for(int y = minY; y <= maxY; ++y)
+        {
+            const float sampleY = y + 0.5f;
+            const XMVECTOR rowE0 = XMVectorReplicate(b[0]*sampleY + c[0]);
+            const XMVECTOR rowE1 = XMVectorReplicate(b[1]*sampleY + c[1]);
+            const XMVECTOR rowE2 = XMVectorReplicate(b[2]*sampleY + c[2]);
+            const XMVECTOR rowZ = XMVectorReplicate(zb*sampleY + zc);
+
+            float* row = &mDepth[(size_t)y*mWidth];
+            for(int x = minX; x <= tri.MaxX; x += 4)
+            {
+                XMVECTOR sampleX = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+
+                XMVECTOR inside = XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeA0, sampleX, rowE0), zero);
+                inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeA1, sampleX, rowE1), zero));
+                inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(XMVectorMultiplyAdd(edgeA2, sampleX, rowE2), zero));
+
+                XMVECTOR z = XMVectorClamp(XMVectorMultiplyAdd(depthA, sampleX, rowZ), triMinZ, triMaxZ);
+                XMVECTOR depth = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(row + x));
+                depth = XMVectorSelect(depth, XMVectorMin(depth, z), inside);
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(row + x), depth);
+            }
+        }
+    }
+
+    // Reduce the band to its blocks' farthest depth.
+    for(UINT bx = 0; bx < mBlocksX; ++bx)
+    {
+        XMVECTOR maxDepth = XMVectorZero();
+        for(int y = bandMinY; y <= bandMaxY; ++y)
+        {
+            const float* block = &mDepth[(size_t)y*mWidth + bx*BlockSize];
+            for(UINT x = 0; x < BlockSize; x += 4)
+                maxDepth = XMVectorMax(maxDepth, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(block + x)));
+        }
+
+        maxDepth = XMVectorMax(maxDepth, XMVectorSwizzle<2, 3, 0, 1>(maxDepth));
+        maxDepth = XMVectorMax(maxDepth, XMVectorSwizzle<1, 0, 3, 2>(maxDepth));
+        mBlockMaxDepth[band*mBlocksX + bx] = XMVectorGetX(maxDepth);
+    }
+}
+
+bool OcclusionCuller::IsVisible(const BoundingBox& bounds, const XMFLOAT4X4& world, float screenMargin)
+{
+    mStats.Tested++;
+
+    // Boxes reaching behind the near plane are treated as visible.
+    XMFLOAT4 corners[8];
+    if(!ProjectBox(bounds, world, corners))
+        return true;
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+    for(const XMFLOAT4& corner : corners)
+    {
+        float invW = 1.0f / corner.w;
+        minX = MathHelper::Min(minX, corner.x*invW);
+        minY = MathHelper::Min(minY, corner.y*invW);
+        minZ = MathHelper::Min(minZ, corner.z*invW);
+        maxX = MathHelper::Max(maxX, corner.x*invW);
+        maxY = MathHelper::Max(maxY, corner.y*invW);
+    }
+
+    minX -= screenMargin;
+    minY -= screenMargin;
+    maxX += screenMargin;
+    maxY += screenMargin;
+
+    if(maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f || minZ > 1.0f)
+    {
+        mStats.Offscreen++;
+        return false;
+    }
+
+    const int rectMinX = MathHelper::Max((int)floorf((0.5f + 0.5f*minX)*mWidth), 0);
+    const int rectMaxX = MathHelper::Min((int)floorf((0.5f + 0.5f*maxX)*mWidth), (int)mWidth - 1);
+    const int rectMinY = MathHelper::Max((int)floorf((0.5f - 0.5f*maxY)*mHeight), 0);
+    const int rectMaxY = MathHelper::Min((int)floorf((0.5f - 0.5f*minY)*mHeight), (int)mHeight - 1);
+
+    const float nearestDepth = minZ - DepthEpsilon;
+    const XMVECTOR nearest = XMVectorReplicate(nearestDepth);
+    const XMVECTOR lanes = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+
+    for(int by = rectMinY / (int)BlockSize; by <= rectMaxY / (int)BlockSize; ++by)
+    {
+        for(int bx = rectMinX / (int)BlockSize; bx <= rectMaxX / (int)BlockSize; ++bx)
+        {
+            // Everything in the block is nearer than the box.
+            if(mBlockMaxDepth[by*mBlocksX + bx] < nearestDepth)
+                continue;
+
+            const int minX = MathHelper::Max(bx*(int)BlockSize, rectMinX);
+            const int maxX = MathHelper::Min(bx*(int)BlockSize + (int)BlockSize - 1, rectMaxX);
+            const int minY = MathHelper::Max(by*(int)BlockSize, rectMinY);
+            const int maxY = MathHelper::Min(by*(int)BlockSize + (int)BlockSize - 1, rectMaxY);
+
+            const XMVECTOR rangeMin = XMVectorReplicate((float)minX);
+            const XMVECTOR rangeMax = XMVectorReplicate((float)maxX);
+            for(int y = minY; y <= maxY; ++y)
+            {
+                const float* row = &mDepth[(size_t)y*mWidth];
+                for(int x = minX & ~3; x <= maxX; x += 4)
+                {
+                    XMVECTOR laneX = XMVectorAdd(XMVectorReplicate((float)x), lanes);
+                    XMVECTOR inRect = XMVectorAndInt(XMVectorGreaterOrEqual(laneX, rangeMin),
+                        XMVectorLessOrEqual(laneX, rangeMax));
+
+                    XMVECTOR depth = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(row + x));
+                    XMVECTOR showing = XMVectorAndInt(inRect, XMVectorGreaterOrEqual(depth, nearest));
+                    if(!XMVector4EqualInt(showing, XMVectorZero()))
+                        return true;
+                }
+            }
+        }
+    }
+
+    mStats.Occluded++;
+    return false;
+}
@@ -0,0 +1,92 @@
+//***************************************************************************************
+// OcclusionCuller.h
+//
+// Software occlusion culling against a coarse CPU depth buffer.  Solid boxes (walls,
+// towers) are rasterized as occluders at low resolution, four pixels at a time with
+// SIMD edge functions, in horizontal bands on a ThreadPool.  Each band also reduces
+// its depth to a max-depth hierarchy of BlockSize x BlockSize blocks.  An occludee's
+// box is projected to a screen rectangle with its nearest depth, tested against the
+// blocks first and only against individual pixels where a block might show it.
+//
+// Depth is D3D normalized device depth, 0 at the near plane and 1 at the far plane.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class ThreadPool;
+
+class OcclusionCuller
+{
+public:
+    static const UINT DefaultWidth = 256;
+    static const UINT DefaultHeight = 144;
+    static const UINT BlockSize = 8;
+
+    struct Stats
+    {
+        UINT Occluders = 0;
+        UINT OccluderTriangles = 0;
+        UINT SkippedOccluders = 0;   // Crossed the near plane, so not rasterized.
+        UINT Tested = 0;
+        UINT Occluded = 0;
+        UINT Offscreen = 0;
+        double RasterMilliseconds = 0.0;
+    };
+
+    // The width is rounded up to a multiple of BlockSize.
+    OcclusionCuller(UINT width = DefaultWidth, UINT height = DefaultHeight);
+    OcclusionCuller(const OcclusionCuller& rhs) = delete;
+    OcclusionCuller& operator=(const OcclusionCuller& rhs) = delete;
+
+    // Starts a frame.  viewProj maps world space to clip space and is not transposed.
+    void Begin(const DirectX::XMFLOAT4X4& viewProj);
+
+    // Queues a solid box, given by local bounds and a world matrix, as an occluder.
+    void AddOccluder(const DirectX::BoundingBox& bounds, const DirectX::XMFLOAT4X4& world);
+
+    // Rasterizes the queued occluders.  pool may be null to rasterize on the calling thread.
+    void RasterizeOccluders(ThreadPool* pool);
+
+    // False if the box is hidden behind the occluders or off screen.  Call after
+    // RasterizeOccluders.  screenMargin grows the box's screen rectangle by that
+    // much in normalized device coordinates, to find boxes that are only just hidden.
+    bool IsVisible(const DirectX::BoundingBox& bounds, const DirectX::XMFLOAT4X4& world,
+        float screenMargin = 0.0f);
+
+    UINT Width()const { return mWidth; }
+    UINT Height()const { return mHeight; }
+    const std::vector<float>& GetDepth()const { return mDepth; }
+
+    const Stats& GetStats()const { return mStats; }
+
+private:
+    struct ScreenTriangle
+    {
+        float X[3], Y[3];
+        float Z[3];
+        int MinX, MinY, MaxX, MaxY;
+    };
+
+    // Corners of the box in clip space.  Returns false if a corner is behind the
+    // near plane.
+    bool ProjectBox(const DirectX::BoundingBox& bounds, const DirectX::XMFLOAT4X4& world,
+        DirectX::XMFLOAT4 corners[8])const;
+
+    void RasterizeBand(UINT band);
+
+private:
+    UINT mWidth = 0;
+    UINT mHeight = 0;
+    UINT mBlocksX = 0;
+    UINT mBlocksY = 0;
+
+    DirectX::XMFLOAT4X4 mViewProj = MathHelper::Identity4x4();
+
+    std::vector<ScreenTriangle> mTriangles;
+    std::vector<float> mDepth;
+    std::vector<float> mBlockMaxDepth;
+
+    Stats mStats;
+};
@@ -0,0 +1,326 @@
+#include "PipelineCache.h"
+#include "ThreadPool.h"
+#include "FileUtil.h"
+
+using Microsoft::WRL::ComPtr;
+
+template<typename T>
+static std::uint64_t HashValue(const T& value, std::uint64_t hash)
+{
+    return d3dUtil::HashBytes(&value, sizeof(T), hash);
+}
+
+static std::uint64_t HashString(const char* str, std::uint64_t hash)
+{
+    if(str == nullptr)
+        str = "";
+    return d3dUtil::HashBytes(str, strlen(str) + 1, hash);
+}
+
+static std::uint64_t HashShader(const D3D12_SHADER_BYTECODE& shader, std::uint64_t hash)
+{
+    hash = HashValue(shader.BytecodeLength, hash);
+    return d3dUtil::HashBytes(shader.pShaderBytecode, shader.BytecodeLength, hash);
+}
+
+// Hashes the desc field by field; several of the state structs contain padding
+// after UINT8 members, which must not leak into the key.
+static std::uint64_t HashDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, std::uint64_t rootSignatureKey)
+{
+    std::uint64_t hash = d3dUtil::HashBytes(&rootSignatureKey, sizeof(rootSignatureKey));
+
+    hash = HashShader(desc.VS, hash);
+    hash = HashShader(desc.PS, hash);
+    hash = HashShader(desc.DS, hash);
+    hash = HashShader(desc.HS, hash);
+    hash = HashShader(desc.GS, hash);
+
+    const D3D12_STREAM_OUTPUT_DESC& so = desc.StreamOutput;
+    hash = HashValue(so.NumEntries, hash);
+    for(UINT i = 0; i < so.NumEntries; ++i)
+    {
+        const D3D12_SO_DECLARATION_ENTRY& entry = so.pSODeclaration[i];
+        hash = HashValue(entry.Stream, hash);
+        hash = HashString(entry.SemanticName, hash);
+        hash = HashValue(entry.SemanticIndex, hash);
+        hash = HashValue(entry.StartComponent, hash);
+        hash = HashValue(entry.ComponentCount, hash);
+        hash = HashValue(entry.OutputSlot, hash);
+    }
+    hash = HashValue(so.NumStrides, hash);
+    hash = d3dUtil::HashBytes(so.pBufferStrides, so.NumStrides * sizeof(UINT), hash);
+    hash = HashValue(so.RasterizedStream, hash);
+
+    const D3D12_BLEND_DESC& blend = desc.BlendState;
+    hash = HashValue(blend.AlphaToCoverageEnable, hash);
+    hash = HashValue(blend.IndependentBlendEnable, hash);
+    for(const D3D12_RENDER_TARGET_BLEND_DESC& rt : blend.RenderTarget)
+    {
+        hash = HashValue(rt.BlendEnable, hash);
+        hash = HashValue(rt.LogicOpEnable, hash);
+        hash = HashValue(rt.SrcBlend, hash);
+        hash = HashValue(rt.DestBlend, hash);
+        hash = HashValue(rt.BlendOp, hash);
+        hash = HashValue(rt.SrcBlendAlpha, hash);
+        hash = HashValue(rt.DestBlendAlpha, hash);
+        hash = HashValue(rt.BlendOpAlpha, hash);
+        hash = HashValue(rt.LogicOp, hash);
+        hash = HashValue(rt.RenderTargetWriteMask, hash);
+    }
+
+    hash = HashValue(desc.SampleMask, hash);
+    hash = HashValue(desc.RasterizerState, hash);
+
+    const D3D12_DEPTH_STENCIL_DESC& ds = desc.DepthStencilState;
+    hash = HashValue(ds.DepthEnable, hash);
+    hash = HashValue(ds.DepthWriteMask, hash);
+    hash = HashValue(ds.DepthFunc, hash);
+    hash = HashValue(ds.StencilEnable, hash);
+    hash = HashValue(ds.StencilReadMask, hash);
+    hash = HashValue(ds.StencilWriteMask, hash);
+    hash = HashValue(ds.FrontFace, hash);
+    hash = HashValue(ds.BackFace, hash);
+
+    const D3D12_INPUT_LAYOUT_DESC& layout = desc.InputLayout;
+    hash = HashValue(layout.NumElements, hash);
+    for(UINT i = 0; i < layout.NumElements; ++i)
+    {
+        const D3D12_INPUT_ELEMENT_DESC& element = layout.pInputElementDescs[i];
+        hash = HashString(element.SemanticName, hash);
+        hash = HashValue(element.SemanticIndex, hash);
+        hash = HashValue(element.Format, hash);
+        hash = HashValue(element.InputSlot, hash);
+        hash = HashValue(element.AlignedByteOffset, hash);
+        hash = HashValue(element.InputSlotClass, hash);
+        hash = HashValue(element.InstanceDataStepRate, hash);
+    }
+
+    hash = HashValue(desc.IBStripCutValue, hash);
+    hash = HashValue(desc.PrimitiveTopologyType, hash);
+    hash = HashValue(desc.NumRenderTargets, hash);
+    hash = HashValue(desc.RTVFormats, hash);
+    hash = HashValue(desc.DSVFormat, hash);
+    hash = HashValue(desc.SampleDesc, hash);
+    hash = HashValue(desc.NodeMask, hash);
+    hash = HashValue(desc.Flags, hash);
+
+    return hash;
+}
+
+PipelineCache::PipelineCache(ID3D12Device* device, ThreadPool* pool, const std::wstring& libraryFile,
+    UINT capacity) :
+    md3dDevice(device),
+    mPool(pool),
+    mLibraryFile(libraryFile),
+    mEntries(new Entry[capacity]),
+    mCapacity(capacity)
+{
+    if(FAILED(device->QueryInterface(IID_PPV_ARGS(md3dDevice1.GetAddressOf()))))
+        return;
+
+    if(GetFileAttributesW(mLibraryFile.c_str()) != INVALID_FILE_ATTRIBUTES)
+    {
+        mLibraryData = d3dUtil::LoadBinary(mLibraryFile);
+        md3dDevice1->CreatePipelineLibrary(mLibraryData->GetBufferPointer(), mLibraryData->GetBufferSize(),
+            IID_PPV_ARGS(mLibrary.GetAddressOf()));
+    }
+
+    if(mLibrary == nullptr)
+    {
+        // No file, or one written by a different driver or adapter: start empty.
+        // Some drivers do not support libraries at all; the cache then only
+        // deduplicates.
+        mLibraryData.Reset();
+        md3dDevice1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(mLibrary.GetAddressOf()));
+    }
+}
+
+PipelineCache::~PipelineCache()
+{
+    // Jobs still running reference this object.
+    for(UINT i = 0; i < mEntryCount; ++i)
+    {
+        if(mEntries[i].Ready.valid())
+            mEntries[i].Ready.wait();
+    }
+}
+
+void PipelineCache::RegisterRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serialized)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRootSignatureKeys[rootSignature] = d3dUtil::HashBytes(serialized->GetBufferPointer(), serialized->GetBufferSize());
+}
+
+PipelineCache::Handle PipelineCache::Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    std::uint64_t key = ComputeKey(desc);
+    Handle handle = InvalidHandle;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStats.Requests++;
+
+        auto it = mHandles.find(key);
+        if(it != mHandles.end())
+        {
+            mStats.Deduplicated++;
+            return it->second;
+        }
+
+        if(mEntryCount == mCapacity)
+            ThrowIfFailed(E_OUTOFMEMORY);
+
+        handle = mEntryCount++;
+        mHandles[key] = handle;
+    }
+
+    Entry& entry = mEntries[handle];
+    entry.Storage = CopyDesc(desc);
+
+    if(mPool != nullptr)
+    {
+        entry.Ready = mPool->Submit([this, handle, key]() { CreatePipeline(handle, key); }).share();
+    }
+    else
+    {
+        std::packaged_task<void()> task([this, handle, key]() { CreatePipeline(handle, key); });
+        entry.Ready = task.get_future().share();
+        task();
+        entry.Ready.get();
+    }
+
+    return handle;
+}
+
+ID3D12PipelineState* PipelineCache::Wait(Handle handle)
+{
+    assert(handle < mEntryCount);
+
+    mEntries[handle].Ready.get();
+    return Get(handle);
+}
+
+void PipelineCache::WaitAll()
+{
+    for(UINT i = 0; i < mEntryCount; ++i)
+        mEntries[i].Ready.get();
+}
+
+void PipelineCache::SaveLibrary()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if(mLibrary == nullptr || !mLibraryDirty)
+        return;
+
+    std::vector<BYTE> data(mLibrary->GetSerializedSize());
+    ThrowIfFailed(mLibrary->Serialize(data.data(), data.size()));
+
+    if(WriteFileAtomic(mLibraryFile, data.data(), data.size()))
+        mLibraryDirty = false;
+}
+
+std::uint64_t PipelineCache::ComputeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)const
+{
+    std::uint64_t rootSignatureKey = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        auto it = mRootSignatureKeys.find(desc.pRootSignature);
+        rootSignatureKey = it != mRootSignatureKeys.end() ? it->second : (std::uint64_t)desc.pRootSignature;
+    }
+
+    return HashDesc(desc, rootSignatureKey);
+}
+
+PipelineCache::Stats PipelineCache::GetStats()const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+std::unique_ptr<PipelineCache::DescStorage> PipelineCache::CopyDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)
+{
+    auto storage = std::make_unique<DescStorage>();
+    storage->Desc = desc;
+    storage->Desc.CachedPSO = { nullptr, 0 };
+
+    D3D12_SHADER_BYTECODE* shaders[] =
+    {
+        &storage->Desc.VS, &storage->Desc.PS, &storage->Desc.DS, &storage->Desc.HS, &storage->Desc.GS
+    };
+
+    for(UINT i = 0; i < _countof(shaders); ++i)
+    {
+        const BYTE* bytecode = reinterpret_cast<const BYTE*>(shaders[i]->pShaderBytecode);
+        storage->ShaderBytecode[i].assign(bytecode, bytecode + shaders[i]->BytecodeLength);
+        shaders[i]->pShaderBytecode = storage->ShaderBytecode[i].data();
+    }
+
+    const D3D12_INPUT_LAYOUT_DESC& layout = desc.InputLayout;
+    const D3D12_STREAM_OUTPUT_DESC& so = desc.StreamOutput;
+
+    // Reserve up front; the copied descs point into these strings.
+    storage->Names.reserve(layout.NumElements + so.NumEntries);
+
+    storage->InputElements.assign(layout.pInputElementDescs, layout.pInputElementDescs + layout.NumElements);
+    for(auto& element : storage->InputElements)
+    {
+        storage->Names.push_back(element.SemanticName);
+        element.SemanticName = storage->Names.back().c_str();
+    }
+    storage->Desc.InputLayout.pInputElementDescs = storage->InputElements.data();
+
+    storage->SoEntries.assign(so.pSODeclaration, so.pSODeclaration + so.NumEntries);
+    for(auto& entry : storage->SoEntries)
+    {
+        // A null semantic name marks a gap in the output.
+        if(entry.SemanticName != nullptr)
+        {
+            storage->Names.push_back(entry.SemanticName);
+            entry.SemanticName = storage->Names.back().c_str();
+        }
+    }
+    storage->SoStrides.assign(so.pBufferStrides, so.pBufferStrides + so.NumStrides);
+    storage->Desc.StreamOutput.pSODeclaration = storage->SoEntries.data();
+    storage->Desc.StreamOutput.pBufferStrides = storage->SoStrides.data();
+
+    return storage;
+}
+
+void PipelineCache::CreatePipeline(Handle handle, std::uint64_t key)
+{
+    Entry& entry = mEntries[handle];
+    const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc = entry.Storage->Desc;
+
+    wchar_t name[17];
+    swprintf_s(name, L"%016llx", (unsigned long long)key);
+
+    // The pipeline library synchronizes internally, so loads need no lock.
+    ComPtr<ID3D12PipelineState> pipeline;
+    bool loaded = mLibrary != nullptr &&
+        SUCCEEDED(mLibrary->LoadGraphicsPipeline(name, &desc, IID_PPV_ARGS(pipeline.GetAddressOf())));
+
+    if(!loaded)
+    {
+        ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(pipeline.GetAddressOf())));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if(loaded)
+        {
+            mStats.LibraryHits++;
+        }
+        else
+        {
+            mStats.Compiled++;
+            if(mLibrary != nullptr && SUCCEEDED(mLibrary->StorePipeline(name, pipeline.Get())))
+                mLibraryDirty = true;
+        }
+    }
+
+    entry.Owner = pipeline;
+    entry.Storage.reset();
+    entry.Pipeline.store(pipeline.Get(), std::memory_order_release);
+}
@@ -0,0 +1,114 @@
+//***************************************************************************************
+// PipelineCache.h
+//
+// Graphics pipeline state objects keyed by a hash of the full
+// D3D12_GRAPHICS_PIPELINE_STATE_DESC: shader bytecode, input layout, root signature
+// and every fixed function state.  Identical requests share one PSO.  New PSOs are
+// created on a ThreadPool and stored in an ID3D12PipelineLibrary that is serialized
+// to disk, so later runs load them instead of compiling.
+//
+// Request returns a handle immediately.  Get is wait-free (one atomic load) and
+// returns null until the PSO is ready; Wait blocks for it.  Get may be called from any
+// thread; Request, Wait, WaitAll and SaveLibrary are meant to be called from one.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include <atomic>
+#include <future>
+#include <mutex>
+
+class ThreadPool;
+
+class PipelineCache
+{
+public:
+    typedef UINT Handle;
+    static const Handle InvalidHandle = ~0u;
+    static const UINT DefaultCapacity = 256;
+
+    struct Stats
+    {
+        UINT Requests = 0;       // Calls to Request.
+        UINT Deduplicated = 0;   // Requests answered with an existing PSO.
+        UINT LibraryHits = 0;    // PSOs loaded from the pipeline library.
+        UINT Compiled = 0;       // PSOs created from scratch.
+    };
+
+    // pool may be null, in which case PSOs are created inside Request.  Without
+    // ID3D12Device1 support the cache still deduplicates, but nothing is persisted.
+    PipelineCache(ID3D12Device* device, ThreadPool* pool, const std::wstring& libraryFile,
+        UINT capacity = DefaultCapacity);
+    PipelineCache(const PipelineCache& rhs) = delete;
+    PipelineCache& operator=(const PipelineCache& rhs) = delete;
+    ~PipelineCache();
+
+    // Root signatures are identified by their serialized form, so keys stay the
+    // same from one run to the next.  Unregistered root signatures are keyed by
+    // address, which still deduplicates but never matches the library.
+    void RegisterRootSignature(ID3D12RootSignature* rootSignature, ID3DBlob* serialized);
+
+    // Everything desc points to is copied; it need not outlive the call.
+    Handle Request(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+
+    ID3D12PipelineState* Get(Handle handle)const
+    {
+        return mEntries[handle].Pipeline.load(std::memory_order_acquire);
+    }
+
+    // Blocks until the PSO is ready; rethrows a failure to create it.
+    ID3D12PipelineState* Wait(Handle handle);
+    void WaitAll();
+
+    // Writes the pipeline library to disk if PSOs were added to it.
+    void SaveLibrary();
+
+    std::uint64_t ComputeKey(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc)const;
+
+    Stats GetStats()const;
+
+private:
+    // Deep copy of a request, owned by the entry while the PSO is created.
+    struct DescStorage
+    {
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+        std::vector<BYTE> ShaderBytecode[5];
+        std::vector<D3D12_INPUT_ELEMENT_DESC> InputElements;
+        std::vector<D3D12_SO_DECLARATION_ENTRY> SoEntries;
+        std::vector<UINT> SoStrides;
+        std::vector<std::string> Names;
+    };
+
+    struct Entry
+    {
+        std::atomic<ID3D12PipelineState*> Pipeline{ nullptr };
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> Owner;
+        std::unique_ptr<DescStorage> Storage;
+        std::shared_future<void> Ready;
+    };
+
+    static std::unique_ptr<DescStorage> CopyDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc);
+    void CreatePipeline(Handle handle, std::uint64_t key);
+
+private:
+    ID3D12Device* md3dDevice = nullptr;
+    Microsoft::WRL::ComPtr<ID3D12Device1> md3dDevice1;
+    ThreadPool* mPool = nullptr;
+
+    std::wstring mLibraryFile;
+    Microsoft::WRL::ComPtr<ID3DBlob> mLibraryData;   // Must outlive the library.
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> mLibrary;
+    bool mLibraryDirty = false;
+
+    // Fixed capacity, so Get never races with a reallocation.
+    std::unique_ptr<Entry[]> mEntries;
+    UINT mCapacity = 0;
+    UINT mEntryCount = 0;
+
+    std::unordered_map<std::uint64_t, Handle> mHandles;
+    std::unordered_map<ID3D12RootSignature*, std::uint64_t> mRootSignatureKeys;
+
+    mutable std::mutex mMutex;
+    Stats mStats;
+};
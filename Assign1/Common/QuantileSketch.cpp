@@ -0,0 +1,93 @@
+#include "QuantileSketch.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+QuantileSketch::QuantileSketch(double relativeAccuracy, double minValue, double maxValue)
+{
+    assert(relativeAccuracy > 0.0 && relativeAccuracy < 1.0);
+    assert(minValue > 0.0 && maxValue > minValue);
+
+    // Bucket i holds (minValue*gamma^(i-1), minValue*gamma^i]; every value in it is
+    // within relativeAccuracy of the bucket's representative value.
+    mGamma = (1.0 + relativeAccuracy) / (1.0 - relativeAccuracy);
+    mLogGamma = std::log(mGamma);
+    mMinValue = minValue;
+
+    std::uint32_t bucketCount = (std::uint32_t)std::ceil(std::log(maxValue / minValue) / mLogGamma) + 1;
+    mCounts.resize(bucketCount, 0);
+}
+
+void QuantileSketch::Add(double value)
+{
+    if(value > 0.0)
+        ++mCounts[BucketIndex(value)];
+    else
+        ++mZeroCount;
+    ++mCount;
+}
+
+void QuantileSketch::Remove(double value)
+{
+    if(value > 0.0)
+    {
+        std::uint32_t index = BucketIndex(value);
+        assert(mCounts[index] > 0);
+        --mCounts[index];
+    }
+    else
+    {
+        assert(mZeroCount > 0);
+        --mZeroCount;
+    }
+    --mCount;
+}
+
+void QuantileSketch::Clear()
+{
+    std::fill(mCounts.begin(), mCounts.end(), 0);
+    mZeroCount = 0;
+    mCount = 0;
+}
+
+double QuantileSketch::Quantile(double q)const
+{
+    if(mCount == 0)
+        return 0.0;
+
+    q = q < 0.0 ? 0.0 : (q > 1.0 ? 1.0 : q);
+    std::uint64_t rank = (std::uint64_t)(q * (double)(mCount - 1));
+
+    std::uint64_t seen = mZeroCount;
+    if(seen > rank)
+        return 0.0;
+
+    for(std::uint32_t i = 0; i < (std::uint32_t)mCounts.size(); ++i)
+    {
+        seen += mCounts[i];
+        if(seen > rank)
+            return BucketValue(i);
+    }
+
+    return BucketValue((std::uint32_t)mCounts.size() - 1);
+}
+
+std::uint32_t QuantileSketch::BucketIndex(double value)const
+{
+    if(!(value > mMinValue))
+        return 0;
+
+    double index = std::ceil(std::log(value / mMinValue) / mLogGamma);
+    double last = (double)(mCounts.size() - 1);
+    return (std::uint32_t)(index < last ? index : last);
+}
+
+double QuantileSketch::BucketValue(std::uint32_t index)const
+{
+    if(index == 0)
+        return mMinValue;
+
+    // The point with equal relative distance to both bucket bounds.
+    return 2.0 * mMinValue * std::pow(mGamma, (double)index) / (mGamma + 1.0);
+}
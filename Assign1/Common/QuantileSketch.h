@@ -0,0 +1,52 @@
+//***************************************************************************************
+// QuantileSketch.h
+//
+// Approximate quantiles of a stream of non-negative values in fixed memory.  Values
+// are counted in logarithmically spaced buckets, so any quantile is returned to
+// within a fixed relative error whatever the distribution; 1% over 1 microsecond to
+// 100 seconds of milliseconds takes under a thousand counters.  Zero has a bucket of
+// its own and is returned exactly, so an idle timing reads 0 rather than minValue.
+//
+// Because a bucket is just a count, values can be removed as well as added, which
+// lets the sketch follow a sliding window (see FrameStats).
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class QuantileSketch
+{
+public:
+    // Values are kept to within relativeAccuracy between minValue and maxValue;
+    // smaller positive and larger ones are counted in the first and last buckets,
+    // and zero or less in the zero bucket.
+    explicit QuantileSketch(double relativeAccuracy = 0.01, double minValue = 1e-3, double maxValue = 1e5);
+
+    void Add(double value);
+
+    // value must have been added and not yet removed.
+    void Remove(double value);
+
+    void Clear();
+
+    // The value at quantile q in [0, 1]; 0 when the sketch is empty.
+    double Quantile(double q)const;
+
+    std::uint64_t Count()const { return mCount; }
+    std::uint32_t BucketCount()const { return (std::uint32_t)mCounts.size(); }
+
+private:
+    std::uint32_t BucketIndex(double value)const;
+    double BucketValue(std::uint32_t index)const;
+
+private:
+    double mGamma = 0.0;
+    double mLogGamma = 0.0;
+    double mMinValue = 0.0;
+
+    std::vector<std::uint64_t> mCounts;
+    std::uint64_t mZeroCount = 0;
+    std::uint64_t mCount = 0;
+};
@@ -0,0 +1,296 @@
+#include "RenderGraph.h"
+
+#include <sstream>
+#include <stdexcept>
+
+static const D3D12_RESOURCE_STATES ReadOnlyStates = D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ;
+
+// Read-only states can be combined; a resource in one of them can be read in any
+// of the combined ways without another transition.
+static bool IsReadOnlyState(D3D12_RESOURCE_STATES state)
+{
+    return state != D3D12_RESOURCE_STATE_COMMON && (state & ~ReadOnlyStates) == 0;
+}
+
+static std::string StateName(D3D12_RESOURCE_STATES state)
+{
+    static const struct { D3D12_RESOURCE_STATES State; const char* Name; } names[] =
+    {
+        { D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, "VERTEX_AND_CONSTANT_BUFFER" },
+        { D3D12_RESOURCE_STATE_INDEX_BUFFER, "INDEX_BUFFER" },
+        { D3D12_RESOURCE_STATE_RENDER_TARGET, "RENDER_TARGET" },
+        { D3D12_RESOURCE_STATE_UNORDERED_ACCESS, "UNORDERED_ACCESS" },
+        { D3D12_RESOURCE_STATE_DEPTH_WRITE, "DEPTH_WRITE" },
+        { D3D12_RESOURCE_STATE_DEPTH_READ, "DEPTH_READ" },
+        { D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, "NON_PIXEL_SHADER_RESOURCE" },
+        { D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, "PIXEL_SHADER_RESOURCE" },
+        { D3D12_RESOURCE_STATE_STREAM_OUT, "STREAM_OUT" },
+        { D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT, "INDIRECT_ARGUMENT" },
+        { D3D12_RESOURCE_STATE_COPY_DEST, "COPY_DEST" },
+        { D3D12_RESOURCE_STATE_COPY_SOURCE, "COPY_SOURCE" },
+        { D3D12_RESOURCE_STATE_RESOLVE_DEST, "RESOLVE_DEST" },
+        { D3D12_RESOURCE_STATE_RESOLVE_SOURCE, "RESOLVE_SOURCE" },
+    };
+
+    if(state == D3D12_RESOURCE_STATE_COMMON)
+        return "COMMON";
+
+    std::string name;
+    for(const auto& e : names)
+    {
+        if((state & e.State) == e.State)
+        {
+            if(!name.empty())
+                name += "|";
+            name += e.Name;
+        }
+    }
+    return name;
+}
+
+void RenderGraph::Reset()
+{
+    mResources.clear();
+    mPasses.clear();
+    mFinalBarriers.clear();
+    mCompiled = false;
+}
+
+RenderGraph::ResourceHandle RenderGraph::ImportResource(const std::string& name, ID3D12Resource* resource,
+    D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState, bool isOutput)
+{
+    Resource r;
+    r.Name = name;
+    r.D3DResource = resource;
+    r.InitialState = initialState;
+    r.FinalState = finalState;
+    r.IsOutput = isOutput;
+    mResources.push_back(r);
+    return (ResourceHandle)mResources.size() - 1;
+}
+
+RenderGraph::PassHandle RenderGraph::AddPass(const std::string& name, const ExecuteFunc& execute)
+{
+    Pass pass;
+    pass.Name = name;
+    pass.Execute = execute;
+    mPasses.push_back(pass);
+    return (PassHandle)mPasses.size() - 1;
+}
+
+void RenderGraph::Read(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state)
+{
+    AddAccess(pass, resource, state, false);
+}
+
+void RenderGraph::Write(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state)
+{
+    AddAccess(pass, resource, state, true);
+}
+
+void RenderGraph::AddAccess(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state, bool isWrite)
+{
+    if(pass >= mPasses.size() || resource >= mResources.size())
+        throw std::invalid_argument("RenderGraph: unknown pass or resource");
+
+    // A pass sees a resource in one state: reads combine, and a write needs the
+    // write state for everything.
+    for(Access& access : mPasses[pass].Accesses)
+    {
+        if(access.Resource != resource)
+            continue;
+
+        if(!access.IsWrite && !isWrite && IsReadOnlyState(access.State) && IsReadOnlyState(state))
+            access.State |= state;
+        else if(access.State != state)
+            throw std::invalid_argument("RenderGraph: pass " + mPasses[pass].Name + " needs " +
+                mResources[resource].Name + " in two states");
+
+        access.IsWrite = access.IsWrite || isWrite;
+        return;
+    }
+
+    Access access;
+    access.Resource = resource;
+    access.State = state;
+    access.IsWrite = isWrite;
+    mPasses[pass].Accesses.push_back(access);
+}
+
+void RenderGraph::Compile()
+{
+    mStats = Stats();
+    mStats.Passes = (UINT)mPasses.size();
+
+    // Walk back from the outputs.  A pass is needed if it writes something that is
+    // needed, and then everything it reads is needed too.  Earlier writers of a
+    // needed resource stay needed, since a later pass may only add to it.
+    std::vector<bool> needed(mResources.size(), false);
+    for(size_t i = 0; i < mResources.size(); ++i)
+        needed[i] = mResources[i].IsOutput;
+
+    for(size_t p = mPasses.size(); p-- > 0; )
+    {
+        Pass& pass = mPasses[p];
+        pass.Culled = true;
+        for(const Access& access : pass.Accesses)
+        {
+            if(access.IsWrite && needed[access.Resource])
+                pass.Culled = false;
+        }
+
+        if(pass.Culled)
+        {
+            mStats.CulledPasses++;
+            continue;
+        }
+
+        for(const Access& access : pass.Accesses)
+            needed[access.Resource] = true;
+    }
+
+    // Track each resource's state through the surviving passes.
+    std::vector<D3D12_RESOURCE_STATES> states(mResources.size());
+    for(size_t i = 0; i < mResources.size(); ++i)
+        states[i] = mResources[i].InitialState;
+
+    for(Pass& pass : mPasses)
+    {
+        pass.Barriers.clear();
+        if(pass.Culled)
+            continue;
+
+        for(const Access& access : pass.Accesses)
+        {
+            D3D12_RESOURCE_STATES& current = states[access.Resource];
+
+            Transition transition;
+            transition.Resource = access.Resource;
+            transition.Before = current;
+            transition.After = access.State;
+
+            if(current == access.State)
+            {
+                // Back to back unordered access needs a UAV barrier instead.
+                if(access.State == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+                    pass.Barriers.push_back(transition);
+                continue;
+            }
+
+            if(!access.IsWrite && IsReadOnlyState(current) && (current & access.State) == access.State)
+                continue;
+
+            pass.Barriers.push_back(transition);
+            current = access.State;
+        }
+
+        mStats.Transitions += (UINT)pass.Barriers.size();
+        mStats.BarrierCalls += pass.Barriers.empty() ? 0 : 1;
+    }
+
+    mFinalBarriers.clear();
+    for(size_t i = 0; i < mResources.size(); ++i)
+    {
+        if(states[i] != mResources[i].FinalState)
+        {
+            Transition transition;
+            transition.Resource = (ResourceHandle)i;
+            transition.Before = states[i];
+            transition.After = mResources[i].FinalState;
+            mFinalBarriers.push_back(transition);
+        }
+    }
+
+    mStats.Transitions += (UINT)mFinalBarriers.size();
+    mStats.BarrierCalls += mFinalBarriers.empty() ? 0 : 1;
+
+    mCompiled = true;
+}
+
+void RenderGraph::Execute(CommandRecorder* cmdList)
+{
+    if(!mCompiled)
+        Compile();
+
+    for(const Pass& pass : mPasses)
+    {
+        if(pass.Culled)
+            continue;
+
+        RecordBarriers(cmdList, pass.Barriers);
+        pass.Execute(cmdList);
+    }
+
+    RecordBarriers(cmdList, mFinalBarriers);
+}
+
+void RenderGraph::RecordBarriers(CommandRecorder* cmdList, const std::vector<Transition>& transitions)const
+{
+    if(transitions.empty())
+        return;
+
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    barriers.reserve(transitions.size());
+    for(const Transition& t : transitions)
+    {
+        // Built by hand rather than with d3dx12.h, so the graph builds without it.
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+        if(t.Before == t.After)
+        {
+            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+            barrier.UAV.pResource = mResources[t.Resource].D3DResource;
+        }
+        else
+        {
+            barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+            barrier.Transition.pResource = mResources[t.Resource].D3DResource;
+            barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+            barrier.Transition.StateBefore = t.Before;
+            barrier.Transition.StateAfter = t.After;
+        }
+        barriers.push_back(barrier);
+    }
+
+    cmdList->ResourceBarrier((UINT)barriers.size(), barriers.data());
+}
+
+std::string RenderGraph::DumpSchedule()const
+{
+    std::ostringstream out;
+
+    auto dumpBarriers = [&](const std::vector<Transition>& transitions)
+    {
+        for(const Transition& t : transitions)
+        {
+            out << "    barrier " << mResources[t.Resource].Name << " ";
+            if(t.Before == t.After)
+                out << "UAV\n";
+            else
+                out << StateName(t.Before) << " -> " << StateName(t.After) << "\n";
+        }
+    };
+
+    for(size_t p = 0; p < mPasses.size(); ++p)
+    {
+        const Pass& pass = mPasses[p];
+        if(pass.Culled)
+        {
+            out << "pass " << p << " " << pass.Name << " (culled)\n";
+            continue;
+        }
+
+        dumpBarriers(pass.Barriers);
+        out << "pass " << p << " " << pass.Name << "\n";
+        for(const Access& access : pass.Accesses)
+        {
+            out << "    " << (access.IsWrite ? "write " : "read ") << mResources[access.Resource].Name <<
+                " " << StateName(access.State) << "\n";
+        }
+    }
+
+    out << "end\n";
+    dumpBarriers(mFinalBarriers);
+
+    return out.str();
+}
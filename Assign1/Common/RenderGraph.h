@@ -0,0 +1,114 @@
+//***************************************************************************************
+// RenderGraph.h
+//
+// Frame graph of render passes.  Each pass declares the resources it reads and writes
+// and the state it needs them in; its commands are recorded by a callback.  Compile
+// drops passes whose results nothing uses, and works out the state transitions
+// between the remaining passes, gathering all the transitions a pass needs into one
+// ResourceBarrier call.  Imported resources are returned to their final state at the
+// end of the graph.
+//
+// The graph is rebuilt every frame: Reset, declare the passes, Compile, Execute.  The
+// compiled schedule is plain data and can be dumped as text without a device.
+//***************************************************************************************
+
+#pragma once
+
+#include "CommandRecorder.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class RenderGraph
+{
+public:
+    typedef UINT ResourceHandle;
+    typedef UINT PassHandle;
+    static const UINT InvalidHandle = 0xffffffff;
+
+    typedef std::function<void(CommandRecorder* cmdList)> ExecuteFunc;
+
+    struct Stats
+    {
+        UINT Passes = 0;
+        UINT CulledPasses = 0;
+        UINT Transitions = 0;
+        UINT BarrierCalls = 0;
+    };
+
+    RenderGraph() = default;
+    RenderGraph(const RenderGraph& rhs) = delete;
+    RenderGraph& operator=(const RenderGraph& rhs) = delete;
+
+    // Removes all passes and resources.
+    void Reset();
+
+    // Adds a resource that lives outside the graph.  It is in initialState when the
+    // graph starts and is left in finalState.  Passes that write an output resource
+    // are never culled.
+    ResourceHandle ImportResource(const std::string& name, ID3D12Resource* resource,
+        D3D12_RESOURCE_STATES initialState, D3D12_RESOURCE_STATES finalState, bool isOutput);
+
+    // Passes run in the order they are added.  Read and Write throw
+    // std::invalid_argument for an unknown handle or conflicting accesses.
+    PassHandle AddPass(const std::string& name, const ExecuteFunc& execute);
+    void Read(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state);
+    void Write(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state);
+
+    void Compile();
+
+    // Records the barriers and the commands of every pass that was not culled.
+    void Execute(CommandRecorder* cmdList);
+
+    // The compiled schedule, one line per pass and barrier.
+    std::string DumpSchedule()const;
+
+    const Stats& GetStats()const { return mStats; }
+
+private:
+    struct Resource
+    {
+        std::string Name;
+        ID3D12Resource* D3DResource = nullptr;
+        D3D12_RESOURCE_STATES InitialState = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_RESOURCE_STATES FinalState = D3D12_RESOURCE_STATE_COMMON;
+        bool IsOutput = false;
+    };
+
+    struct Access
+    {
+        ResourceHandle Resource = InvalidHandle;
+        D3D12_RESOURCE_STATES State = D3D12_RESOURCE_STATE_COMMON;
+        bool IsWrite = false;
+    };
+
+    struct Transition
+    {
+        ResourceHandle Resource = InvalidHandle;
+        D3D12_RESOURCE_STATES Before = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_RESOURCE_STATES After = D3D12_RESOURCE_STATE_COMMON;
+    };
+
+    struct Pass
+    {
+        std::string Name;
+        ExecuteFunc Execute;
+        std::vector<Access> Accesses;
+
+        // Filled in by Compile.
+        bool Culled = false;
+        std::vector<Transition> Barriers;   // Issued before the pass.
+    };
+
+    void AddAccess(PassHandle pass, ResourceHandle resource, D3D12_RESOURCE_STATES state, bool isWrite);
+    void RecordBarriers(CommandRecorder* cmdList, const std::vector<Transition>& transitions)const;
+
+private:
+    std::vector<Resource> mResources;
+    std::vector<Pass> mPasses;
+    std::vector<Transition> mFinalBarriers;
+    bool mCompiled = false;
+
+    Stats mStats;
+};
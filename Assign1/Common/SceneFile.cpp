@@ -0,0 +1,283 @@
+#include "SceneFile.h"
+#include "FileUtil.h"
+
+using namespace DirectX;
+
+static const UINT SceneMagic = 0x424E4353;   // "SCNB"
+static const UINT SceneVersion = 2;
+
+static void SceneSyntaxError(const std::wstring& textFile, UINT lineNumber)
+{
+    std::wstring text = textFile + L"(" + std::to_wstring(lineNumber) + L"): scene syntax error\n";
+    ::OutputDebugString(text.c_str());
+    ThrowIfFailed(E_INVALIDARG);
+}
+
+bool SceneFile::Load(const std::wstring& filename)
+{
+    if(GetFileAttributesW(filename.c_str()) == INVALID_FILE_ATTRIBUTES)
+        return false;
+
+    mData = d3dUtil::LoadBinary(filename);
+    const BYTE* data = reinterpret_cast<const BYTE*>(mData->GetBufferPointer());
+    const UINT64 fileSize = mData->GetBufferSize();
+
+    if(fileSize < sizeof(Header))
+        return false;
+
+    memcpy(&mHeader, data, sizeof(Header));
+    if(mHeader.Magic != SceneMagic || mHeader.Version != SceneVersion)
+        return false;
+
+    UINT64 offset = sizeof(Header);
+    auto table = [&](UINT64 byteSize) { const BYTE* p = data + offset; offset += byteSize; return p; };
+
+    const UINT64 expectedSize = sizeof(Header) +
+        (UINT64)mHeader.TransformCount*sizeof(XMFLOAT4X4) +
+        (UINT64)mHeader.NodeCount*sizeof(Node) +
+        (UINT64)mHeader.ItemCount*sizeof(Item) +
+        (UINT64)mHeader.GeometryCount*sizeof(GeometryRef) +
+        (UINT64)mHeader.MaterialCount*sizeof(UINT) +
+        mHeader.StringBytes;
+    if(fileSize < expectedSize || mHeader.StringBytes == 0)
+        return false;
+
+    mTransforms = reinterpret_cast<const XMFLOAT4X4*>(table((UINT64)mHeader.TransformCount*sizeof(XMFLOAT4X4)));
+    mNodes = reinterpret_cast<const Node*>(table((UINT64)mHeader.NodeCount*sizeof(Node)));
+    mItems = reinterpret_cast<const Item*>(table((UINT64)mHeader.ItemCount*sizeof(Item)));
+    mGeometries = reinterpret_cast<const GeometryRef*>(table((UINT64)mHeader.GeometryCount*sizeof(GeometryRef)));
+    mMaterials = reinterpret_cast<const UINT*>(table((UINT64)mHeader.MaterialCount*sizeof(UINT)));
+    mStrings = reinterpret_cast<const char*>(table(mHeader.StringBytes));
+
+    // Check every reference once here so the tables can be indexed without checks.
+    if(mStrings[mHeader.StringBytes - 1] != '\0')
+        return false;
+
+    for(UINT i = 0; i < mHeader.NodeCount; ++i)
+    {
+        if((mNodes[i].Parent != InvalidIndex && mNodes[i].Parent >= i) ||
+           mNodes[i].Transform >= mHeader.TransformCount)
+            return false;
+    }
+
+    for(UINT i = 0; i < mHeader.ItemCount; ++i)
+    {
+        const Item& item = mItems[i];
+        if((item.Parent != InvalidIndex && item.Parent >= mHeader.NodeCount) ||
+           item.Transform >= mHeader.TransformCount || item.TexTransform >= mHeader.TransformCount ||
+           item.Geometry >= mHeader.GeometryCount || item.Material >= mHeader.MaterialCount)
+            return false;
+    }
+
+    for(UINT i = 0; i < mHeader.GeometryCount; ++i)
+    {
+        if(mGeometries[i].GeometryName >= mHeader.StringBytes || mGeometries[i].SubmeshName >= mHeader.StringBytes)
+            return false;
+    }
+
+    for(UINT i = 0; i < mHeader.MaterialCount; ++i)
+    {
+        if(mMaterials[i] >= mHeader.StringBytes)
+            return false;
+    }
+
+    return true;
+}
+
+void SceneFile::ConvertText(const std::wstring& textFile, const std::wstring& binaryFile)
+{
+    std::ifstream fin(textFile);
+    if(!fin)
+        ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND));
+
+    std::vector<XMFLOAT4X4> transforms;
+    std::vector<Node> nodes;
+    std::vector<Item> items;
+    std::vector<GeometryRef> geometries;
+    std::vector<UINT> materials;
+    std::string strings;
+
+    // Identical transforms, names and references are stored once.
+    std::unordered_map<std::string, UINT> transformIndex;
+    std::unordered_map<std::string, UINT> stringOffsets;
+    std::unordered_map<std::uint64_t, UINT> geometryIndex;
+    std::unordered_map<UINT, UINT> materialIndex;
+
+    auto internString = [&](const std::string& s)
+    {
+        auto it = stringOffsets.find(s);
+        if(it != stringOffsets.end())
+            return it->second;
+
+        UINT offset = (UINT)strings.size();
+        strings.append(s);
+        strings.push_back('\0');
+        stringOffsets[s] = offset;
+        return offset;
+    };
+
+    auto addTransform = [&](FXMMATRIX M)
+    {
+        XMFLOAT4X4 m;
+        XMStoreFloat4x4(&m, M);
+
+        std::string key(reinterpret_cast<const char*>(&m), sizeof(m));
+        auto it = transformIndex.find(key);
+        if(it != transformIndex.end())
+            return it->second;
+
+        UINT index = (UINT)transforms.size();
+        transforms.push_back(m);
+        transformIndex[key] = index;
+        return index;
+    };
+
+    std::string line;
+    UINT lineNumber = 0;
+    while(std::getline(fin, line))
+    {
+        ++lineNumber;
+
+        std::istringstream in(line.substr(0, line.find('#')));
+        std::string keyword;
+        if(!(in >> keyword))
+            continue;
+
+        const bool isItem = keyword == "item";
+        if(!isItem && keyword != "node")
+            SceneSyntaxError(textFile, lineNumber);
+
+        std::string parentText;
+        in >> parentText;
+        UINT parent = InvalidIndex;
+        if(parentText != "-")
+        {
+            char* end = nullptr;
+            unsigned long value = strtoul(parentText.c_str(), &end, 10);
+            if(parentText.empty() || *end != '\0' || value >= nodes.size())
+                SceneSyntaxError(textFile, lineNumber);
+            parent = (UINT)value;
+        }
+
+        Item item;
+        Node node;
+        if(isItem)
+        {
+            std::string geometryName, submeshName, materialName;
+            if(!(in >> geometryName >> submeshName >> materialName))
+                SceneSyntaxError(textFile, lineNumber);
+
+            GeometryRef geometry;
+            geometry.GeometryName = internString(geometryName);
+            geometry.SubmeshName = internString(submeshName);
+            std::uint64_t geometryKey = ((std::uint64_t)geometry.GeometryName << 32) | geometry.SubmeshName;
+            if(geometryIndex.find(geometryKey) == geometryIndex.end())
+            {
+                geometryIndex[geometryKey] = (UINT)geometries.size();
+                geometries.push_back(geometry);
+            }
+            item.Geometry = geometryIndex[geometryKey];
+
+            UINT materialName32 = internString(materialName);
+            if(materialIndex.find(materialName32) == materialIndex.end())
+            {
+                materialIndex[materialName32] = (UINT)materials.size();
+                materials.push_back(materialName32);
+            }
+            item.Material = materialIndex[materialName32];
+        }
+
+        XMMATRIX transform = XMMatrixIdentity();
+        XMMATRIX texTransform = XMMatrixIdentity();
+
+        std::string op;
+        while(in >> op)
+        {
+            if(isItem && op == "occluder")
+            {
+                item.Flags |= ItemOccluder;
+                continue;
+            }
+
+            if(isItem && op == "static")
+            {
+                item.Flags |= ItemStatic;
+                continue;
+            }
+
+            if(!isItem && op == "movable")
+            {
+                node.Flags |= NodeMovable;
+                continue;
+            }
+
+            float x, y, z;
+            if(!(in >> x >> y >> z))
+                SceneSyntaxError(textFile, lineNumber);
+
+            if(op == "scale")
+                transform = XMMatrixMultiply(transform, XMMatrixScaling(x, y, z));
+            else if(op == "rotate")
+                transform = XMMatrixMultiply(transform, XMMatrixRotationRollPitchYaw(
+                    XMConvertToRadians(x), XMConvertToRadians(y), XMConvertToRadians(z)));
+            else if(op == "translate")
+                transform = XMMatrixMultiply(transform, XMMatrixTranslation(x, y, z));
+            else if(isItem && op == "texscale")
+                texTransform = XMMatrixScaling(x, y, z);
+            else
+                SceneSyntaxError(textFile, lineNumber);
+        }
+
+        if(isItem)
+        {
+            item.Parent = parent;
+            item.Transform = addTransform(transform);
+            item.TexTransform = addTransform(texTransform);
+            items.push_back(item);
+        }
+        else
+        {
+            node.Parent = parent;
+            node.Transform = addTransform(transform);
+            nodes.push_back(node);
+        }
+    }
+
+    // The string table is never empty, so every offset in it is valid.
+    if(strings.empty())
+        strings.push_back('\0');
+
+    Header header;
+    header.Magic = SceneMagic;
+    header.Version = SceneVersion;
+    header.TransformCount = (UINT)transforms.size();
+    header.NodeCount = (UINT)nodes.size();
+    header.ItemCount = (UINT)items.size();
+    header.GeometryCount = (UINT)geometries.size();
+    header.MaterialCount = (UINT)materials.size();
+    header.StringBytes = (UINT)strings.size();
+
+    WriteFileAtomic(binaryFile, [&](std::ostream& fout)
+    {
+        fout.write((const char*)&header, sizeof(header));
+        fout.write((const char*)transforms.data(), transforms.size()*sizeof(XMFLOAT4X4));
+        fout.write((const char*)nodes.data(), nodes.size()*sizeof(Node));
+        fout.write((const char*)items.data(), items.size()*sizeof(Item));
+        fout.write((const char*)geometries.data(), geometries.size()*sizeof(GeometryRef));
+        fout.write((const char*)materials.data(), materials.size()*sizeof(UINT));
+        fout.write(strings.data(), strings.size());
+    });
+}
+
+bool SceneFile::IsOutOfDate(const std::wstring& textFile, const std::wstring& binaryFile)
+{
+    WIN32_FILE_ATTRIBUTE_DATA textInfo, binaryInfo;
+    if(!GetFileAttributesExW(binaryFile.c_str(), GetFileExInfoStandard, &binaryInfo))
+        return true;
+
+    // Without the text file the binary is all there is.
+    if(!GetFileAttributesExW(textFile.c_str(), GetFileExInfoStandard, &textInfo))
+        return false;
+
+    return CompareFileTime(&textInfo.ftLastWriteTime, &binaryInfo.ftLastWriteTime) > 0;
+}
@@ -0,0 +1,117 @@
+//***************************************************************************************
+// SceneFile.h
+//
+// Compact binary scene description.  A scene is a table of transforms, a table of
+// geometry (mesh and submesh name) and material references, a list of scene graph
+// nodes and a list of render items.  Nodes and items refer to the tables by index,
+// so names are resolved once per table entry at load time rather than once per
+// item.  The file is read with a single read and the tables are used in place.
+//
+// Scenes are written in a line-based text format and converted with ConvertText:
+//
+//   node <parent> [movable] [transform]
+//   item <parent> <geometry> <submesh> <material> [occluder] [static] [transform] [texscale x y z]
+//
+// where <parent> is the index of an earlier node or '-' for none, and a transform is
+// any sequence of "scale x y z", "rotate pitch yaw roll" (degrees) and
+// "translate x y z", applied in that order relative to the parent.  Static items
+// never move relative to their parent and may be merged with each other, unless a
+// node above them is movable: the application may move such nodes at run time, so
+// the items below them are kept separate.  '#' starts a comment.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class SceneFile
+{
+public:
+    static const UINT InvalidIndex = 0xffffffff;
+
+    enum ItemFlags : UINT
+    {
+        ItemOccluder = 0x1,
+        ItemStatic = 0x2,
+    };
+
+    enum NodeFlags : UINT
+    {
+        NodeMovable = 0x1,
+    };
+
+    struct Node
+    {
+        UINT Parent = InvalidIndex;   // Always an earlier node.
+        UINT Transform = 0;
+        UINT Flags = 0;
+    };
+
+    struct Item
+    {
+        UINT Parent = InvalidIndex;   // Node the item's transform is relative to.
+        UINT Transform = 0;
+        UINT TexTransform = 0;
+        UINT Geometry = 0;
+        UINT Material = 0;
+        UINT Flags = 0;
+    };
+
+    // Offsets into the string table.
+    struct GeometryRef
+    {
+        UINT GeometryName = 0;
+        UINT SubmeshName = 0;
+    };
+
+    SceneFile() = default;
+    SceneFile(const SceneFile& rhs) = delete;
+    SceneFile& operator=(const SceneFile& rhs) = delete;
+
+    // Returns false if the file is missing or not a valid scene.
+    bool Load(const std::wstring& filename);
+
+    // Parses a text scene and writes it in binary form.  Throws on a syntax error.
+    static void ConvertText(const std::wstring& textFile, const std::wstring& binaryFile);
+
+    // True if binaryFile is missing or older than textFile.
+    static bool IsOutOfDate(const std::wstring& textFile, const std::wstring& binaryFile);
+
+    UINT TransformCount()const { return mHeader.TransformCount; }
+    UINT NodeCount()const { return mHeader.NodeCount; }
+    UINT ItemCount()const { return mHeader.ItemCount; }
+    UINT GeometryCount()const { return mHeader.GeometryCount; }
+    UINT MaterialCount()const { return mHeader.MaterialCount; }
+
+    const DirectX::XMFLOAT4X4* Transforms()const { return mTransforms; }
+    const Node* Nodes()const { return mNodes; }
+    const Item* Items()const { return mItems; }
+    const GeometryRef* Geometries()const { return mGeometries; }
+    const UINT* Materials()const { return mMaterials; }   // Material name offsets.
+
+    const char* GetString(UINT offset)const { return mStrings + offset; }
+
+private:
+    struct Header
+    {
+        UINT Magic = 0;
+        UINT Version = 0;
+        UINT TransformCount = 0;
+        UINT NodeCount = 0;
+        UINT ItemCount = 0;
+        UINT GeometryCount = 0;
+        UINT MaterialCount = 0;
+        UINT StringBytes = 0;
+    };
+
+private:
+    Microsoft::WRL::ComPtr<ID3DBlob> mData = nullptr;
+    Header mHeader;
+
+    const DirectX::XMFLOAT4X4* mTransforms = nullptr;
+    const Node* mNodes = nullptr;
+    const Item* mItems = nullptr;
+    const GeometryRef* mGeometries = nullptr;
+    const UINT* mMaterials = nullptr;
+    const char* mStrings = nullptr;
+};
@@ -0,0 +1,148 @@
+#include "SceneGraph.h"
+
+using namespace DirectX;
+
+static const UINT NoSlot = 0xffffffff;
+
+SceneGraph::NodeHandle SceneGraph::CreateNode(NodeHandle parent, const XMFLOAT4X4& local)
+{
+    if(parent != InvalidNode && parent >= (NodeHandle)mSlotOfNode.size())
+        ThrowIfFailed(E_INVALIDARG);
+
+    const NodeHandle node = (NodeHandle)mSlotOfNode.size();
+    const UINT slot = (UINT)mLocal.size();
+    const UINT parentSlot = parent != InvalidNode ? mSlotOfNode[parent] : NoSlot;
+
+    mLocal.push_back(local);
+    mWorld.push_back(local);
+    mParentSlot.push_back(parentSlot);
+    mDepth.push_back(parentSlot != NoSlot ? mDepth[parentSlot] + 1 : 0);
+    mDirty.push_back(1);
+    mNodeOfSlot.push_back(node);
+    mSlotOfNode.push_back(slot);
+
+    // Appending keeps parents before children, but not the depth order.
+    if(slot > 0 && mDepth[slot] < mDepth[slot - 1])
+        mOrderDirty = true;
+
+    mFirstDirtySlot = MathHelper::Min(mFirstDirtySlot, slot);
+    mStats.NodeCount = (UINT)mSlotOfNode.size();
+
+    return node;
+}
+
+void SceneGraph::SetLocalTransform(NodeHandle node, const XMFLOAT4X4& local)
+{
+    const UINT slot = mSlotOfNode[node];
+    mLocal[slot] = local;
+    mDirty[slot] = 1;
+    mFirstDirtySlot = MathHelper::Min(mFirstDirtySlot, slot);
+}
+
+const XMFLOAT4X4& SceneGraph::GetLocalTransform(NodeHandle node)const
+{
+    return mLocal[mSlotOfNode[node]];
+}
+
+const XMFLOAT4X4& SceneGraph::GetWorldTransform(NodeHandle node)const
+{
+    return mWorld[mSlotOfNode[node]];
+}
+
+XMFLOAT4X4 SceneGraph::ComputeWorldTransform(NodeHandle node)const
+{
+    XMMATRIX world = XMMatrixIdentity();
+    for(UINT slot = mSlotOfNode[node]; slot != NoSlot; slot = mParentSlot[slot])
+        world = XMMatrixMultiply(world, XMLoadFloat4x4(&mLocal[slot]));
+
+    XMFLOAT4X4 result;
+    XMStoreFloat4x4(&result, world);
+    return result;
+}
+
+SceneGraph::NodeHandle SceneGraph::GetParent(NodeHandle node)const
+{
+    const UINT parentSlot = mParentSlot[mSlotOfNode[node]];
+    return parentSlot != NoSlot ? mNodeOfSlot[parentSlot] : InvalidNode;
+}
+
+const std::vector<SceneGraph::NodeHandle>& SceneGraph::Update()
+{
+    if(mOrderDirty)
+        SortByDepth();
+
+    mChangedNodes.clear();
+
+    // Slots before the first dirty one cannot change.  A slot is updated if it was
+    // set dirty or its parent was updated earlier in this pass.
+    const UINT slotCount = (UINT)mLocal.size();
+    for(UINT slot = mFirstDirtySlot; slot < slotCount; ++slot)
+    {
+        const UINT parentSlot = mParentSlot[slot];
+        if(parentSlot != NoSlot && mDirty[parentSlot])
+            mDirty[slot] = 1;
+
+        if(!mDirty[slot])
+            continue;
+
+        XMMATRIX world = XMLoadFloat4x4(&mLocal[slot]);
+        if(parentSlot != NoSlot)
+            world = XMMatrixMultiply(world, XMLoadFloat4x4(&mWorld[parentSlot]));
+        XMStoreFloat4x4(&mWorld[slot], world);
+
+        mChangedNodes.push_back(mNodeOfSlot[slot]);
+    }
+
+    for(NodeHandle node : mChangedNodes)
+        mDirty[mSlotOfNode[node]] = 0;
+
+    mFirstDirtySlot = slotCount;
+    mStats.UpdatedNodes = (UINT)mChangedNodes.size();
+
+    return mChangedNodes;
+}
+
+void SceneGraph::SortByDepth()
+{
+    const UINT slotCount = (UINT)mLocal.size();
+
+    // Stable, so siblings keep their creation order.
+    std::vector<UINT> order(slotCount);
+    for(UINT i = 0; i < slotCount; ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+        [this](UINT a, UINT b) { return mDepth[a] < mDepth[b]; });
+
+    std::vector<UINT> newSlotOf(slotCount);
+    for(UINT i = 0; i < slotCount; ++i)
+        newSlotOf[order[i]] = i;
+
+    std::vector<XMFLOAT4X4> local(slotCount), world(slotCount);
+    std::vector<UINT> parentSlot(slotCount), depth(slotCount);
+    std::vector<std::uint8_t> dirty(slotCount);
+    std::vector<NodeHandle> nodeOfSlot(slotCount);
+    mFirstDirtySlot = slotCount;
+    for(UINT i = 0; i < slotCount; ++i)
+    {
+        const UINT old = order[i];
+        local[i] = mLocal[old];
+        world[i] = mWorld[old];
+        parentSlot[i] = mParentSlot[old] != NoSlot ? newSlotOf[mParentSlot[old]] : NoSlot;
+        depth[i] = mDepth[old];
+        dirty[i] = mDirty[old];
+        nodeOfSlot[i] = mNodeOfSlot[old];
+        mSlotOfNode[nodeOfSlot[i]] = i;
+
+        if(dirty[i])
+            mFirstDirtySlot = MathHelper::Min(mFirstDirtySlot, i);
+    }
+
+    mLocal.swap(local);
+    mWorld.swap(world);
+    mParentSlot.swap(parentSlot);
+    mDepth.swap(depth);
+    mDirty.swap(dirty);
+    mNodeOfSlot.swap(nodeOfSlot);
+
+    mOrderDirty = false;
+}
@@ -0,0 +1,78 @@
+//***************************************************************************************
+// SceneGraph.h
+//
+// Transform hierarchy.  Each node has a local transform relative to its parent and a
+// world transform.  Nodes are kept in flat arrays sorted by depth, so every parent
+// is stored before its children and one forward pass computes world transforms.
+// Setting a local transform marks the node dirty; Update recomputes the world
+// transforms of dirty nodes and their descendants only, starting at the first dirty
+// slot, and reports which nodes changed.
+//
+// Transforms use the row-vector convention of the rest of the code:
+// world = local * parentWorld.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class SceneGraph
+{
+public:
+    typedef UINT NodeHandle;
+    static const NodeHandle InvalidNode = 0xffffffff;
+
+    struct Stats
+    {
+        UINT NodeCount = 0;
+        UINT UpdatedNodes = 0;   // On the last Update.
+    };
+
+    SceneGraph() = default;
+    SceneGraph(const SceneGraph& rhs) = delete;
+    SceneGraph& operator=(const SceneGraph& rhs) = delete;
+
+    // parent may be InvalidNode for a root.  The node starts out dirty.
+    NodeHandle CreateNode(NodeHandle parent, const DirectX::XMFLOAT4X4& local = MathHelper::Identity4x4());
+
+    void SetLocalTransform(NodeHandle node, const DirectX::XMFLOAT4X4& local);
+    const DirectX::XMFLOAT4X4& GetLocalTransform(NodeHandle node)const;
+
+    // As of the last Update.
+    const DirectX::XMFLOAT4X4& GetWorldTransform(NodeHandle node)const;
+
+    // Walks up the parents, so it is correct before Update too.  Not for per-frame use.
+    DirectX::XMFLOAT4X4 ComputeWorldTransform(NodeHandle node)const;
+
+    NodeHandle GetParent(NodeHandle node)const;
+    UINT NodeCount()const { return (UINT)mSlotOfNode.size(); }
+
+    // Recomputes the world transforms of dirty nodes and their descendants and
+    // returns the nodes whose world transform changed, parents before children.
+    const std::vector<NodeHandle>& Update();
+
+    const Stats& GetStats()const { return mStats; }
+
+private:
+    void SortByDepth();
+
+private:
+    // Indexed by slot, in depth order.
+    std::vector<DirectX::XMFLOAT4X4> mLocal;
+    std::vector<DirectX::XMFLOAT4X4> mWorld;
+    std::vector<UINT> mParentSlot;
+    std::vector<UINT> mDepth;
+    std::vector<std::uint8_t> mDirty;
+    std::vector<NodeHandle> mNodeOfSlot;
+
+    // Indexed by node handle.
+    std::vector<UINT> mSlotOfNode;
+
+    // Nodes created since the last sort are appended out of depth order.
+    bool mOrderDirty = false;
+    UINT mFirstDirtySlot = 0;
+
+    std::vector<NodeHandle> mChangedNodes;
+
+    Stats mStats;
+};
@@ -0,0 +1,161 @@
+#include "ShaderCache.h"
+#include "FileUtil.h"
+
+using Microsoft::WRL::ComPtr;
+
+static std::uint64_t HashString(const std::string& str, std::uint64_t hash)
+{
+    // Hash the terminator too so "ab"+"c" and "a"+"bc" differ.
+    return d3dUtil::HashBytes(str.c_str(), str.size() + 1, hash);
+}
+
+static std::wstring DirectoryOf(const std::wstring& filename)
+{
+    size_t slash = filename.find_last_of(L"\\/");
+    return slash == std::wstring::npos ? std::wstring() : filename.substr(0, slash + 1);
+}
+
+// Returns the file named by an #include directive on this line, or an empty string.
+static std::string ParseInclude(const std::string& line)
+{
+    size_t i = line.find_first_not_of(" \t");
+    if(i == std::string::npos || line[i] != '#')
+        return std::string();
+
+    i = line.find_first_not_of(" \t", i + 1);
+    if(i == std::string::npos || line.compare(i, 7, "include") != 0)
+        return std::string();
+
+    i = line.find_first_of("\"<", i + 7);
+    if(i == std::string::npos)
+        return std::string();
+
+    size_t end = line.find(line[i] == '"' ? '"' : '>', i + 1);
+    if(end == std::string::npos)
+        return std::string();
+
+    return line.substr(i + 1, end - i - 1);
+}
+
+ShaderCache::ShaderCache(const std::wstring& cacheDirectory) :
+    mCacheDirectory(cacheDirectory)
+{
+    if(!mCacheDirectory.empty() && mCacheDirectory.back() != L'\\' && mCacheDirectory.back() != L'/')
+        mCacheDirectory += L'\\';
+
+    // Fails harmlessly if the directory already exists.
+    CreateDirectoryW(mCacheDirectory.c_str(), nullptr);
+}
+
+ComPtr<ID3DBlob> ShaderCache::CompileShader(
+    const std::wstring& filename,
+    const D3D_SHADER_MACRO* defines,
+    const std::string& entrypoint,
+    const std::string& target,
+    UINT compileFlags)
+{
+    std::wstring cacheFile = CacheFilename(ComputeKey(filename, defines, entrypoint, target, compileFlags));
+
+    if(GetFileAttributesW(cacheFile.c_str()) != INVALID_FILE_ATTRIBUTES)
+    {
+        ComPtr<ID3DBlob> byteCode = d3dUtil::LoadBinary(cacheFile);
+
+        // An empty file is left behind if a previous run died while writing it.
+        if(byteCode->GetBufferSize() > 0)
+        {
+            std::lock_guard<std::mutex> lock(mStatsMutex);
+            mStats.Hits++;
+            mStats.BytesLoaded += byteCode->GetBufferSize();
+            return byteCode;
+        }
+    }
+
+    ComPtr<ID3DBlob> byteCode = d3dUtil::CompileShader(filename, defines, entrypoint, target, compileFlags);
+
+    {
+        std::lock_guard<std::mutex> lock(mStatsMutex);
+        mStats.Misses++;
+        mStats.BytesCompiled += byteCode->GetBufferSize();
+    }
+
+    // Failing to write only costs a recompile next time, so errors are ignored.
+    WriteFileAtomic(cacheFile, byteCode->GetBufferPointer(), byteCode->GetBufferSize());
+
+    return byteCode;
+}
+
+std::uint64_t ShaderCache::ComputeKey(
+    const std::wstring& filename,
+    const D3D_SHADER_MACRO* defines,
+    const std::string& entrypoint,
+    const std::string& target,
+    UINT compileFlags)
+{
+    // Bytecode from a different compiler version must not be reused.
+    UINT compilerVersion = D3D_COMPILER_VERSION;
+    std::uint64_t hash = d3dUtil::HashBytes(&compilerVersion, sizeof(compilerVersion));
+
+    std::vector<std::wstring> visited;
+    hash = HashSourceFile(filename, hash, visited);
+
+    for(const D3D_SHADER_MACRO* define = defines; define != nullptr && define->Name != nullptr; ++define)
+    {
+        hash = HashString(define->Name, hash);
+        hash = HashString(define->Definition != nullptr ? define->Definition : "", hash);
+    }
+
+    hash = HashString(entrypoint, hash);
+    hash = HashString(target, hash);
+    hash = d3dUtil::HashBytes(&compileFlags, sizeof(compileFlags), hash);
+
+    return hash;
+}
+
+std::uint64_t ShaderCache::HashSourceFile(const std::wstring& filename, std::uint64_t hash,
+    std::vector<std::wstring>& visited)
+{
+    // Headers are normally include-guarded, so each file only contributes once.
+    if(std::find(visited.begin(), visited.end(), filename) != visited.end())
+        return hash;
+    visited.push_back(filename);
+
+    hash = d3dUtil::HashBytes(filename.c_str(), (filename.size() + 1) * sizeof(wchar_t), hash);
+
+    std::ifstream fin(filename, std::ios::binary);
+    if(!fin)
+    {
+        // Nothing to hash; the compiler will report the missing file.
+        return hash;
+    }
+
+    std::string source((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+    hash = d3dUtil::HashBytes(source.data(), source.size(), hash);
+
+    // Includes resolve relative to the including file, like D3D_COMPILE_STANDARD_FILE_INCLUDE.
+    std::wstring directory = DirectoryOf(filename);
+
+    std::istringstream lines(source);
+    std::string line;
+    while(std::getline(lines, line))
+    {
+        std::string include = ParseInclude(line);
+        if(!include.empty())
+            hash = HashSourceFile(directory + AnsiToWString(include), hash, visited);
+    }
+
+    return hash;
+}
+
+ShaderCache::Stats ShaderCache::GetStats()const
+{
+    std::lock_guard<std::mutex> lock(mStatsMutex);
+    return mStats;
+}
+
+std::wstring ShaderCache::CacheFilename(std::uint64_t key)const
+{
+    wchar_t name[17];
+    swprintf_s(name, L"%016llx", (unsigned long long)key);
+
+    return mCacheDirectory + name + L".cso";
+}
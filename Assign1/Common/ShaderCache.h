@@ -0,0 +1,63 @@
+//***************************************************************************************
+// ShaderCache.h
+//
+// Content-addressed cache of compiled shader bytecode on disk.  The key is a hash of
+// the shader source and every file it transitively #includes, the macro defines, the
+// entry point, the target profile and the compile flags.  A hit loads the bytecode
+// with d3dUtil::LoadBinary; a miss compiles with d3dUtil::CompileShader and writes
+// the result to the cache directory.  Editing any of the inputs changes the key, so
+// stale entries are never used; they are simply left behind.
+//
+// CompileShader may be called from several threads at once.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+#include <mutex>
+
+class ShaderCache
+{
+public:
+    struct Stats
+    {
+        UINT Hits = 0;
+        UINT Misses = 0;
+        UINT64 BytesLoaded = 0;     // Bytecode read from the cache.
+        UINT64 BytesCompiled = 0;   // Bytecode produced by the compiler.
+    };
+
+    explicit ShaderCache(const std::wstring& cacheDirectory = L"ShaderCache");
+    ShaderCache(const ShaderCache& rhs) = delete;
+    ShaderCache& operator=(const ShaderCache& rhs) = delete;
+
+    // Same contract as d3dUtil::CompileShader.
+    Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
+        const std::wstring& filename,
+        const D3D_SHADER_MACRO* defines,
+        const std::string& entrypoint,
+        const std::string& target,
+        UINT compileFlags = d3dUtil::DefaultShaderCompileFlags());
+
+    // The cache key for the given compile; also names the cache file.
+    static std::uint64_t ComputeKey(
+        const std::wstring& filename,
+        const D3D_SHADER_MACRO* defines,
+        const std::string& entrypoint,
+        const std::string& target,
+        UINT compileFlags);
+
+    const std::wstring& Directory()const { return mCacheDirectory; }
+    Stats GetStats()const;
+
+private:
+    static std::uint64_t HashSourceFile(const std::wstring& filename, std::uint64_t hash,
+        std::vector<std::wstring>& visited);
+    std::wstring CacheFilename(std::uint64_t key)const;
+
+private:
+    std::wstring mCacheDirectory;
+
+    mutable std::mutex mStatsMutex;
+    Stats mStats;
+};
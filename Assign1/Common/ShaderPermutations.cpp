@@ -0,0 +1,262 @@
+#include "ShaderPermutations.h"
+#include "ShaderCache.h"
+#include "FileUtil.h"
+#include "ThreadPool.h"
+
+using Microsoft::WRL::ComPtr;
+
+static const UINT ArchiveMagic = 0x41565053;   // "SPVA"
+static const UINT ArchiveVersion = 1;
+
+struct ArchiveHeader
+{
+    UINT Magic;
+    UINT Version;
+    std::uint64_t Key;
+    UINT AxisCount;
+    UINT VariantCount;
+};
+
+// Each variant table entry is AxisCount ints followed by the bytecode offset and size.
+static UINT TableEntrySize(UINT axisCount)
+{
+    return (axisCount + 2) * sizeof(UINT);
+}
+
+ShaderPermutations::ShaderPermutations(
+    const std::wstring& filename,
+    const std::string& entrypoint,
+    const std::string& target,
+    const D3D_SHADER_MACRO* baseDefines,
+    UINT compileFlags) :
+    mFilename(filename),
+    mEntrypoint(entrypoint),
+    mTarget(target),
+    mCompileFlags(compileFlags)
+{
+    for(const D3D_SHADER_MACRO* define = baseDefines; define != nullptr && define->Name != nullptr; ++define)
+        mBaseDefines.push_back({ define->Name, define->Definition != nullptr ? define->Definition : "" });
+}
+
+void ShaderPermutations::AddAxis(const std::string& define, std::vector<int> values)
+{
+    assert(!values.empty());
+    assert(mArchive == nullptr);
+
+    std::sort(values.begin(), values.end());
+    values.erase(std::unique(values.begin(), values.end()), values.end());
+
+    mAxes.push_back({ define, std::move(values) });
+}
+
+UINT ShaderPermutations::VariantCount()const
+{
+    UINT count = 1;
+    for(auto& axis : mAxes)
+        count *= (UINT)axis.Values.size();
+
+    return count;
+}
+
+void ShaderPermutations::Build(ThreadPool& pool, ShaderCache* cache)
+{
+    const UINT variantCount = VariantCount();
+    std::vector<ComPtr<ID3DBlob>> byteCode(variantCount);
+
+    pool.ParallelFor(variantCount, [&](UINT i)
+    {
+        std::vector<std::string> storage;
+        std::vector<D3D_SHADER_MACRO> defines = BuildDefines(EnumerateValues(i), storage);
+
+        byteCode[i] = cache != nullptr ?
+            cache->CompileShader(mFilename, defines.data(), mEntrypoint, mTarget, mCompileFlags) :
+            d3dUtil::CompileShader(mFilename, defines.data(), mEntrypoint, mTarget, mCompileFlags);
+    });
+
+    // Pack the header, the variant table and the bytecode into one blob.
+    const UINT axisCount = (UINT)mAxes.size();
+    UINT archiveSize = sizeof(ArchiveHeader) + variantCount * TableEntrySize(axisCount);
+
+    mVariants.resize(variantCount);
+    for(UINT i = 0; i < variantCount; ++i)
+    {
+        mVariants[i].Values = EnumerateValues(i);
+        mVariants[i].Offset = archiveSize;
+        mVariants[i].Size = (UINT)byteCode[i]->GetBufferSize();
+
+        // Bytecode is a stream of DWORDs; keep every variant 4-byte aligned.
+        archiveSize += (mVariants[i].Size + 3) & ~3u;
+    }
+
+    ThrowIfFailed(D3DCreateBlob(archiveSize, mArchive.ReleaseAndGetAddressOf()));
+    BYTE* data = reinterpret_cast<BYTE*>(mArchive->GetBufferPointer());
+    ZeroMemory(data, archiveSize);
+
+    ArchiveHeader header;
+    header.Magic = ArchiveMagic;
+    header.Version = ArchiveVersion;
+    header.Key = ComputeArchiveKey();
+    header.AxisCount = axisCount;
+    header.VariantCount = variantCount;
+    memcpy(data, &header, sizeof(header));
+
+    UINT* table = reinterpret_cast<UINT*>(data + sizeof(ArchiveHeader));
+    for(UINT i = 0; i < variantCount; ++i)
+    {
+        for(UINT a = 0; a < axisCount; ++a)
+            *table++ = (UINT)mVariants[i].Values[a];
+        *table++ = mVariants[i].Offset;
+        *table++ = mVariants[i].Size;
+
+        memcpy(data + mVariants[i].Offset, byteCode[i]->GetBufferPointer(), mVariants[i].Size);
+    }
+}
+
+bool ShaderPermutations::LoadArchive(const std::wstring& filename)
+{
+    if(GetFileAttributesW(filename.c_str()) == INVALID_FILE_ATTRIBUTES)
+        return false;
+
+    ComPtr<ID3DBlob> archive = d3dUtil::LoadBinary(filename);
+    const BYTE* data = reinterpret_cast<const BYTE*>(archive->GetBufferPointer());
+    const UINT archiveSize = (UINT)archive->GetBufferSize();
+
+    if(archiveSize < sizeof(ArchiveHeader))
+        return false;
+
+    ArchiveHeader header;
+    memcpy(&header, data, sizeof(header));
+
+    const UINT axisCount = (UINT)mAxes.size();
+    const UINT variantCount = VariantCount();
+
+    if(header.Magic != ArchiveMagic || header.Version != ArchiveVersion ||
+       header.AxisCount != axisCount || header.VariantCount != variantCount ||
+       header.Key != ComputeArchiveKey())
+    {
+        return false;
+    }
+
+    if(archiveSize < sizeof(ArchiveHeader) + variantCount * TableEntrySize(axisCount))
+        return false;
+
+    std::vector<Variant> variants(variantCount);
+    const UINT* table = reinterpret_cast<const UINT*>(data + sizeof(ArchiveHeader));
+    for(UINT i = 0; i < variantCount; ++i)
+    {
+        variants[i].Values.resize(axisCount);
+        for(UINT a = 0; a < axisCount; ++a)
+            variants[i].Values[a] = (int)*table++;
+        variants[i].Offset = *table++;
+        variants[i].Size = *table++;
+
+        if(variants[i].Offset > archiveSize || variants[i].Size > archiveSize - variants[i].Offset)
+            return false;
+    }
+
+    mArchive = archive;
+    mVariants = std::move(variants);
+
+    return true;
+}
+
+void ShaderPermutations::SaveArchive(const std::wstring& filename)const
+{
+    assert(mArchive != nullptr);
+
+    // A failed write only costs a rebuild next time.
+    WriteFileAtomic(filename, mArchive->GetBufferPointer(), mArchive->GetBufferSize());
+}
+
+int ShaderPermutations::FindVariant(const std::vector<int>& required)const
+{
+    assert(required.size() == mAxes.size());
+
+    int best = InvalidVariant;
+    int bestCost = INT_MAX;
+
+    for(int i = 0; i < (int)mVariants.size(); ++i)
+    {
+        const std::vector<int>& values = mVariants[i].Values;
+
+        bool covers = true;
+        int cost = 0;
+        for(size_t a = 0; a < values.size(); ++a)
+        {
+            covers = covers && values[a] >= required[a];
+            cost += values[a];
+        }
+
+        if(covers && cost < bestCost)
+        {
+            best = i;
+            bestCost = cost;
+        }
+    }
+
+    return best;
+}
+
+D3D12_SHADER_BYTECODE ShaderPermutations::GetBytecode(int variant)const
+{
+    assert(variant >= 0 && variant < (int)mVariants.size());
+
+    const BYTE* data = reinterpret_cast<const BYTE*>(mArchive->GetBufferPointer());
+    return { data + mVariants[variant].Offset, mVariants[variant].Size };
+}
+
+const std::vector<int>& ShaderPermutations::GetVariantValues(int variant)const
+{
+    assert(variant >= 0 && variant < (int)mVariants.size());
+    return mVariants[variant].Values;
+}
+
+std::vector<int> ShaderPermutations::EnumerateValues(UINT index)const
+{
+    // The last axis varies fastest.
+    std::vector<int> values(mAxes.size());
+    for(size_t a = mAxes.size(); a-- > 0; )
+    {
+        UINT valueCount = (UINT)mAxes[a].Values.size();
+        values[a] = mAxes[a].Values[index % valueCount];
+        index /= valueCount;
+    }
+
+    return values;
+}
+
+std::vector<D3D_SHADER_MACRO> ShaderPermutations::BuildDefines(const std::vector<int>& values,
+    std::vector<std::string>& storage)const
+{
+    // Fill storage first; the macros point into it.
+    storage.clear();
+    storage.reserve(values.size());
+    for(int value : values)
+        storage.push_back(std::to_string(value));
+
+    std::vector<D3D_SHADER_MACRO> defines;
+    for(auto& define : mBaseDefines)
+        defines.push_back({ define.first.c_str(), define.second.c_str() });
+    for(size_t a = 0; a < mAxes.size(); ++a)
+        defines.push_back({ mAxes[a].Define.c_str(), storage[a].c_str() });
+    defines.push_back({ nullptr, nullptr });
+
+    return defines;
+}
+
+std::uint64_t ShaderPermutations::ComputeArchiveKey()const
+{
+    // Combines the shader cache key of every variant, so the archive goes stale
+    // whenever any of them would be recompiled.
+    std::uint64_t hash = d3dUtil::HashBytes(&ArchiveVersion, sizeof(ArchiveVersion));
+
+    std::vector<std::string> storage;
+    for(UINT i = 0; i < VariantCount(); ++i)
+    {
+        std::vector<D3D_SHADER_MACRO> defines = BuildDefines(EnumerateValues(i), storage);
+        std::uint64_t key = ShaderCache::ComputeKey(mFilename, defines.data(), mEntrypoint, mTarget, mCompileFlags);
+        hash = d3dUtil::HashBytes(&key, sizeof(key), hash);
+    }
+
+    return hash;
+}
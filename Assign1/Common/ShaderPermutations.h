@@ -0,0 +1,85 @@
+//***************************************************************************************
+// ShaderPermutations.h
+//
+// Compiles every combination of a set of declared integer defines (for example the
+// NUM_DIR_LIGHTS/NUM_POINT_LIGHTS/NUM_SPOT_LIGHTS counts of Default.hlsl) for one
+// shader entry point.  The variants are compiled concurrently on a ThreadPool and
+// packed into a single archive blob that can be saved and reloaded as one file, so a
+// warm start is one file read.  At runtime FindVariant picks the variant with the
+// fewest slots that still covers the requested values.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class ShaderCache;
+class ThreadPool;
+
+class ShaderPermutations
+{
+public:
+    static const int InvalidVariant = -1;
+
+    ShaderPermutations(
+        const std::wstring& filename,
+        const std::string& entrypoint,
+        const std::string& target,
+        const D3D_SHADER_MACRO* baseDefines = nullptr,
+        UINT compileFlags = d3dUtil::DefaultShaderCompileFlags());
+    ShaderPermutations(const ShaderPermutations& rhs) = delete;
+    ShaderPermutations& operator=(const ShaderPermutations& rhs) = delete;
+
+    // Declares a define and the values it is compiled with.  Axes must be declared
+    // before Build or LoadArchive.
+    void AddAxis(const std::string& define, std::vector<int> values);
+
+    UINT VariantCount()const;
+
+    // Compiles all variants on pool, through cache when one is given, and packs them.
+    void Build(ThreadPool& pool, ShaderCache* cache = nullptr);
+
+    // Loads a previously saved archive.  Returns false if the file is missing or
+    // was built from different sources, defines or settings.
+    bool LoadArchive(const std::wstring& filename);
+    void SaveArchive(const std::wstring& filename)const;
+
+    // Returns the variant whose value on every axis is at least required[axis],
+    // with the smallest sum of values, or InvalidVariant if none covers it.
+    int FindVariant(const std::vector<int>& required)const;
+
+    D3D12_SHADER_BYTECODE GetBytecode(int variant)const;
+    const std::vector<int>& GetVariantValues(int variant)const;
+
+private:
+    struct Axis
+    {
+        std::string Define;
+        std::vector<int> Values;
+    };
+
+    struct Variant
+    {
+        std::vector<int> Values;
+        UINT Offset = 0;   // Bytecode location in the archive blob.
+        UINT Size = 0;
+    };
+
+    std::vector<int> EnumerateValues(UINT index)const;
+    std::vector<D3D_SHADER_MACRO> BuildDefines(const std::vector<int>& values,
+        std::vector<std::string>& storage)const;
+    std::uint64_t ComputeArchiveKey()const;
+
+private:
+    std::wstring mFilename;
+    std::string mEntrypoint;
+    std::string mTarget;
+    UINT mCompileFlags = 0;
+    std::vector<std::pair<std::string, std::string>> mBaseDefines;
+
+    std::vector<Axis> mAxes;
+
+    // Archive image: header, variant table and all bytecode back to back.
+    Microsoft::WRL::ComPtr<ID3DBlob> mArchive = nullptr;
+    std::vector<Variant> mVariants;
+};
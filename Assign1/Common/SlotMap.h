@@ -0,0 +1,170 @@
+//***************************************************************************************
+// SlotMap.h
+//
+// Contiguous storage addressed by stable handles.  The values live in one dense
+// array, so walking all of them touches no other memory.  A handle names a slot,
+// and the slot holds the value's current position in the dense array.  Removing a
+// value moves the last value into its place and bumps the slot's generation, so a
+// handle to a removed value can be detected and is never silently reused.
+//
+// A value may be bound to a NameRegistry id when it is inserted, so it can be found
+// by name once while loading.  The per-frame code should only use handles.
+//***************************************************************************************
+
+#pragma once
+
+#include "NameRegistry.h"
+
+struct SlotHandle
+{
+    UINT Index = 0xffffffff;
+    UINT Generation = 0;
+
+    bool operator==(const SlotHandle& rhs)const { return Index == rhs.Index && Generation == rhs.Generation; }
+    bool operator!=(const SlotHandle& rhs)const { return !(*this == rhs); }
+};
+
+template<typename T>
+class SlotMap
+{
+public:
+    typedef SlotHandle Handle;
+    typedef typename std::vector<T>::iterator iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    SlotMap() = default;
+    SlotMap(const SlotMap& rhs) = delete;
+    SlotMap& operator=(const SlotMap& rhs) = delete;
+
+    // name may be InvalidName for a value that is never looked up by name.
+    Handle Insert(T&& value, NameRegistry::NameId name = NameRegistry::InvalidName)
+    {
+        Handle handle;
+        if(!mFreeSlots.empty())
+        {
+            handle.Index = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        else
+        {
+            handle.Index = (UINT)mSlots.size();
+            mSlots.push_back(Slot());
+        }
+
+        Slot& slot = mSlots[handle.Index];
+        slot.Value = (UINT)mValues.size();
+        handle.Generation = slot.Generation;
+
+        mValues.push_back(std::move(value));
+        mValueSlots.push_back(handle.Index);
+        mValueNames.push_back(name);
+
+        if(name != NameRegistry::InvalidName)
+        {
+            if(name >= mByName.size())
+                mByName.resize(name + 1);
+            mByName[name] = handle;
+        }
+
+        return handle;
+    }
+
+    void Remove(Handle handle)
+    {
+        assert(IsValid(handle));
+
+        Slot& slot = mSlots[handle.Index];
+        const UINT value = slot.Value;
+        const UINT last = (UINT)mValues.size() - 1;
+
+        if(mValueNames[value] != NameRegistry::InvalidName)
+            mByName[mValueNames[value]] = Handle();
+
+        // Fill the hole with the last value so the array stays dense.
+        if(value != last)
+        {
+            mValues[value] = std::move(mValues[last]);
+            mValueSlots[value] = mValueSlots[last];
+            mValueNames[value] = mValueNames[last];
+            mSlots[mValueSlots[value]].Value = value;
+        }
+
+        mValues.pop_back();
+        mValueSlots.pop_back();
+        mValueNames.pop_back();
+
+        slot.Value = InvalidValue;
+        slot.Generation++;
+        mFreeSlots.push_back(handle.Index);
+    }
+
+    bool IsValid(Handle handle)const
+    {
+        return handle.Index < mSlots.size() &&
+            mSlots[handle.Index].Generation == handle.Generation &&
+            mSlots[handle.Index].Value != InvalidValue;
+    }
+
+    // Returns an invalid handle if nothing is bound to name.
+    Handle Find(NameRegistry::NameId name)const
+    {
+        return name < mByName.size() ? mByName[name] : Handle();
+    }
+
+    T& operator[](Handle handle)
+    {
+        assert(IsValid(handle));
+        return mValues[mSlots[handle.Index].Value];
+    }
+
+    const T& operator[](Handle handle)const
+    {
+        assert(IsValid(handle));
+        return mValues[mSlots[handle.Index].Value];
+    }
+
+    NameRegistry::NameId GetName(Handle handle)const { return mValueNames[mSlots[handle.Index].Value]; }
+
+    // Position of a value in the dense order, and the handle of the value at a position.
+    UINT IndexOf(Handle handle)const { assert(IsValid(handle)); return mSlots[handle.Index].Value; }
+    Handle HandleAt(UINT index)const
+    {
+        Handle handle;
+        handle.Index = mValueSlots[index];
+        handle.Generation = mSlots[handle.Index].Generation;
+        return handle;
+    }
+
+    UINT Size()const { return (UINT)mValues.size(); }
+
+    // Handle indexes are below SlotCount.  Slots are reused, so it only grows when
+    // more values are alive at once than ever before.
+    UINT SlotCount()const { return (UINT)mSlots.size(); }
+
+    T* Data() { return mValues.data(); }
+    const T* Data()const { return mValues.data(); }
+
+    // Values in dense order.  The order changes when a value is removed.
+    iterator begin() { return mValues.begin(); }
+    iterator end() { return mValues.end(); }
+    const_iterator begin()const { return mValues.begin(); }
+    const_iterator end()const { return mValues.end(); }
+
+private:
+    static const UINT InvalidValue = 0xffffffff;
+
+    struct Slot
+    {
+        UINT Value = InvalidValue;
+        UINT Generation = 0;
+    };
+
+    std::vector<T> mValues;
+    std::vector<UINT> mValueSlots;
+    std::vector<NameRegistry::NameId> mValueNames;
+
+    std::vector<Slot> mSlots;
+    std::vector<UINT> mFreeSlots;
+
+    std::vector<Handle> mByName;
+};
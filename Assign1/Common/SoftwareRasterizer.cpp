@@ -0,0 +1,507 @@
+#include "SoftwareRasterizer.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <stdexcept>
+
+using namespace DirectX;
+
+// Pixel coordinates are snapped to 1/256 of a pixel, like D3D's 8-bit subpixel precision.
+static const int SubPixelBits = 8;
+static const std::int64_t SubPixelScale = 1 << SubPixelBits;
+
+// Clip volume planes, inside where dot(plane, PosH) >= 0.  D3D clip space has
+// 0 <= z <= w.
+static const XMFLOAT4 ClipPlanes[] =
+{
+    {  0.0f,  0.0f,  1.0f, 0.0f },   // near
+    {  0.0f,  0.0f, -1.0f, 1.0f },   // far
+    {  1.0f,  0.0f,  0.0f, 1.0f },   // left
+    { -1.0f,  0.0f,  0.0f, 1.0f },   // right
+    {  0.0f,  1.0f,  0.0f, 1.0f },   // bottom
+    {  0.0f, -1.0f,  0.0f, 1.0f },   // top
+};
+
+// The position and normal every vertex starts with.
+static const std::int64_t VertexByteSize = 2*sizeof(XMFLOAT3);
+
+static const int MaxClippedVertices = 3 + sizeof(ClipPlanes) / sizeof(ClipPlanes[0]);
+
+static float PlaneDistance(const XMFLOAT4& plane, const XMFLOAT4& p)
+{
+    return plane.x*p.x + plane.y*p.y + plane.z*p.z + plane.w*p.w;
+}
+
+static XMFLOAT3 Lerp3(const XMFLOAT3& a, const XMFLOAT3& b, float t)
+{
+    return { a.x + (b.x - a.x)*t, a.y + (b.y - a.y)*t, a.z + (b.z - a.z)*t };
+}
+
+static std::uint32_t PackUnorm(float r, float g, float b, float a)
+{
+    auto toByte = [](float v) { return (std::uint32_t)(std::min<float>(std::max<float>(v, 0.0f), 1.0f)*255.0f + 0.5f); };
+    return toByte(r) | (toByte(g) << 8) | (toByte(b) << 16) | (toByte(a) << 24);
+}
+
+static void AddStats(SoftwareRasterizer::Stats& total, const SoftwareRasterizer::Stats& stats)
+{
+    total.Triangles += stats.Triangles;
+    total.CulledTriangles += stats.CulledTriangles;
+    total.ClippedTriangles += stats.ClippedTriangles;
+    total.BinnedTriangles += stats.BinnedTriangles;
+    total.PixelsTested += stats.PixelsTested;
+    total.PixelsShaded += stats.PixelsShaded;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(UINT width, UINT height, ThreadPool* pool, UINT tileSize) :
+    mThreadPool(pool),
+    mTileSize(tileSize)
+{
+    Resize(width, height);
+}
+
+void SoftwareRasterizer::Resize(UINT width, UINT height)
+{
+    mWidth = width;
+    mHeight = height;
+    mTileCountX = (width + mTileSize - 1) / mTileSize;
+    mTileCountY = (height + mTileSize - 1) / mTileSize;
+
+    mColor.assign((size_t)width*height, 0);
+    mDepth.assign((size_t)width*height, 1.0f);
+}
+
+void SoftwareRasterizer::Clear(const XMFLOAT4& color, float depth)
+{
+    std::fill(mColor.begin(), mColor.end(), PackUnorm(color.x, color.y, color.z, color.w));
+    std::fill(mDepth.begin(), mDepth.end(), depth);
+}
+
+void SoftwareRasterizer::Draw(const PassData& pass, const Light* lights, int numDir, int numPoint, int numSpot,
+    const std::vector<DrawCall>& draws)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point startTime = Clock::now();
+
+    for(const DrawCall& draw : draws)
+    {
+        const UINT indexSize = draw.IndexFormat == DXGI_FORMAT_R32_UINT ? 4 : 2;
+        if(draw.IndexFormat != DXGI_FORMAT_R32_UINT && draw.IndexFormat != DXGI_FORMAT_R16_UINT)
+            throw std::invalid_argument("SoftwareRasterizer: index format must be R16_UINT or R32_UINT");
+        if(((UINT64)draw.StartIndexLocation + draw.IndexCount)*indexSize > draw.IndexBufferByteSize)
+            throw std::invalid_argument("SoftwareRasterizer: draw reads past its index data");
+        if(draw.VertexByteStride < VertexByteSize)
+            throw std::invalid_argument("SoftwareRasterizer: vertex stride is smaller than a position and normal");
+    }
+
+    mPass = &pass;
+    mLights = lights;
+    mNumDirLights = numDir;
+    mNumPointLights = numPoint;
+    mNumSpotLights = numSpot;
+    mDraws = &draws;
+    mStats = Stats();
+
+    // The constants hold transposed matrices for the shader.
+    XMStoreFloat4x4(&mViewProj, XMMatrixTranspose(XMLoadFloat4x4(&pass.ViewProj)));
+    mWorlds.resize(draws.size());
+    for(size_t i = 0; i < draws.size(); ++i)
+        XMStoreFloat4x4(&mWorlds[i], XMMatrixTranspose(XMLoadFloat4x4(&draws[i].World)));
+
+    // Split the draws into batches.  The batch vectors keep their capacity from frame to frame.
+    const UINT batchIndices = MaxBatchTriangles*3;
+    size_t batchCount = 0;
+    for(UINT d = 0; d < (UINT)draws.size(); ++d)
+    {
+        const UINT indexCount = draws[d].IndexCount - draws[d].IndexCount % 3;
+        for(UINT first = 0; first < indexCount; first += batchIndices)
+        {
+            if(batchCount == mBatches.size())
+                mBatches.emplace_back();
+
+            Batch& batch = mBatches[batchCount++];
+            batch.Draw = d;
+            batch.FirstIndex = draws[d].StartIndexLocation + first;
+            batch.IndexCount = std::min<UINT>(batchIndices, indexCount - first);
+        }
+    }
+    mBatches.resize(batchCount);
+
+    if(mThreadPool != nullptr)
+        mThreadPool->ParallelFor((UINT)mBatches.size(), [this](UINT i) { SetupBatch(mBatches[i]); });
+    else
+    {
+        for(Batch& batch : mBatches)
+            SetupBatch(batch);
+    }
+
+    for(const Batch& batch : mBatches)
+        AddStats(mStats, batch.BatchStats);
+
+    const Clock::time_point setupTime = Clock::now();
+
+    const UINT tileCount = mTileCountX*mTileCountY;
+    mTileStats.assign(tileCount, Stats());
+    if(mThreadPool != nullptr)
+        mThreadPool->ParallelFor(tileCount, [this](UINT tile) { RasterizeTile(tile, mTileStats[tile]); });
+    else
+    {
+        for(UINT tile = 0; tile < tileCount; ++tile)
+            RasterizeTile(tile, mTileStats[tile]);
+    }
+
+    for(const Stats& stats : mTileStats)
+        AddStats(mStats, stats);
+
+    const Clock::time_point endTime = Clock::now();
+    mStats.SetupMilliseconds = std::chrono::duration<double, std::milli>(setupTime - startTime).count();
+    mStats.RasterMilliseconds = std::chrono::duration<double, std::milli>(endTime - setupTime).count();
+
+    mPass = nullptr;
+    mLights = nullptr;
+    mDraws = nullptr;
+}
+
+std::uint64_t SoftwareRasterizer::ColorHash()const
+{
+    // FNV-1a, as d3dUtil::HashBytes, which is not available without windows.h.
+    const BYTE* bytes = reinterpret_cast<const BYTE*>(mColor.data());
+    std::uint64_t hash = 14695981039346656037ull;
+    for(size_t i = 0; i < mColor.size()*sizeof(std::uint32_t); ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void SoftwareRasterizer::SetupBatch(Batch& batch)
+{
+    const DrawCall& draw = (*mDraws)[batch.Draw];
+
+    batch.Triangles.clear();
+    batch.BatchStats = Stats();
+
+    const BYTE* indexData = reinterpret_cast<const BYTE*>(draw.IndexData);
+    const bool index32 = draw.IndexFormat == DXGI_FORMAT_R32_UINT;
+    auto getIndex = [indexData, index32](UINT i) -> UINT
+    {
+        return index32 ? reinterpret_cast<const std::uint32_t*>(indexData)[i] :
+                         reinterpret_cast<const std::uint16_t*>(indexData)[i];
+    };
+
+    // Run the vertex shader once for each vertex the batch references.
+    UINT minIndex = UINT_MAX;
+    UINT maxIndex = 0;
+    for(UINT i = batch.FirstIndex; i < batch.FirstIndex + batch.IndexCount; ++i)
+    {
+        UINT index = getIndex(i);
+        minIndex = std::min<UINT>(minIndex, index);
+        maxIndex = std::max<UINT>(maxIndex, index);
+    }
+
+    // Draw checked the indices; the vertices they pick are checked here.
+    const std::int64_t firstVertex = (std::int64_t)draw.BaseVertexLocation + minIndex;
+    const std::int64_t lastVertex = (std::int64_t)draw.BaseVertexLocation + maxIndex;
+    if(firstVertex < 0 || lastVertex*draw.VertexByteStride + VertexByteSize > draw.VertexBufferByteSize)
+        throw std::invalid_argument("SoftwareRasterizer: draw reads past its vertex data");
+
+    const BYTE* vertexData = reinterpret_cast<const BYTE*>(draw.VertexData);
+    XMMATRIX world = XMLoadFloat4x4(&mWorlds[batch.Draw]);
+    XMMATRIX viewProj = XMLoadFloat4x4(&mViewProj);
+
+    std::vector<ClipVertex> vertices(maxIndex - minIndex + 1);
+    for(UINT i = 0; i < (UINT)vertices.size(); ++i)
+    {
+        const XMFLOAT3* vin = reinterpret_cast<const XMFLOAT3*>(
+            vertexData + (size_t)(firstVertex + i)*draw.VertexByteStride);
+
+        // Assumes nonuniform scaling, as the shader does.
+        XMVECTOR posW = XMVector3TransformCoord(XMLoadFloat3(&vin[0]), world);
+        XMStoreFloat3(&vertices[i].PosW, posW);
+        XMStoreFloat3(&vertices[i].NormalW, XMVector3TransformNormal(XMLoadFloat3(&vin[1]), world));
+        XMStoreFloat4(&vertices[i].PosH, XMVector4Transform(XMVectorSetW(posW, 1.0f), viewProj));
+    }
+
+    for(UINT i = batch.FirstIndex; i < batch.FirstIndex + batch.IndexCount; i += 3)
+    {
+        batch.BatchStats.Triangles++;
+        AddTriangle(batch,
+            vertices[getIndex(i) - minIndex],
+            vertices[getIndex(i + 1) - minIndex],
+            vertices[getIndex(i + 2) - minIndex]);
+    }
+
+    // Bin the triangles: count the tiles each one overlaps, then place them in
+    // submission order.
+    const UINT tileCount = mTileCountX*mTileCountY;
+    batch.TileOffsets.assign(tileCount + 1, 0);
+    for(const Triangle& tri : batch.Triangles)
+    {
+        for(int ty = tri.MinY / (int)mTileSize; ty <= tri.MaxY / (int)mTileSize; ++ty)
+            for(int tx = tri.MinX / (int)mTileSize; tx <= tri.MaxX / (int)mTileSize; ++tx)
+                batch.TileOffsets[ty*mTileCountX + tx + 1]++;
+    }
+    for(UINT t = 0; t < tileCount; ++t)
+        batch.TileOffsets[t + 1] += batch.TileOffsets[t];
+
+    batch.TileTriangles.resize(batch.TileOffsets[tileCount]);
+    batch.BatchStats.BinnedTriangles = batch.TileOffsets[tileCount];
+
+    std::vector<UINT> cursor(batch.TileOffsets.begin(), batch.TileOffsets.end() - 1);
+    for(UINT i = 0; i < (UINT)batch.Triangles.size(); ++i)
+    {
+        const Triangle& tri = batch.Triangles[i];
+        for(int ty = tri.MinY / (int)mTileSize; ty <= tri.MaxY / (int)mTileSize; ++ty)
+            for(int tx = tri.MinX / (int)mTileSize; tx <= tri.MaxX / (int)mTileSize; ++tx)
+                batch.TileTriangles[cursor[ty*mTileCountX + tx]++] = i;
+    }
+}
+
+void SoftwareRasterizer::AddTriangle(Batch& batch, const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2)
+{
+    ClipVertex polygons[2][MaxClippedVertices] = { { v0, v1, v2 } };
+    int vertexCount = 3;
+    int current = 0;
+
+    bool clipped = false;
+    for(const XMFLOAT4& plane : ClipPlanes)
+    {
+        const ClipVertex* in = polygons[current];
+        ClipVertex* out = polygons[current ^ 1];
+
+        float distances[MaxClippedVertices];
+        int insideCount = 0;
+        for(int i = 0; i < vertexCount; ++i)
+        {
+            distances[i] = PlaneDistance(plane, in[i].PosH);
+            if(distances[i] >= 0.0f)
+                insideCount++;
+        }
+
+        if(insideCount == 0)
+        {
+            batch.BatchStats.CulledTriangles++;
+            return;
+        }
+        if(insideCount == vertexCount)
+            continue;
+
+        // Sutherland-Hodgman against this plane.
+        int outCount = 0;
+        for(int i = 0; i < vertexCount; ++i)
+        {
+            int j = (i + 1) % vertexCount;
+            if(distances[i] >= 0.0f)
+                out[outCount++] = in[i];
+
+            if((distances[i] >= 0.0f) != (distances[j] >= 0.0f))
+            {
+                float t = distances[i] / (distances[i] - distances[j]);
+                ClipVertex& v = out[outCount++];
+                XMStoreFloat4(&v.PosH, XMVectorLerp(XMLoadFloat4(&in[i].PosH), XMLoadFloat4(&in[j].PosH), t));
+                v.PosW = Lerp3(in[i].PosW, in[j].PosW, t);
+                v.NormalW = Lerp3(in[i].NormalW, in[j].NormalW, t);
+            }
+        }
+
+        vertexCount = outCount;
+        current ^= 1;
+        clipped = true;
+    }
+
+    if(clipped)
+        batch.BatchStats.ClippedTriangles++;
+
+    // Triangulate the clipped polygon as a fan.  Everything is inside the clip
+    // volume now, so w > 0 and the screen coordinates are within the viewport.
+    const ClipVertex* polygon = polygons[current];
+    bool emitted = false;
+    for(int i = 1; i + 1 < vertexCount; ++i)
+    {
+        const ClipVertex* corners[3] = { &polygon[0], &polygon[i], &polygon[i + 1] };
+
+        Triangle tri;
+        for(int k = 0; k < 3; ++k)
+        {
+            const XMFLOAT4& p = corners[k]->PosH;
+            float invW = 1.0f / p.w;
+            float x = (0.5f + 0.5f*p.x*invW)*mWidth;
+            float y = (0.5f - 0.5f*p.y*invW)*mHeight;
+
+            tri.X[k] = (std::int64_t)floorf(x*SubPixelScale + 0.5f);
+            tri.Y[k] = (std::int64_t)floorf(y*SubPixelScale + 0.5f);
+            tri.Z[k] = p.z*invW;
+            tri.InvW[k] = invW;
+            tri.PosW[k] = corners[k]->PosW;
+            tri.NormalW[k] = corners[k]->NormalW;
+        }
+
+        // Front faces are clockwise on screen (FrontCounterClockwise = false) and
+        // back faces are culled.  y points down, so clockwise has positive area.
+        std::int64_t area = (tri.X[1] - tri.X[0])*(tri.Y[2] - tri.Y[0]) - (tri.Y[1] - tri.Y[0])*(tri.X[2] - tri.X[0]);
+        if(area <= 0)
+            continue;
+
+        std::int64_t minX = std::min<std::int64_t>({ tri.X[0], tri.X[1], tri.X[2] });
+        std::int64_t minY = std::min<std::int64_t>({ tri.Y[0], tri.Y[1], tri.Y[2] });
+        std::int64_t maxX = std::max<std::int64_t>({ tri.X[0], tri.X[1], tri.X[2] });
+        std::int64_t maxY = std::max<std::int64_t>({ tri.Y[0], tri.Y[1], tri.Y[2] });
+        tri.MinX = (int)(minX >> SubPixelBits);
+        tri.MinY = (int)(minY >> SubPixelBits);
+        tri.MaxX = std::min<int>((int)(maxX >> SubPixelBits), (int)mWidth - 1);
+        tri.MaxY = std::min<int>((int)(maxY >> SubPixelBits), (int)mHeight - 1);
+
+        batch.Triangles.push_back(tri);
+        emitted = true;
+    }
+
+    if(!emitted)
+        batch.BatchStats.CulledTriangles++;
+}
+
+void SoftwareRasterizer::RasterizeTile(UINT tile, Stats& stats)
+{
+    const int tileMinX = (int)((tile % mTileCountX)*mTileSize);
+    const int tileMinY = (int)((tile / mTileCountX)*mTileSize);
+    const int tileMaxX = std::min<int>(tileMinX + (int)mTileSize, (int)mWidth) - 1;
+    const int tileMaxY = std::min<int>(tileMinY + (int)mTileSize, (int)mHeight) - 1;
+
+    const XMVECTOR eyePos = XMLoadFloat3(&mPass->EyePosW);
+    const XMFLOAT4& ambientLight = mPass->AmbientLight;
+
+    // Pixels that passed the depth test wait here to be shaded eight at a time.
+    LightingReference::SampleBatch samples;
+    LightingReference::ColorBatch colors;
+    size_t pixels[LightingReference::BatchSize];
+    int sampleCount = 0;
+
+    LightingReference::ShadingMaterial mat;
+    auto flush = [&]()
+    {
+        if(sampleCount == 0)
+            return;
+
+        // Pad a partial batch with copies of the first sample.
+        for(int i = sampleCount; i < LightingReference::BatchSize; ++i)
+        {
+            XMFLOAT3 pos = { samples.PosX[0], samples.PosY[0], samples.PosZ[0] };
+            XMFLOAT3 normal = { samples.NormalX[0], samples.NormalY[0], samples.NormalZ[0] };
+            XMFLOAT3 toEye = { samples.ToEyeX[0], samples.ToEyeY[0], samples.ToEyeZ[0] };
+            samples.SetSample(i, pos, normal, toEye, mat);
+        }
+
+        LightingReference::ComputeLighting8(mLights, mNumDirLights, mNumPointLights, mNumSpotLights,
+            samples, colors);
+
+        const XMFLOAT4& diffuse = mat.DiffuseAlbedo;
+        for(int i = 0; i < sampleCount; ++i)
+        {
+            mColor[pixels[i]] = PackUnorm(
+                ambientLight.x*diffuse.x + colors.R[i],
+                ambientLight.y*diffuse.y + colors.G[i],
+                ambientLight.z*diffuse.z + colors.B[i],
+                diffuse.w);
+        }
+
+        stats.PixelsShaded += sampleCount;
+        sampleCount = 0;
+    };
+
+    for(const Batch& batch : mBatches)
+    {
+        mat = (*mDraws)[batch.Draw].Material;
+
+        for(UINT k = batch.TileOffsets[tile]; k < batch.TileOffsets[tile + 1]; ++k)
+        {
+            const Triangle& tri = batch.Triangles[batch.TileTriangles[k]];
+
+            const int minX = std::max<int>(tri.MinX, tileMinX);
+            const int minY = std::max<int>(tri.MinY, tileMinY);
+            const int maxX = std::min<int>(tri.MaxX, tileMaxX);
+            const int maxY = std::min<int>(tri.MaxY, tileMaxY);
+            if(minX > maxX || minY > maxY)
+                continue;
+
+            // Edge i runs from vertex i to vertex i+1; its function is the weight
+            // of the opposite vertex, scaled by the triangle area.
+            std::int64_t rowEdge[3], stepX[3], stepY[3], bias[3];
+            const std::int64_t sampleX = (std::int64_t)minX*SubPixelScale + SubPixelScale/2;
+            const std::int64_t sampleY = (std::int64_t)minY*SubPixelScale + SubPixelScale/2;
+            for(int e = 0; e < 3; ++e)
+            {
+                int next = (e + 1) % 3;
+                std::int64_t dx = tri.X[next] - tri.X[e];
+                std::int64_t dy = tri.Y[next] - tri.Y[e];
+
+                rowEdge[e] = dx*(sampleY - tri.Y[e]) - dy*(sampleX - tri.X[e]);
+                stepX[e] = -dy*SubPixelScale;
+                stepY[e] = dx*SubPixelScale;
+
+                // Top-left fill rule: pixel centers exactly on an edge belong to the
+                // triangle only for top and left edges.
+                bool topLeft = (dy == 0 && dx > 0) || dy < 0;
+                bias[e] = topLeft ? 0 : -1;
+            }
+
+            const std::int64_t area = (tri.X[1] - tri.X[0])*(tri.Y[2] - tri.Y[0]) - (tri.Y[1] - tri.Y[0])*(tri.X[2] - tri.X[0]);
+            const float invArea = 1.0f / (float)area;
+
+            for(int y = minY; y <= maxY; ++y)
+            {
+                std::int64_t edge[3] = { rowEdge[0], rowEdge[1], rowEdge[2] };
+                for(int x = minX; x <= maxX; ++x)
+                {
+                    if(((edge[0] + bias[0]) | (edge[1] + bias[1]) | (edge[2] + bias[2])) >= 0)
+                    {
+                        stats.PixelsTested++;
+
+                        const float w0 = (float)edge[1]*invArea;
+                        const float w1 = (float)edge[2]*invArea;
+                        const float w2 = (float)edge[0]*invArea;
+
+                        const float z = w0*tri.Z[0] + w1*tri.Z[1] + w2*tri.Z[2];
+                        const size_t pixel = (size_t)y*mWidth + x;
+                        if(z < mDepth[pixel])
+                        {
+                            mDepth[pixel] = z;
+
+                            // Perspective-correct attributes.
+                            const float p0 = w0*tri.InvW[0];
+                            const float p1 = w1*tri.InvW[1];
+                            const float p2 = w2*tri.InvW[2];
+                            const float invSum = 1.0f / (p0 + p1 + p2);
+
+                            XMVECTOR posW = (XMLoadFloat3(&tri.PosW[0])*p0 + XMLoadFloat3(&tri.PosW[1])*p1 +
+                                XMLoadFloat3(&tri.PosW[2])*p2)*invSum;
+                            XMVECTOR normalW = XMLoadFloat3(&tri.NormalW[0])*p0 + XMLoadFloat3(&tri.NormalW[1])*p1 +
+                                XMLoadFloat3(&tri.NormalW[2])*p2;
+
+                            XMFLOAT3 pos, normal, toEye;
+                            XMStoreFloat3(&pos, posW);
+                            XMStoreFloat3(&normal, XMVector3Normalize(normalW));
+                            XMStoreFloat3(&toEye, XMVector3Normalize(eyePos - posW));
+
+                            samples.SetSample(sampleCount, pos, normal, toEye, mat);
+                            pixels[sampleCount++] = pixel;
+                            if(sampleCount == LightingReference::BatchSize)
+                                flush();
+                        }
+                    }
+
+                    for(int e = 0; e < 3; ++e)
+                        edge[e] += stepX[e];
+                }
+
+                for(int e = 0; e < 3; ++e)
+                    rowEdge[e] += stepY[e];
+            }
+
+            // A triangle's pixels are shaded before the next triangle can cover them.
+            flush();
+        }
+    }
+}
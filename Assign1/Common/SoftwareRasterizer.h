@@ -0,0 +1,165 @@
+//***************************************************************************************
+// SoftwareRasterizer.h
+//
+// CPU implementation of the opaque pass: Default.hlsl's vertex shader, clipping,
+// back-face culling, a LESS depth test and the pixel shader (through
+// LightingReference), writing an R8G8B8A8_UNORM color image and a float depth image
+// in system memory.  Draws name their vertices and indices by pointer and size and
+// carry the constants the GPU path uploads, so a frame can be rendered and compared
+// without a device.  Needs D3D12Types.h and DirectXMath only (see Tests/).
+//
+// Draws are split into batches of triangles.  Each batch is transformed, clipped and
+// binned into screen tiles in parallel, then the tiles are rasterized in parallel,
+// each tile walking the batches in submission order so the result does not depend
+// on the thread count.
+//***************************************************************************************
+
+#pragma once
+
+#include "D3D12Types.h"
+#include "LightingReference.h"
+
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+class SoftwareRasterizer
+{
+public:
+    static const UINT DefaultTileSize = 32;
+    static const UINT MaxBatchTriangles = 2048;
+
+    // The pass constants the opaque pass reads.  As uploaded, so ViewProj is transposed.
+    struct PassData
+    {
+        DirectX::XMFLOAT4X4 ViewProj;
+        DirectX::XMFLOAT3 EyePosW = { 0.0f, 0.0f, 0.0f };
+        DirectX::XMFLOAT4 AmbientLight = { 0.0f, 0.0f, 0.0f, 1.0f };
+    };
+
+    // One indexed triangle list draw.  Each vertex starts with a float3 position and
+    // a float3 normal, as Vertex does, and may hold more after them.  World is as
+    // uploaded, so transposed; Material is the shader's, with Shininess already
+    // 1 - Roughness.
+    struct DrawCall
+    {
+        const void* VertexData = nullptr;
+        UINT VertexBufferByteSize = 0;
+        UINT VertexByteStride = 0;
+        const void* IndexData = nullptr;
+        UINT IndexBufferByteSize = 0;
+        DXGI_FORMAT IndexFormat = DXGI_FORMAT_R16_UINT;
+
+        UINT IndexCount = 0;
+        UINT StartIndexLocation = 0;
+        int BaseVertexLocation = 0;
+
+        DirectX::XMFLOAT4X4 World;
+        LightingReference::ShadingMaterial Material;
+    };
+
+    struct Stats
+    {
+        UINT Triangles = 0;
+        UINT CulledTriangles = 0;    // Back facing, degenerate or outside the frustum.
+        UINT ClippedTriangles = 0;   // Crossed the near plane.
+        UINT BinnedTriangles = 0;    // Triangle-tile pairs.
+        UINT64 PixelsTested = 0;
+        UINT64 PixelsShaded = 0;
+        double SetupMilliseconds = 0.0;
+        double RasterMilliseconds = 0.0;
+    };
+
+    // pool may be null to render on the calling thread.
+    SoftwareRasterizer(UINT width, UINT height, ThreadPool* pool = nullptr, UINT tileSize = DefaultTileSize);
+    SoftwareRasterizer(const SoftwareRasterizer& rhs) = delete;
+    SoftwareRasterizer& operator=(const SoftwareRasterizer& rhs) = delete;
+
+    void Resize(UINT width, UINT height);
+    void Clear(const DirectX::XMFLOAT4& color, float depth = 1.0f);
+
+    // lights holds numDir directional, then numPoint point, then numSpot spot lights,
+    // as in PassConstants::Lights.  Throws std::invalid_argument if a draw reads
+    // past its index or vertex data.
+    void Draw(const PassData& pass, const Light* lights, int numDir, int numPoint, int numSpot,
+        const std::vector<DrawCall>& draws);
+
+    UINT Width()const { return mWidth; }
+    UINT Height()const { return mHeight; }
+
+    // Row-major, one R8G8B8A8_UNORM texel (red in the low byte) per pixel.
+    const std::vector<std::uint32_t>& GetColor()const { return mColor; }
+    const std::vector<float>& GetDepth()const { return mDepth; }
+
+    // Hash of the color image, for comparing frames between builds.
+    std::uint64_t ColorHash()const;
+
+    // Statistics of the last Draw.
+    const Stats& GetStats()const { return mStats; }
+
+private:
+    // A vertex after the vertex shader.
+    struct ClipVertex
+    {
+        DirectX::XMFLOAT4 PosH;
+        DirectX::XMFLOAT3 PosW;
+        DirectX::XMFLOAT3 NormalW;
+    };
+
+    // A triangle ready to rasterize.  Positions are in 24.8 fixed point pixels.
+    struct Triangle
+    {
+        std::int64_t X[3], Y[3];
+        float Z[3];
+        float InvW[3];
+        DirectX::XMFLOAT3 PosW[3];
+        DirectX::XMFLOAT3 NormalW[3];
+        int MinX, MinY, MaxX, MaxY;   // Pixel bounds, inclusive.
+    };
+
+    struct Batch
+    {
+        UINT Draw = 0;
+        UINT FirstIndex = 0;
+        UINT IndexCount = 0;
+
+        std::vector<Triangle> Triangles;
+
+        // Triangles overlapping tile t are TileTriangles[TileOffsets[t], TileOffsets[t+1]).
+        std::vector<UINT> TileOffsets;
+        std::vector<UINT> TileTriangles;
+
+        Stats BatchStats;
+    };
+
+    void SetupBatch(Batch& batch);
+    void AddTriangle(Batch& batch, const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2);
+    void RasterizeTile(UINT tile, Stats& stats);
+
+private:
+    ThreadPool* mThreadPool = nullptr;
+
+    UINT mWidth = 0;
+    UINT mHeight = 0;
+    UINT mTileSize = DefaultTileSize;
+    UINT mTileCountX = 0;
+    UINT mTileCountY = 0;
+
+    std::vector<std::uint32_t> mColor;
+    std::vector<float> mDepth;
+
+    // State of the Draw in progress.
+    const PassData* mPass = nullptr;
+    const Light* mLights = nullptr;
+    int mNumDirLights = 0;
+    int mNumPointLights = 0;
+    int mNumSpotLights = 0;
+    const std::vector<DrawCall>* mDraws = nullptr;
+    DirectX::XMFLOAT4X4 mViewProj;
+    std::vector<DirectX::XMFLOAT4X4> mWorlds;
+
+    std::vector<Batch> mBatches;
+    std::vector<Stats> mTileStats;
+    Stats mStats;
+};
@@ -0,0 +1,147 @@
+#include "StaticBatcher.h"
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <map>
+#include <tuple>
+
+using namespace DirectX;
+
+StaticBatcher::StaticBatcher(UINT vertexByteStride, UINT positionOffset, UINT normalOffset, float cellSize) :
+    mVertexByteStride(vertexByteStride),
+    mPositionOffset(positionOffset),
+    mNormalOffset(normalOffset),
+    mCellSize(cellSize)
+{
+    if(vertexByteStride < positionOffset + sizeof(XMFLOAT3) ||
+       vertexByteStride < normalOffset + sizeof(XMFLOAT3) || cellSize <= 0.0f)
+        ThrowIfFailed(E_INVALIDARG);
+}
+
+void StaticBatcher::Add(UINT id, UINT material, const void* vertices, const std::uint32_t* indices, UINT indexCount,
+    const XMFLOAT4X4& world, const BoundingBox& localBounds)
+{
+    Instance instance;
+    instance.Id = id;
+    instance.Material = material;
+    instance.Vertices = reinterpret_cast<const BYTE*>(vertices);
+    instance.Indices = indices;
+    instance.IndexCount = indexCount;
+    instance.World = world;
+    localBounds.Transform(instance.Bounds, XMLoadFloat4x4(&world));
+
+    instance.Cell[0] = (int)floorf(instance.Bounds.Center.x / mCellSize);
+    instance.Cell[1] = (int)floorf(instance.Bounds.Center.y / mCellSize);
+    instance.Cell[2] = (int)floorf(instance.Bounds.Center.z / mCellSize);
+
+    mInstances.push_back(instance);
+}
+
+void StaticBatcher::Build(ThreadPool* pool)
+{
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point startTime = Clock::now();
+
+    // An ordered map keeps the batch order independent of hashing.
+    typedef std::tuple<UINT, int, int, int> BatchKey;
+    std::map<BatchKey, std::vector<UINT>> groups;
+    for(UINT i = 0; i < (UINT)mInstances.size(); ++i)
+    {
+        const Instance& instance = mInstances[i];
+        groups[BatchKey(instance.Material, instance.Cell[0], instance.Cell[1], instance.Cell[2])].push_back(i);
+    }
+
+    mBatches.clear();
+    mBatches.resize(groups.size());
+
+    std::vector<const std::vector<UINT>*> groupInstances;
+    for(auto& e : groups)
+    {
+        mBatches[groupInstances.size()].Material = std::get<0>(e.first);
+        groupInstances.push_back(&e.second);
+    }
+
+    if(pool != nullptr)
+        pool->ParallelFor((UINT)mBatches.size(), [&](UINT i) { BakeBatch(mBatches[i], *groupInstances[i]); });
+    else
+    {
+        for(UINT i = 0; i < (UINT)mBatches.size(); ++i)
+            BakeBatch(mBatches[i], *groupInstances[i]);
+    }
+
+    mStats = Stats();
+    mStats.Instances = (UINT)mInstances.size();
+    mStats.Batches = (UINT)mBatches.size();
+    for(const Batch& batch : mBatches)
+    {
+        mStats.Vertices += batch.VertexCount;
+        mStats.Indices += (UINT)batch.Indices.size();
+    }
+    mStats.Milliseconds = std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+
+    mInstances.clear();
+}
+
+void StaticBatcher::BakeBatch(Batch& batch, const std::vector<UINT>& instances)
+{
+    // The meshes only say how many indices they have, so each instance takes the
+    // vertex range its indices reach.
+    std::vector<UINT> vertexCounts(instances.size());
+    UINT totalVertices = 0;
+    UINT totalIndices = 0;
+    for(size_t i = 0; i < instances.size(); ++i)
+    {
+        const Instance& instance = mInstances[instances[i]];
+
+        std::uint32_t maxIndex = 0;
+        for(UINT j = 0; j < instance.IndexCount; ++j)
+            maxIndex = MathHelper::Max(maxIndex, instance.Indices[j]);
+
+        vertexCounts[i] = instance.IndexCount > 0 ? maxIndex + 1 : 0;
+        totalVertices += vertexCounts[i];
+        totalIndices += instance.IndexCount;
+    }
+
+    batch.Vertices.resize((size_t)totalVertices*mVertexByteStride);
+    batch.VertexCount = totalVertices;
+    batch.Indices.resize(totalIndices);
+    batch.Instances.clear();
+
+    UINT firstVertex = 0;
+    UINT firstIndex = 0;
+    for(size_t i = 0; i < instances.size(); ++i)
+    {
+        const Instance& instance = mInstances[instances[i]];
+        const UINT vertexCount = vertexCounts[i];
+        BYTE* dst = batch.Vertices.data() + (size_t)firstVertex*mVertexByteStride;
+
+        // Copy the whole vertices for the attributes that are not transformed, then
+        // overwrite positions and normals with their world space values.
+        memcpy(dst, instance.Vertices, (size_t)vertexCount*mVertexByteStride);
+
+        // Normals go through the upper 3x3 of the world matrix, like Default.hlsl's
+        // vertex shader, so a batched item shades exactly like an unbatched one.
+        XMMATRIX world = XMLoadFloat4x4(&instance.World);
+        XMVector3TransformCoordStream(
+            reinterpret_cast<XMFLOAT3*>(dst + mPositionOffset), mVertexByteStride,
+            reinterpret_cast<const XMFLOAT3*>(instance.Vertices + mPositionOffset), mVertexByteStride,
+            vertexCount, world);
+        XMVector3TransformNormalStream(
+            reinterpret_cast<XMFLOAT3*>(dst + mNormalOffset), mVertexByteStride,
+            reinterpret_cast<const XMFLOAT3*>(instance.Vertices + mNormalOffset), mVertexByteStride,
+            vertexCount, world);
+
+        for(UINT j = 0; j < instance.IndexCount; ++j)
+            batch.Indices[firstIndex + j] = instance.Indices[j] + firstVertex;
+
+        if(i == 0)
+            batch.Bounds = instance.Bounds;
+        else
+            BoundingBox::CreateMerged(batch.Bounds, batch.Bounds, instance.Bounds);
+
+        batch.Instances.push_back(instance.Id);
+
+        firstVertex += vertexCount;
+        firstIndex += instance.IndexCount;
+    }
+}
@@ -0,0 +1,93 @@
+//***************************************************************************************
+// StaticBatcher.h
+//
+// Bakes mesh instances that never move into merged meshes.  Instances are grouped by
+// material and by the cell of a uniform world grid their bounds are centred in, so a
+// batch covers a bounded part of the scene and can still be culled as a whole.  Each
+// batch's vertices are pre-transformed to world space, with positions and normals
+// transformed a whole mesh at a time by DirectXMath's stream functions, so a batch
+// is drawn with an identity world matrix.
+//
+// The batcher only works on system memory and has no device dependency; the caller
+// uploads the results, normally into the same GeometryPool as the sources.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class ThreadPool;
+
+class StaticBatcher
+{
+public:
+    struct Batch
+    {
+        UINT Material = 0;
+
+        // VertexCount vertices in the source vertex format, and indices relative to
+        // the first of them.
+        std::vector<BYTE> Vertices;
+        UINT VertexCount = 0;
+        std::vector<std::uint32_t> Indices;
+
+        // World space bounds of the whole batch.
+        DirectX::BoundingBox Bounds;
+
+        // Ids of the instances merged into this batch, in the order they were added.
+        std::vector<UINT> Instances;
+    };
+
+    struct Stats
+    {
+        UINT Instances = 0;
+        UINT Batches = 0;
+        UINT Vertices = 0;
+        UINT Indices = 0;
+        double Milliseconds = 0.0;
+    };
+
+    // Vertices are vertexByteStride bytes apart and hold an XMFLOAT3 position and an
+    // XMFLOAT3 normal at the given offsets.  Other attributes are copied unchanged.
+    StaticBatcher(UINT vertexByteStride, UINT positionOffset, UINT normalOffset, float cellSize = 32.0f);
+    StaticBatcher(const StaticBatcher& rhs) = delete;
+    StaticBatcher& operator=(const StaticBatcher& rhs) = delete;
+
+    // Queues an instance of a mesh.  vertices points at the mesh's first vertex and
+    // the indices are relative to it.  The data must stay alive until Build.  world
+    // is not transposed, and localBounds are the mesh's bounds.
+    void Add(UINT id, UINT material, const void* vertices, const std::uint32_t* indices, UINT indexCount,
+        const DirectX::XMFLOAT4X4& world, const DirectX::BoundingBox& localBounds);
+
+    // Merges the queued instances and clears the queue.  pool may be null to bake on
+    // the calling thread.  Batches come out sorted by material, then cell.
+    void Build(ThreadPool* pool);
+
+    const std::vector<Batch>& GetBatches()const { return mBatches; }
+    const Stats& GetStats()const { return mStats; }
+
+private:
+    struct Instance
+    {
+        UINT Id = 0;
+        UINT Material = 0;
+        const BYTE* Vertices = nullptr;
+        const std::uint32_t* Indices = nullptr;
+        UINT IndexCount = 0;
+        DirectX::XMFLOAT4X4 World;
+        DirectX::BoundingBox Bounds;   // World space.
+        int Cell[3];
+    };
+
+    void BakeBatch(Batch& batch, const std::vector<UINT>& instances);
+
+private:
+    UINT mVertexByteStride = 0;
+    UINT mPositionOffset = 0;
+    UINT mNormalOffset = 0;
+    float mCellSize = 32.0f;
+
+    std::vector<Instance> mInstances;
+    std::vector<Batch> mBatches;
+    Stats mStats;
+};
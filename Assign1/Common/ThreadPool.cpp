@@ -0,0 +1,125 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t threadCount)
+{
+    if(threadCount == 0)
+    {
+        uint32_t hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    mWorkers.reserve(threadCount);
+    for(uint32_t i = 0; i < threadCount; ++i)
+        mWorkers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mShutdown = true;
+    }
+    mJobAvailable.notify_all();
+
+    for(auto& worker : mWorkers)
+        worker.join();
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+{
+    if(count == 0)
+        return;
+
+    struct SharedState
+    {
+        std::atomic<uint32_t> Next{ 0 };
+        std::atomic<uint32_t> Done{ 0 };
+        std::mutex Mutex;
+        std::condition_variable Finished;
+        std::exception_ptr Error;
+    };
+
+    // Shared so helpers still queued after the range is finished stay valid.
+    auto state = std::make_shared<SharedState>();
+
+    auto run = [state, count, &func]()
+    {
+        for(uint32_t i = state->Next++; i < count; i = state->Next++)
+        {
+            try
+            {
+                func(i);
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                if(!state->Error)
+                    state->Error = std::current_exception();
+            }
+
+            if(++state->Done == count)
+            {
+                std::lock_guard<std::mutex> lock(state->Mutex);
+                state->Finished.notify_all();
+            }
+        }
+    };
+
+    // The calling thread takes part, so only count-1 helpers are ever useful.
+    uint32_t helpers = count - 1 < ThreadCount() ? count - 1 : ThreadCount();
+    for(uint32_t i = 0; i < helpers; ++i)
+        Enqueue(run);
+
+    run();
+
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    state->Finished.wait(lock, [&]() { return state->Done == count; });
+
+    if(state->Error)
+        std::rethrow_exception(state->Error);
+}
+
+void ThreadPool::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this]() { return mJobs.empty() && mActiveJobs == 0; });
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mJobs.push_back(std::move(job));
+    }
+    mJobAvailable.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for(;;)
+    {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mJobAvailable.wait(lock, [this]() { return mShutdown || !mJobs.empty(); });
+
+            if(mJobs.empty())
+                return;
+
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+            mActiveJobs++;
+        }
+
+        // Submit stores exceptions in the future and ParallelFor catches its own,
+        // so jobs do not throw here.
+        job();
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mActiveJobs--;
+            if(mJobs.empty() && mActiveJobs == 0)
+                mIdle.notify_all();
+        }
+    }
+}
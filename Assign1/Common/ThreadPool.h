@@ -0,0 +1,67 @@
+//***************************************************************************************
+// ThreadPool.h
+//
+// Fixed set of worker threads that run queued jobs.  ParallelFor splits an index
+// range over the workers and the calling thread and blocks until it is done; an
+// exception thrown by any iteration is rethrown on the calling thread.  Has no
+// dependency on Direct3D.
+//***************************************************************************************
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    // threadCount == 0 uses one worker per hardware thread, minus the calling thread.
+    explicit ThreadPool(uint32_t threadCount = 0);
+    ThreadPool(const ThreadPool& rhs) = delete;
+    ThreadPool& operator=(const ThreadPool& rhs) = delete;
+    ~ThreadPool();
+
+    // Queues job to run on a worker.  The future holds its result or exception.
+    template<typename F>
+    auto Submit(F&& job) -> std::future<decltype(job())>
+    {
+        using Result = decltype(job());
+
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> result = task->get_future();
+        Enqueue([task]() { (*task)(); });
+
+        return result;
+    }
+
+    // Calls func(i) for every i in [0, count).  Iterations are handed out one at a
+    // time, so uneven iterations balance across threads.
+    void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+    // Blocks until the queue is empty and no job is running.
+    void WaitIdle();
+
+    uint32_t ThreadCount()const { return (uint32_t)mWorkers.size(); }
+
+private:
+    void Enqueue(std::function<void()> job);
+    void WorkerLoop();
+
+private:
+    std::vector<std::thread> mWorkers;
+
+    std::mutex mMutex;
+    std::condition_variable mJobAvailable;
+    std::condition_variable mIdle;
+    std::deque<std::function<void()>> mJobs;
+    uint32_t mActiveJobs = 0;
+    bool mShutdown = false;
+};
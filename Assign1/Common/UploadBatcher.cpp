@@ -0,0 +1,219 @@
+#include "UploadBatcher.h"
+#include "HeapManager.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Copies have no placement requirement for buffers, but keep staging ranges
+// aligned so memcpy into the upload heap stays on cache-line friendly offsets.
+static const UINT64 StagingAlignment = 16;
+
+UploadBatcher::UploadBatcher(ID3D12Device* device, HeapManager* heaps, UINT64 stagingSize) :
+    md3dDevice(device),
+    mHeaps(heaps)
+{
+    CreateStaging(stagingSize);
+}
+
+UploadBatcher::~UploadBatcher()
+{
+    if(mStaging != nullptr)
+        mStaging->Unmap(0, nullptr);
+}
+
+ComPtr<ID3D12Resource> UploadBatcher::CreateDefaultBuffer(
+    const void* initData,
+    UINT64 byteSize,
+    D3D12_RESOURCE_STATES finalState)
+{
+    ComPtr<ID3D12Resource> defaultBuffer;
+
+    if(mHeaps != nullptr)
+    {
+        defaultBuffer = mHeaps->CreateBuffer(byteSize, D3D12_RESOURCE_STATE_COMMON);
+    }
+    else
+    {
+        ThrowIfFailed(md3dDevice->CreateCommittedResource(
+            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+            D3D12_HEAP_FLAG_NONE,
+            &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+            D3D12_RESOURCE_STATE_COMMON,
+            nullptr,
+            IID_PPV_ARGS(defaultBuffer.GetAddressOf())));
+    }
+
+    QueueBufferUpload(defaultBuffer.Get(), 0, initData, byteSize,
+        D3D12_RESOURCE_STATE_COMMON, finalState);
+
+    return defaultBuffer;
+}
+
+void UploadBatcher::QueueBufferUpload(
+    ID3D12Resource* dest,
+    UINT64 destOffset,
+    const void* data,
+    UINT64 byteSize,
+    D3D12_RESOURCE_STATES stateBefore,
+    D3D12_RESOURCE_STATES stateAfter)
+{
+    UINT64 stagingOffset = AllocateStaging(byteSize);
+    memcpy(mStagingData + stagingOffset, data, (size_t)byteSize);
+
+    PendingUpload upload;
+    upload.Dest = dest;
+    upload.DestOffset = destOffset;
+    upload.Staging = mStaging;
+    upload.StagingOffset = stagingOffset;
+    upload.ByteSize = byteSize;
+    upload.StateBefore = stateBefore;
+    upload.StateAfter = stateAfter;
+    mPending.push_back(upload);
+
+    mStats.BytesStaged += byteSize;
+    mStats.UploadCount++;
+}
+
+void UploadBatcher::Flush(ID3D12GraphicsCommandList* cmdList, UINT64 fenceValue)
+{
+    if(mPending.empty())
+        return;
+
+    // Several uploads may target the same resource (e.g. sub-ranges of a shared
+    // buffer), so transition each distinct resource only once.
+    std::vector<D3D12_RESOURCE_BARRIER> before;
+    std::vector<D3D12_RESOURCE_BARRIER> after;
+    std::vector<ID3D12Resource*> transitioned;
+    for(auto& upload : mPending)
+    {
+        ID3D12Resource* dest = upload.Dest.Get();
+        if(std::find(transitioned.begin(), transitioned.end(), dest) != transitioned.end())
+            continue;
+        transitioned.push_back(dest);
+
+        if(upload.StateBefore != D3D12_RESOURCE_STATE_COPY_DEST)
+        {
+            before.push_back(CD3DX12_RESOURCE_BARRIER::Transition(dest,
+                upload.StateBefore, D3D12_RESOURCE_STATE_COPY_DEST));
+        }
+        if(upload.StateAfter != D3D12_RESOURCE_STATE_COPY_DEST)
+        {
+            after.push_back(CD3DX12_RESOURCE_BARRIER::Transition(dest,
+                D3D12_RESOURCE_STATE_COPY_DEST, upload.StateAfter));
+        }
+    }
+
+    if(!before.empty())
+        cmdList->ResourceBarrier((UINT)before.size(), before.data());
+
+    for(auto& upload : mPending)
+    {
+        cmdList->CopyBufferRegion(upload.Dest.Get(), upload.DestOffset,
+            upload.Staging.Get(), upload.StagingOffset, upload.ByteSize);
+    }
+
+    if(!after.empty())
+        cmdList->ResourceBarrier((UINT)after.size(), after.data());
+
+    mPending.clear();
+
+    // The staging memory written so far is in use until fenceValue completes.
+    InFlightBatch batch;
+    batch.Fence = fenceValue;
+    batch.End = mHead;
+    mInFlight.push_back(batch);
+
+    for(auto& retired : mRetired)
+    {
+        if(retired.Fence == 0)
+            retired.Fence = fenceValue;
+    }
+
+    mStats.BatchCount++;
+}
+
+void UploadBatcher::ReleaseCompleted(UINT64 completedFenceValue)
+{
+    // Batches are flushed in fence order, so the ring is freed front to back.
+    size_t completed = 0;
+    while(completed < mInFlight.size() && mInFlight[completed].Fence <= completedFenceValue)
+    {
+        mTail = mInFlight[completed].End;
+        ++completed;
+    }
+    mInFlight.erase(mInFlight.begin(), mInFlight.begin() + completed);
+
+    mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(),
+        [completedFenceValue](const RetiredStaging& r)
+        {
+            return r.Fence != 0 && r.Fence <= completedFenceValue;
+        }), mRetired.end());
+}
+
+UINT64 UploadBatcher::AllocateStaging(UINT64 byteSize)
+{
+    UINT64 offset = 0;
+    if(TryAllocateStaging(byteSize, offset))
+        return offset;
+
+    // Out of staging memory.  Retire the current buffer (pending and in-flight
+    // copies still reference it) and continue in one at least twice as big.
+    if(!mPending.empty() || !mInFlight.empty())
+    {
+        RetiredStaging retired;
+        retired.Resource = mStaging;
+        retired.Fence = mPending.empty() ? mInFlight.back().Fence : 0;
+        mRetired.push_back(retired);
+    }
+    mStaging->Unmap(0, nullptr);
+
+    UINT64 newSize = MathHelper::Max(2 * mStagingSize, (byteSize + 0xFFFF) & ~0xFFFFull);
+    CreateStaging(newSize);
+
+    bool allocated = TryAllocateStaging(byteSize, offset);
+    assert(allocated);
+    return offset;
+}
+
+bool UploadBatcher::TryAllocateStaging(UINT64 byteSize, UINT64& offset)
+{
+    UINT64 physical = mHead % mStagingSize;
+    UINT64 aligned = (physical + StagingAlignment - 1) & ~(StagingAlignment - 1);
+
+    // Never split an upload across the end of the ring; skip to the start instead.
+    if(aligned + byteSize > mStagingSize)
+        aligned = mStagingSize;
+
+    UINT64 padding = aligned - physical;
+    if(aligned == mStagingSize)
+        aligned = 0;
+
+    if(mHead + padding + byteSize - mTail > mStagingSize)
+        return false;
+
+    offset = aligned;
+    mHead += padding + byteSize;
+
+    mStats.PeakStagingBytes = MathHelper::Max(mStats.PeakStagingBytes, mHead - mTail);
+    return true;
+}
+
+void UploadBatcher::CreateStaging(UINT64 byteSize)
+{
+    ThrowIfFailed(md3dDevice->CreateCommittedResource(
+        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        D3D12_HEAP_FLAG_NONE,
+        &CD3DX12_RESOURCE_DESC::Buffer(byteSize),
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(mStaging.ReleaseAndGetAddressOf())));
+
+    ThrowIfFailed(mStaging->Map(0, nullptr, reinterpret_cast<void**>(&mStagingData)));
+
+    mStagingSize = byteSize;
+    mStats.StagingCapacity = byteSize;
+
+    // Everything still in flight lives in a retired buffer now.
+    mHead = 0;
+    mTail = 0;
+    mInFlight.clear();
+}
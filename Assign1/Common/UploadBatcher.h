@@ -0,0 +1,119 @@
+//***************************************************************************************
+// UploadBatcher.h
+//
+// Batches uploads into default heap buffers.  All pending uploads are sub-allocated
+// from one shared staging ring buffer in an upload heap and recorded together: one
+// barrier batch into COPY_DEST, the copies, and one barrier batch into the final
+// states.  Staging memory is reclaimed automatically once the fence of the command
+// list that performed the copies has passed.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class HeapManager;
+
+class UploadBatcher
+{
+public:
+    static const UINT64 DefaultStagingSize = 4 * 1024 * 1024;
+
+    struct Stats
+    {
+        UINT64 BytesStaged = 0;       // Total bytes copied through the staging buffer.
+        UINT UploadCount = 0;         // Total number of queued uploads.
+        UINT BatchCount = 0;          // Number of Flush calls that recorded copies.
+        UINT64 PeakStagingBytes = 0;  // Largest amount of staging memory in use at once.
+        UINT64 StagingCapacity = 0;   // Current size of the staging ring buffer.
+    };
+
+    // When heaps is given, default buffers are created as placed resources in its
+    // heaps instead of as committed resources.
+    UploadBatcher(ID3D12Device* device, HeapManager* heaps = nullptr,
+        UINT64 stagingSize = DefaultStagingSize);
+    UploadBatcher(const UploadBatcher& rhs) = delete;
+    UploadBatcher& operator=(const UploadBatcher& rhs) = delete;
+    ~UploadBatcher();
+
+    // Creates a default heap buffer and queues initData to be copied into it.
+    // The buffer ends up in finalState once the next Flush has executed.
+    // A buffer placed in the HeapManager's heaps is returned to it with
+    // HeapManager::FreeBuffer.
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
+        const void* initData,
+        UINT64 byteSize,
+        D3D12_RESOURCE_STATES finalState = D3D12_RESOURCE_STATE_GENERIC_READ);
+
+    // Queues a copy of byteSize bytes into dest at destOffset.  dest is expected to
+    // be in stateBefore and is left in stateAfter.
+    void QueueBufferUpload(
+        ID3D12Resource* dest,
+        UINT64 destOffset,
+        const void* data,
+        UINT64 byteSize,
+        D3D12_RESOURCE_STATES stateBefore,
+        D3D12_RESOURCE_STATES stateAfter);
+
+    // Records every queued upload on cmdList.  fenceValue is the fence value that
+    // will be signaled once cmdList has executed; the staging memory used by this
+    // batch is reclaimed by ReleaseCompleted after that value is reached.
+    void Flush(ID3D12GraphicsCommandList* cmdList, UINT64 fenceValue);
+
+    // Frees the staging memory of every batch whose fence has completed.
+    void ReleaseCompleted(UINT64 completedFenceValue);
+
+    bool HasPendingUploads()const { return !mPending.empty(); }
+    UINT64 StagingBytesInUse()const { return mHead - mTail; }
+    const Stats& GetStats()const { return mStats; }
+
+private:
+    struct PendingUpload
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Dest;
+        UINT64 DestOffset = 0;
+        Microsoft::WRL::ComPtr<ID3D12Resource> Staging;
+        UINT64 StagingOffset = 0;
+        UINT64 ByteSize = 0;
+        D3D12_RESOURCE_STATES StateBefore = D3D12_RESOURCE_STATE_COMMON;
+        D3D12_RESOURCE_STATES StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
+    };
+
+    // A flushed batch owns the staging range up to End until Fence completes.
+    struct InFlightBatch
+    {
+        UINT64 Fence = 0;
+        UINT64 End = 0;
+    };
+
+    // Staging buffer replaced by a bigger one, kept alive until Fence completes.
+    // Fence is 0 until the batch still referencing it has been flushed.
+    struct RetiredStaging
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        UINT64 Fence = 0;
+    };
+
+    UINT64 AllocateStaging(UINT64 byteSize);
+    bool TryAllocateStaging(UINT64 byteSize, UINT64& offset);
+    void CreateStaging(UINT64 byteSize);
+
+private:
+    ID3D12Device* md3dDevice = nullptr;
+    HeapManager* mHeaps = nullptr;
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> mStaging;
+    BYTE* mStagingData = nullptr;
+    UINT64 mStagingSize = 0;
+
+    // Ring buffer cursors.  They only ever grow; the physical offset is the
+    // cursor modulo mStagingSize, and mHead - mTail is the memory in use.
+    UINT64 mHead = 0;
+    UINT64 mTail = 0;
+
+    std::vector<PendingUpload> mPending;
+    std::vector<InFlightBatch> mInFlight;
+    std::vector<RetiredStaging> mRetired;
+
+    Stats mStats;
+};
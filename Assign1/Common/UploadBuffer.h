@@ -10,6 +10,7 @@ public:
         mIsConstantBuffer(isConstantBuffer)
     {
         mElementByteSize = sizeof(T);
+        mElementCount = elementCount;
 
         // Constant buffer elements need to be multiples of 256 bytes.
         // This is because the hardware can only view constant data 
@@ -55,10 +56,22 @@ public:
         memcpy(&mMappedData[elementIndex*mElementByteSize], &data, sizeof(T));
     }
 
+    // The mapped memory is write-combined, so reading it back is slow.
+    const BYTE* MappedData()const
+    {
+        return mMappedData;
+    }
+
+    UINT ByteSize()const
+    {
+        return mElementByteSize*mElementCount;
+    }
+
 private:
     Microsoft::WRL::ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE* mMappedData = nullptr;
 
     UINT mElementByteSize = 0;
+    UINT mElementCount = 0;
     bool mIsConstantBuffer = false;
 };
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "VisibilityCache.h"
+
+using namespace DirectX;
+
+VisibilityCache::VisibilityCache(float maxTranslation, float maxRotationDegrees, float boundaryMargin) :
+    mMaxTranslation(maxTranslation),
+    mMinCosRotation(cosf(XMConvertToRadians(maxRotationDegrees))),
+    mBoundaryMargin(boundaryMargin)
+{
+}
+
+bool VisibilityCache::Begin(const XMFLOAT4X4& view, UINT itemCount)
+{
+    // The rows of the inverse view matrix are the camera's axes and position in world space.
+    XMMATRIX V = XMLoadFloat4x4(&view);
+    XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(V), V);
+
+    XMFLOAT3 up, forward, eyePos;
+    XMStoreFloat3(&up, invView.r[1]);
+    XMStoreFloat3(&forward, invView.r[2]);
+    XMStoreFloat3(&eyePos, invView.r[3]);
+
+    mFullTest = !mValid || itemCount != (UINT)mItems.size();
+    if(!mFullTest)
+    {
+        float translation = XMVectorGetX(XMVector3Length(XMLoadFloat3(&eyePos) - XMLoadFloat3(&mEyePos)));
+        float cosForward = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&forward), XMLoadFloat3(&mForward)));
+        float cosUp = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&up), XMLoadFloat3(&mUp)));
+
+        mFullTest = translation > mMaxTranslation || cosForward < mMinCosRotation || cosUp < mMinCosRotation;
+    }
+
+    if(mFullTest)
+    {
+        mEyePos = eyePos;
+        mForward = forward;
+        mUp = up;
+        mValid = true;
+        mItems.resize(itemCount);
+        mStats.FullTests++;
+    }
+
+    mStats.Tested = 0;
+    mStats.Reused = 0;
+
+    return mFullTest;
+}
+
+bool VisibilityCache::NeedsTest(UINT item, bool transformChanged)
+{
+    const ItemState& state = mItems[item];
+    if(mFullTest || transformChanged || (!state.Visible && state.NearBoundary))
+        return true;
+
+    mStats.Reused++;
+    return false;
+}
+
+void VisibilityCache::Store(UINT item, bool visible, bool nearBoundary)
+{
+    mItems[item].Visible = visible;
+    mItems[item].NearBoundary = nearBoundary;
+    mStats.Tested++;
+}
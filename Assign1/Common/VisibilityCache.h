@@ -0,0 +1,80 @@
+//***************************************************************************************
+// VisibilityCache.h
+//
+// Keeps each item's visibility from one frame to the next so that, while the camera
+// only moves a little, most items keep their last result instead of being tested
+// again.  Items are re-tested when their transform changed or when the last test
+// found them hidden by less than the boundary margin (just off screen or just behind
+// an occluder).  Items that were visible stay visible, which is conservative.  Once
+// the camera has moved or turned past the thresholds since the last full test,
+// every item is tested again.
+//
+// Items are identified by a dense index.  Has no dependency on Direct3D beyond
+// DirectXMath.
+//***************************************************************************************
+
+#pragma once
+
+#include "d3dUtil.h"
+
+class VisibilityCache
+{
+public:
+    struct Stats
+    {
+        UINT FullTests = 0;   // Frames on which every item was tested.
+        UINT Tested = 0;      // Items tested on the last frame.
+        UINT Reused = 0;      // Items that kept their result on the last frame.
+    };
+
+    // boundaryMargin is the screen margin, in normalized device coordinates, within
+    // which a hidden item counts as near the boundary.  It should cover how far
+    // things can move on screen while the camera stays within the thresholds.
+    VisibilityCache(float maxTranslation = 0.25f, float maxRotationDegrees = 1.0f,
+        float boundaryMargin = 0.05f);
+    VisibilityCache(const VisibilityCache& rhs) = delete;
+    VisibilityCache& operator=(const VisibilityCache& rhs) = delete;
+
+    // Starts a frame.  Returns true if every item has to be tested: the camera moved
+    // past the thresholds, the item count changed or Invalidate was called.
+    bool Begin(const DirectX::XMFLOAT4X4& view, UINT itemCount);
+
+    // Forces a full test on the next frame, e.g. after an occluder moved or the
+    // projection changed; Begin only compares the view.
+    void Invalidate() { mValid = false; }
+
+    // Whether the item has to be tested this frame.  Otherwise IsVisible holds its result.
+    bool NeedsTest(UINT item, bool transformChanged);
+
+    // Records a test result.  nearBoundary is only meaningful for hidden items.
+    void Store(UINT item, bool visible, bool nearBoundary);
+
+    bool IsVisible(UINT item)const { return mItems[item].Visible; }
+
+    float BoundaryMargin()const { return mBoundaryMargin; }
+
+    const Stats& GetStats()const { return mStats; }
+
+private:
+    struct ItemState
+    {
+        bool Visible = true;
+        bool NearBoundary = true;
+    };
+
+private:
+    float mMaxTranslation = 0.0f;
+    float mMinCosRotation = 1.0f;
+    float mBoundaryMargin = 0.0f;
+
+    // Camera at the last full test.
+    DirectX::XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT3 mForward = { 0.0f, 0.0f, 1.0f };
+    DirectX::XMFLOAT3 mUp = { 0.0f, 1.0f, 0.0f };
+
+    bool mValid = false;
+    bool mFullTest = true;
+    std::vector<ItemState> mItems;
+
+    Stats mStats;
+};
@@ -90,9 +90,22 @@ int D3DApp::Run()
 
 			if( !mAppPaused )
 			{
-				CalculateFrameStats();
+				ClockSource& clock = mTimer.GetClock();
+				const double msPerCount = clock.SecondsPerCount() * 1000.0;
+
+				mFrameStats.BeginFrame(mTimer.TotalTime(), mTimer.DeltaTime() * 1000.0);
+
+				std::int64_t updateStart = clock.Now();
 				Update(mTimer);	
+				std::int64_t drawStart = clock.Now();
                 Draw(mTimer);
+				std::int64_t drawEnd = clock.Now();
+
+				mFrameStats.AddTime(FrameStats::TimingUpdate, (drawStart - updateStart) * msPerCount);
+				mFrameStats.AddTime(FrameStats::TimingDraw, (drawEnd - drawStart) * msPerCount);
+				mFrameStats.EndFrame();
+
+				CalculateFrameStats();
 			}
 			else
 			{
@@ -575,34 +588,30 @@ D3D12_CPU_DESCRIPTOR_HANDLE D3DApp::DepthStencilView()const
 
 void D3DApp::CalculateFrameStats()
 {
-	// Code computes the average frames per second, and also the 
-	// average time it takes to render one frame.  These stats 
-	// are appended to the window caption bar.
-    
-	static int frameCnt = 0;
-	static float timeElapsed = 0.0f;
+	// Once a second, the frame rate over that second and the rolling frame time
+	// statistics over the whole window are appended to the window caption bar.
+	// The percentiles show the stutters an average hides.
 
-	frameCnt++;
+	if( (mTimer.TotalTime() - mFrameStatsCaptionTime) < 1.0f )
+		return;
 
-	// Compute averages over one second period.
-	if( (mTimer.TotalTime() - timeElapsed) >= 1.0f )
-	{
-		float fps = (float)frameCnt; // fps = frameCnt / 1
-		float mspf = 1000.0f / fps;
+	mFrameStatsCaptionTime = mTimer.TotalTime();
 
-        wstring fpsStr = to_wstring(fps);
-        wstring mspfStr = to_wstring(mspf);
+	FrameStats::Summary frame = mFrameStats.Summarize(FrameStats::TimingFrame);
+	if( frame.Count == 0 || frame.Mean <= 0.0 )
+		return;
 
-        wstring windowText = mMainWndCaption +
-            L"    fps: " + fpsStr +
-            L"   mspf: " + mspfStr;
+	float fps = (float)mFrameStats.FramesPerSecond(mTimer.TotalTime());
 
-        SetWindowText(mhMainWnd, windowText.c_str());
-		
-		// Reset for next average.
-		frameCnt = 0;
-		timeElapsed += 1.0f;
-	}
+    wstring windowText = mMainWndCaption +
+        L"    fps: " + to_wstring(fps) +
+        L"   last " + to_wstring(frame.Count) + L" frames: mspf: " + to_wstring(frame.Mean) +
+        L"   p95: " + to_wstring(frame.P95) +
+        L"   p99: " + to_wstring(frame.P99) +
+        L"   max: " + to_wstring(frame.Max) +
+        L"   over budget: " + to_wstring(mFrameStats.FlaggedCount(FrameStats::FrameOverBudget));
+
+    SetWindowText(mhMainWnd, windowText.c_str());
 }
 
 void D3DApp::LogAdapters()
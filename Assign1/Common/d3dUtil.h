@@ -28,6 +28,7 @@
 #include "d3dx12.h"
 #include "DDSTextureLoader.h"
 #include "MathHelper.h"
+#include "Light.h"
 
 extern const int gNumFrameResources;
 
@@ -112,6 +113,19 @@ public:
         return (byteSize + 255) & ~255;
     }
 
+    // 64-bit FNV-1a.  Pass a previous result as hash to continue hashing more data.
+    static std::uint64_t HashBytes(const void* data, size_t byteSize,
+        std::uint64_t hash = 14695981039346656037ull)
+    {
+        const BYTE* bytes = reinterpret_cast<const BYTE*>(data);
+        for(size_t i = 0; i < byteSize; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
     static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring& filename);
 
     static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
@@ -121,11 +135,15 @@ public:
         UINT64 byteSize,
         Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 
+	// Debug builds compile shaders with debug info and without optimization.
+	static UINT DefaultShaderCompileFlags();
+
 	static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(
 		const std::wstring& filename,
 		const D3D_SHADER_MACRO* defines,
 		const std::string& entrypoint,
-		const std::string& target);
+		const std::string& target,
+		UINT compileFlags = DefaultShaderCompileFlags());
 };
 
 class DxException
@@ -146,6 +164,7 @@ public:
 // geometries are stored in one vertex and index buffer.  It provides the offsets
 // and data needed to draw a subset of geometry stores in the vertex and index 
 // buffers so that we can implement the technique described by Figure 6.3.
+// Geometry sub-allocated from a GeometryPool uses offsets into the pool buffers.
 struct SubmeshGeometry
 {
 	UINT IndexCount = 0;
@@ -170,6 +189,8 @@ struct MeshGeometry
 	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferGPU = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferGPU = nullptr;
 
+	// Only used with d3dUtil::CreateDefaultBuffer.  Buffers created through an
+	// UploadBatcher leave these null; the batcher reclaims its staging memory itself.
 	Microsoft::WRL::ComPtr<ID3D12Resource> VertexBufferUploader = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> IndexBufferUploader = nullptr;
 
@@ -181,8 +202,28 @@ struct MeshGeometry
 
 	// A MeshGeometry may store multiple geometries in one vertex/index buffer.
 	// Use this container to define the Submesh geometries so we can draw
-	// the Submeshes individually.
-	std::unordered_map<std::string, SubmeshGeometry> DrawArgs;
+	// the Submeshes individually.  Submeshes are looked up by name once with
+	// FindSubmesh and addressed by index afterwards.
+	std::vector<SubmeshGeometry> Submeshes;
+	std::vector<std::string> SubmeshNames;
+
+	UINT AddSubmesh(const std::string& name, const SubmeshGeometry& submesh)
+	{
+		Submeshes.push_back(submesh);
+		SubmeshNames.push_back(name);
+		return (UINT)Submeshes.size() - 1;
+	}
+
+	// Returns ~0u if there is no submesh of that name.
+	UINT FindSubmesh(const std::string& name)const
+	{
+		for(size_t i = 0; i < SubmeshNames.size(); ++i)
+		{
+			if(SubmeshNames[i] == name)
+				return (UINT)i;
+		}
+		return ~0u;
+	}
 
 	D3D12_VERTEX_BUFFER_VIEW VertexBufferView()const
 	{
@@ -212,18 +253,6 @@ struct MeshGeometry
 	}
 };
 
-struct Light
-{
-    DirectX::XMFLOAT3 Strength = { 0.5f, 0.5f, 0.5f };
-    float FalloffStart = 1.0f;                          // point/spot light only
-    DirectX::XMFLOAT3 Direction = { 0.0f, -1.0f, 0.0f };// directional/spot light only
-    float FalloffEnd = 10.0f;                           // point/spot light only
-    DirectX::XMFLOAT3 Position = { 0.0f, 0.0f, 0.0f };  // point/spot light only
-    float SpotPower = 64.0f;                            // spot light only
-};
-
-#define MaxLights 16
-
 struct MaterialConstants
 {
 	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 0.0f, 1.0f };
@@ -270,6 +299,9 @@ struct Texture
 
 	std::wstring Filename;
 
+	// Index of the texture's SRV in the shader-visible descriptor heap.
+	int SrvHeapIndex = -1;
+
 	Microsoft::WRL::ComPtr<ID3D12Resource> Resource = nullptr;
 	Microsoft::WRL::ComPtr<ID3D12Resource> UploadHeap = nullptr;
 };
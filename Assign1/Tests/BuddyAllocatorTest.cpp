@@ -0,0 +1,145 @@
+//***************************************************************************************
+// BuddyAllocatorTest.cpp
+//
+// Drives BuddyAllocator over a small range: block rounding, splitting, buddies
+// merging back on Free, requests that cannot fit, and the fragmentation stats,
+// validating the free lists after every step.
+//***************************************************************************************
+
+#include "../Common/BuddyAllocator.h"
+#include "TestCheck.h"
+
+namespace
+{
+    const uint64_t Invalid = BuddyAllocator::InvalidOffset;
+
+    void TestSplitAndMerge()
+    {
+        BuddyAllocator alloc(1024, 64);
+        CHECK(alloc.Validate());
+        CHECK(alloc.Empty());
+        CHECK(alloc.BlockSize(1) == 64);
+        CHECK(alloc.BlockSize(64) == 64);
+        CHECK(alloc.BlockSize(65) == 128);
+
+        // 100 bytes take a 128 byte block at the bottom, leaving free blocks of
+        // 128, 256 and 512 above it.
+        uint64_t a = alloc.Allocate(100);
+        CHECK(a == 0);
+        CHECK(alloc.Validate());
+
+        BuddyAllocator::Stats stats = alloc.GetStats();
+        CHECK(stats.TotalBytes == 1024);
+        CHECK(stats.AllocatedBytes == 128);
+        CHECK(stats.RequestedBytes == 100);
+        CHECK(stats.FreeBytes == 896);
+        CHECK(stats.FreeBlockCount == 3);
+        CHECK(stats.LargestFreeBlock == 512);
+        CHECK(stats.AllocationCount == 1);
+        CHECK(stats.InternalFragmentation() == 1.0f - 100.0f / 128.0f);
+
+        // The smallest block splits the free 128, not the 512.
+        uint64_t b = alloc.Allocate(64);
+        CHECK(b == 128);
+        uint64_t c = alloc.Allocate(300);
+        CHECK(c == 512);
+        CHECK(alloc.Validate());
+        CHECK(alloc.GetStats().FreeBlockCount == 2);
+
+        // Nothing free is large enough, or the request is degenerate.
+        CHECK(alloc.Allocate(600) == Invalid);
+        CHECK(alloc.Allocate(0) == Invalid);
+        CHECK(alloc.Allocate(2048) == Invalid);
+
+        // b merges with its free buddy into 128, which cannot merge with a.
+        alloc.Free(b);
+        CHECK(alloc.Validate());
+        stats = alloc.GetStats();
+        CHECK(stats.FreeBlockCount == 2);
+        CHECK(stats.LargestFreeBlock == 256);
+
+        // a merges all the way up to the lower half, which waits on c.
+        alloc.Free(a);
+        CHECK(alloc.Validate());
+        stats = alloc.GetStats();
+        CHECK(stats.FreeBlockCount == 1);
+        CHECK(stats.LargestFreeBlock == 512);
+        CHECK(stats.ExternalFragmentation() == 0.0f);
+
+        alloc.Free(c);
+        CHECK(alloc.Validate());
+        CHECK(alloc.Empty());
+        stats = alloc.GetStats();
+        CHECK(stats.FreeBlockCount == 1);
+        CHECK(stats.LargestFreeBlock == 1024);
+        CHECK(stats.RequestedBytes == 0);
+        CHECK(stats.InternalFragmentation() == 0.0f);
+
+        // The whole range is one block again.
+        CHECK(alloc.Allocate(1024) == 0);
+        CHECK(alloc.Validate());
+    }
+
+    void TestFragmentation()
+    {
+        BuddyAllocator alloc(1024, 64);
+        uint64_t blocks[4];
+        for(int i = 0; i < 4; ++i)
+            blocks[i] = alloc.Allocate(256);
+        CHECK(blocks[0] == 0 && blocks[1] == 256 && blocks[2] == 512 && blocks[3] == 768);
+        CHECK(alloc.GetStats().FreeBytes == 0);
+        CHECK(alloc.GetStats().ExternalFragmentation() == 0.0f);
+
+        // Two free 256 blocks that are not buddies: half the free space is unusable
+        // for a 512 request.
+        alloc.Free(blocks[0]);
+        alloc.Free(blocks[2]);
+        CHECK(alloc.Validate());
+
+        BuddyAllocator::Stats stats = alloc.GetStats();
+        CHECK(stats.FreeBytes == 512);
+        CHECK(stats.LargestFreeBlock == 256);
+        CHECK(stats.FreeBlockCount == 2);
+        CHECK(stats.ExternalFragmentation() == 0.5f);
+        CHECK(alloc.Allocate(512) == Invalid);
+
+        // Freeing a buddy fixes it.
+        alloc.Free(blocks[1]);
+        CHECK(alloc.Validate());
+        CHECK(alloc.GetStats().LargestFreeBlock == 512);
+        CHECK(alloc.Allocate(512) == 0);
+        CHECK(alloc.Validate());
+    }
+
+    // Many small allocations freed in a scattered order still merge back to one block.
+    void TestScatteredFree()
+    {
+        BuddyAllocator alloc(1 << 16, 64);
+        uint64_t offsets[64];
+        for(int i = 0; i < 64; ++i)
+        {
+            offsets[i] = alloc.Allocate(1 + (i * 37) % 1024);
+            CHECK(offsets[i] != Invalid);
+        }
+        CHECK(alloc.Validate());
+
+        for(int i = 0; i < 64; ++i)
+        {
+            alloc.Free(offsets[(i * 23) % 64]);
+            CHECK(alloc.Validate());
+        }
+
+        CHECK(alloc.Empty());
+        CHECK(alloc.GetStats().LargestFreeBlock == (1 << 16));
+        CHECK(alloc.GetStats().FreeBlockCount == 1);
+    }
+}
+
+int main()
+{
+    TestSplitAndMerge();
+    TestFragmentation();
+    TestScatteredFree();
+
+    return TestResult("BuddyAllocatorTest");
+}
@@ -0,0 +1,302 @@
+//***************************************************************************************
+// CommandCaptureTest.cpp
+//
+// Captures three frames recorded through CommandStreamRecorder, with buffer snapshots
+// that change, stay the same and appear, saves them, loads them back and replays them
+// with CommandReplay against the recording backend: the snapshots that repeat are
+// marked and not counted as uploaded, the redundant state changes are counted per
+// call type, the replayed stream is the one that was captured, and the object names
+// resolve to live objects.  Also checks that damaged files are rejected.
+//
+// The capture is left in CommandCaptureTest.ccap for the ReplayCapture tool's test.
+//***************************************************************************************
+
+#include "../Common/CommandReplay.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <map>
+#include <sstream>
+
+namespace
+{
+    const UINT FrameCount = 3;
+    const UINT DrawsPerFrame = 4;
+    const UINT CommandsPerFrame = 10 + 5*DrawsPerFrame;
+
+    // Per frame: the second viewport, the second PSO, and every vertex buffer, index
+    // buffer and topology after the first draw's.
+    const UINT RedundantPerFrame = 2 + 3*(DrawsPerFrame - 1);
+
+    const D3D12_GPU_VIRTUAL_ADDRESS PassAddress = 0x10000;
+    const D3D12_GPU_VIRTUAL_ADDRESS MaterialAddress = 0x20000;
+    const D3D12_GPU_VIRTUAL_ADDRESS LightAddress = 0x30000;
+
+    // Stand-ins for the D3D objects.  The recorder only stores their addresses.
+    char gObjects[8];
+
+    template<typename T>
+    T* Object(int i)
+    {
+        return reinterpret_cast<T*>(&gObjects[i]);
+    }
+
+    const std::map<void*, std::string> gNames =
+    {
+        { &gObjects[0], "BackBuffer" },
+        { &gObjects[1], "DescriptorHeap" },
+        { &gObjects[2], "PSO" },
+        { &gObjects[3], "RootSignature" },
+    };
+
+    std::string NameOf(void* object)
+    {
+        auto it = gNames.find(object);
+        return it != gNames.end() ? it->second : std::string();
+    }
+
+    D3D12_RESOURCE_BARRIER Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+    {
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barrier.Transition.pResource = resource;
+        barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        barrier.Transition.StateBefore = before;
+        barrier.Transition.StateAfter = after;
+        return barrier;
+    }
+
+    void RecordFrame(CommandRecorder* cmdList)
+    {
+        ID3D12Resource* backBuffer = Object<ID3D12Resource>(0);
+        ID3D12DescriptorHeap* heap = Object<ID3D12DescriptorHeap>(1);
+        ID3D12PipelineState* pso = Object<ID3D12PipelineState>(2);
+        ID3D12RootSignature* rootSignature = Object<ID3D12RootSignature>(3);
+
+        D3D12_RESOURCE_BARRIER toTarget = Transition(backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        cmdList->ResourceBarrier(1, &toTarget);
+        cmdList->SetDescriptorHeaps(1, &heap);
+
+        D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 800.0f, 600.0f, 0.0f, 1.0f };
+        D3D12_RECT scissor = { 0, 0, 800, 600 };
+        cmdList->RSSetViewports(1, &viewport);
+        cmdList->RSSetViewports(1, &viewport);
+        cmdList->RSSetScissorRects(1, &scissor);
+
+        cmdList->SetPipelineState(pso);
+        cmdList->SetGraphicsRootSignature(rootSignature);
+        cmdList->SetGraphicsRootConstantBufferView(2, PassAddress);
+
+        D3D12_VERTEX_BUFFER_VIEW vbv = { 0x40000, 24*1000, 24 };
+        D3D12_INDEX_BUFFER_VIEW ibv = { 0x50000, 4*3000, DXGI_FORMAT_R32_UINT };
+        for(UINT d = 0; d < DrawsPerFrame; ++d)
+        {
+            UINT constants[2] = { d, 7 };
+            cmdList->SetGraphicsRoot32BitConstants(0, 2, constants, 0);
+            cmdList->IASetVertexBuffers(0, 1, &vbv);
+            cmdList->IASetIndexBuffer(&ibv);
+            cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            cmdList->DrawIndexedInstanced(36, 1, d*36, 0, 0);
+        }
+
+        cmdList->SetPipelineState(pso);
+
+        D3D12_RESOURCE_BARRIER toPresent = Transition(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        cmdList->ResourceBarrier(1, &toPresent);
+    }
+
+    // The pass constants change every frame, the materials never do, and the
+    // lights only appear in the last frame.
+    void MakeCapture(CommandCapture& capture, CommandStreamRecorder& stream)
+    {
+        std::vector<BYTE> material(512, 0x5a);
+        for(UINT f = 0; f < FrameCount; ++f)
+        {
+            stream.Clear();
+            RecordFrame(&stream);
+
+            std::vector<BYTE> pass(256, (BYTE)f);
+            capture.BeginFrame();
+            capture.AddBufferData(PassAddress, pass.data(), pass.size());
+            capture.AddBufferData(MaterialAddress, material.data(), material.size());
+            if(f == FrameCount - 1)
+            {
+                std::vector<BYTE> lights(64, 0xee);
+                capture.AddBufferData(LightAddress, lights.data(), lights.size());
+            }
+            capture.EndFrame(stream, NameOf);
+        }
+    }
+
+    void CheckFrames(const CommandCapture& capture, const std::vector<BYTE>& commands)
+    {
+        CHECK(capture.FrameCount() == FrameCount);
+        if(capture.FrameCount() != FrameCount)
+            return;
+
+        for(UINT f = 0; f < FrameCount; ++f)
+        {
+            const CommandCapture::Frame& frame = capture.GetFrame(f);
+            CHECK(frame.Commands == commands);
+            CHECK((frame.ObjectNames == std::vector<std::string>{ "BackBuffer", "DescriptorHeap", "PSO", "RootSignature" }));
+            CHECK(frame.Buffers.size() == (f == FrameCount - 1 ? 3u : 2u));
+            CHECK(frame.Buffers[0].GpuAddress == PassAddress && !frame.Buffers[0].Repeat);
+            CHECK(frame.Buffers[0].Data == std::vector<BYTE>(256, (BYTE)f));
+            CHECK(frame.Buffers[1].GpuAddress == MaterialAddress && frame.Buffers[1].Repeat == (f > 0));
+            CHECK(frame.Buffers[1].Data == std::vector<BYTE>(512, 0x5a));
+        }
+
+        CHECK(capture.GetFrame(0).UploadedBytes() == 256 + 512);
+        CHECK(capture.GetFrame(1).UploadedBytes() == 256);
+        CHECK(capture.GetFrame(2).UploadedBytes() == 256 + 64);
+    }
+
+    void TestSaveLoadReplay()
+    {
+        CommandCapture capture;
+        CommandStreamRecorder stream;
+        capture.SetSession(0x1234567890ull);
+        MakeCapture(capture, stream);
+        const std::vector<BYTE> commands = stream.GetStream();
+        CheckFrames(capture, commands);
+
+        // Through a stream, and through a file.
+        std::stringstream buffer;
+        CHECK(capture.Save(buffer));
+
+        CommandCapture loaded;
+        CHECK(loaded.Load(buffer));
+        CHECK(loaded.GetSession() == 0x1234567890ull);
+        CheckFrames(loaded, commands);
+
+        CHECK(capture.Save(L"CommandCaptureTest.ccap"));
+        CommandCapture fromFile;
+        CHECK(fromFile.Load(L"CommandCaptureTest.ccap"));
+        CheckFrames(fromFile, commands);
+
+        // The repeats cost nothing in the file: the material is written once.
+        const size_t fileBytes = buffer.str().size();
+        CHECK(fileBytes < 3*commands.size() + 3*256 + 2*512 + 64 + 1024);
+
+        // Replaying with the ids passed through records the captured stream again.
+        CommandStreamRecorder target;
+        CommandReplay replay(&target);
+        for(UINT f = 0; f < loaded.FrameCount(); ++f)
+        {
+            target.Clear();
+            replay.ReplayFrame(loaded.GetFrame(f));
+            CHECK(target.GetStream() == commands);
+            CHECK(target.GetObjects().size() == 4);
+        }
+
+        const CommandReplay::Report& report = replay.GetReport();
+        CHECK(report.Frames == FrameCount);
+        CHECK(report.Commands == FrameCount*CommandsPerFrame);
+        CHECK(report.RedundantCommands == FrameCount*RedundantPerFrame);
+        CHECK(report.BytesUploaded == (256 + 512) + 256 + (256 + 64));
+
+        typedef CommandStreamRecorder R;
+        CHECK(report.Calls[R::CmdRSSetViewports].Calls == 2*FrameCount);
+        CHECK(report.Calls[R::CmdRSSetViewports].Redundant == FrameCount);
+        CHECK(report.Calls[R::CmdSetPipelineState].Redundant == FrameCount);
+        CHECK(report.Calls[R::CmdIASetVertexBuffers].Redundant == (DrawsPerFrame - 1)*FrameCount);
+        CHECK(report.Calls[R::CmdIASetIndexBuffer].Redundant == (DrawsPerFrame - 1)*FrameCount);
+        CHECK(report.Calls[R::CmdIASetPrimitiveTopology].Redundant == (DrawsPerFrame - 1)*FrameCount);
+        CHECK(report.Calls[R::CmdSetGraphicsRoot32BitConstants].Redundant == 0);
+        CHECK(report.Calls[R::CmdSetDescriptorHeaps].Redundant == 0);
+        CHECK(report.Calls[R::CmdDrawIndexedInstanced].Calls == DrawsPerFrame*FrameCount);
+        CHECK(report.Milliseconds >= 0.0);
+
+        CHECK(replay.FormatReport().find("Replayed 3 frames: 90 commands, 33 redundant, 1344 bytes uploaded") == 0);
+    }
+
+    // The names map back to live objects for a replay on a device.
+    void TestResolveObjects()
+    {
+        CommandCapture capture;
+        CommandStreamRecorder stream;
+        MakeCapture(capture, stream);
+
+        char live[4];
+        std::map<std::string, void*> liveObjects =
+        {
+            { "BackBuffer", &live[0] },
+            { "DescriptorHeap", &live[1] },
+            { "PSO", &live[2] },
+            { "RootSignature", &live[3] },
+        };
+        auto find = [&liveObjects](const std::string& name) -> void*
+        {
+            auto it = liveObjects.find(name);
+            return it != liveObjects.end() ? it->second : nullptr;
+        };
+
+        std::vector<void*> objects;
+        std::vector<std::string> missing;
+        CHECK(CommandCapture::ResolveObjects(capture.GetFrame(0), find, objects, &missing));
+        CHECK((objects == std::vector<void*>{ &live[0], &live[1], &live[2], &live[3] }));
+        CHECK(missing.empty());
+
+        // Replayed with the live table, the stream refers to the live objects.
+        CommandStreamRecorder target;
+        CommandReplay replay(&target);
+        replay.ReplayFrame(capture.GetFrame(0), objects.data(), (UINT)objects.size());
+        CHECK(target.GetObjects() == objects);
+
+        liveObjects.erase("PSO");
+        CHECK(!CommandCapture::ResolveObjects(capture.GetFrame(0), find, objects, &missing));
+        CHECK((missing == std::vector<std::string>{ "PSO" }));
+
+        // An unnamed object cannot be resolved at all.
+        CommandCapture unnamed;
+        unnamed.BeginFrame();
+        unnamed.EndFrame(stream);
+        CHECK(unnamed.GetFrame(0).ObjectNames == std::vector<std::string>(4));
+        CHECK(!CommandCapture::ResolveObjects(unnamed.GetFrame(0), find, objects));
+    }
+
+    void TestDamagedFiles()
+    {
+        CommandCapture capture;
+        CommandStreamRecorder stream;
+        MakeCapture(capture, stream);
+
+        std::stringstream buffer;
+        capture.Save(buffer);
+        const std::string file = buffer.str();
+
+        CommandCapture loaded;
+
+        // Every truncation fails, and leaves the capture empty.
+        bool allFailed = true;
+        for(size_t size = 0; size < file.size(); size += 7)
+        {
+            std::istringstream in(file.substr(0, size));
+            allFailed = allFailed && !loaded.Load(in) && loaded.FrameCount() == 0;
+        }
+        CHECK(allFailed);
+
+        std::istringstream longer(file + "x");
+        CHECK(!loaded.Load(longer));
+
+        std::string otherVersion = file;
+        otherVersion[4] = 1;
+        std::istringstream in(otherVersion);
+        CHECK(!loaded.Load(in));
+
+        CHECK(!loaded.Load(L"NoSuchCapture.ccap"));
+
+        std::istringstream good(file);
+        CHECK(loaded.Load(good));
+        CHECK(loaded.FrameCount() == FrameCount);
+    }
+}
+
+int main()
+{
+    TestSaveLoadReplay();
+    TestResolveObjects();
+    TestDamagedFiles();
+
+    return TestResult("CommandCaptureTest");
+}
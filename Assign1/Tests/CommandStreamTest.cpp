@@ -0,0 +1,203 @@
+//***************************************************************************************
+// CommandStreamTest.cpp
+//
+// Records a synthetic large scene through CommandStreamRecorder, without a device, and
+// checks the call statistics, the hash, and that Replay and Dump round-trip.  Also
+// reports the CPU cost of recording a frame.
+//***************************************************************************************
+
+#include "../Common/CommandStream.h"
+#include "../Common/ClockSource.h"
+#include "TestCheck.h"
+
+#include <stdexcept>
+
+namespace
+{
+    const UINT DrawCount = 20000;
+    const UINT DrawsPerMesh = 50;
+    const UINT DrawsPerPso = 2000;
+    const UINT IndicesPerDraw = 36;
+
+    // Stand-ins for the D3D objects.  The recorder only stores their addresses.
+    char gObjects[16];
+
+    template<typename T>
+    T* Object(int i)
+    {
+        return reinterpret_cast<T*>(&gObjects[i]);
+    }
+
+    D3D12_RESOURCE_BARRIER Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+    {
+        D3D12_RESOURCE_BARRIER barrier = {};
+        barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+        barrier.Transition.pResource = resource;
+        barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+        barrier.Transition.StateBefore = before;
+        barrier.Transition.StateAfter = after;
+        return barrier;
+    }
+
+    // A frame shaped like ShapesApp's: target setup, then every draw setting its
+    // object and material indices as root constants, with the mesh bindings and PSO
+    // changing now and then.  changedDraw, if below DrawCount, gets a different
+    // start index.
+    void RecordScene(CommandRecorder* cmdList, UINT changedDraw = DrawCount)
+    {
+        ID3D12Resource* backBuffer = Object<ID3D12Resource>(0);
+        ID3D12Resource* argumentBuffer = Object<ID3D12Resource>(1);
+        ID3D12DescriptorHeap* heap = Object<ID3D12DescriptorHeap>(2);
+        ID3D12RootSignature* rootSignature = Object<ID3D12RootSignature>(3);
+        ID3D12CommandSignature* commandSignature = Object<ID3D12CommandSignature>(4);
+
+        D3D12_RESOURCE_BARRIER toTarget = Transition(backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+        cmdList->ResourceBarrier(1, &toTarget);
+
+        D3D12_VIEWPORT viewport = { 0.0f, 0.0f, 1920.0f, 1080.0f, 0.0f, 1.0f };
+        D3D12_RECT scissor = { 0, 0, 1920, 1080 };
+        cmdList->RSSetViewports(1, &viewport);
+        cmdList->RSSetScissorRects(1, &scissor);
+
+        D3D12_CPU_DESCRIPTOR_HANDLE rtv = { 0x1000 };
+        D3D12_CPU_DESCRIPTOR_HANDLE dsv = { 0x2000 };
+        const FLOAT clearColor[4] = { 0.0f, 0.2f, 0.4f, 1.0f };
+        cmdList->ClearRenderTargetView(rtv, clearColor, 1, &scissor);
+        cmdList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+        cmdList->OMSetRenderTargets(1, &rtv, true, &dsv);
+
+        cmdList->SetDescriptorHeaps(1, &heap);
+        cmdList->SetGraphicsRootSignature(rootSignature);
+        cmdList->SetGraphicsRootConstantBufferView(2, 0x100000);
+        cmdList->SetGraphicsRootShaderResourceView(3, 0x200000);
+        cmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+        for(UINT i = 0; i < DrawCount; ++i)
+        {
+            if(i % DrawsPerPso == 0)
+                cmdList->SetPipelineState(Object<ID3D12PipelineState>(5 + (i / DrawsPerPso) % 4));
+
+            if(i % DrawsPerMesh == 0)
+            {
+                D3D12_VERTEX_BUFFER_VIEW vbv = { 0x400000 + (UINT64)(i / DrawsPerMesh) * 0x10000, 0x10000, 32 };
+                D3D12_INDEX_BUFFER_VIEW ibv = { 0x800000, 0x100000, DXGI_FORMAT_R32_UINT };
+                cmdList->IASetVertexBuffers(0, 1, &vbv);
+                cmdList->IASetIndexBuffer(&ibv);
+            }
+
+            UINT indices[2] = { i, i % 64 };
+            cmdList->SetGraphicsRoot32BitConstants(0, 2, indices, 0);
+            cmdList->DrawIndexedInstanced(IndicesPerDraw, 1, i == changedDraw ? 1 : 0, 0, 0);
+        }
+
+        cmdList->ExecuteIndirect(commandSignature, 128, argumentBuffer, 0, nullptr, 0);
+
+        D3D12_RESOURCE_BARRIER toPresent = Transition(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        cmdList->ResourceBarrier(1, &toPresent);
+    }
+
+    UINT64 LineCount(const std::string& text)
+    {
+        UINT64 lines = 0;
+        for(char c : text)
+            lines += c == '\n' ? 1 : 0;
+        return lines;
+    }
+}
+
+int main()
+{
+    typedef CommandStreamRecorder S;
+
+    S stream;
+    RecordScene(&stream);
+
+    // Stats.
+    const S::Stats& stats = stream.GetStats();
+    const UINT meshChanges = DrawCount / DrawsPerMesh;
+    const UINT psoChanges = DrawCount / DrawsPerPso;
+
+    CHECK(stats.Calls[S::CmdResourceBarrier] == 2);
+    CHECK(stats.Calls[S::CmdClearRenderTargetView] == 1);
+    CHECK(stats.Calls[S::CmdClearDepthStencilView] == 1);
+    CHECK(stats.Calls[S::CmdRSSetViewports] == 1);
+    CHECK(stats.Calls[S::CmdRSSetScissorRects] == 1);
+    CHECK(stats.Calls[S::CmdOMSetRenderTargets] == 1);
+    CHECK(stats.Calls[S::CmdSetDescriptorHeaps] == 1);
+    CHECK(stats.Calls[S::CmdSetGraphicsRootSignature] == 1);
+    CHECK(stats.Calls[S::CmdSetPipelineState] == psoChanges);
+    CHECK(stats.Calls[S::CmdIASetVertexBuffers] == meshChanges);
+    CHECK(stats.Calls[S::CmdIASetIndexBuffer] == meshChanges);
+    CHECK(stats.Calls[S::CmdSetGraphicsRoot32BitConstants] == DrawCount);
+    CHECK(stats.Calls[S::CmdDrawIndexedInstanced] == DrawCount);
+    CHECK(stats.Calls[S::CmdExecuteIndirect] == 1);
+
+    UINT64 commands = 0;
+    for(UINT t = 0; t < S::CommandTypeCount; ++t)
+        commands += stats.Calls[t];
+    CHECK(stats.Commands == commands);
+    CHECK(stats.Bytes == stream.GetStream().size());
+    CHECK(stats.Barriers == 2);
+    CHECK(stats.Indices == (UINT64)DrawCount * IndicesPerDraw);
+
+    // Backbuffer, argument buffer, heap, root signature, command signature and four PSOs.
+    CHECK(stream.GetObjects().size() == 9);
+
+    // Hash: the same submission hashes the same, a one-argument change does not.
+    S again;
+    RecordScene(&again);
+    CHECK(again.Hash() == stream.Hash());
+    CHECK(again.GetStream() == stream.GetStream());
+
+    S changed;
+    RecordScene(&changed, DrawCount / 2);
+    CHECK(changed.Hash() != stream.Hash());
+    CHECK(changed.GetStream().size() == stream.GetStream().size());
+
+    // Replay into another stream reproduces it byte for byte, with the same objects.
+    S replayed;
+    stream.Replay(&replayed);
+    CHECK(replayed.GetStream() == stream.GetStream());
+    CHECK(replayed.GetObjects() == stream.GetObjects());
+    CHECK(replayed.Hash() == stream.Hash());
+    CHECK(replayed.GetStats().Indices == stats.Indices);
+
+    // Dump: one line per command plus one per barrier, and the same text after a replay.
+    std::string dump = stream.Dump();
+    CHECK(LineCount(dump) == stats.Commands + stats.Barriers);
+    CHECK(dump.compare(0, 17, "ResourceBarrier 1") == 0);
+    CHECK(dump.find("ExecuteIndirect #8 128 #9 0 #0 0\n") != std::string::npos);
+    CHECK(dump.find("ClearRenderTargetView 0x1000 0x0 0x3e4ccccd 0x3ecccccd 0x3f800000 1 (0 0 1920 1080)\n") != std::string::npos);
+    CHECK(replayed.Dump() == dump);
+    CHECK(changed.Dump() != dump);
+
+    // A truncated stream is rejected instead of read past its end.
+    bool threw = false;
+    try
+    {
+        S sink;
+        S::Replay(stream.GetStream().data(), stream.GetStream().size() - 1,
+            stream.GetObjects().data(), (UINT)stream.GetObjects().size(), &sink);
+    }
+    catch(const std::invalid_argument&)
+    {
+        threw = true;
+    }
+    CHECK(threw);
+
+    // Recording cost, for comparing builds on the same machine.
+    const int frames = 20;
+    std::unique_ptr<ClockSource> clock = CreateDefaultClock();
+    S bench;
+    std::int64_t start = clock->Now();
+    for(int i = 0; i < frames; ++i)
+    {
+        bench.Clear();
+        RecordScene(&bench);
+    }
+    double us = (clock->Now() - start) * clock->SecondsPerCount() * 1e6 / frames;
+    std::printf("Recorded %u draws (%llu commands, %llu bytes) in %.1f us per frame\n",
+        DrawCount, (unsigned long long)stats.Commands, (unsigned long long)stats.Bytes, us);
+
+    return TestResult("CommandStreamTest");
+}
@@ -0,0 +1,180 @@
+//***************************************************************************************
+// DescriptorAllocatorTest.cpp
+//
+// Drives DescriptorAllocator without a device: the persistent first-fit free list
+// with its merging, the per-frame transient ring as it wraps and frames are retired,
+// and the occupancy stats, validating the bookkeeping after every step.
+//***************************************************************************************
+
+#include "../Common/DescriptorAllocator.h"
+#include "TestCheck.h"
+
+namespace
+{
+    const uint32_t Invalid = DescriptorAllocator::InvalidIndex;
+
+    void TestPersistent()
+    {
+        DescriptorAllocator alloc(16, 0);
+        CHECK(alloc.Validate());
+
+        uint32_t a = alloc.AllocatePersistent(4);
+        uint32_t b = alloc.AllocatePersistent(4);
+        uint32_t c = alloc.AllocatePersistent(4);
+        CHECK(a == 0 && b == 4 && c == 8);
+        CHECK(alloc.Validate());
+
+        DescriptorAllocator::Stats stats = alloc.GetStats();
+        CHECK(stats.PersistentCapacity == 16);
+        CHECK(stats.PersistentUsed == 12);
+        CHECK(stats.PersistentAllocations == 3);
+        CHECK(stats.FreeRangeCount == 1);
+        CHECK(stats.LargestFreeRange == 4);
+        CHECK(stats.PersistentOccupancy() == 0.75f);
+
+        // Freeing the middle leaves two ranges of 4 that cannot hold 5.
+        alloc.FreePersistent(b);
+        CHECK(alloc.Validate());
+        stats = alloc.GetStats();
+        CHECK(stats.FreeRangeCount == 2);
+        CHECK(stats.LargestFreeRange == 4);
+        CHECK(alloc.AllocatePersistent(5) == Invalid);
+        CHECK(alloc.GetStats().FailedAllocations == 1);
+
+        // First fit takes the hole in the middle, not the tail.
+        uint32_t d = alloc.AllocatePersistent(2);
+        CHECK(d == 4);
+        CHECK(alloc.Validate());
+        CHECK(alloc.GetStats().FreeRangeCount == 2);
+
+        // Freeing d merges with the free range after it, freeing c with both sides.
+        alloc.FreePersistent(d);
+        CHECK(alloc.Validate());
+        CHECK(alloc.GetStats().FreeRangeCount == 2);
+
+        alloc.FreePersistent(c);
+        CHECK(alloc.Validate());
+        stats = alloc.GetStats();
+        CHECK(stats.FreeRangeCount == 1);
+        CHECK(stats.LargestFreeRange == 12);
+        CHECK(stats.PersistentUsed == 4);
+
+        uint32_t e = alloc.AllocatePersistent(12);
+        CHECK(e == 4);
+        CHECK(alloc.AllocatePersistent(1) == Invalid);
+        CHECK(alloc.GetStats().PersistentOccupancy() == 1.0f);
+        CHECK(alloc.GetStats().FreeRangeCount == 0);
+
+        // Freeing the first allocation then the second merges back to one range.
+        alloc.FreePersistent(a);
+        alloc.FreePersistent(e);
+        CHECK(alloc.Validate());
+        stats = alloc.GetStats();
+        CHECK(stats.PersistentUsed == 0);
+        CHECK(stats.PersistentAllocations == 0);
+        CHECK(stats.FreeRangeCount == 1);
+        CHECK(stats.LargestFreeRange == 16);
+        CHECK(stats.FailedAllocations == 2);
+
+        CHECK(alloc.AllocatePersistent(0) == Invalid);
+    }
+
+    // Three frame resources over a ring of 10.  A frame's slots are only reclaimed
+    // once BeginFrame comes back to its frame index.
+    void TestTransientRing()
+    {
+        DescriptorAllocator alloc(4, 10);
+        const uint32_t base = alloc.PersistentCount();
+
+        alloc.BeginFrame(0);
+        CHECK(alloc.AllocateTransient(4) == base + 0);
+        CHECK(alloc.AllocateTransient(3) == base + 4);
+        CHECK(alloc.Validate());
+
+        // Frame 0 is still in flight: 4 slots do not fit before the end of the ring
+        // and skipping to the start would run into it.
+        alloc.BeginFrame(1);
+        CHECK(alloc.GetStats().LastFrameUsed == 7);
+        CHECK(alloc.AllocateTransient(4) == Invalid);
+        CHECK(alloc.AllocateTransient(3) == base + 7);
+        CHECK(alloc.AllocateTransient(1) == Invalid);
+        CHECK(alloc.Validate());
+
+        DescriptorAllocator::Stats stats = alloc.GetStats();
+        CHECK(stats.TransientCapacity == 10);
+        CHECK(stats.TransientUsed == 10);
+        CHECK(stats.TransientOccupancy() == 1.0f);
+        CHECK(stats.TransientPeak == 10);
+        CHECK(stats.FailedAllocations == 2);
+
+        alloc.BeginFrame(2);
+        CHECK(alloc.GetStats().LastFrameUsed == 3);
+        CHECK(alloc.AllocateTransient(1) == Invalid);
+
+        // Back to frame 0: its slots at the start of the ring are reclaimed, frame 1's
+        // at the end are not.
+        alloc.BeginFrame(0);
+        CHECK(alloc.GetStats().LastFrameUsed == 0);
+        CHECK(alloc.GetStats().TransientUsed == 3);
+        CHECK(alloc.AllocateTransient(5) == base + 0);
+        CHECK(alloc.AllocateTransient(3) == Invalid);
+        CHECK(alloc.AllocateTransient(2) == base + 5);
+        CHECK(alloc.Validate());
+
+        // Frame 1 retires, and 4 slots from the head would straddle the end.
+        alloc.BeginFrame(1);
+        CHECK(alloc.GetStats().TransientUsed == 7);
+        CHECK(alloc.AllocateTransient(4) == Invalid);
+        CHECK(alloc.AllocateTransient(3) == base + 7);
+        CHECK(alloc.Validate());
+
+        CHECK(alloc.AllocateTransient(0) == Invalid);
+        CHECK(alloc.AllocateTransient(11) == Invalid);
+        CHECK(alloc.GetStats().TransientPeak == 10);
+    }
+
+    // An allocation that does not fit before the end of the ring skips the slots
+    // there and starts over at the bottom; the skipped slots count as used until
+    // the frame retires.
+    void TestTransientWrap()
+    {
+        DescriptorAllocator alloc(0, 10);
+
+        alloc.BeginFrame(0);
+        CHECK(alloc.AllocateTransient(6) == 0);
+        alloc.BeginFrame(1);
+        CHECK(alloc.AllocateTransient(2) == 6);
+
+        alloc.BeginFrame(0);
+        CHECK(alloc.GetStats().TransientUsed == 2);
+        CHECK(alloc.AllocateTransient(3) == 0);
+        CHECK(alloc.Validate());
+
+        DescriptorAllocator::Stats stats = alloc.GetStats();
+        CHECK(stats.TransientUsed == 7);
+        CHECK(stats.TransientOccupancy() == 0.7f);
+
+        alloc.BeginFrame(1);
+        CHECK(alloc.GetStats().LastFrameUsed == 5);
+        CHECK(alloc.GetStats().TransientUsed == 5);
+        CHECK(alloc.AllocateTransient(5) == 3);
+        CHECK(alloc.Validate());
+
+        // Retiring every frame empties the ring and puts the head back at the start.
+        alloc.BeginFrame(0);
+        alloc.BeginFrame(1);
+        CHECK(alloc.GetStats().TransientUsed == 0);
+        CHECK(alloc.AllocateTransient(10) == 0);
+        CHECK(alloc.Validate());
+        CHECK(alloc.GetStats().FailedAllocations == 0);
+    }
+}
+
+int main()
+{
+    TestPersistent();
+    TestTransientRing();
+    TestTransientWrap();
+
+    return TestResult("DescriptorAllocatorTest");
+}
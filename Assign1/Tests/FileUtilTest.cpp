@@ -0,0 +1,78 @@
+//***************************************************************************************
+// FileUtilTest.cpp
+//
+// WriteFileAtomic in the working directory: a new file, one replaced in place, text
+// written through a stream, and writes that fail before or during the rename, which
+// must leave the old contents and no temporary file behind.
+//***************************************************************************************
+
+#include "../Common/FileUtil.h"
+#include "TestCheck.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    const wchar_t* TestFile = L"FileUtilTest.bin";
+
+    std::string Read(const char* filename)
+    {
+        std::ifstream fin(filename, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+    }
+
+    bool Exists(const char* filename)
+    {
+        return std::ifstream(filename).good();
+    }
+
+    void TestWrite()
+    {
+        std::remove("FileUtilTest.bin");
+
+        CHECK(WriteFileAtomic(TestFile, "first", 5));
+        CHECK(Read("FileUtilTest.bin") == "first");
+        CHECK(!Exists("FileUtilTest.bin.tmp"));
+
+        // An existing file is replaced, not appended to.
+        CHECK(WriteFileAtomic(TestFile, "2nd", 3));
+        CHECK(Read("FileUtilTest.bin") == "2nd");
+
+        CHECK(WriteFileAtomic(TestFile, [](std::ostream& out) { out << "line " << 3 << "\n"; }, false));
+        CHECK(Read("FileUtilTest.bin") == "line 3\n");
+        CHECK(!Exists("FileUtilTest.bin.tmp"));
+
+        CHECK(WriteFileAtomic(TestFile, nullptr, 0));
+        CHECK(Read("FileUtilTest.bin").empty());
+    }
+
+    void TestFailure()
+    {
+        CHECK(WriteFileAtomic(TestFile, "keep", 4));
+
+        // A stream error leaves the old file alone.
+        CHECK(!WriteFileAtomic(TestFile, [](std::ostream& out)
+        {
+            out << "partial";
+            out.setstate(std::ios::badbit);
+        }));
+        CHECK(Read("FileUtilTest.bin") == "keep");
+        CHECK(!Exists("FileUtilTest.bin.tmp"));
+
+        // So does a directory that is not there.
+        CHECK(!WriteFileAtomic(L"NoSuchDirectory/FileUtilTest.bin", "x", 1));
+        CHECK(!Exists("NoSuchDirectory/FileUtilTest.bin.tmp"));
+
+        std::remove("FileUtilTest.bin");
+    }
+}
+
+int main()
+{
+    TestWrite();
+    TestFailure();
+
+    return TestResult("FileUtilTest");
+}
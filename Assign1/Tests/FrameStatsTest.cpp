@@ -0,0 +1,109 @@
+//***************************************************************************************
+// FrameStatsTest.cpp
+//
+// Feeds FrameStats synthetic frames and checks the rolling summaries, including
+// timings that are often exactly zero, the frame rate over the last second, and the
+// budget and spike flags.
+//***************************************************************************************
+
+#include "../Common/FrameStats.h"
+#include "TestCheck.h"
+
+#include <cmath>
+
+namespace
+{
+    bool Near(double a, double b, double relative)
+    {
+        return std::fabs(a - b) <= relative * std::fabs(b);
+    }
+
+    // Adds a frame of frameMs at time, with the given fence wait.
+    void AddFrame(FrameStats& stats, double& time, double frameMs, double fenceWaitMs)
+    {
+        time += frameMs / 1000.0;
+        stats.BeginFrame(time, frameMs);
+        stats.AddTime(FrameStats::TimingUpdate, frameMs * 0.25);
+        stats.AddTime(FrameStats::TimingFenceWait, fenceWaitMs);
+        stats.EndFrame();
+    }
+
+    void TestZeroTimings()
+    {
+        FrameStats stats(256);
+        double time = 0.0;
+
+        // A GPU that keeps up: the fence is never waited on.
+        for(int i = 0; i < 100; ++i)
+            AddFrame(stats, time, 16.0, 0.0);
+
+        FrameStats::Summary wait = stats.Summarize(FrameStats::TimingFenceWait);
+        CHECK(wait.Count == 100);
+        CHECK(wait.P50 == 0.0 && wait.P95 == 0.0 && wait.P99 == 0.0);
+        CHECK(wait.Min == 0.0 && wait.Max == 0.0);
+
+        // Then 10% of frames wait 4 ms: the median stays 0, the tail does not.
+        for(int i = 0; i < 100; ++i)
+            AddFrame(stats, time, 16.0, i % 10 == 0 ? 4.0 : 0.0);
+
+        wait = stats.Summarize(FrameStats::TimingFenceWait);
+        CHECK(wait.P50 == 0.0);
+        CHECK(Near(wait.P99, 4.0, 0.01));
+        CHECK(wait.Max == 4.0);
+
+        // Percentiles stay inside the observed range.
+        FrameStats::Summary frame = stats.Summarize(FrameStats::TimingFrame);
+        CHECK(frame.Min == 16.0 && frame.Max == 16.0);
+        CHECK(frame.P50 == 16.0 && frame.P99 == 16.0);
+        CHECK(Near(frame.Mean, 16.0, 1e-9));
+    }
+
+    void TestFramesPerSecond()
+    {
+        FrameStats stats(1024);
+        CHECK(stats.FramesPerSecond(0.0) == 0.0);
+
+        // Ten seconds at 100 fps, then one at 20: the window's mean is dominated by
+        // the fast frames, the last second is not.
+        double time = 0.0;
+        for(int i = 0; i < 1000; ++i)
+            AddFrame(stats, time, 10.0, 0.0);
+        CHECK(Near(stats.FramesPerSecond(time), 100.0, 0.02));
+
+        for(int i = 0; i < 20; ++i)
+            AddFrame(stats, time, 50.0, 0.0);
+
+        CHECK(Near(stats.FramesPerSecond(time), 20.0, 0.02));
+        CHECK(1000.0 / stats.Summarize(FrameStats::TimingFrame).Mean > 80.0);
+    }
+
+    void TestFlags()
+    {
+        FrameStats stats(64, 20.0, 2.0);
+        double time = 0.0;
+        for(int i = 0; i < 32; ++i)
+            AddFrame(stats, time, 10.0, 0.0);
+        CHECK(stats.OverBudgetCount() == 0 && stats.SpikeCount() == 0);
+
+        // Over the budget but not a spike, then both.
+        AddFrame(stats, time, 19.0, 0.0);
+        AddFrame(stats, time, 21.0, 0.0);
+        CHECK(stats.OverBudgetCount() == 1);
+        CHECK(stats.SpikeCount() == 1);
+        CHECK(stats.FlaggedCount(FrameStats::FrameOverBudget | FrameStats::FrameSpike) == 1);
+        CHECK(stats.GetRecord(stats.Size() - 1).Flags == (FrameStats::FrameOverBudget | FrameStats::FrameSpike));
+
+        stats.Clear();
+        CHECK(stats.Size() == 0 && stats.FrameCount() == 0);
+        CHECK(stats.Summarize(FrameStats::TimingFrame).Count == 0);
+    }
+}
+
+int main()
+{
+    TestZeroTimings();
+    TestFramesPerSecond();
+    TestFlags();
+
+    return TestResult("FrameStatsTest");
+}
@@ -0,0 +1,95 @@
+//***************************************************************************************
+// GameTimerTest.cpp
+//
+// Drives GameTimer from a ManualClockSource, so every reading is exact: delta and
+// total time across Reset, Tick, Stop and Start, with paused time left out of the
+// total, and a clock that steps backwards.
+//***************************************************************************************
+
+#include "../Common/GameTimer.h"
+#include "TestCheck.h"
+
+#include <cmath>
+
+namespace
+{
+    bool Near(double a, double b)
+    {
+        return std::fabs(a - b) < 1e-6;
+    }
+}
+
+int main()
+{
+    ManualClockSource clock(1000000000);
+    GameTimer timer(&clock);
+    CHECK(&timer.GetClock() == &clock);
+
+    timer.Reset();
+    CHECK(timer.TickOverhead() == 0.0);
+    CHECK(Near(timer.TotalTime(), 0.0));
+
+    // Running.
+    clock.Advance(0.016);
+    timer.Tick();
+    CHECK(Near(timer.DeltaTime(), 0.016));
+    CHECK(Near(timer.TotalTime(), 0.016));
+
+    clock.Advance(0.020);
+    timer.Tick();
+    CHECK(Near(timer.DeltaTime(), 0.020));
+    CHECK(Near(timer.TotalTime(), 0.036));
+
+    // Stopped: no delta, and the total holds where it stopped.
+    clock.Advance(0.004);
+    timer.Stop();
+    clock.Advance(5.0);
+    timer.Tick();
+    CHECK(timer.DeltaTime() == 0.0f);
+    CHECK(Near(timer.TotalTime(), 0.040));
+
+    // A second Stop does not move the stop time.
+    clock.Advance(1.0);
+    timer.Stop();
+    CHECK(Near(timer.TotalTime(), 0.040));
+
+    // Started again: the six paused seconds count for neither delta nor total.
+    timer.Start();
+    clock.Advance(0.010);
+    timer.Tick();
+    CHECK(Near(timer.DeltaTime(), 0.010));
+    CHECK(Near(timer.TotalTime(), 0.050));
+
+    // A second pause accumulates with the first.
+    timer.Stop();
+    clock.Advance(2.0);
+    timer.Start();
+    clock.Advance(0.030);
+    timer.Tick();
+    CHECK(Near(timer.DeltaTime(), 0.030));
+    CHECK(Near(timer.TotalTime(), 0.080));
+
+    // Start while running changes nothing.
+    timer.Start();
+    clock.Advance(0.005);
+    timer.Tick();
+    CHECK(Near(timer.DeltaTime(), 0.005));
+    CHECK(Near(timer.TotalTime(), 0.085));
+
+    // A clock that steps backwards gives a zero delta, not a negative one.
+    clock.Set(clock.Now() - 1000000);
+    timer.Tick();
+    CHECK(timer.DeltaTime() == 0.0f);
+    clock.Advance(0.016);
+    timer.Tick();
+    CHECK(Near(timer.DeltaTime(), 0.016));
+
+    // Reset starts the total again.
+    timer.Reset();
+    clock.Advance(0.25);
+    timer.Tick();
+    CHECK(Near(timer.TotalTime(), 0.25));
+    CHECK(Near(timer.DeltaTime(), 0.25));
+
+    return TestResult("GameTimerTest");
+}
@@ -0,0 +1,81 @@
+//***************************************************************************************
+// HeapManagerTest.cpp
+//
+// Drives HeapManager in its CPU-only mode, with no device: sub-allocation from a
+// heap, new heaps when one is full, dedicated heaps for oversized requests, and the
+// combined stats across heaps.
+//***************************************************************************************
+
+#include "../Common/HeapManager.h"
+#include "TestCheck.h"
+
+int main()
+{
+    const UINT64 KB = 1024;
+    const UINT64 MB = 1024 * KB;
+
+    // The heap size is rounded up to a power of two.
+    HeapManager heaps(nullptr, D3D12_HEAP_TYPE_DEFAULT, 1000 * KB);
+    CHECK(heaps.IsCpuOnly());
+    CHECK(heaps.GetStats().HeapCount == 0);
+    CHECK(heaps.Validate());
+
+    // Small buffers round up to the 64KB placement alignment.
+    HeapManager::Allocation a = heaps.Allocate(100);
+    CHECK(a.HeapIndex == 0 && a.Offset == 0 && a.Size == 64 * KB);
+
+    HeapManager::Allocation b = heaps.Allocate(200 * KB);
+    CHECK(b.HeapIndex == 0 && b.Size == 256 * KB);
+    CHECK(b.Offset % b.Size == 0);
+    CHECK(heaps.Validate());
+
+    HeapManager::Stats stats = heaps.GetStats();
+    CHECK(stats.HeapCount == 1);
+    CHECK(stats.ReservedBytes == 1 * MB);
+    CHECK(stats.AllocatedBytes == 320 * KB);
+    CHECK(stats.RequestedBytes == 100 + 200 * KB);
+    CHECK(stats.AllocationCount == 2);
+
+    // An oversized request gets a heap of its own, sized to it.
+    HeapManager::Allocation big = heaps.Allocate(3 * MB);
+    CHECK(big.HeapIndex == 1 && big.Offset == 0 && big.Size == 4 * MB);
+    stats = heaps.GetStats();
+    CHECK(stats.HeapCount == 2);
+    CHECK(stats.ReservedBytes == 5 * MB);
+
+    // The first heap takes what fits; the rest spills into a new heap.
+    HeapManager::Allocation c = heaps.Allocate(512 * KB);
+    CHECK(c.HeapIndex == 0 && c.Offset == 512 * KB);
+    HeapManager::Allocation d = heaps.Allocate(512 * KB);
+    CHECK(d.HeapIndex == 2 && d.Offset == 0);
+    CHECK(heaps.Validate());
+
+    stats = heaps.GetStats();
+    CHECK(stats.HeapCount == 3);
+    CHECK(stats.ReservedBytes == 6 * MB);
+    CHECK(stats.AllocationCount == 5);
+    CHECK(stats.LargestFreeBlock == 512 * KB);
+    CHECK(stats.InternalFragmentation() > 0.0f);
+
+    // Freed ranges are reused and the heaps are kept.
+    heaps.Free(b);
+    heaps.Free(big);
+    CHECK(heaps.Validate());
+    HeapManager::Allocation e = heaps.Allocate(2 * MB);
+    CHECK(e.HeapIndex == 1 && e.Offset == 0);
+
+    heaps.Free(a);
+    heaps.Free(c);
+    heaps.Free(d);
+    heaps.Free(e);
+    CHECK(heaps.Validate());
+
+    stats = heaps.GetStats();
+    CHECK(stats.HeapCount == 3);
+    CHECK(stats.AllocationCount == 0);
+    CHECK(stats.AllocatedBytes == 0);
+    CHECK(stats.LargestFreeBlock == 4 * MB);
+    CHECK(stats.FreeBlockCount == 3);
+
+    return TestResult("HeapManagerTest");
+}
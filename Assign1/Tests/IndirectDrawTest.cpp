@@ -0,0 +1,271 @@
+//***************************************************************************************
+// IndirectDrawTest.cpp
+//
+// Packs draws with IndirectDrawBuilder and runs them back through IndirectEmulator
+// with the builder's command signature: each draw comes out with its own arguments
+// and root constants, constants persist from one command and one Execute to the
+// next, a count buffer clamps the command count, draws past the index buffer are
+// counted and skipped, and malformed signatures and buffers are rejected.
+//***************************************************************************************
+
+#include "../Common/IndirectDraw.h"
+#include "TestCheck.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+    D3D12_DRAW_INDEXED_ARGUMENTS MakeArgs(UINT indexCount, UINT startIndex, INT baseVertex)
+    {
+        D3D12_DRAW_INDEXED_ARGUMENTS args;
+        args.IndexCountPerInstance = indexCount;
+        args.InstanceCount = 1;
+        args.StartIndexLocation = startIndex;
+        args.BaseVertexLocation = baseVertex;
+        args.StartInstanceLocation = 0;
+        return args;
+    }
+
+    struct Draw
+    {
+        D3D12_DRAW_INDEXED_ARGUMENTS Args;
+        UINT Constants[2];
+    };
+
+    std::vector<Draw> Run(IndirectEmulator& emulator, const IndirectDrawBuilder& builder,
+        UINT maxCommandCount, const UINT* countBuffer, UINT indexCount)
+    {
+        std::vector<Draw> draws;
+        emulator.Execute(builder.GetSignatureDesc(), maxCommandCount, builder.Data(), builder.ByteSize(),
+            countBuffer, indexCount,
+            [&](const IndirectEmulator& state, const D3D12_DRAW_INDEXED_ARGUMENTS& args)
+        {
+            draws.push_back({ args, { state.GetRootConstant(0, 0), state.GetRootConstant(0, 1) } });
+        });
+        return draws;
+    }
+
+    void TestRoundTrip()
+    {
+        IndirectDrawBuilder builder(0, 2);
+        CHECK(builder.ByteStride() == 2*sizeof(UINT) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS));
+
+        const D3D12_COMMAND_SIGNATURE_DESC& signature = builder.GetSignatureDesc();
+        CHECK(signature.ByteStride == builder.ByteStride());
+        CHECK(signature.NumArgumentDescs == 2);
+        CHECK(signature.pArgumentDescs[0].Type == D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT);
+        CHECK(signature.pArgumentDescs[0].Constant.Num32BitValuesToSet == 2);
+        CHECK(signature.pArgumentDescs[1].Type == D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED);
+
+        for(UINT i = 0; i < 5; ++i)
+        {
+            const UINT constants[2] = { i, 100 + i };
+            builder.AddDraw(constants, MakeArgs(36, i*36, (INT)i*24));
+        }
+        CHECK(builder.CommandCount() == 5);
+        CHECK(builder.ByteSize() == 5*(UINT64)builder.ByteStride());
+
+        IndirectEmulator emulator;
+        std::vector<Draw> draws = Run(emulator, builder, builder.CommandCount(), nullptr, 5*36);
+        CHECK(draws.size() == 5);
+        for(UINT i = 0; i < draws.size(); ++i)
+        {
+            CHECK(draws[i].Constants[0] == i);
+            CHECK(draws[i].Constants[1] == 100 + i);
+            CHECK(draws[i].Args.IndexCountPerInstance == 36);
+            CHECK(draws[i].Args.StartIndexLocation == i*36);
+            CHECK(draws[i].Args.BaseVertexLocation == (INT)i*24);
+        }
+
+        const IndirectEmulator::Stats& stats = emulator.GetStats();
+        CHECK(stats.Commands == 5);
+        CHECK(stats.Draws == 5);
+        CHECK(stats.Indices == 5*36);
+        CHECK(stats.OutOfRange == 0);
+
+        // Without constants the signature is the draw alone.
+        IndirectDrawBuilder drawsOnly(0, 0);
+        CHECK(drawsOnly.ByteStride() == sizeof(D3D12_DRAW_INDEXED_ARGUMENTS));
+        CHECK(drawsOnly.GetSignatureDesc().NumArgumentDescs == 1);
+        CHECK(drawsOnly.GetSignatureDesc().pArgumentDescs[0].Type == D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED);
+        drawsOnly.AddDraw(nullptr, MakeArgs(6, 0, 0));
+        CHECK(Run(emulator, drawsOnly, 1, nullptr, 6).size() == 1);
+
+        builder.Reset();
+        CHECK(builder.CommandCount() == 0);
+        CHECK(builder.ByteSize() == 0);
+    }
+
+    // A signature that sets one constant per command leaves the other where the
+    // last command (or the last Execute) put it.
+    void TestConstantsPersist()
+    {
+        D3D12_INDIRECT_ARGUMENT_DESC descs[2] = {};
+        descs[0].Type = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+        descs[0].Constant.RootParameterIndex = 0;
+        descs[0].Constant.DestOffsetIn32BitValues = 1;
+        descs[0].Constant.Num32BitValuesToSet = 1;
+        descs[1].Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+        D3D12_COMMAND_SIGNATURE_DESC signature = {};
+        signature.ByteStride = sizeof(UINT) + sizeof(D3D12_DRAW_INDEXED_ARGUMENTS);
+        signature.NumArgumentDescs = 2;
+        signature.pArgumentDescs = descs;
+
+        IndirectEmulator emulator;
+        CHECK(emulator.GetRootConstant(0, 0) == 0);
+
+        // First set both constants with a full-width builder.
+        IndirectDrawBuilder builder(0, 2);
+        const UINT constants[2] = { 7, 1 };
+        builder.AddDraw(constants, MakeArgs(3, 0, 0));
+        Run(emulator, builder, 1, nullptr, 3);
+        CHECK(emulator.GetRootConstant(0, 0) == 7);
+        CHECK(emulator.GetRootConstant(0, 1) == 1);
+
+        std::vector<UINT> arguments;
+        for(UINT i = 0; i < 3; ++i)
+        {
+            D3D12_DRAW_INDEXED_ARGUMENTS args = MakeArgs(3, 0, 0);
+            const UINT* argWords = reinterpret_cast<const UINT*>(&args);
+            arguments.push_back(10 + i);
+            arguments.insert(arguments.end(), argWords, argWords + sizeof(args) / sizeof(UINT));
+        }
+
+        std::vector<UINT> seen;
+        emulator.Execute(signature, 3, arguments.data(), arguments.size()*sizeof(UINT), nullptr, 3,
+            [&](const IndirectEmulator& state, const D3D12_DRAW_INDEXED_ARGUMENTS&)
+        {
+            seen.push_back(state.GetRootConstant(0, 0));
+            seen.push_back(state.GetRootConstant(0, 1));
+        });
+        CHECK((seen == std::vector<UINT>{ 7, 10, 7, 11, 7, 12 }));
+
+        // Constants never set read as zero.
+        CHECK(emulator.GetRootConstant(0, 2) == 0);
+        CHECK(emulator.GetRootConstant(3, 0) == 0);
+    }
+
+    void TestCountBuffer()
+    {
+        IndirectDrawBuilder builder(0, 2);
+        for(UINT i = 0; i < 4; ++i)
+        {
+            const UINT constants[2] = { i, 0 };
+            builder.AddDraw(constants, MakeArgs(3, 0, 0));
+        }
+
+        IndirectEmulator emulator;
+
+        // The smaller of the count and the maximum wins.
+        UINT count = 2;
+        std::vector<Draw> draws = Run(emulator, builder, 4, &count, 3);
+        CHECK(draws.size() == 2);
+        CHECK(draws.back().Constants[0] == 1);
+
+        count = 100;
+        CHECK(Run(emulator, builder, 3, &count, 3).size() == 3);
+        CHECK(emulator.GetStats().Commands == 3);
+
+        count = 0;
+        CHECK(Run(emulator, builder, 4, &count, 3).empty());
+        CHECK(emulator.GetStats().Commands == 0);
+    }
+
+    void TestOutOfRange()
+    {
+        IndirectDrawBuilder builder(0, 2);
+        const UINT constants[2] = { 0, 0 };
+        builder.AddDraw(constants, MakeArgs(36, 0, 0));
+        builder.AddDraw(constants, MakeArgs(36, 36, 0));     // Ends exactly at the end.
+        builder.AddDraw(constants, MakeArgs(36, 40, 0));     // Runs past it.
+        builder.AddDraw(constants, MakeArgs(1, 72, 0));      // Starts at it.
+
+        IndirectEmulator emulator;
+        std::vector<Draw> draws = Run(emulator, builder, builder.CommandCount(), nullptr, 72);
+        CHECK(draws.size() == 2);
+
+        const IndirectEmulator::Stats& stats = emulator.GetStats();
+        CHECK(stats.Commands == 4);
+        CHECK(stats.Draws == 2);
+        CHECK(stats.OutOfRange == 2);
+        CHECK(stats.Indices == 72);
+    }
+
+    bool Throws(IndirectEmulator& emulator, const D3D12_COMMAND_SIGNATURE_DESC& signature,
+        UINT commandCount, const void* arguments, UINT64 argumentBytes)
+    {
+        bool drew = false;
+        try
+        {
+            emulator.Execute(signature, commandCount, arguments, argumentBytes, nullptr, 1000,
+                [&](const IndirectEmulator&, const D3D12_DRAW_INDEXED_ARGUMENTS&) { drew = true; });
+        }
+        catch(const std::invalid_argument&)
+        {
+            return !drew;
+        }
+        return false;
+    }
+
+    void TestMalformed()
+    {
+        IndirectDrawBuilder builder(0, 2);
+        const UINT constants[2] = { 1, 2 };
+        builder.AddDraw(constants, MakeArgs(3, 0, 0));
+        builder.AddDraw(constants, MakeArgs(3, 0, 0));
+
+        IndirectEmulator emulator;
+
+        // More commands than the buffer holds.
+        CHECK(Throws(emulator, builder.GetSignatureDesc(), 3, builder.Data(), builder.ByteSize()));
+
+        // A stride too small for the arguments is caught before the draw is read,
+        // so nothing past the command is touched.  The buffer is exactly one
+        // command long.
+        D3D12_COMMAND_SIGNATURE_DESC signature = builder.GetSignatureDesc();
+        signature.ByteStride = builder.ByteStride() - sizeof(UINT);
+        std::vector<BYTE> oneCommand(signature.ByteStride);
+        memcpy(oneCommand.data(), builder.Data(), oneCommand.size());
+        CHECK(Throws(emulator, signature, 1, oneCommand.data(), oneCommand.size()));
+
+        // Even too small for the constants.
+        signature.ByteStride = sizeof(UINT);
+        CHECK(Throws(emulator, signature, 1, oneCommand.data(), signature.ByteStride));
+
+        // A larger stride is fine: the padding is skipped.
+        std::vector<UINT> arguments;
+        for(int i = 0; i < 2; ++i)
+        {
+            const UINT* words = reinterpret_cast<const UINT*>(builder.Data());
+            arguments.insert(arguments.end(), words, words + builder.ByteStride() / sizeof(UINT));
+            arguments.push_back(0xdeadbeef);
+        }
+        signature = builder.GetSignatureDesc();
+        signature.ByteStride = builder.ByteStride() + sizeof(UINT);
+        UINT draws = 0;
+        emulator.Execute(signature, 2, arguments.data(), arguments.size()*sizeof(UINT), nullptr, 3,
+            [&](const IndirectEmulator&, const D3D12_DRAW_INDEXED_ARGUMENTS&) { ++draws; });
+        CHECK(draws == 2);
+
+        // Only constants and indexed draws are emulated.
+        D3D12_INDIRECT_ARGUMENT_DESC dispatch = {};
+        dispatch.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+        signature.NumArgumentDescs = 1;
+        signature.pArgumentDescs = &dispatch;
+        CHECK(Throws(emulator, signature, 1, arguments.data(), arguments.size()*sizeof(UINT)));
+    }
+}
+
+int main()
+{
+    TestRoundTrip();
+    TestConstantsPersist();
+    TestCountBuffer();
+    TestOutOfRange();
+    TestMalformed();
+
+    return TestResult("IndirectDrawTest");
+}
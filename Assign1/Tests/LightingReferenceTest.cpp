@@ -0,0 +1,201 @@
+//***************************************************************************************
+// LightingReferenceTest.cpp
+//
+// Checks that the eight-wide LightingReference::ComputeLighting8 agrees with the
+// scalar ComputeLighting, which follows the shader line for line, over random
+// samples lit by a mix of directional, point and spot lights, including samples out
+// of range of the local lights, where the eight-wide version masks lanes instead of
+// returning early.
+//***************************************************************************************
+
+#include "../Common/LightingReference.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    typedef LightingReference LR;
+
+    const float Tolerance = 1e-4f;
+
+    std::mt19937 gRandom(1234);
+
+    float Random(float a, float b)
+    {
+        return std::uniform_real_distribution<float>(a, b)(gRandom);
+    }
+
+    XMFLOAT3 RandomUnit()
+    {
+        for(;;)
+        {
+            XMFLOAT3 v = { Random(-1.0f, 1.0f), Random(-1.0f, 1.0f), Random(-1.0f, 1.0f) };
+            float len = std::sqrt(v.x*v.x + v.y*v.y + v.z*v.z);
+            if(len > 0.1f && len <= 1.0f)
+                return { v.x / len, v.y / len, v.z / len };
+        }
+    }
+
+    LR::ShadingMaterial RandomMaterial()
+    {
+        LR::ShadingMaterial mat;
+        mat.DiffuseAlbedo = { Random(0.0f, 1.0f), Random(0.0f, 1.0f), Random(0.0f, 1.0f), 1.0f };
+        float r0 = Random(0.01f, 0.2f);
+        mat.FresnelR0 = { r0, r0, r0 };
+        mat.Shininess = Random(0.05f, 0.95f);
+        return mat;
+    }
+
+    // Two directional, three point and two spot lights around the origin.  The
+    // samples lie within 12 units of it, so every local light leaves some of them
+    // out of range.
+    std::vector<Light> MakeLights()
+    {
+        std::vector<Light> lights(7);
+
+        lights[0].Direction = { 0.57735f, -0.57735f, 0.57735f };
+        lights[0].Strength = { 0.6f, 0.6f, 0.6f };
+        lights[1].Direction = { -0.70711f, -0.70711f, 0.0f };
+        lights[1].Strength = { 0.3f, 0.25f, 0.2f };
+
+        for(int i = 2; i < 7; ++i)
+        {
+            Light& L = lights[i];
+            L.Position = { Random(-6.0f, 6.0f), Random(0.0f, 4.0f), Random(-6.0f, 6.0f) };
+            L.Strength = { Random(0.5f, 1.0f), Random(0.5f, 1.0f), Random(0.5f, 1.0f) };
+            L.FalloffStart = Random(0.5f, 2.0f);
+            L.FalloffEnd = L.FalloffStart + Random(3.0f, 8.0f);
+            L.Direction = RandomUnit();
+            L.Direction.y = -std::fabs(L.Direction.y);
+            L.SpotPower = Random(1.0f, 16.0f);
+        }
+
+        return lights;
+    }
+
+    bool Near(float a, float b)
+    {
+        return std::fabs(a - b) <= Tolerance * std::fmax(1.0f, std::fabs(a));
+    }
+
+    bool Near(const XMFLOAT4& a, const XMFLOAT4& b)
+    {
+        return Near(a.x, b.x) && Near(a.y, b.y) && Near(a.z, b.z) && a.w == b.w;
+    }
+
+    float Distance(const XMFLOAT3& a, const XMFLOAT3& b)
+    {
+        float x = a.x - b.x, y = a.y - b.y, z = a.z - b.z;
+        return std::sqrt(x*x + y*y + z*z);
+    }
+
+    void TestMixedLights()
+    {
+        const std::vector<Light> lights = MakeLights();
+        const XMFLOAT3 eyePos = { 0.0f, 5.0f, -15.0f };
+        const XMFLOAT3 shadowFactor = { 0.5f, 1.0f, 1.0f };
+
+        int mismatches = 0;
+        int outOfRange = 0;
+        for(int batch = 0; batch < 256; ++batch)
+        {
+            LR::SampleBatch samples;
+            XMFLOAT4 expected[LR::BatchSize];
+
+            for(int i = 0; i < LR::BatchSize; ++i)
+            {
+                XMFLOAT3 pos = { Random(-12.0f, 12.0f), Random(-2.0f, 6.0f), Random(-12.0f, 12.0f) };
+                XMFLOAT3 normal = RandomUnit();
+                XMFLOAT3 toEye = { eyePos.x - pos.x, eyePos.y - pos.y, eyePos.z - pos.z };
+                float len = std::sqrt(toEye.x*toEye.x + toEye.y*toEye.y + toEye.z*toEye.z);
+                toEye = { toEye.x / len, toEye.y / len, toEye.z / len };
+                LR::ShadingMaterial mat = RandomMaterial();
+
+                samples.SetSample(i, pos, normal, toEye, mat);
+                expected[i] = LR::ComputeLighting(lights.data(), 2, 3, 2, mat, pos, normal, toEye, shadowFactor);
+
+                for(int l = 2; l < 7; ++l)
+                    outOfRange += Distance(lights[l].Position, pos) > lights[l].FalloffEnd ? 1 : 0;
+            }
+
+            LR::ColorBatch result;
+            LR::ComputeLighting8(lights.data(), 2, 3, 2, samples, result, shadowFactor);
+
+            for(int i = 0; i < LR::BatchSize; ++i)
+            {
+                if(!Near(expected[i], result.GetSample(i)))
+                    ++mismatches;
+            }
+        }
+
+        CHECK(mismatches == 0);
+
+        // Both sides of the range test were exercised.
+        CHECK(outOfRange > 256 * LR::BatchSize);
+        CHECK(outOfRange < 256 * LR::BatchSize * 5);
+    }
+
+    // A single local light with half the lanes out of range: those lanes get
+    // exactly nothing, and the others match the scalar result.
+    void TestOutOfRangeLanes()
+    {
+        for(int spot = 0; spot < 2; ++spot)
+        {
+            Light L;
+            L.Position = { 0.0f, 3.0f, 0.0f };
+            L.Direction = { 0.0f, -1.0f, 0.0f };
+            L.Strength = { 1.0f, 0.9f, 0.8f };
+            L.FalloffStart = 1.0f;
+            L.FalloffEnd = 5.0f;
+            L.SpotPower = 4.0f;
+
+            LR::ShadingMaterial mat;
+            const XMFLOAT3 normal = { 0.0f, 1.0f, 0.0f };
+            const XMFLOAT3 toEye = { 0.0f, 0.70711f, -0.70711f };
+
+            LR::SampleBatch samples;
+            XMFLOAT4 expected[LR::BatchSize];
+            for(int i = 0; i < LR::BatchSize; ++i)
+            {
+                // Odd lanes sit 1 to 3 units off the light's axis, even lanes 6 to 9.
+                float x = (i % 2 == 1) ? 1.0f + i * 0.25f : 6.0f + i * 0.4f;
+                XMFLOAT3 pos = { x, 0.0f, 0.0f };
+                samples.SetSample(i, pos, normal, toEye, mat);
+                expected[i] = spot ?
+                    LR::ComputeLighting(&L, 0, 0, 1, mat, pos, normal, toEye) :
+                    LR::ComputeLighting(&L, 0, 1, 0, mat, pos, normal, toEye);
+            }
+
+            LR::ColorBatch result;
+            LR::ComputeLighting8(&L, 0, spot ? 0 : 1, spot ? 1 : 0, samples, result);
+
+            for(int i = 0; i < LR::BatchSize; ++i)
+            {
+                XMFLOAT4 color = result.GetSample(i);
+                if(i % 2 == 0)
+                {
+                    CHECK(color.x == 0.0f && color.y == 0.0f && color.z == 0.0f);
+                    CHECK(expected[i].x == 0.0f && expected[i].y == 0.0f && expected[i].z == 0.0f);
+                }
+                else
+                {
+                    CHECK(color.x > 0.0f);
+                    CHECK(Near(expected[i], color));
+                }
+            }
+        }
+    }
+}
+
+int main()
+{
+    TestMixedLights();
+    TestOutOfRangeLanes();
+
+    return TestResult("LightingReferenceTest");
+}
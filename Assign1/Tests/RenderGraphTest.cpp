@@ -0,0 +1,291 @@
+//***************************************************************************************
+// RenderGraphTest.cpp
+//
+// Compiles and executes a RenderGraph against a mock CommandRecorder that logs the
+// barrier calls and pass executions, and checks pass culling, the batching of
+// transitions into one call per pass, the final-state restore of imported resources
+// and the DumpSchedule text.
+//***************************************************************************************
+
+#include "../Common/RenderGraph.h"
+#include "TestCheck.h"
+
+#include <stdexcept>
+
+namespace
+{
+    // Records ResourceBarrier calls, and pass executions through Mark, as lines of
+    // text; every other call is ignored.
+    class MockCommandList : public CommandRecorder
+    {
+    public:
+        std::vector<std::string> Events;
+        std::vector<std::vector<D3D12_RESOURCE_BARRIER>> BarrierCalls;
+        std::vector<ID3D12Resource*> Resources;
+        std::vector<std::string> ResourceNames;
+
+        void Mark(const std::string& pass) { Events.push_back("execute " + pass); }
+
+        void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* barriers) override
+        {
+            BarrierCalls.emplace_back(barriers, barriers + numBarriers);
+
+            std::string event = "barrier";
+            for(UINT i = 0; i < numBarriers; ++i)
+            {
+                const D3D12_RESOURCE_BARRIER& b = barriers[i];
+                if(b.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+                {
+                    event += " " + Name(b.UAV.pResource) + ":UAV";
+                }
+                else
+                {
+                    event += " " + Name(b.Transition.pResource) + ":" + std::to_string(b.Transition.StateBefore) +
+                        "->" + std::to_string(b.Transition.StateAfter);
+                }
+            }
+            Events.push_back(event);
+        }
+
+        void ClearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE, const FLOAT[4], UINT, const D3D12_RECT*) override {}
+        void ClearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE, D3D12_CLEAR_FLAGS, FLOAT, UINT8, UINT, const D3D12_RECT*) override {}
+        void RSSetViewports(UINT, const D3D12_VIEWPORT*) override {}
+        void RSSetScissorRects(UINT, const D3D12_RECT*) override {}
+        void OMSetRenderTargets(UINT, const D3D12_CPU_DESCRIPTOR_HANDLE*, BOOL, const D3D12_CPU_DESCRIPTOR_HANDLE*) override {}
+        void SetDescriptorHeaps(UINT, ID3D12DescriptorHeap* const*) override {}
+        void SetPipelineState(ID3D12PipelineState*) override {}
+        void SetGraphicsRootSignature(ID3D12RootSignature*) override {}
+        void SetGraphicsRootConstantBufferView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+        void SetGraphicsRootShaderResourceView(UINT, D3D12_GPU_VIRTUAL_ADDRESS) override {}
+        void SetGraphicsRoot32BitConstants(UINT, UINT, const void*, UINT) override {}
+        void IASetVertexBuffers(UINT, UINT, const D3D12_VERTEX_BUFFER_VIEW*) override {}
+        void IASetIndexBuffer(const D3D12_INDEX_BUFFER_VIEW*) override {}
+        void IASetPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY) override {}
+        void DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) override {}
+        void ExecuteIndirect(ID3D12CommandSignature*, UINT, ID3D12Resource*, UINT64, ID3D12Resource*, UINT64) override {}
+
+    private:
+        std::string Name(ID3D12Resource* resource)const
+        {
+            for(size_t i = 0; i < Resources.size(); ++i)
+            {
+                if(Resources[i] == resource)
+                    return ResourceNames[i];
+            }
+            return "?";
+        }
+    };
+
+    // Stand-ins for the D3D resources.  The graph only passes their addresses on.
+    char gResources[8];
+
+    std::string States(D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+    {
+        return std::to_string(before) + "->" + std::to_string(after);
+    }
+
+    // A shadow pass, a clear and an opaque pass that reach the back buffer, plus a
+    // debug pass and a blur of its output that nothing presents.
+    void TestFrame()
+    {
+        const D3D12_RESOURCE_STATES Present = D3D12_RESOURCE_STATE_PRESENT;
+        const D3D12_RESOURCE_STATES RenderTarget = D3D12_RESOURCE_STATE_RENDER_TARGET;
+        const D3D12_RESOURCE_STATES DepthWrite = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+        const D3D12_RESOURCE_STATES ShaderResource = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+        const D3D12_RESOURCE_STATES CopyDest = D3D12_RESOURCE_STATE_COPY_DEST;
+        const D3D12_RESOURCE_STATES Common = D3D12_RESOURCE_STATE_COMMON;
+
+        MockCommandList cmdList;
+        const char* names[] = { "BackBuffer", "Depth", "Shadow", "Lights", "DebugTarget", "Blurred" };
+        for(int i = 0; i < 6; ++i)
+        {
+            cmdList.Resources.push_back(reinterpret_cast<ID3D12Resource*>(&gResources[i]));
+            cmdList.ResourceNames.push_back(names[i]);
+        }
+
+        RenderGraph graph;
+        auto backBuffer = graph.ImportResource("BackBuffer", cmdList.Resources[0], Present, Present, true);
+        auto depth = graph.ImportResource("Depth", cmdList.Resources[1], DepthWrite, DepthWrite, false);
+        auto shadow = graph.ImportResource("Shadow", cmdList.Resources[2], Common, ShaderResource, false);
+        auto lights = graph.ImportResource("Lights", cmdList.Resources[3], CopyDest, CopyDest, false);
+        auto debugTarget = graph.ImportResource("DebugTarget", cmdList.Resources[4], Common, Common, false);
+        auto blurred = graph.ImportResource("Blurred", cmdList.Resources[5], Common, Common, false);
+
+        auto pass = [&](const char* name)
+        {
+            return graph.AddPass(name, [&cmdList, name](CommandRecorder*) { cmdList.Mark(name); });
+        };
+
+        auto shadowPass = pass("Shadow");
+        graph.Write(shadowPass, shadow, DepthWrite);
+
+        auto debugPass = pass("Debug");
+        graph.Write(debugPass, debugTarget, RenderTarget);
+
+        auto clearPass = pass("Clear");
+        graph.Write(clearPass, backBuffer, RenderTarget);
+        graph.Write(clearPass, depth, DepthWrite);
+
+        auto opaquePass = pass("Opaque");
+        graph.Read(opaquePass, shadow, ShaderResource);
+        graph.Read(opaquePass, lights, ShaderResource);
+        graph.Write(opaquePass, backBuffer, RenderTarget);
+        graph.Write(opaquePass, depth, DepthWrite);
+
+        auto blurPass = pass("Blur");
+        graph.Read(blurPass, debugTarget, ShaderResource);
+        graph.Write(blurPass, blurred, RenderTarget);
+
+        graph.Compile();
+        graph.Execute(&cmdList);
+
+        // Culling: Debug and Blur only feed each other.  Batching: each surviving
+        // pass gets at most one barrier call, holding all of its transitions.
+        // Restore: the back buffer and the lights go back to their final states; the
+        // shadow map already ends in its final state and gets no barrier.
+        std::vector<std::string> expected =
+        {
+            "barrier Shadow:" + States(Common, DepthWrite),
+            "execute Shadow",
+            "barrier BackBuffer:" + States(Present, RenderTarget),
+            "execute Clear",
+            "barrier Shadow:" + States(DepthWrite, ShaderResource) + " Lights:" + States(CopyDest, ShaderResource),
+            "execute Opaque",
+            "barrier BackBuffer:" + States(RenderTarget, Present) + " Lights:" + States(ShaderResource, CopyDest),
+        };
+        CHECK(cmdList.Events == expected);
+
+        for(const auto& call : cmdList.BarrierCalls)
+        {
+            for(const D3D12_RESOURCE_BARRIER& b : call)
+            {
+                CHECK(b.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION);
+                CHECK(b.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE);
+                CHECK(b.Transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+            }
+        }
+
+        const RenderGraph::Stats& stats = graph.GetStats();
+        CHECK(stats.Passes == 5);
+        CHECK(stats.CulledPasses == 2);
+        CHECK(stats.Transitions == 6);
+        CHECK(stats.BarrierCalls == 4);
+
+        const std::string expectedSchedule =
+            "    barrier Shadow COMMON -> DEPTH_WRITE\n"
+            "pass 0 Shadow\n"
+            "    write Shadow DEPTH_WRITE\n"
+            "pass 1 Debug (culled)\n"
+            "    barrier BackBuffer COMMON -> RENDER_TARGET\n"
+            "pass 2 Clear\n"
+            "    write BackBuffer RENDER_TARGET\n"
+            "    write Depth DEPTH_WRITE\n"
+            "    barrier Shadow DEPTH_WRITE -> PIXEL_SHADER_RESOURCE\n"
+            "    barrier Lights COPY_DEST -> PIXEL_SHADER_RESOURCE\n"
+            "pass 3 Opaque\n"
+            "    read Shadow PIXEL_SHADER_RESOURCE\n"
+            "    read Lights PIXEL_SHADER_RESOURCE\n"
+            "    write BackBuffer RENDER_TARGET\n"
+            "    write Depth DEPTH_WRITE\n"
+            "pass 4 Blur (culled)\n"
+            "end\n"
+            "    barrier BackBuffer RENDER_TARGET -> COMMON\n"
+            "    barrier Lights PIXEL_SHADER_RESOURCE -> COPY_DEST\n";
+        CHECK(graph.DumpSchedule() == expectedSchedule);
+
+        // Executing again records the same thing; the schedule is compiled once.
+        MockCommandList again;
+        again.Resources = cmdList.Resources;
+        again.ResourceNames = cmdList.ResourceNames;
+        graph.Execute(&again);
+        CHECK(again.BarrierCalls.size() == cmdList.BarrierCalls.size());
+    }
+
+    // Back to back unordered access writes get a UAV barrier, and reads in
+    // read-only states combine without another transition.
+    void TestUavAndCombinedReads()
+    {
+        const D3D12_RESOURCE_STATES Uav = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+
+        MockCommandList cmdList;
+        cmdList.Resources = { reinterpret_cast<ID3D12Resource*>(&gResources[0]) };
+        cmdList.ResourceNames = { "Particles" };
+
+        RenderGraph graph;
+        auto particles = graph.ImportResource("Particles", cmdList.Resources[0], D3D12_RESOURCE_STATE_COMMON,
+            D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, true);
+
+        auto simulate = graph.AddPass("Simulate", [&cmdList](CommandRecorder*) { cmdList.Mark("Simulate"); });
+        graph.Write(simulate, particles, Uav);
+        auto sort = graph.AddPass("Sort", [&cmdList](CommandRecorder*) { cmdList.Mark("Sort"); });
+        graph.Write(sort, particles, Uav);
+
+        graph.Compile();
+        graph.Execute(&cmdList);
+
+        std::vector<std::string> expected =
+        {
+            "barrier Particles:" + States(D3D12_RESOURCE_STATE_COMMON, Uav),
+            "execute Simulate",
+            "barrier Particles:UAV",
+            "execute Sort",
+            "barrier Particles:" + States(Uav,
+                D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE),
+        };
+        CHECK(cmdList.Events == expected);
+        CHECK(graph.GetStats().CulledPasses == 0);
+
+        // A second read in another read-only state merges into the first.
+        RenderGraph reads;
+        auto texture = reads.ImportResource("Texture", nullptr, D3D12_RESOURCE_STATE_COMMON,
+            D3D12_RESOURCE_STATE_COMMON, true);
+        auto draw = reads.AddPass("Draw", [](CommandRecorder*) {});
+        reads.Read(draw, texture, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        reads.Read(draw, texture, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+        reads.Write(draw, reads.ImportResource("Out", nullptr, D3D12_RESOURCE_STATE_RENDER_TARGET,
+            D3D12_RESOURCE_STATE_RENDER_TARGET, true), D3D12_RESOURCE_STATE_RENDER_TARGET);
+        reads.Compile();
+        CHECK(reads.DumpSchedule().find(
+            "read Texture NON_PIXEL_SHADER_RESOURCE|PIXEL_SHADER_RESOURCE\n") != std::string::npos);
+    }
+
+    void TestInvalidAccess()
+    {
+        RenderGraph graph;
+        auto target = graph.ImportResource("Target", nullptr, D3D12_RESOURCE_STATE_COMMON,
+            D3D12_RESOURCE_STATE_COMMON, true);
+        auto pass = graph.AddPass("Pass", [](CommandRecorder*) {});
+        graph.Write(pass, target, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+        bool threw = false;
+        try
+        {
+            graph.Write(pass, target, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+        }
+        catch(const std::invalid_argument&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+
+        threw = false;
+        try
+        {
+            graph.Read(pass, target + 1, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+        }
+        catch(const std::invalid_argument&)
+        {
+            threw = true;
+        }
+        CHECK(threw);
+    }
+}
+
+int main()
+{
+    TestFrame();
+    TestUavAndCombinedReads();
+    TestInvalidAccess();
+
+    return TestResult("RenderGraphTest");
+}
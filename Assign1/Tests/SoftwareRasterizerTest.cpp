@@ -0,0 +1,421 @@
+//***************************************************************************************
+// SoftwareRasterizerTest.cpp
+//
+// Renders fixed scenes with SoftwareRasterizer.  An unlit scene drawn straight in
+// clip space has a known image: the depth test, back-face culling, clipping against
+// the near and far planes and the fill rule decide every pixel, so the color hash
+// and the depth image are checked exactly.  A lit scene in perspective is checked
+// against LightingReference at one pixel, and both scenes must come out the same
+// with no thread pool, with a ThreadPool and with other tile sizes.
+//***************************************************************************************
+
+#include "../Common/SoftwareRasterizer.h"
+#include "../Common/ThreadPool.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    const UINT Size = 64;
+
+    // Extra data after the position and normal, as a textured vertex has.
+    struct TexVertex
+    {
+        XMFLOAT3 Pos;
+        XMFLOAT3 Normal;
+        float TexC[2];
+    };
+
+    struct Vertex
+    {
+        XMFLOAT3 Pos;
+        XMFLOAT3 Normal;
+    };
+
+    XMFLOAT4X4 Identity()
+    {
+        XMFLOAT4X4 m;
+        for(int i = 0; i < 4; ++i)
+            for(int j = 0; j < 4; ++j)
+                m.m[i][j] = i == j ? 1.0f : 0.0f;
+        return m;
+    }
+
+    std::uint32_t Pack(int r, int g, int b, int a)
+    {
+        return (std::uint32_t)r | ((std::uint32_t)g << 8) | ((std::uint32_t)b << 16) | ((std::uint32_t)a << 24);
+    }
+
+    std::uint64_t Hash(const std::vector<std::uint32_t>& color)
+    {
+        const BYTE* bytes = reinterpret_cast<const BYTE*>(color.data());
+        std::uint64_t hash = 14695981039346656037ull;
+        for(size_t i = 0; i < color.size()*sizeof(std::uint32_t); ++i)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    LightingReference::ShadingMaterial Material(float r, float g, float b)
+    {
+        LightingReference::ShadingMaterial mat;
+        mat.DiffuseAlbedo = { r, g, b, 1.0f };
+        return mat;
+    }
+
+    // The unlit scene, in clip space with w = 1.  Quads are clockwise on screen.
+    struct UnlitScene
+    {
+        std::vector<TexVertex> Vertices;
+        std::vector<std::uint16_t> Indices;
+        std::vector<SoftwareRasterizer::DrawCall> Draws;
+
+        // A quad over [x0, x1] x [y0, y1] whose depth goes from zLeft to zRight.
+        // Each quad's vertices and indices start where the last one's end, and the
+        // draw finds them through its base vertex and start index.
+        void AddQuad(float x0, float y0, float x1, float y1, float zLeft, float zRight,
+            const LightingReference::ShadingMaterial& mat, bool backFacing = false)
+        {
+            SoftwareRasterizer::DrawCall draw;
+            draw.StartIndexLocation = (UINT)Indices.size();
+            draw.BaseVertexLocation = (int)Vertices.size();
+            draw.IndexCount = 6;
+            draw.World = Identity();
+            draw.Material = mat;
+            Draws.push_back(draw);
+
+            const XMFLOAT3 normal = { 0.0f, 0.0f, -1.0f };
+            Vertices.push_back({ { x0, y1, zLeft }, normal, { 0.0f, 0.0f } });
+            Vertices.push_back({ { x1, y1, zRight }, normal, { 1.0f, 0.0f } });
+            Vertices.push_back({ { x1, y0, zRight }, normal, { 1.0f, 1.0f } });
+            Vertices.push_back({ { x0, y0, zLeft }, normal, { 0.0f, 1.0f } });
+
+            const std::uint16_t front[6] = { 0, 1, 2, 0, 2, 3 };
+            const std::uint16_t back[6] = { 0, 2, 1, 0, 3, 2 };
+            Indices.insert(Indices.end(), backFacing ? back : front, (backFacing ? back : front) + 6);
+        }
+
+        std::vector<SoftwareRasterizer::DrawCall> GetDraws()const
+        {
+            std::vector<SoftwareRasterizer::DrawCall> draws = Draws;
+            for(SoftwareRasterizer::DrawCall& draw : draws)
+            {
+                draw.VertexData = Vertices.data();
+                draw.VertexBufferByteSize = (UINT)(Vertices.size()*sizeof(TexVertex));
+                draw.VertexByteStride = sizeof(TexVertex);
+                draw.IndexData = Indices.data();
+                draw.IndexBufferByteSize = (UINT)(Indices.size()*sizeof(std::uint16_t));
+                draw.IndexFormat = DXGI_FORMAT_R16_UINT;
+            }
+            return draws;
+        }
+    };
+
+    UnlitScene BuildUnlitScene()
+    {
+        UnlitScene scene;
+
+        // Drawn first, so the far quad fails the depth test where they overlap.
+        scene.AddQuad(0.0f, 0.0f, 1.0f, 1.0f, 0.25f, 0.25f, Material(1.0f, 0.0f, 0.0f));
+        scene.AddQuad(-0.5f, -0.5f, 0.5f, 0.5f, 0.75f, 0.75f, Material(0.0f, 0.0f, 1.0f));
+
+        // Nearest of all but facing away.
+        scene.AddQuad(-1.0f, -1.0f, 1.0f, 1.0f, 0.1f, 0.1f, Material(1.0f, 1.0f, 1.0f), true);
+
+        // Crosses the near plane at x = 7.2 pixels and the far plane at x = 15.2.
+        scene.AddQuad(-1.0f, -1.0f, -0.5f, -0.5f, -0.9f, 1.1f, Material(1.0f, 1.0f, 0.0f));
+        return scene;
+    }
+
+    // What the unlit scene must look like: ambient light times the albedo, or the
+    // clear color.
+    void ExpectedUnlitImage(std::vector<std::uint32_t>& color, std::vector<float>& depth)
+    {
+        color.assign(Size*Size, Pack(0, 128, 0, 255));
+        depth.assign(Size*Size, 1.0f);
+        for(UINT y = 0; y < Size; ++y)
+        {
+            for(UINT x = 0; x < Size; ++x)
+            {
+                const UINT pixel = y*Size + x;
+                if(x >= 32 && y < 32)
+                {
+                    color[pixel] = Pack(255, 0, 0, 255);
+                    depth[pixel] = 0.25f;
+                }
+                else if(x >= 16 && x < 48 && y >= 16 && y < 48)
+                {
+                    color[pixel] = Pack(0, 0, 255, 255);
+                    depth[pixel] = 0.75f;
+                }
+                else if(x >= 7 && x < 15 && y >= 48)
+                {
+                    color[pixel] = Pack(255, 255, 0, 255);
+                    depth[pixel] = -0.9f + 2.0f*(x + 0.5f)/16.0f;
+                }
+            }
+        }
+    }
+
+    struct Image
+    {
+        std::uint64_t Hash = 0;
+        std::vector<std::uint32_t> Color;
+        std::vector<float> Depth;
+        SoftwareRasterizer::Stats Stats;
+    };
+
+    Image Render(ThreadPool* pool, UINT tileSize, const SoftwareRasterizer::PassData& pass,
+        const Light* lights, int numDir, int numPoint, int numSpot,
+        const std::vector<SoftwareRasterizer::DrawCall>& draws)
+    {
+        SoftwareRasterizer rasterizer(Size, Size, pool, tileSize);
+        rasterizer.Clear({ 0.0f, 0.5f, 0.0f, 1.0f });
+        rasterizer.Draw(pass, lights, numDir, numPoint, numSpot, draws);
+
+        Image image;
+        image.Hash = rasterizer.ColorHash();
+        image.Color = rasterizer.GetColor();
+        image.Depth = rasterizer.GetDepth();
+        image.Stats = rasterizer.GetStats();
+        return image;
+    }
+
+    void CheckSame(const Image& a, const Image& b)
+    {
+        CHECK(a.Hash == b.Hash);
+        CHECK(a.Color == b.Color);
+        CHECK(a.Depth == b.Depth);
+        CHECK(a.Stats.Triangles == b.Stats.Triangles);
+        CHECK(a.Stats.CulledTriangles == b.Stats.CulledTriangles);
+        CHECK(a.Stats.ClippedTriangles == b.Stats.ClippedTriangles);
+        CHECK(a.Stats.PixelsTested == b.Stats.PixelsTested);
+        CHECK(a.Stats.PixelsShaded == b.Stats.PixelsShaded);
+    }
+
+    void TestUnlitScene(ThreadPool& pool)
+    {
+        const UnlitScene scene = BuildUnlitScene();
+        const std::vector<SoftwareRasterizer::DrawCall> draws = scene.GetDraws();
+
+        SoftwareRasterizer::PassData pass;
+        pass.ViewProj = Identity();
+        pass.AmbientLight = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+        std::vector<std::uint32_t> expectedColor;
+        std::vector<float> expectedDepth;
+        ExpectedUnlitImage(expectedColor, expectedDepth);
+
+        const Image image = Render(nullptr, SoftwareRasterizer::DefaultTileSize, pass, nullptr, 0, 0, 0, draws);
+        CHECK(image.Color == expectedColor);
+        CHECK(image.Hash == Hash(expectedColor));
+
+        // Vertices snap to 1/256 pixel, which moves the sloped quad's depth by up to
+        // half a step of its 1/8 per pixel slope.
+        bool depthMatches = true;
+        for(UINT i = 0; i < Size*Size; ++i)
+        {
+            const bool sloped = expectedColor[i] == Pack(255, 255, 0, 255);
+            const float tolerance = sloped ? 0.125f / 512.0f : 1e-6f;
+            depthMatches = depthMatches && std::fabs(image.Depth[i] - expectedDepth[i]) <= tolerance;
+        }
+        CHECK(depthMatches);
+
+        const SoftwareRasterizer::Stats& stats = image.Stats;
+        CHECK(stats.Triangles == 8);
+        CHECK(stats.CulledTriangles == 2);
+        CHECK(stats.ClippedTriangles == 2);
+        CHECK(stats.PixelsTested == 32*32 + 32*32 + 8*16);
+        CHECK(stats.PixelsShaded == 32*32 + (32*32 - 16*16) + 8*16);
+
+        CheckSame(image, Render(&pool, SoftwareRasterizer::DefaultTileSize, pass, nullptr, 0, 0, 0, draws));
+        CheckSame(image, Render(&pool, 16, pass, nullptr, 0, 0, 0, draws));
+        CheckSame(image, Render(nullptr, 7, pass, nullptr, 0, 0, 0, draws));
+    }
+
+    // A left-handed perspective projection looking down +z, as uploaded (transposed).
+    XMFLOAT4X4 Perspective(float scale, float nearZ, float farZ)
+    {
+        XMFLOAT4X4 m;
+        for(int i = 0; i < 4; ++i)
+            for(int j = 0; j < 4; ++j)
+                m.m[i][j] = 0.0f;
+        m.m[0][0] = scale;
+        m.m[1][1] = scale;
+        m.m[2][2] = farZ / (farZ - nearZ);
+        m.m[2][3] = -nearZ*farZ / (farZ - nearZ);
+        m.m[3][2] = 1.0f;
+        return m;
+    }
+
+    // A lit quad at z = 10 in front of enough random triangles to need several
+    // batches, through 32-bit indices and a translated world matrix.
+    void TestLitScene(ThreadPool& pool)
+    {
+        const float ProjScale = 1.5f;
+        const float QuadZ = 10.0f;
+
+        std::vector<Vertex> vertices;
+        std::vector<std::uint32_t> indices;
+
+        // The quad is built around the origin and moved to QuadZ by its world matrix.
+        const XMFLOAT3 toCamera = { 0.0f, 0.0f, -1.0f };
+        vertices.push_back({ { -2.0f, 2.0f, 0.0f }, toCamera });
+        vertices.push_back({ { 2.0f, 2.0f, 0.0f }, toCamera });
+        vertices.push_back({ { 2.0f, -2.0f, 0.0f }, toCamera });
+        vertices.push_back({ { -2.0f, -2.0f, 0.0f }, toCamera });
+        indices.insert(indices.end(), { 0, 1, 2, 0, 2, 3 });
+
+        std::mt19937 random(99);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        const UINT triangleCount = 3*SoftwareRasterizer::MaxBatchTriangles / 2;
+        for(UINT i = 0; i < triangleCount; ++i)
+        {
+            XMFLOAT3 center = { unit(random)*12.0f, unit(random)*12.0f, 16.0f + unit(random)*4.0f };
+            XMFLOAT3 normal = { unit(random), unit(random), -1.0f };
+            for(int k = 0; k < 3; ++k)
+            {
+                XMFLOAT3 pos = { center.x + unit(random), center.y + unit(random), center.z + unit(random) };
+                indices.push_back((std::uint32_t)vertices.size());
+                vertices.push_back({ pos, normal });
+            }
+        }
+
+        Light lights[3];
+        lights[0].Direction = { 0.3f, -0.5f, 0.8f };
+        lights[0].Strength = { 0.6f, 0.6f, 0.6f };
+        lights[1].Position = { 1.0f, 1.0f, 8.0f };
+        lights[1].Strength = { 0.8f, 0.5f, 0.2f };
+        lights[1].FalloffEnd = 20.0f;
+        lights[2].Position = { 0.0f, 0.0f, 0.0f };
+        lights[2].Direction = { 0.0f, 0.0f, 1.0f };
+        lights[2].Strength = { 0.2f, 0.4f, 0.9f };
+        lights[2].FalloffEnd = 40.0f;
+        lights[2].SpotPower = 8.0f;
+
+        SoftwareRasterizer::PassData pass;
+        pass.ViewProj = Perspective(ProjScale, 1.0f, 100.0f);
+        pass.AmbientLight = { 0.25f, 0.25f, 0.35f, 1.0f };
+
+        SoftwareRasterizer::DrawCall draw;
+        draw.VertexData = vertices.data();
+        draw.VertexBufferByteSize = (UINT)(vertices.size()*sizeof(Vertex));
+        draw.VertexByteStride = sizeof(Vertex);
+        draw.IndexData = indices.data();
+        draw.IndexBufferByteSize = (UINT)(indices.size()*sizeof(std::uint32_t));
+        draw.IndexFormat = DXGI_FORMAT_R32_UINT;
+
+        std::vector<SoftwareRasterizer::DrawCall> draws(2, draw);
+        draws[0].IndexCount = 6;
+        draws[0].World = Identity();
+        draws[0].World.m[2][3] = QuadZ;   // Transposed, so the translation is the last column.
+        draws[0].Material = Material(0.8f, 0.7f, 0.6f);
+        draws[0].Material.FresnelR0 = { 0.05f, 0.05f, 0.05f };
+        draws[0].Material.Shininess = 0.7f;
+        draws[1].StartIndexLocation = 6;
+        draws[1].IndexCount = triangleCount*3;
+        draws[1].World = Identity();
+        draws[1].Material = Material(0.3f, 0.9f, 0.4f);
+
+        const Image image = Render(nullptr, SoftwareRasterizer::DefaultTileSize, pass, lights, 1, 1, 1, draws);
+        CHECK(image.Stats.Triangles == 2 + triangleCount);
+        CHECK(image.Stats.PixelsShaded > 0);
+
+        // The pixel at the center sees the quad.  Shade its sample with the scalar
+        // reference and compare.
+        const UINT px = Size / 2, py = Size / 2;
+        const float ndcX = 2.0f*(px + 0.5f) / Size - 1.0f;
+        const float ndcY = 1.0f - 2.0f*(py + 0.5f) / Size;
+        const XMFLOAT3 pos = { ndcX*QuadZ / ProjScale, ndcY*QuadZ / ProjScale, QuadZ };
+        const float length = std::sqrt(pos.x*pos.x + pos.y*pos.y + pos.z*pos.z);
+        const XMFLOAT3 toEye = { -pos.x / length, -pos.y / length, -pos.z / length };
+
+        const LightingReference::ShadingMaterial& mat = draws[0].Material;
+        const XMFLOAT4 lit = LightingReference::ComputeLighting(lights, 1, 1, 1, mat, pos, toCamera, toEye);
+        const std::uint32_t texel = image.Color[py*Size + px];
+        const float expected[3] =
+        {
+            pass.AmbientLight.x*mat.DiffuseAlbedo.x + lit.x,
+            pass.AmbientLight.y*mat.DiffuseAlbedo.y + lit.y,
+            pass.AmbientLight.z*mat.DiffuseAlbedo.z + lit.z,
+        };
+        for(int c = 0; c < 3; ++c)
+        {
+            const int actual = (int)((texel >> (8*c)) & 0xff);
+            const int wanted = (int)(std::min(std::max(expected[c], 0.0f), 1.0f)*255.0f + 0.5f);
+            CHECK(std::abs(actual - wanted) <= 1);
+        }
+        CHECK(std::fabs(image.Depth[py*Size + px] - (100.0f / 99.0f)*(1.0f - 1.0f / QuadZ)) < 1e-5f);
+
+        CheckSame(image, Render(&pool, SoftwareRasterizer::DefaultTileSize, pass, lights, 1, 1, 1, draws));
+        CheckSame(image, Render(&pool, 16, pass, lights, 1, 1, 1, draws));
+        CheckSame(image, Render(nullptr, 7, pass, lights, 1, 1, 1, draws));
+    }
+
+    bool Throws(ThreadPool* pool, const std::vector<SoftwareRasterizer::DrawCall>& draws)
+    {
+        SoftwareRasterizer::PassData pass;
+        pass.ViewProj = Identity();
+        SoftwareRasterizer rasterizer(Size, Size, pool);
+        try
+        {
+            rasterizer.Draw(pass, nullptr, 0, 0, 0, draws);
+        }
+        catch(const std::invalid_argument&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    void TestMalformed(ThreadPool& pool)
+    {
+        const UnlitScene scene = BuildUnlitScene();
+        std::vector<SoftwareRasterizer::DrawCall> draws = scene.GetDraws();
+        CHECK(!Throws(&pool, draws));
+
+        // Past the end of the indices.
+        draws.back().IndexCount = 9;
+        CHECK(Throws(&pool, draws));
+
+        // Past the end of the vertices, found by the batch setup on a worker.
+        draws = scene.GetDraws();
+        draws.back().BaseVertexLocation += 1;
+        CHECK(Throws(&pool, draws));
+        CHECK(Throws(nullptr, draws));
+
+        // Before the start of them.
+        draws = scene.GetDraws();
+        draws[0].BaseVertexLocation = -1;
+        CHECK(Throws(nullptr, draws));
+
+        draws = scene.GetDraws();
+        draws[0].VertexByteStride = sizeof(XMFLOAT3);
+        CHECK(Throws(nullptr, draws));
+
+        draws = scene.GetDraws();
+        draws[0].IndexFormat = DXGI_FORMAT_UNKNOWN;
+        CHECK(Throws(nullptr, draws));
+    }
+}
+
+int main()
+{
+    ThreadPool pool(4);
+
+    TestUnlitScene(pool);
+    TestLitScene(pool);
+    TestMalformed(pool);
+
+    return TestResult("SoftwareRasterizerTest");
+}
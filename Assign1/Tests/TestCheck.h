@@ -0,0 +1,36 @@
+//***************************************************************************************
+// TestCheck.h
+//
+// Minimal checking for the headless tests: CHECK reports a failed condition with its
+// location and counts it, and TestResult() turns the count into the exit code.
+//***************************************************************************************
+
+#pragma once
+
+#include <cstdio>
+
+inline int& TestFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                            \
+    do                                                                              \
+    {                                                                               \
+        if(!(condition))                                                            \
+        {                                                                           \
+            std::printf("%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++TestFailures();                                                       \
+        }                                                                           \
+    } while(false)
+
+inline int TestResult(const char* name)
+{
+    if(TestFailures() == 0)
+        std::printf("%s: passed\n", name);
+    else
+        std::printf("%s: %d check(s) failed\n", name, TestFailures());
+
+    return TestFailures() == 0 ? 0 : 1;
+}